@@ -11,7 +11,7 @@ category_sets = make_category_sets( f, iters );
 
 common_inputs = make_common_inputs( params );
 
-methods = { 'hash', 'cust', 'sort' };
+methods = { 'hash', 'cust', 'sort', 'radix', 'dense', 'auto' };
 results = cell( numel(methods), 1 );
 
 for i = 1:numel(methods)
@@ -29,9 +29,16 @@ cat_build( {...
     , 'cat_requirecat.cpp' ...
     , 'cat_findallc.cpp' ...
     , 'cat_findall.cpp' ...
+    , 'cat_findallgroups.cpp' ...
+    , 'cat_findallnested.cpp' ...
+    , 'cat_findallcids.cpp' ...
     , 'cat_size.cpp' ...
     , 'cat_append.cpp' ...
+    , 'cat_appendmany.cpp' ...
     , 'cat_find.cpp' ...
+    , 'cat_findbatch.cpp' ...
+    , 'cat_findexpr.cpp' ...
+    , 'cat_countrows.cpp' ...
     , 'cat_fullcat.cpp' ...
     , 'cat_incat.cpp' ...
     , 'cat_keep.cpp' ...
@@ -265,13 +265,18 @@ classdef fcat < handle
       %
       %     See also fcat/keepeach, fcat/findall, fcat/count
       
-      if ( nargout == 1 )
-        I = findall( obj, categories );
+      if ( nargout < 2 )
+        c = double( cat_api('count_rows', obj.id, categories) );
       else
-        [I, C] = findall( obj, categories );
+        [c, C] = cat_api( 'count_rows', obj.id, categories );
+        c = double( c );
+        
+        if ( ~ischar(categories) && numel(categories) > 0 )
+          C = reshape( C, numel(categories), numel(C) / numel(categories) );
+        else
+          C = C(:)';
+        end
       end
-      
-      c = cellfun( @numel, I );
     end
     
     function obj = resize(obj, to)
@@ -1050,6 +1055,126 @@ classdef fcat < handle
       end
     end
     
+    function [I, offsets, G] = findallflat(obj, categories, inds)
+      
+      %   FINDALLFLAT -- Find indices of combinations of labels in 
+      %     categories, as a single index vector.
+      %
+      %     [I, offsets] = findallflat( obj, categories ) returns the same 
+      %     groups of row indices as findall( obj, categories ), but 
+      %     concatenated into the uint64 vector `I`. The indices of the 
+      %     i-th group are I(offsets(i)+1:offsets(i+1)), such that 
+      %     `offsets` has one more element than there are groups. This 
+      %     avoids building a cell array, which is costly when there are
+      %     many groups.
+      %
+      %     [..., G] = findallflat( ... ) also returns `G`, the group of 
+      %     each row searched.
+      %
+      %     [...] = findallflat( ..., inds ) searches the subset of rows 
+      %     given by the uint64 index vector `inds`.
+      %
+      %     EX //
+      %
+      %     f = fcat.example();
+      %     [I, offsets] = findallflat( f, {'dose', 'roi'} );
+      %
+      %     See also fcat/findall, fcat/countrows
+      
+      if ( nargin < 3 )
+        args = { obj.id, categories };
+      else
+        args = { obj.id, categories, uint64(inds) };
+      end
+      
+      if ( nargout > 2 )
+        [I, offsets, G] = cat_api( 'find_all_groups', args{:} );
+      else
+        [I, offsets] = cat_api( 'find_all_groups', args{:} );
+      end
+    end
+    
+    function [I, offsets, parents, C] = findallnested(obj, levels, inds)
+      
+      %   FINDALLNESTED -- Find indices of combinations of labels in 
+      %     nested levels of categories.
+      %
+      %     [I, offsets] = findallnested( obj, levels ), where `levels` is 
+      %     a cell array of cell arrays of strings, groups rows by the 
+      %     categories in levels{1}, then splits each group by the 
+      %     categories in levels{2}, and so on, in a single call. Rows are 
+      %     concatenated into the uint64 vector `I`. `offsets{k}` gives 
+      %     the groups of the k-th level: the indices of the i-th group 
+      %     are I(offsets{k}(i)+1:offsets{k}(i+1)). The groups of a level 
+      %     are ordered by their parent group, then by first appearance, 
+      %     such that the rows and subgroups of each group are contiguous.
+      %
+      %     [..., parents] = findallnested( ... ) also returns, for each 
+      %     level k > 1, the group of level k-1 containing each group of 
+      %     level k. parents{1} is empty.
+      %
+      %     [..., C] = findallnested( ... ) also returns, for each level 
+      %     k, the labels of each group in the categories of levels{k}, 
+      %     with one column per group.
+      %
+      %     [...] = findallnested( ..., inds ) searches the subset of 
+      %     rows given by the uint64 index vector `inds`.
+      %
+      %     EX //
+      %
+      %     f = fcat.example();
+      %     [I, offsets, parents] = findallnested( f, {{'dose'}, {'roi'}} );
+      %
+      %     See also fcat/findallflat, fcat/findall
+      
+      if ( nargin < 3 )
+        args = { obj.id, levels };
+      else
+        args = { obj.id, levels, uint64(inds) };
+      end
+      
+      if ( nargout > 3 )
+        [I, offsets, parents, C] = cat_api( 'find_all_nested', args{:} );
+      elseif ( nargout > 2 )
+        [I, offsets, parents] = cat_api( 'find_all_nested', args{:} );
+      else
+        [I, offsets] = cat_api( 'find_all_nested', args{:} );
+      end
+    end
+    
+    function [I, ids, labels] = findallids(obj, categories, inds)
+      
+      %   FINDALLIDS -- Find indices of combinations of labels in 
+      %     categories, identifying each combination by label ids.
+      %
+      %     [I, ids, labels] = findallids( obj, categories ) returns the 
+      %     same Mx1 cell array of uint64 index vectors `I` as findall. 
+      %     `ids` is an MxN uint32 matrix of M combinations by N 
+      %     categories, and `labels` is a cell array of strings, such 
+      %     that labels(ids(i, :)) are the labels used to generate the 
+      %     i-th index of I. Only the distinct labels are created, making 
+      %     this cheaper than findall when there are many combinations.
+      %
+      %     [...] = findallids( ..., inds ) searches the subset of rows 
+      %     given by the uint64 index vector `inds`.
+      %
+      %     EX //
+      %
+      %     f = fcat.example();
+      %     [I, ids, labels] = findallids( f, {'dose', 'roi'} );
+      %     C = labels(ids)';
+      %
+      %     See also fcat/findall, fcat/findallflat
+      
+      if ( nargin < 3 )
+        args = { obj.id, categories };
+      else
+        args = { obj.id, categories, uint64(inds) };
+      end
+      
+      [I, ids, labels] = cat_api( 'find_allc_ids', args{:} );
+    end
+    
     function I = findall_or_one(obj, varargin)
       
       %   FINDALL_OR_ONE -- Find indices of combinations of labels in 
@@ -1148,6 +1273,35 @@ classdef fcat < handle
       end
     end
     
+    function I = findbatch(obj, label_sets, inds)
+      
+      %   FINDBATCH -- Find indices of rows matching each of several label
+      %     combinations.
+      %
+      %     I = findbatch( obj, label_sets ) returns a cell array `I` with 
+      %     one element per element of `label_sets`, a cell array whose 
+      %     elements are char vectors or cell arrays of strings. `I{i}` is 
+      %     the same as find( obj, label_sets{i} ). The columns of `obj` 
+      %     are scanned once for all label combinations, making `findbatch` 
+      %     faster than calling `find` for each combination.
+      %
+      %     I = findbatch( ..., inds ) restricts the search to the subset 
+      %     of rows identified by the uint64 index vector `inds`.
+      %
+      %     EX //
+      %
+      %     f = fcat.create( 'a', {'a', 'b'}, 'c', {'c', 'd'} )
+      %     findbatch( f, {{'a'}, {'b', 'd'}, 'c'} )
+      %
+      %     See also fcat/find, fcat/findall
+      
+      if ( nargin < 3 )
+        I = cat_api( 'find_batch', obj.id, label_sets );
+      else
+        I = cat_api( 'find_batch', obj.id, label_sets, uint64(inds) );
+      end
+    end
+    
     function I = findor(obj, labels, inds)
       
       %   FINDOR -- Find indices of rows matching any among labels.
@@ -1818,7 +1972,7 @@ classdef fcat < handle
       n = cat_api( 'prune', obj.id );
     end
     
-    function obj = append(obj, B, inds)
+    function obj = append(obj, B, varargin)
       
       %   APPEND -- Append another fcat object.
       %
@@ -1829,6 +1983,11 @@ classdef fcat < handle
       %     equivalent to append( A, B(inds) ), but is generally much
       %     faster, since it avoids copying `B`.
       %
+      %     append( ..., 'move' ) takes the contents of `B` rather than
+      %     copying them, where possible. Use this when `B` is no longer
+      %     needed, e.g., when building up `A` from freshly created parts.
+      %     `B` is left empty if its contents were taken.
+      %
       %     Categories must match between objects; labels shared between 
       %     objects must reside in consistent categories.
       %
@@ -1841,10 +2000,12 @@ classdef fcat < handle
         error( 'Cannot append objects of class "%s".', class(B) );
       end
       
-      if ( nargin == 2 )
-        cat_api( 'append', obj.id, B.id );
+      [varargin, op] = fcat.parse_move_flag( varargin, 'append' );
+      
+      if ( isempty(varargin) )
+        cat_api( op, obj.id, B.id );
       else
-        cat_api( 'append', obj.id, B.id, uint64(inds) );
+        cat_api( op, obj.id, B.id, uint64(varargin{1}) );
       end
     end
     
@@ -1909,6 +2070,9 @@ classdef fcat < handle
       %     above. Categories shared between B, C ... are set to the 
       %     contents of the right-most argument.
       %
+      %     merge( ..., 'move' ) takes the contents of B, C ... rather
+      %     than copying them, where possible, leaving them empty.
+      %
       %     EX //
       %
       %     A = fcat.create( 'date', datestr(now) );
@@ -1922,6 +2086,7 @@ classdef fcat < handle
         error( 'Cannot merge objects of class "%s".', class(obj) );
       end
       
+      [varargin, op] = fcat.parse_move_flag( varargin, 'merge' );
       N = numel( varargin );
       
       for i = 1:N
@@ -1931,7 +2096,7 @@ classdef fcat < handle
           error( 'Cannot merge objects of class "%s".', class(b_obj) );
         end
         
-        cat_api( 'merge', uint32(0), obj.id, varargin{i}.id );
+        cat_api( op, uint32(0), obj.id, varargin{i}.id );
       end
     end
     
@@ -1950,6 +2115,9 @@ classdef fcat < handle
       %     join( A, B, C ... ) adds the contents of B, C ... into A, 
       %     as above.
       %
+      %     join( ..., 'move' ) takes the contents of B, C ... rather than
+      %     copying them, where possible, leaving them empty.
+      %
       %     EX //
       %
       %     A = fcat.create( 'date', datestr(now), 'city', 'Buffalo' );
@@ -1964,6 +2132,7 @@ classdef fcat < handle
         error( 'Cannot join objects of class "%s".', class(obj) );
       end
       
+      [varargin, op] = fcat.parse_move_flag( varargin, 'merge' );
       N = numel( varargin );
       
       for i = 1:N
@@ -1973,7 +2142,7 @@ classdef fcat < handle
           error( 'Cannot join objects of class "%s".', class(b_obj) );
         end
         
-        cat_api( 'merge', uint32(1), obj.id, b_obj.id );
+        cat_api( op, uint32(1), obj.id, b_obj.id );
       end
     end
     
@@ -2015,11 +2184,27 @@ classdef fcat < handle
       %
       %     Note that A will be modified unless explicitly copied. 
       %
+      %     All objects are appended in a single operation, which is much 
+      %     faster than appending them one at a time. If any object cannot 
+      %     be appended, A is unchanged.
+      %
       %     See also fcat/append
       
+      if ( ~isa(obj, 'fcat') )
+        error( 'Cannot append objects of class "%s".', class(obj) );
+      end
+      
+      ids = cell( size(varargin) );
+      
       for i = 1:numel(varargin)
-        append( obj, varargin{i} );
+        if ( ~isa(varargin{i}, 'fcat') )
+          error( 'Cannot append objects of class "%s".', class(varargin{i}) );
+        end
+        
+        ids{i} = varargin{i}.id;
       end
+      
+      cat_api( 'append_many', obj.id, ids );
     end
     
     function obj = horzcat(obj, varargin)
@@ -2036,7 +2221,7 @@ classdef fcat < handle
       end
     end
     
-    function obj = assign(obj, B, to_indices, from_indices)
+    function obj = assign(obj, B, to_indices, varargin)
       
       %   ASSIGN -- Assign contents of other fcat at indices.
       %
@@ -2049,6 +2234,11 @@ classdef fcat < handle
       %     is a scalar, the single row is implicitly repeated to match 
       %     the number of destination indices `di`.
       %
+      %     assign( ..., 'move' ) takes the contents of `B` rather than
+      %     copying them, where possible. This is the case when `B` derives
+      %     from `obj` (e.g., B = copy(obj)) and replaces every row of `obj`
+      %     in order. `B` is left empty if its contents were taken.
+      %
       %     See also fcat/setcat, fcat/fcat
       
       if ( ~isa(obj, 'fcat') )
@@ -2058,10 +2248,12 @@ classdef fcat < handle
         error( 'Cannot assign objects of class "%s".', class(B) );
       end
       
-      if ( nargin == 3 )
-        cat_api( 'assign', obj.id, B.id, uint64(to_indices) );
+      [varargin, op] = fcat.parse_move_flag( varargin, 'assign' );
+      
+      if ( isempty(varargin) )
+        cat_api( op, obj.id, B.id, uint64(to_indices) );
       else
-        cat_api( 'assign', obj.id, B.id, uint64(to_indices), uint64(from_indices) );
+        cat_api( op, obj.id, B.id, uint64(to_indices), uint64(varargin{1}) );
       end
     end
     
@@ -2103,6 +2295,11 @@ classdef fcat < handle
        
       %   COPY -- Create a copy of the current instance.
       %
+      %     The copy shares its contents with `obj` until either object
+      %     is modified, so copying is cheap regardless of the size of
+      %     `obj`. Only the parts of an object that are modified are
+      %     then copied.
+      %
       %     See also fcat/fcat
       
       B = fcat( cat_api('copy', obj.id) );
@@ -2594,6 +2791,26 @@ classdef fcat < handle
   
   methods (Static = true, Access = private)
     
+    function [inputs, op] = parse_move_flag(inputs, op)
+      
+      %   PARSE_MOVE_FLAG -- Remove trailing 'move' flag from inputs.
+      %
+      %     If the last of `inputs` is the char flag 'move', it is removed,
+      %     and `op` is replaced by its counterpart that takes the contents
+      %     of its source.
+      
+      if ( isempty(inputs) || ~ischar(inputs{end}) )
+        return
+      end
+      
+      if ( ~strcmp(inputs{end}, 'move') )
+        error( 'Unrecognized flag "%s"; expected "move".', inputs{end} );
+      end
+      
+      inputs(end) = [];
+      op = sprintf( '%s_move', op );
+    end
+    
     function [cats, mask_a, apply_mask_a, mask_b, apply_mask_b] = ...
         parse_set_membership_function_inputs(a, b, inputs, output_indices)
       
@@ -3051,6 +3268,10 @@ classdef fcat < handle
       %     M2 = fcat.mask( f, M, @find, {'low', 'saline'}, @findnot, 'outdoors' );
       %     isequal( M1, M2 )
       %
+      %     When every function is one of fcat/find, fcat/findor, 
+      %     fcat/findnot and fcat/findnone, the chain is evaluated in a 
+      %     single pass, without materializing intermediate masks.
+      %
       %     See also fcat/find, fcat/findor, fcat/findnone, fcat/findnot
       
       if ( ~fcat.is(obj) )
@@ -3081,6 +3302,20 @@ classdef fcat < handle
         end
       end
 
+      find_ids = find_function_ids( varargin(start:2:N) );
+      
+      if ( ~isempty(find_ids) )
+        label_sets = varargin(start+1:2:N);
+        
+        if ( begin_with_mask )
+          mask = cat_api( 'find_expr', obj.id, find_ids, label_sets, mask );
+        else
+          mask = cat_api( 'find_expr', obj.id, find_ids, label_sets );
+        end
+        
+        return;
+      end
+
       for i = start:2:N
         func = varargin{i};
         labs = varargin{i+1};
@@ -3099,6 +3334,30 @@ classdef fcat < handle
           throw( err );
         end
       end
+      
+      function ids = find_function_ids(funcs)
+        %   FIND_FUNCTION_IDS -- Ids of the find functions of the `find`
+        %     op, or [] if any function is not one of them.
+        
+        names = { 'find', 'findnot', 'findor', 'findnone' };
+        ids = zeros( numel(funcs), 1, 'uint32' );
+        
+        for j = 1:numel(funcs)
+          if ( ~isa(funcs{j}, 'function_handle') )
+            ids = [];
+            return;
+          end
+          
+          idx = find( strcmp(names, func2str(funcs{j})) );
+          
+          if ( isempty(idx) )
+            ids = [];
+            return;
+          end
+          
+          ids(j) = uint32( idx - 1 );
+        end
+      end
     end
     
     function [out, ia, ib] = intersect(a, b, varargin)
@@ -9,13 +9,21 @@ namespace util {
             {"destroy",                 &util::destroy},
             {"find_allc",               &util::find_allc},
             {"find_all",                &util::find_all},
+            {"find_all_groups",         &util::find_all_groups},
+            {"find_all_nested",         &util::find_all_nested},
+            {"find_allc_ids",           &util::find_allc_ids},
             {"set_cat",                 &util::set_category},
             {"require_cat",             &util::require_category},
             {"size",                    &util::size},
             {"get_labs",                &util::get_labels},
             {"get_cats",                &util::get_categories},
             {"append",                  &util::append},
+            {"append_many",             &util::append_many},
+            {"append_move",             &util::append_move},
             {"find",                    &util::find},
+            {"find_batch",              &util::find_batch},
+            {"find_expr",               &util::find_expr},
+            {"count_rows",              &util::count_rows},
             {"full_cat",                &util::full_category},
             {"in_cat",                  &util::in_category},
             {"keep",                    &util::keep},
@@ -35,6 +43,7 @@ namespace util {
             {"n_cats",                  &util::n_categories},
             {"n_labs",                  &util::n_labels},
             {"assign",                  &util::assign},
+            {"assign_move",             &util::assign_move},
             {"set_cats",                &util::set_categories},
             {"prune",                   &util::prune},
             {"count",                   &util::count},
@@ -47,6 +56,7 @@ namespace util {
             {"from_categorical",        &util::from_categorical},
             {"replace",                 &util::replace},
             {"merge",                   &util::merge},
+            {"merge_move",              &util::merge_move},
             {"remove",                  &util::remove_labels},
             {"rename_cat",              &util::rename_category},
             {"append_one",              &util::append_one},
@@ -16,9 +16,13 @@ namespace util {
     MEXFUNC(copy);
     
     MEXFUNC(merge);
+    MEXFUNC(merge_move);
     MEXFUNC(append);
     MEXFUNC(append_one);
+    MEXFUNC(append_many);
+    MEXFUNC(append_move);
     MEXFUNC(assign);
+    MEXFUNC(assign_move);
     MEXFUNC(prune);
     
     MEXFUNC(replace);
@@ -60,8 +64,14 @@ namespace util {
     
     MEXFUNC(count);
     MEXFUNC(find);
+    MEXFUNC(find_batch);
+    MEXFUNC(find_expr);
+    MEXFUNC(count_rows);
     MEXFUNC(find_all);
     MEXFUNC(find_allc);
+    MEXFUNC(find_all_groups);
+    MEXFUNC(find_all_nested);
+    MEXFUNC(find_allc_ids);
     
     MEXFUNC(to_numeric_matrix);
     MEXFUNC(from_categorical);
@@ -1,57 +1,71 @@
 #include "cat_api.hpp"
 
-void util::append(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+namespace
 {
-    using util::u32;
-    using util::u64;
-    
-    const char* func_id = "categorical:append";
-    
-    util::assert_nrhs(3, 4, nrhs, func_id);
-    util::assert_nlhs(nlhs, 0, func_id);
-    
-    util::categorical* cat_a = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
-    util::categorical* cat_b = util::detail::mat_to_ptr<util::categorical>(prhs[2]);
-    
-    u32 status;
-    
-    if (nrhs == 3)
-    {
-        status = cat_a->append(*cat_b);
-    }
-    else
+    //  append_impl: Append b to a. If `take` is true, b's storage is taken
+    //      where possible; see categorical::append.
+    void append_impl(int nlhs, int nrhs, const mxArray *prhs[], bool take, const char* func_id)
     {
-        u64 index_offset = 1;
+        using util::u32;
+        using util::u64;
         
-        std::vector<u64> indices = util::numeric_array_to_vector64(prhs[3], func_id);
+        util::assert_nrhs(3, 4, nrhs, func_id);
+        util::assert_nlhs(nlhs, 0, func_id);
         
-        status = cat_a->append(*cat_b, indices, index_offset);
-    }
-    
-    if (status == util::categorical_status::OK)
-    {
-        return;
-    }
-    
-    if (status == util::categorical_status::CATEGORIES_DO_NOT_MATCH)
-    {
-        mexErrMsgIdAndTxt(func_id, "Categories do not match.");
-    }
-    
-    if (status == util::categorical_status::CAT_OVERFLOW)
-    {
-        mexErrMsgIdAndTxt(func_id, "Append operation would result in overflow.");
-    }
-    
-    if (status == util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY)
-    {
-        mexErrMsgIdAndTxt(func_id, util::get_error_text_label_exists().c_str());
-    }
-    
-    if (status == util::categorical_status::OUT_OF_BOUNDS)
-    {
-        mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+        util::categorical* cat_a = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+        util::categorical* cat_b = util::detail::mat_to_ptr<util::categorical>(prhs[2]);
+        
+        u32 status;
+        
+        if (nrhs == 3)
+        {
+            status = take ? cat_a->append(std::move(*cat_b)) : cat_a->append(*cat_b);
+        }
+        else
+        {
+            u64 index_offset = 1;
+            
+            std::vector<u64> indices = util::numeric_array_to_vector64(prhs[3], func_id);
+            
+            status = take ? cat_a->append(std::move(*cat_b), indices, index_offset) :
+                cat_a->append(*cat_b, indices, index_offset);
+        }
+        
+        if (status == util::categorical_status::OK)
+        {
+            return;
+        }
+        
+        if (status == util::categorical_status::CATEGORIES_DO_NOT_MATCH)
+        {
+            mexErrMsgIdAndTxt(func_id, "Categories do not match.");
+        }
+        
+        if (status == util::categorical_status::CAT_OVERFLOW)
+        {
+            mexErrMsgIdAndTxt(func_id, "Append operation would result in overflow.");
+        }
+        
+        if (status == util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY)
+        {
+            mexErrMsgIdAndTxt(func_id, util::get_error_text_label_exists().c_str());
+        }
+        
+        if (status == util::categorical_status::OUT_OF_BOUNDS)
+        {
+            mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+        }
+        
+        mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
     }
-    
-    mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
-}
\ No newline at end of file
+}
+
+void util::append(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    append_impl(nlhs, nrhs, prhs, false, "categorical:append");
+}
+
+void util::append_move(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    append_impl(nlhs, nrhs, prhs, true, "categorical:append_move");
+}
@@ -0,0 +1,56 @@
+#include "cat_api.hpp"
+
+void util::append_many(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    using util::u32;
+    using util::u64;
+    
+    const char* func_id = "categorical:append_many";
+    
+    util::assert_nrhs(nrhs, 3, func_id);
+    util::assert_nlhs(nlhs, 0, func_id);
+    
+    util::categorical* cat = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+    
+    if (!mxIsCell(prhs[2]))
+    {
+        mexErrMsgIdAndTxt(func_id, "Objects to append must be given as a cell array of handles.");
+    }
+    
+    const u64 n_others = mxGetNumberOfElements(prhs[2]);
+    std::vector<const util::categorical*> others(n_others);
+    
+    for (u64 i = 0; i < n_others; i++)
+    {
+        others[i] = util::detail::mat_to_ptr<util::categorical>(mxGetCell(prhs[2], i));
+    }
+    
+    const u32 status = cat->append_many(others);
+    
+    if (status == util::categorical_status::OK)
+    {
+        return;
+    }
+    
+    if (status == util::categorical_status::CATEGORIES_DO_NOT_MATCH)
+    {
+        mexErrMsgIdAndTxt(func_id, "Categories do not match.");
+    }
+    
+    if (status == util::categorical_status::CAT_OVERFLOW)
+    {
+        mexErrMsgIdAndTxt(func_id, "Append operation would result in overflow.");
+    }
+    
+    if (status == util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY)
+    {
+        mexErrMsgIdAndTxt(func_id, util::get_error_text_label_exists().c_str());
+    }
+    
+    if (status == util::categorical_status::COLLAPSED_EXPRESSION_IN_WRONG_CATEGORY)
+    {
+        mexErrMsgIdAndTxt(func_id, "A collapsed expression is present in the wrong category.");
+    }
+    
+    mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
+}
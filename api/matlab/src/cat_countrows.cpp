@@ -0,0 +1,57 @@
+#include "cat_api.hpp"
+
+void util::count_rows(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    using util::u64;
+    
+    const char* func_id = "categorical:count_rows";
+    
+    util::assert_nrhs(3, 4, nrhs, func_id);
+    util::assert_nlhs(nlhs, 2, func_id);
+    
+    const util::categorical* cat = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+    const std::vector<std::string> categories = util::get_strings(prhs[2], func_id);
+    
+    u64 index_offset = 1; //  indices start at 1.
+    
+    util::combination_counts_t result;
+    
+    if (nrhs == 3)
+    {
+        result = cat->combination_counts(categories);
+    }
+    else
+    {
+        u32 status;
+        
+        const std::vector<u64> indices = util::numeric_array_to_vector64(prhs[3], func_id);
+        
+        result = cat->combination_counts(categories, indices, &status, index_offset);
+        
+        if (status != util::categorical_status::OK)
+        {
+            if (status == util::categorical_status::OUT_OF_BOUNDS)
+            {
+                mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+            }
+            
+            mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
+        }
+    }
+    
+    const u64 n_labels = result.combinations.size();
+    
+    plhs[0] = util::numeric_vector_to_array(result.counts, mxUINT64_CLASS);
+    
+    if (nlhs > 1)
+    {
+        mxArray* all_combs = mxCreateCellMatrix(n_labels, 1);
+        
+        for (u64 i = 0; i < n_labels; i++)
+        {
+            mxSetCell(all_combs, i, mxCreateString(result.combinations[i].c_str()));
+        }
+        
+        plhs[1] = all_combs;
+    }
+}
@@ -10,7 +10,7 @@ namespace
     
     util::categorical::find_all_method get_method(const char* func_id, const mxArray* array)
     {
-        char method_str[5];
+        char method_str[6];
 
         if (mxGetString(array, method_str, sizeof(method_str)))
         {
@@ -29,6 +29,18 @@ namespace
         {
             return util::categorical::find_all_method::custom_hash;
         }
+        else if (std::strcmp("radix", method_str) == 0)
+        {
+            return util::categorical::find_all_method::radix;
+        }
+        else if (std::strcmp("dense", method_str) == 0)
+        {
+            return util::categorical::find_all_method::dense_key;
+        }
+        else if (std::strcmp("auto", method_str) == 0)
+        {
+            return util::categorical::find_all_method::automatic;
+        }
         else
         {
             mexErrMsgIdAndTxt(func_id, "Unrecognized method specifier.");
@@ -0,0 +1,78 @@
+#include "cat_api.hpp"
+#include <algorithm>
+
+void util::find_allc_ids(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    using util::u64;
+    using util::u32;
+    
+    const char* func_id = "categorical:find_allc_ids";
+    
+    util::assert_nrhs(3, 4, nrhs, func_id);
+    util::assert_nlhs(nlhs, 3, func_id);
+    
+    const util::categorical* cat = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+    const std::vector<std::string> categories = util::get_strings(prhs[2], func_id);
+    
+    const u64 index_offset = 1; //  indices start at 1.
+    
+    util::combination_ids_t result;
+    
+    if (nrhs == 3)
+    {
+        result = cat->find_allc_ids(categories, index_offset);
+    }
+    else
+    {
+        u32 status;
+        const std::vector<u64> indices = util::double_or_uint64_array_to_vector64(prhs[3], func_id);
+        
+        result = cat->find_allc_ids(categories, indices, &status, index_offset);
+        
+        if (status != util::categorical_status::OK)
+        {
+            if (status == util::categorical_status::OUT_OF_BOUNDS)
+            {
+                mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+            }
+            
+            mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
+        }
+    }
+    
+    const u64 n_groups = result.offsets.empty() ? 0 : result.offsets.size() - 1;
+    const u64 n_cats = n_groups == 0 ? 0 : result.ids.size() / n_groups;
+    
+    mxArray* all_indices = mxCreateCellMatrix(n_groups, 1);
+    
+    for (u64 i = 0; i < n_groups; i++)
+    {
+        const auto begin = result.indices.begin();
+        const std::vector<u64> c_inds(begin + result.offsets[i], begin + result.offsets[i + 1]);
+        
+        mxSetCell(all_indices, i, util::numeric_vector_to_array(c_inds, mxUINT64_CLASS));
+    }
+    
+    plhs[0] = all_indices;
+    
+    if (nlhs > 1)
+    {
+        //  ids become 1-based positions into the returned labels.
+        const std::vector<u32>& label_ids = result.labels.ids;
+        mxArray* ids = mxCreateUninitNumericMatrix(n_groups, n_cats, mxUINT32_CLASS, mxREAL);
+        u32* data = (u32*) mxGetData(ids);
+        
+        for (u64 i = 0; i < result.ids.size(); i++)
+        {
+            const auto it = std::lower_bound(label_ids.begin(), label_ids.end(), result.ids[i]);
+            data[i] = u32(it - label_ids.begin()) + 1;
+        }
+        
+        plhs[1] = ids;
+    }
+    
+    if (nlhs > 2)
+    {
+        plhs[2] = util::string_vector_to_array(result.labels.labels);
+    }
+}
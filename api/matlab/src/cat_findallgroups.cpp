@@ -0,0 +1,59 @@
+#include "cat_api.hpp"
+
+void util::find_all_groups(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    using util::u64;
+    
+    const char* func_id = "categorical:find_all_groups";
+    
+    util::assert_nrhs(3, 4, nrhs, func_id);
+    util::assert_nlhs(nlhs, 3, func_id);
+    
+    const util::categorical* cat = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+    const std::vector<std::string> categories = util::get_strings(prhs[2], func_id);
+    
+    const u64 index_offset = 1; //  indices start at 1.
+    const auto ids = nlhs > 2 ? util::with_group_ids::yes : util::with_group_ids::no;
+    
+    util::groups_t result;
+    
+    if (nrhs == 3)
+    {
+        result = cat->find_all_groups(categories, index_offset, ids);
+    }
+    else
+    {
+        u32 status;
+        const std::vector<u64> indices = util::double_or_uint64_array_to_vector64(prhs[3], func_id);
+        
+        result = cat->find_all_groups(categories, indices, &status, index_offset, ids);
+        
+        if (status != util::categorical_status::OK)
+        {
+            if (status == util::categorical_status::OUT_OF_BOUNDS)
+            {
+                mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+            }
+            
+            mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
+        }
+    }
+    
+    plhs[0] = util::numeric_vector_to_array(result.indices, mxUINT64_CLASS);
+    
+    if (nlhs > 1)
+    {
+        plhs[1] = util::numeric_vector_to_array(result.offsets, mxUINT64_CLASS);
+    }
+    
+    if (nlhs > 2)
+    {
+        //  group ids start at 1.
+        for (auto& id : result.group_ids)
+        {
+            id++;
+        }
+        
+        plhs[2] = util::numeric_vector_to_array(result.group_ids, mxUINT64_CLASS);
+    }
+}
@@ -0,0 +1,124 @@
+#include "cat_api.hpp"
+
+namespace
+{
+    std::vector<std::vector<std::string>> get_levels(const mxArray* array, const char* func_id)
+    {
+        if (!mxIsCell(array))
+        {
+            mexErrMsgIdAndTxt(func_id, "Levels must be a cell array of cell arrays of strings.");
+        }
+        
+        const util::u64 n_levels = mxGetNumberOfElements(array);
+        std::vector<std::vector<std::string>> levels(n_levels);
+        
+        for (util::u64 i = 0; i < n_levels; i++)
+        {
+            const mxArray* level = mxGetCell(array, i);
+            
+            if (level != nullptr && mxGetNumberOfElements(level) > 0)
+            {
+                levels[i] = util::get_strings(level, func_id);
+            }
+        }
+        
+        return levels;
+    }
+}
+
+void util::find_all_nested(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    using util::u64;
+    
+    const char* func_id = "categorical:find_all_nested";
+    
+    util::assert_nrhs(3, 4, nrhs, func_id);
+    util::assert_nlhs(nlhs, 4, func_id);
+    
+    const util::categorical* cat = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+    const std::vector<std::vector<std::string>> levels = get_levels(prhs[2], func_id);
+    
+    const u64 index_offset = 1; //  indices start at 1.
+    
+    util::nested_groups_t result;
+    
+    if (nrhs == 3)
+    {
+        result = cat->find_all_nested(levels, index_offset);
+    }
+    else
+    {
+        u32 status;
+        const std::vector<u64> indices = util::double_or_uint64_array_to_vector64(prhs[3], func_id);
+        
+        result = cat->find_all_nested(levels, indices, &status, index_offset);
+        
+        if (status != util::categorical_status::OK)
+        {
+            if (status == util::categorical_status::OUT_OF_BOUNDS)
+            {
+                mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+            }
+            
+            mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
+        }
+    }
+    
+    const u64 n_levels = result.offsets.size();
+    
+    plhs[0] = util::numeric_vector_to_array(result.indices, mxUINT64_CLASS);
+    
+    if (nlhs > 1)
+    {
+        mxArray* offsets = mxCreateCellMatrix(n_levels, 1);
+        
+        for (u64 i = 0; i < n_levels; i++)
+        {
+            mxSetCell(offsets, i, util::numeric_vector_to_array(result.offsets[i], mxUINT64_CLASS));
+        }
+        
+        plhs[1] = offsets;
+    }
+    
+    if (nlhs > 2)
+    {
+        mxArray* parents = mxCreateCellMatrix(n_levels, 1);
+        
+        for (u64 i = 0; i < n_levels; i++)
+        {
+            //  parent groups start at 1.
+            for (auto& parent : result.parents[i])
+            {
+                parent++;
+            }
+            
+            mxSetCell(parents, i, util::numeric_vector_to_array(result.parents[i], mxUINT64_CLASS));
+        }
+        
+        plhs[2] = parents;
+    }
+    
+    if (nlhs > 3)
+    {
+        mxArray* combinations = mxCreateCellMatrix(n_levels, 1);
+        
+        for (u64 i = 0; i < n_levels; i++)
+        {
+            //  one column of labels per group.
+            const u64 n_cats = levels[i].size();
+            const u64 n_groups = result.offsets[i].size() - 1;
+            const std::vector<std::string>& labels = result.combinations[i];
+            
+            mxArray* level = mxCreateCellMatrix(n_cats, n_groups);
+            
+            for (u64 j = 0; j < labels.size(); j++)
+            {
+                mxSetCell(level, j, mxCreateString(labels[j].c_str()));
+            }
+            
+            mxSetCell(combinations, i, level);
+        }
+        
+        plhs[3] = combinations;
+    }
+}
@@ -0,0 +1,72 @@
+#include "cat_api.hpp"
+
+namespace
+{
+    std::vector<std::vector<std::string>> get_label_sets(const mxArray* array, const char* func_id)
+    {
+        if (mxGetClassID(array) != mxCELL_CLASS)
+        {
+            mexErrMsgIdAndTxt(func_id, "Label sets must be a cell array of cell arrays of strings.");
+        }
+        
+        const size_t n_sets = mxGetNumberOfElements(array);
+        std::vector<std::vector<std::string>> label_sets(n_sets);
+        
+        for (size_t i = 0; i < n_sets; i++)
+        {
+            label_sets[i] = util::get_strings(mxGetCell(array, i), func_id);
+        }
+        
+        return label_sets;
+    }
+}
+
+void util::find_batch(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    using util::u64;
+    using util::u32;
+    
+    const char* func_id = "categorical:find_batch";
+    
+    util::assert_nrhs(3, 4, nrhs, func_id);
+    util::assert_nlhs(nlhs, 1, func_id);
+    
+    const util::categorical* cat = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+    const std::vector<std::vector<std::string>> label_sets = get_label_sets(prhs[2], func_id);
+    
+    const u64 index_offset = 1;
+    
+    std::vector<std::vector<u64>> result;
+    
+    if (nrhs == 3)
+    {
+        result = cat->find_batch(label_sets, index_offset);
+    }
+    else
+    {
+        u32 status;
+        const std::vector<u64> indices = util::numeric_array_to_vector64(prhs[3], func_id);
+        
+        result = cat->find_batch(label_sets, indices, &status, index_offset);
+        
+        if (status != util::categorical_status::OK)
+        {
+            if (status == util::categorical_status::OUT_OF_BOUNDS)
+            {
+                mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+            }
+            
+            mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
+        }
+    }
+    
+    const u64 n_sets = result.size();
+    mxArray* all_indices = mxCreateCellMatrix(n_sets, 1);
+    
+    for (u64 i = 0; i < n_sets; i++)
+    {
+        mxSetCell(all_indices, i, util::numeric_vector_to_array(result[i], mxUINT64_CLASS));
+    }
+    
+    plhs[0] = all_indices;
+}
@@ -0,0 +1,105 @@
+#include "cat_api.hpp"
+
+namespace
+{
+    //  make_find_term: Term of the expression for one find function, with the
+    //      same ids as the `find` op.
+    util::query_expr make_find_term(util::u32 find_func_id,
+                                    const std::vector<std::string>& labels,
+                                    const char* func_id)
+    {
+        using util::query_expr;
+        
+        switch (find_func_id)
+        {
+            case 0:
+                return query_expr::find(labels);
+            case 1:
+                return query_expr::negate(query_expr::find(labels));
+            case 2:
+                return query_expr::find_or(labels);
+            case 3:
+                return query_expr::negate(query_expr::find_or(labels));
+            default:
+                mexErrMsgIdAndTxt(func_id, "Unrecognized find function id.");
+                //  Unreachable.
+                return query_expr::find(labels);
+        }
+    }
+    
+    util::query_expr get_find_terms(const mxArray* func_ids_array,
+                                    const mxArray* label_sets_array,
+                                    const char* func_id)
+    {
+        const std::vector<util::u32> find_func_ids = util::numeric_array_to_vector32(func_ids_array, func_id);
+        
+        if (mxGetClassID(label_sets_array) != mxCELL_CLASS)
+        {
+            mexErrMsgIdAndTxt(func_id, "Label sets must be a cell array of cell arrays of strings.");
+        }
+        
+        const size_t n_terms = find_func_ids.size();
+        
+        if (mxGetNumberOfElements(label_sets_array) != n_terms)
+        {
+            mexErrMsgIdAndTxt(func_id, "Number of label sets must match number of find function ids.");
+        }
+        
+        std::vector<util::query_expr> terms;
+        terms.reserve(n_terms);
+        
+        for (size_t i = 0; i < n_terms; i++)
+        {
+            const std::vector<std::string> labels = util::get_strings(mxGetCell(label_sets_array, i), func_id);
+            terms.push_back(make_find_term(find_func_ids[i], labels, func_id));
+        }
+        
+        return util::query_expr::all_of(std::move(terms));
+    }
+}
+
+//  find_expr: Rows matching every one of a chain of find functions, each
+//      given by the id it has in the `find` op and a set of labels, evaluated
+//      with a single call to categorical::find_expr.
+
+void util::find_expr(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    using util::u64;
+    using util::u32;
+    
+    const char* func_id = "categorical:find_expr";
+    
+    util::assert_nrhs(4, 5, nrhs, func_id);
+    util::assert_nlhs(nlhs, 1, func_id);
+    
+    const util::categorical* cat = util::detail::mat_to_ptr<util::categorical>(prhs[1]);
+    const util::query_expr expr = get_find_terms(prhs[2], prhs[3], func_id);
+    
+    const u64 index_offset = 1;
+    
+    std::vector<u64> result;
+    
+    if (nrhs == 4)
+    {
+        result = cat->find_expr(expr, index_offset);
+    }
+    else
+    {
+        u32 status;
+        const std::vector<u64> indices = util::numeric_array_to_vector64(prhs[4], func_id);
+        
+        result = cat->find_expr(expr, indices, &status, index_offset);
+        
+        if (status != util::categorical_status::OK)
+        {
+            if (status == util::categorical_status::OUT_OF_BOUNDS)
+            {
+                mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
+            }
+            
+            mexErrMsgIdAndTxt(func_id, "An unknown error occurred.");
+        }
+    }
+    
+    plhs[0] = util::numeric_vector_to_array(result, mxUINT64_CLASS);
+}
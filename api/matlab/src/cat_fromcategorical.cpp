@@ -28,7 +28,7 @@ void util::from_matlab_categorical(util::categorical* self,
     {
         const std::string& category = categories[i];
         
-        std::vector<u32>& dest = self->m_labels[i];
+        util::label_column& dest = self->m_labels[i];
         
         for (u64 j = 0; j < rows; j++)
         {
@@ -43,14 +43,14 @@ void util::from_matlab_categorical(util::categorical* self,
                             get_error_text_label_exists().c_str());
                 }
                 
-                dest[j] = val;
+                dest.set(j, val);
                 
                 continue;
             }
             
             const std::string& lab = labels[val-1];
 
-            if (self->m_collapsed_expressions.count(lab) > 0)
+            if (self->m_collapsed_expressions->count(lab) > 0)
             {
                 if (self->get_collapsed_expression(category) != lab)
                 {
@@ -60,14 +60,16 @@ void util::from_matlab_categorical(util::categorical* self,
                 }
             }
 
-            self->m_label_ids.insert(lab, val);
-            self->m_in_category[lab] = category;
+            self->m_label_ids.mutate().insert(lab, val);
+            self->m_in_category.mutate()[lab] = category;
 
             visited[val] = i;
             
-            dest[j] = val;
+            dest.set(j, val);
         }
     }
+    
+    self->rebuild_label_id_allocator();
 }
 
 void util::from_categorical(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
@@ -14,7 +14,7 @@ namespace {
         bool all_exist;
 
         util::labels_t labs = cat->get_labels_and_ids();
-        vector<const vector<u32>*> all_ids = cat->get_label_mat(cats, &all_exist);
+        vector<const util::label_column*> all_ids = cat->get_label_mat(cats, &all_exist);
         
         if (!all_exist)
         {
@@ -30,10 +30,7 @@ namespace {
 
         for (u64 i = 0; i < n_cats; i++)
         {
-            const vector<u32>* col = all_ids[i];
-            const u32* src = col->data();
-
-            std::memcpy(data + i * sz, src, sz * sizeof(u32));
+            all_ids[i]->copy_to(data + i * sz);
         }
 
         plhs[0] = mat;
@@ -56,7 +53,7 @@ namespace {
         bool all_exist;
 
         util::labels_t labs = cat->get_labels_and_ids();
-        vector<const vector<u32>*> all_ids = cat->get_label_mat(cats, &all_exist);
+        vector<const util::label_column*> all_ids = cat->get_label_mat(cats, &all_exist);
         
         if (!all_exist)
         {
@@ -74,8 +71,7 @@ namespace {
 
         for (u64 i = 0; i < n_cats; i++)
         {
-            const vector<u32>* col = all_ids[i];
-            const u32* src = col->data();
+            const util::label_column& col = *all_ids[i];
             
             for (u64 j = 0; j < n_indices; j++)
             {
@@ -88,7 +84,7 @@ namespace {
                     mexErrMsgIdAndTxt(func_id, "Indices exceed categorical dimensions.");
                 }
                 
-                data[assign_idx] = src[idx-1];
+                data[assign_idx] = col[idx-1];
                 
                 assign_idx++;
             }
@@ -63,7 +63,17 @@ namespace util {
         static constexpr uint32_t GET_VERSION = 56u;
         static constexpr uint32_t ADD_LABEL = 57u;
         static constexpr uint32_t UNION = 58u;
+        static constexpr uint32_t FIND_BATCH = 59u;
+        static constexpr uint32_t COUNT_ROWS = 60u;
+        static constexpr uint32_t FIND_ALL_GROUPS = 61u;
+        static constexpr uint32_t FIND_ALL_NESTED = 62u;
+        static constexpr uint32_t FIND_ALLC_IDS = 63u;
+        static constexpr uint32_t APPEND_MANY = 64u;
+        static constexpr uint32_t APPEND_MOVE = 65u;
+        static constexpr uint32_t ASSIGN_MOVE = 66u;
+        static constexpr uint32_t MERGE_MOVE = 67u;
+        static constexpr uint32_t FIND_EXPR = 68u;
         //
-        static constexpr uint32_t N_OPS = 59u;
+        static constexpr uint32_t N_OPS = 69u;
     }
 }
\ No newline at end of file
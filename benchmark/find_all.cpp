@@ -0,0 +1,174 @@
+//
+//  find_all.cpp
+//  categorical
+//
+
+//  Time each find_all method over a grid of row counts, numbers of categories
+//  and labels per category, and suggest the thresholds of
+//  find_all_method::automatic in config.hpp.
+
+#include "categorical.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <limits>
+
+namespace
+{
+    using util::categorical;
+    using util::u64;
+    
+    struct method_info
+    {
+        categorical::find_all_method method;
+        const char* name;
+    };
+    
+    categorical make_categorical(u64 rows, u64 n_cats, u64 n_labels, std::vector<std::string>& cats)
+    {
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<u64> dist(0, n_labels - 1);
+        
+        categorical cat;
+        cats.clear();
+        
+        for (u64 i = 0; i < n_cats; i++)
+        {
+            const std::string category = "cat" + std::to_string(i);
+            std::vector<std::string> labels(n_labels);
+            std::vector<std::string> column(rows);
+            
+            for (u64 j = 0; j < n_labels; j++)
+            {
+                labels[j] = category + "_" + std::to_string(j);
+            }
+            
+            for (u64 j = 0; j < rows; j++)
+            {
+                column[j] = labels[dist(rng)];
+            }
+            
+            cat.require_category(category);
+            cat.set_category(category, column);
+            cats.push_back(category);
+        }
+        
+        return cat;
+    }
+    
+    double time_method(const categorical& cat, const std::vector<std::string>& cats, categorical::find_all_method method)
+    {
+        const u64 iters = 3;
+        double best = std::numeric_limits<double>::max();
+        
+        for (u64 i = 0; i < iters; i++)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            const auto groups = cat.find_all_groups(method, cats);
+            const auto t1 = std::chrono::steady_clock::now();
+            
+            best = std::min(best, std::chrono::duration<double, std::milli>(t1 - t0).count());
+        }
+        
+        return best;
+    }
+}
+
+int main()
+{
+    const std::vector<method_info> methods{
+        {categorical::find_all_method::hash, "hash"},
+        {categorical::find_all_method::custom_hash, "custom_hash"},
+        {categorical::find_all_method::sort, "sort"},
+        {categorical::find_all_method::radix, "radix"},
+        {categorical::find_all_method::dense_key, "dense_key"},
+        {categorical::find_all_method::automatic, "automatic"}
+    };
+    
+    const std::vector<u64> row_counts{1000, 10000, 100000, 1000000};
+    const std::vector<u64> cat_counts{1, 2, 4};
+    const std::vector<u64> label_counts{4, 64, 4096};
+    
+    //  smallest row count from which radix beat custom_hash, in total over the
+    //  configurations too large for dense_key. The automatic method restores the
+    //  order of first appearance after sorting, in about the time of a second
+    //  sort, so radix time is counted twice.
+    u64 radix_min_rows = std::numeric_limits<u64>::max();
+    
+    std::cout << std::setw(8) << "rows" << std::setw(6) << "cats" << std::setw(8) << "labels";
+    
+    for (const auto& info : methods)
+    {
+        std::cout << std::setw(13) << info.name;
+    }
+    
+    std::cout << std::endl;
+    
+    for (auto it = row_counts.rbegin(); it != row_counts.rend(); ++it)
+    {
+        const u64 rows = *it;
+        double radix_total = 0.0;
+        double custom_hash_total = 0.0;
+        
+        for (const u64 n_cats : cat_counts)
+        {
+            for (const u64 n_labels : label_counts)
+            {
+                std::vector<std::string> cats;
+                const categorical cat = make_categorical(rows, n_cats, n_labels, cats);
+                
+                double key_space = 1.0;
+                
+                for (u64 i = 0; i < n_cats; i++)
+                {
+                    key_space *= double(n_labels);
+                }
+                
+                std::vector<double> times;
+                
+                std::cout << std::setw(8) << rows << std::setw(6) << n_cats << std::setw(8) << n_labels;
+                
+                for (const auto& info : methods)
+                {
+                    times.push_back(time_method(cat, cats, info.method));
+                    std::cout << std::setw(13) << std::fixed << std::setprecision(3) << times.back();
+                }
+                
+                std::cout << std::endl;
+                
+                const bool dense_applies = key_space <= double(CAT_DENSE_KEY_MAX_SPACE) &&
+                    key_space <= double(rows) * CAT_DENSE_KEY_ROWS_RATIO;
+                
+                if (!dense_applies)
+                {
+                    radix_total += times[3] * 2.0;
+                    custom_hash_total += times[1];
+                }
+            }
+        }
+        
+        if (radix_total >= custom_hash_total)
+        {
+            break;
+        }
+        
+        radix_min_rows = rows;
+    }
+    
+    std::cout << std::endl << "times are in ms." << std::endl;
+    
+    if (radix_min_rows == std::numeric_limits<u64>::max())
+    {
+        std::cout << "radix did not beat custom_hash at any row count; suggest raising CAT_AUTO_RADIX_MIN_ROWS." << std::endl;
+    }
+    else
+    {
+        std::cout << "suggested CAT_AUTO_RADIX_MIN_ROWS: " << radix_min_rows
+                  << " (currently " << CAT_AUTO_RADIX_MIN_ROWS << ")" << std::endl;
+    }
+    
+    return 0;
+}
@@ -6,9 +6,216 @@
 //
 
 #include "bit_array.hpp"
+#include "bit_ops.hpp"
+#include "platform.hpp"
+#include "config.hpp"
 #include <stdexcept>
 #include <cstring>
-#include <cmath>
+
+#if defined(CAT_USE_SIMD_BIT_KERNELS) && defined(CAT_HAS_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(CAT_USE_SIMD_BIT_KERNELS) && defined(CAT_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+
+//
+//  word kernels
+//
+
+namespace
+{
+    enum class word_op
+    {
+        bit_or,
+        bit_and,
+        bit_and_not,
+        bit_xor,
+        bit_eq
+    };
+    
+    using binary_words_t = void (*)(util::u64*, const util::u64*, const util::u64*, util::u64, word_op);
+    using sum_words_t = util::u64 (*)(const util::u64*, util::u64);
+    
+    void binary_words_scalar(util::u64* out, const util::u64* a, const util::u64* b, util::u64 n, word_op op)
+    {
+        switch (op)
+        {
+            case word_op::bit_or:
+                for (util::u64 i = 0; i < n; i++)
+                {
+                    out[i] = a[i] | b[i];
+                }
+                break;
+            case word_op::bit_and:
+                for (util::u64 i = 0; i < n; i++)
+                {
+                    out[i] = a[i] & b[i];
+                }
+                break;
+            case word_op::bit_and_not:
+                for (util::u64 i = 0; i < n; i++)
+                {
+                    out[i] = a[i] & ~(b[i]);
+                }
+                break;
+            case word_op::bit_xor:
+                for (util::u64 i = 0; i < n; i++)
+                {
+                    out[i] = a[i] ^ b[i];
+                }
+                break;
+            case word_op::bit_eq:
+                for (util::u64 i = 0; i < n; i++)
+                {
+                    out[i] = ~(a[i] ^ b[i]);
+                }
+                break;
+        }
+    }
+    
+    util::u64 sum_words_scalar(const util::u64* data, util::u64 n)
+    {
+        util::u64 sum = 0;
+        
+        for (util::u64 i = 0; i < n; i++)
+        {
+            sum += util::popcount64(data[i]);
+        }
+        
+        return sum;
+    }
+    
+#if defined(CAT_USE_SIMD_BIT_KERNELS) && defined(CAT_HAS_SSE2)
+    void binary_words_sse2(util::u64* out, const util::u64* a, const util::u64* b, util::u64 n, word_op op)
+    {
+        const util::u64 n_vec = n - n % 2;
+        const __m128i ones = _mm_set1_epi32(-1);
+        
+        for (util::u64 i = 0; i < n_vec; i += 2)
+        {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            __m128i res;
+            
+            switch (op)
+            {
+                case word_op::bit_or:
+                    res = _mm_or_si128(va, vb);
+                    break;
+                case word_op::bit_and:
+                    res = _mm_and_si128(va, vb);
+                    break;
+                case word_op::bit_and_not:
+                    res = _mm_andnot_si128(vb, va);
+                    break;
+                case word_op::bit_xor:
+                    res = _mm_xor_si128(va, vb);
+                    break;
+                default:
+                    res = _mm_xor_si128(_mm_xor_si128(va, vb), ones);
+                    break;
+            }
+            
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), res);
+        }
+        
+        binary_words_scalar(out + n_vec, a + n_vec, b + n_vec, n - n_vec, op);
+    }
+#endif
+    
+#if defined(CAT_USE_SIMD_BIT_KERNELS) && defined(CAT_HAS_X86_DISPATCH)
+    __attribute__((target("avx2")))
+    void binary_words_avx2(util::u64* out, const util::u64* a, const util::u64* b, util::u64 n, word_op op)
+    {
+        const util::u64 n_vec = n - n % 4;
+        const __m256i ones = _mm256_set1_epi32(-1);
+        
+        for (util::u64 i = 0; i < n_vec; i += 4)
+        {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            __m256i res;
+            
+            switch (op)
+            {
+                case word_op::bit_or:
+                    res = _mm256_or_si256(va, vb);
+                    break;
+                case word_op::bit_and:
+                    res = _mm256_and_si256(va, vb);
+                    break;
+                case word_op::bit_and_not:
+                    res = _mm256_andnot_si256(vb, va);
+                    break;
+                case word_op::bit_xor:
+                    res = _mm256_xor_si256(va, vb);
+                    break;
+                default:
+                    res = _mm256_xor_si256(_mm256_xor_si256(va, vb), ones);
+                    break;
+            }
+            
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), res);
+        }
+        
+        binary_words_scalar(out + n_vec, a + n_vec, b + n_vec, n - n_vec, op);
+    }
+    
+    __attribute__((target("popcnt")))
+    util::u64 sum_words_popcnt(const util::u64* data, util::u64 n)
+    {
+        util::u64 sum = 0;
+        
+        for (util::u64 i = 0; i < n; i++)
+        {
+            sum += util::u64(__builtin_popcountll(data[i]));
+        }
+        
+        return sum;
+    }
+#endif
+    
+    binary_words_t select_binary_words()
+    {
+#if defined(CAT_USE_SIMD_BIT_KERNELS) && defined(CAT_HAS_X86_DISPATCH)
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return &binary_words_avx2;
+        }
+#endif
+#if defined(CAT_USE_SIMD_BIT_KERNELS) && defined(CAT_HAS_SSE2)
+        return &binary_words_sse2;
+#else
+        return &binary_words_scalar;
+#endif
+    }
+    
+    sum_words_t select_sum_words()
+    {
+#if defined(CAT_USE_SIMD_BIT_KERNELS) && defined(CAT_HAS_X86_DISPATCH)
+        if (__builtin_cpu_supports("popcnt"))
+        {
+            return &sum_words_popcnt;
+        }
+#endif
+        return &sum_words_scalar;
+    }
+    
+    //  The kernels are chosen once, on first use.
+    void binary_words(util::u64* out, const util::u64* a, const util::u64* b, util::u64 n, word_op op)
+    {
+        static const binary_words_t impl = select_binary_words();
+        impl(out, a, b, n, op);
+    }
+    
+    util::u64 sum_words(const util::u64* data, util::u64 n)
+    {
+        static const sum_words_t impl = select_sum_words();
+        return impl(data, n);
+    }
+}
 
 util::bit_array::bit_array()
 {
@@ -110,16 +317,16 @@ void util::bit_array::unchecked_place(bool value, util::u64 at_index)
 
 void util::bit_array::unchecked_place(bool value, util::u64 bin, util::u32 bit)
 {
-    util::u32* data = m_data.unsafe_get_pointer();
-    util::u32 current = data[bin];
+    util::u64* data = m_data.unsafe_get_pointer();
+    util::u64 current = data[bin];
     
     if (value)
     {
-        current = current | (1u << bit);
+        current = current | (util::u64(1) << bit);
     }
     else
     {
-        current = current & ~(1u << bit);
+        current = current & ~(util::u64(1) << bit);
     }
     
     data[bin] = current;
@@ -156,27 +363,27 @@ void util::bit_array::unchecked_keep(const util::dynamic_array<util::u64> &at_in
     
     util::u64 new_data_size = get_data_size(new_size);
     
-    util::dynamic_array<util::u32> tmp(new_data_size);
+    util::dynamic_array<util::u64> tmp(new_data_size);
     
-    util::u32* tmp_ptr = tmp.unsafe_get_pointer();
-    util::u32* data_ptr = m_data.unsafe_get_pointer();
+    util::u64* tmp_ptr = tmp.unsafe_get_pointer();
+    util::u64* data_ptr = m_data.unsafe_get_pointer();
     util::u64* at_indices_ptr = at_indices.unsafe_get_pointer();
     
-    std::memset(tmp_ptr, 0u, new_data_size * sizeof(util::u32));
+    std::memset(tmp_ptr, 0u, new_data_size * sizeof(util::u64));
     
     for (util::u64 i = 0; i < new_size; i++)
     {
         util::u64 idx = at_indices_ptr[i] + index_offset;
-        util::u32 datum = data_ptr[get_bin(idx)];
+        util::u64 datum = data_ptr[get_bin(idx)];
         util::u32 bit = get_bit(idx);
         util::u64 into_bin = get_bin(i);
         util::u32 into_bit = get_bit(i);
         
-        bool res = datum & (1u << bit);
+        bool res = datum & (util::u64(1) << bit);
         
         if (res)
         {
-            tmp_ptr[into_bin] |= (1u << into_bit);
+            tmp_ptr[into_bin] |= (util::u64(1) << into_bit);
         }
     }
     
@@ -186,7 +393,7 @@ void util::bit_array::unchecked_keep(const util::dynamic_array<util::u64> &at_in
 
 bool util::bit_array::assign_true(const util::u64* at_indices_data, util::u64 indices_sz, util::s64 index_offset)
 {
-    util::u32* own_data = m_data.unsafe_get_pointer();
+    util::u64* own_data = m_data.unsafe_get_pointer();
     
     for (util::u64 i = 0; i < indices_sz; i++)
     {
@@ -200,7 +407,7 @@ bool util::bit_array::assign_true(const util::u64* at_indices_data, util::u64 in
         util::u64 bin = get_bin(idx);
         util::u32 bit = get_bit(idx);
         
-        own_data[bin] |= (1u << bit);
+        own_data[bin] |= (util::u64(1) << bit);
     }
     
     return true;
@@ -226,7 +433,7 @@ bool util::bit_array::assign_true(const std::vector<util::u64>& at_indices, util
 void util::bit_array::unchecked_assign_true(const util::dynamic_array<util::u64> &at_indices, util::s64 index_offset)
 {
     util::u64* at_indices_data = at_indices.unsafe_get_pointer();
-    util::u32* own_data = m_data.unsafe_get_pointer();
+    util::u64* own_data = m_data.unsafe_get_pointer();
     util::u64 indices_size = at_indices.tail();
     
     for (util::u64 i = 0; i < indices_size; i++)
@@ -235,7 +442,7 @@ void util::bit_array::unchecked_assign_true(const util::dynamic_array<util::u64>
         util::u64 bin = get_bin(idx);
         util::u32 bit = get_bit(idx);
         
-        own_data[bin] |= (1u << bit);
+        own_data[bin] |= (util::u64(1) << bit);
     }
 }
 
@@ -259,8 +466,8 @@ void util::bit_array::append(const util::bit_array &other)
     
     m_data.resize(new_data_size);
     
-    util::u32* m_data_ptr = m_data.unsafe_get_pointer();
-    util::u32* other_data_ptr = other.m_data.unsafe_get_pointer();
+    util::u64* m_data_ptr = m_data.unsafe_get_pointer();
+    util::u64* other_data_ptr = other.m_data.unsafe_get_pointer();
     
     util::u32 last_bit = get_bit(orig_size);
     
@@ -272,23 +479,23 @@ void util::bit_array::append(const util::bit_array &other)
     //  fast copy of elements if they're already aligned.
     if (last_bit == 0)
     {
-        std::memcpy(&m_data_ptr[orig_tail], other_data_ptr, other_tail * sizeof(util::u32));
+        std::memcpy(&m_data_ptr[orig_tail], other_data_ptr, other_tail * sizeof(util::u64));
         return;
     }
     
-    std::memset(&m_data_ptr[orig_tail], 0u, other_tail * sizeof(util::u32));
+    std::memset(&m_data_ptr[orig_tail], 0u, other_tail * sizeof(util::u64));
     
     util::u32 bit_offset = m_size_int - last_bit;
     
     //  fill remaining elements in final bin with 0
-    util::u32 last_bin0 = ~(0u) >> bit_offset;
+    util::u64 last_bin0 = ~util::u64(0) >> bit_offset;
     
     m_data_ptr[orig_tail-1] &= last_bin0;
 
     for (util::u64 i = 0; i < other_tail; i++)
     {
-        util::u32 other0 = other_data_ptr[i];
-        util::u32 other1 = other0;
+        util::u64 other0 = other_data_ptr[i];
+        util::u64 other1 = other0;
 
         other0 = other0 << last_bit;
         other1 = other1 >> bit_offset;
@@ -300,15 +507,19 @@ void util::bit_array::append(const util::bit_array &other)
 
 void util::bit_array::fill(bool with)
 {
-    util::u32 fill_with = with ? ~(0u) : 0u;
+    int fill_with = with ? 0xff : 0;
     util::u64 fill_to = get_data_size(m_size);
-    std::memset(m_data.unsafe_get_pointer(), fill_with, fill_to * sizeof(util::u32));
+    
+    if (fill_to > 0)
+    {
+        std::memset(m_data.unsafe_get_pointer(), fill_with, fill_to * sizeof(util::u64));
+    }
 }
 
 void util::bit_array::flip()
 {
     util::u64 data_size = get_data_size(m_size);
-    util::u32* data = m_data.unsafe_get_pointer();
+    util::u64* data = m_data.unsafe_get_pointer();
     
     for (util::u64 i = 0; i < data_size; i++)
     {
@@ -321,7 +532,7 @@ bool util::bit_array::at(util::u64 index) const
     util::u64 bin = get_bin(index);
     util::u32 bit = get_bit(index);
     
-    return m_data.at(bin) & (1 << bit);
+    return m_data.at(bin) & (util::u64(1) << bit);
 }
 
 util::u64 util::bit_array::sum() const
@@ -332,19 +543,15 @@ util::u64 util::bit_array::sum() const
         return 0u;
     }
     
-    util::u64 c_sum = 0;
     util::u64 data_size = get_data_size(m_size);
-    util::u32* data = m_data.unsafe_get_pointer();
+    util::u64* data = m_data.unsafe_get_pointer();
     
-    for (util::u64 i = 0; i < data_size-1; i++)
-    {
-        c_sum += util::bit_array::bit_sum(data[i]);
-    }
+    util::u64 c_sum = sum_words(data, data_size-1);
     
     //  only sum the active values in the final bin
-    util::u32 last_datum = get_final_bin_with_zeros(data, data_size);
+    util::u64 last_datum = get_final_bin_with_zeros(data, data_size);
     
-    c_sum += util::bit_array::bit_sum(last_datum);
+    c_sum += util::popcount64(last_datum);
     
     return c_sum;
 }
@@ -360,7 +567,7 @@ void util::bit_array::resize(util::u64 to_size)
     util::u64 new_data_size = get_data_size(to_size);
     util::u64 orig_size = m_size;
     
-    util::u32* data = m_data.unsafe_get_pointer();
+    util::u64* data = m_data.unsafe_get_pointer();
     
     if (c_data_size > 0)
     {
@@ -385,7 +592,7 @@ void util::bit_array::resize(util::u64 to_size)
     
     util::u64 n_set = new_data_size - c_data_size;
     
-    std::memset(data + c_data_size, 0u, n_set * sizeof(util::u32));
+    std::memset(data + c_data_size, 0u, n_set * sizeof(util::u64));
 }
 
 util::u64 util::bit_array::size() const
@@ -403,50 +610,61 @@ util::u32 util::bit_array::get_bit(util::u64 index) const
     return index % m_size_int;
 }
 
-util::u32 util::bit_array::get_final_bin_with_zeros() const
+util::u64 util::bit_array::get_final_bin_with_zeros() const
 {
     util::u64 data_size = get_data_size(m_size);
-    util::u32* data = m_data.unsafe_get_pointer();
+    util::u64* data = m_data.unsafe_get_pointer();
     
     return get_final_bin_with_zeros(data, data_size);
 }
 
-util::u32 util::bit_array::get_final_bin_with_zeros(util::u32* data, util::u64 data_size) const
+util::u64 util::bit_array::get_final_bin_with_zeros(util::u64* data, util::u64 data_size) const
 {
-    util::u32 bit_offset = m_size_int - get_bit(m_size);
-    
-    util::u32 last_bin0 = ~(0u) >> bit_offset;
-    util::u32 last_datum = data[data_size-1];
+    util::u32 last_bit = get_bit(m_size);
+    util::u64 last_datum = data[data_size-1];
     
-    last_datum &= last_bin0;
+    if (last_bit == 0)
+    {
+        return last_datum;
+    }
     
-    return last_datum;
+    return last_datum & ((util::u64(1) << last_bit) - 1);
 }
 
 util::u64 util::bit_array::get_data_size(util::u64 n_elements) const
 {
-    double res = double(n_elements) / double(m_size_int);
-    return util::u64(std::ceil(res));
+    return (n_elements + m_size_int - 1) / m_size_int;
 }
 
 util::u32 util::bit_array::get_size_int() const
 {
-    return sizeof(util::u32) * 8u;
+    return sizeof(util::u64) * 8u;
 }
 
-bool util::bit_array::all_bits_set(util::u32 value, util::u32 n)
+bool util::bit_array::all_bits_set(util::u64 value, util::u32 n)
 {
-    util::u32 mask = (1 << n) - 1;
+    util::u64 mask = n == 64 ? ~util::u64(0) : (util::u64(1) << n) - 1;
     value &= mask;
     return value == mask;
 }
 
-util::u32 util::bit_array::bit_sum(util::u32 i)
+//  get_bin_range [private]: Words spanning bits [start, stop). False if the range is empty.
+
+bool util::bit_array::get_bin_range(const util::bit_array& a,
+                                    util::u64 start,
+                                    util::u64 stop,
+                                    util::u64* first_bin,
+                                    util::u64* n_bins)
 {
-    //  https://stackoverflow.com/questions/109023/how-to-count-the-number-of-set-bits-in-a-32-bit-integer
-    i = i - ((i >> 1) & 0x55555555);
-    i = (i & 0x33333333) + ((i >> 2) & 0x33333333);
-    return (((i + (i >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+    if (stop <= start)
+    {
+        return false;
+    }
+    
+    *first_bin = a.get_bin(start);
+    *n_bins = a.get_bin(stop-1) - *first_bin + 1;
+    
+    return true;
 }
 
 void util::bit_array::unchecked_dot_or(util::bit_array &out,
@@ -455,18 +673,18 @@ void util::bit_array::unchecked_dot_or(util::bit_array &out,
                                        util::u64 start,
                                        util::u64 stop)
 {
-    util::u64 first_bin = a.get_bin(start);
-    util::u32 last_bit = a.get_bit(stop);
-    util::u64 last_bin = last_bit == 0u ? a.get_bin(stop-1) : a.get_bin(stop);
+    util::u64 first_bin;
+    util::u64 n_bins;
     
-    util::u32* a_data = a.m_data.unsafe_get_pointer();
-    util::u32* b_data = b.m_data.unsafe_get_pointer();
-    util::u32* out_data = out.m_data.unsafe_get_pointer();
-    
-    for (util::u64 i = first_bin; i <= last_bin; i++)
+    if (!get_bin_range(a, start, stop, &first_bin, &n_bins))
     {
-        out_data[i] = a_data[i] | b_data[i];
+        return;
     }
+    
+    binary_words(out.m_data.unsafe_get_pointer() + first_bin,
+                 a.m_data.unsafe_get_pointer() + first_bin,
+                 b.m_data.unsafe_get_pointer() + first_bin,
+                 n_bins, word_op::bit_or);
 }
 
 void util::bit_array::unchecked_dot_and(util::bit_array &out,
@@ -475,18 +693,18 @@ void util::bit_array::unchecked_dot_and(util::bit_array &out,
                                         util::u64 start,
                                         util::u64 stop)
 {
-    util::u64 first_bin = a.get_bin(start);
-    util::u32 last_bit = a.get_bit(stop);
-    util::u64 last_bin = last_bit == 0u ? a.get_bin(stop-1) : a.get_bin(stop);
-    
-    util::u32* a_data = a.m_data.unsafe_get_pointer();
-    util::u32* b_data = b.m_data.unsafe_get_pointer();
-    util::u32* out_data = out.m_data.unsafe_get_pointer();
+    util::u64 first_bin;
+    util::u64 n_bins;
     
-    for (util::u64 i = first_bin; i <= last_bin; i++)
+    if (!get_bin_range(a, start, stop, &first_bin, &n_bins))
     {
-        out_data[i] = a_data[i] & b_data[i];
+        return;
     }
+    
+    binary_words(out.m_data.unsafe_get_pointer() + first_bin,
+                 a.m_data.unsafe_get_pointer() + first_bin,
+                 b.m_data.unsafe_get_pointer() + first_bin,
+                 n_bins, word_op::bit_and);
 }
 
 void util::bit_array::unchecked_dot_and_not(util::bit_array &out,
@@ -495,18 +713,18 @@ void util::bit_array::unchecked_dot_and_not(util::bit_array &out,
                                         util::u64 start,
                                         util::u64 stop)
 {
-    util::u64 first_bin = a.get_bin(start);
-    util::u32 last_bit = a.get_bit(stop);
-    util::u64 last_bin = last_bit == 0u ? a.get_bin(stop-1) : a.get_bin(stop);
-    
-    util::u32* a_data = a.m_data.unsafe_get_pointer();
-    util::u32* b_data = b.m_data.unsafe_get_pointer();
-    util::u32* out_data = out.m_data.unsafe_get_pointer();
+    util::u64 first_bin;
+    util::u64 n_bins;
     
-    for (util::u64 i = first_bin; i <= last_bin; i++)
+    if (!get_bin_range(a, start, stop, &first_bin, &n_bins))
     {
-        out_data[i] = a_data[i] & ~(b_data[i]);
+        return;
     }
+    
+    binary_words(out.m_data.unsafe_get_pointer() + first_bin,
+                 a.m_data.unsafe_get_pointer() + first_bin,
+                 b.m_data.unsafe_get_pointer() + first_bin,
+                 n_bins, word_op::bit_and_not);
 }
 
 void util::bit_array::unchecked_dot_eq(util::bit_array &out,
@@ -515,18 +733,38 @@ void util::bit_array::unchecked_dot_eq(util::bit_array &out,
                                         util::u64 start,
                                         util::u64 stop)
 {
-    util::u64 first_bin = a.get_bin(start);
-    util::u32 last_bit = a.get_bit(stop);
-    util::u64 last_bin = last_bit == 0u ? a.get_bin(stop-1) : a.get_bin(stop);
+    util::u64 first_bin;
+    util::u64 n_bins;
+    
+    if (!get_bin_range(a, start, stop, &first_bin, &n_bins))
+    {
+        return;
+    }
     
-    util::u32* a_data = a.m_data.unsafe_get_pointer();
-    util::u32* b_data = b.m_data.unsafe_get_pointer();
-    util::u32* out_data = out.m_data.unsafe_get_pointer();
+    binary_words(out.m_data.unsafe_get_pointer() + first_bin,
+                 a.m_data.unsafe_get_pointer() + first_bin,
+                 b.m_data.unsafe_get_pointer() + first_bin,
+                 n_bins, word_op::bit_eq);
+}
+
+void util::bit_array::unchecked_dot_xor(util::bit_array &out,
+                                        const util::bit_array &a,
+                                        const util::bit_array &b,
+                                        util::u64 start,
+                                        util::u64 stop)
+{
+    util::u64 first_bin;
+    util::u64 n_bins;
     
-    for (util::u64 i = first_bin; i <= last_bin; i++)
+    if (!get_bin_range(a, start, stop, &first_bin, &n_bins))
     {
-        out_data[i] = ~(a_data[i] ^ b_data[i]);
+        return;
     }
+    
+    binary_words(out.m_data.unsafe_get_pointer() + first_bin,
+                 a.m_data.unsafe_get_pointer() + first_bin,
+                 b.m_data.unsafe_get_pointer() + first_bin,
+                 n_bins, word_op::bit_xor);
 }
 
 void util::bit_array::dot_or(util::bit_array &out,
@@ -555,11 +793,11 @@ bool util::bit_array::all() const
     util::u64 last_bin = get_bin(m_size);
     util::u32 last_bit = get_bit(m_size);
 
-    util::u32* a_data = m_data.unsafe_get_pointer();
+    util::u64* a_data = m_data.unsafe_get_pointer();
 
     util::u64 stop_idx = last_bit == 0u ? last_bin-1 : last_bin;
     util::u32 n_check_last = last_bit == 0u ? m_size_int : last_bit;
-    util::u32 one = ~(0u);
+    util::u64 one = ~util::u64(0);
     
     for (util::u64 i = 0; i < stop_idx; i++)
     {
@@ -569,9 +807,9 @@ bool util::bit_array::all() const
         }
     }
     
-    util::u32 last_datum = get_final_bin_with_zeros(a_data, get_data_size(m_size));
+    util::u64 last_datum = get_final_bin_with_zeros(a_data, get_data_size(m_size));
     
-    return util::bit_array::bit_sum(last_datum) == n_check_last;
+    return util::popcount64(last_datum) == n_check_last;
 }
 
 bool util::bit_array::any() const
@@ -581,7 +819,7 @@ bool util::bit_array::any() const
         return false;
     }
     
-    util::u32* a_data = m_data.unsafe_get_pointer();
+    util::u64* a_data = m_data.unsafe_get_pointer();
     util::u64 data_size = get_data_size(m_size);
     
     for (util::u64 i = 0; i < data_size-1; i++)
@@ -593,7 +831,7 @@ bool util::bit_array::any() const
     }
     
     //  make sure the bits beyond `m_size` are zeroed
-    util::u32 last_datum = get_final_bin_with_zeros(a_data, data_size);
+    util::u64 last_datum = get_final_bin_with_zeros(a_data, data_size);
     
     return last_datum != 0u;
 }
@@ -611,38 +849,20 @@ void util::bit_array::binary_check_dimensions(const util::bit_array &out,
 void util::bit_array::unchecked_find(util::u64* out, const util::bit_array& a, util::u64 index_offset)
 {
     util::u64 data_size = a.get_data_size(a.m_size);
-    util::u32 last_bit = a.get_bit(a.m_size);
-    util::u32* data = a.m_data.unsafe_get_pointer();
+    util::u64* data = a.m_data.unsafe_get_pointer();
     util::u32 size_int = a.m_size_int;
     util::u64 out_idx = 0;
     
     for (util::u64 i = 0; i < data_size; i++)
     {
-        util::u32 datum = data[i];
-        
-        if (datum == 0u)
-        {
-            continue;
-        }
-        
-        util::u32 stop_bit;
+        util::u64 datum = i < data_size - 1 ? data[i] : a.get_final_bin_with_zeros(data, data_size);
         
-        if (i < data_size - 1)
+        //  visit set bits lowest-first, clearing each in turn.
+        while (datum != 0u)
         {
-            stop_bit = a.m_size_int;
-        }
-        else
-        {
-            stop_bit = last_bit == 0 ? a.m_size_int : last_bit;
-        }
-        
-        for (util::u32 j = 0; j < stop_bit; j++)
-        {
-            if (datum & (1u << j))
-            {
-                out[out_idx] = (i * size_int) + j + index_offset;
-                out_idx++;
-            }
+            out[out_idx] = (i * size_int) + util::ctz64(datum) + index_offset;
+            out_idx++;
+            datum &= datum - 1;
         }
     }
 }
@@ -712,12 +932,12 @@ void util::bit_array::iterator::next()
 
 bool util::bit_array::iterator::value() const
 {
-    return m_data[m_bin] & (1u << m_bit);
+    return m_data[m_bin] & (util::u64(1) << m_bit);
 }
 
 void util::bit_array::iterator::set(bool value)
 {
-    util::u32 val = 1u << m_bit;
+    util::u64 val = util::u64(1) << m_bit;
     
     if (value)
     {
@@ -26,7 +26,7 @@ public:
         bool value() const;
         void set(bool value);
     private:
-        util::u32* m_data;
+        util::u64* m_data;
         util::u64 m_idx;
         util::u64 m_bin;
         util::u32 m_bit;
@@ -81,12 +81,14 @@ public:
                                   const bit_array& b, util::u64 start, util::u64 stop);
     static void unchecked_dot_eq(bit_array& out, const bit_array& a,
                                   const bit_array& b, util::u64 start, util::u64 stop);
+    static void unchecked_dot_xor(bit_array& out, const bit_array& a,
+                                  const bit_array& b, util::u64 start, util::u64 stop);
     
     static util::dynamic_array<util::u64> find(const bit_array& a, util::u64 index_offset = 0u);
     static std::vector<util::u64> findv(const bit_array& a, util::u64 index_offset = 0u);
     
 private:
-    util::dynamic_array<util::u32> m_data;
+    util::dynamic_array<util::u64> m_data;
     
     util::u64 m_size;
     util::u32 m_size_int;
@@ -94,8 +96,8 @@ private:
     util::u64 get_bin(util::u64 index) const;
     util::u32 get_bit(util::u64 index) const;
     util::u64 get_data_size(util::u64 n_elements) const;
-    util::u32 get_final_bin_with_zeros() const;
-    util::u32 get_final_bin_with_zeros(util::u32* data, util::u64 data_size) const;
+    util::u64 get_final_bin_with_zeros() const;
+    util::u64 get_final_bin_with_zeros(util::u64* data, util::u64 data_size) const;
     util::u32 get_size_int() const;
     
     bool assign_true(const util::u64* at_indices_data, util::u64 at_indices_sz, util::s64 index_offset);
@@ -105,6 +107,7 @@ private:
     static void unchecked_find(util::u64* out, const bit_array& a, util::u64 index_offset);
     
     static void binary_check_dimensions(const bit_array& out, const bit_array& a, const bit_array& b);
-    static bool all_bits_set(util::u32 value, util::u32 n);
-    static util::u32 bit_sum(util::u32 i);
+    static bool get_bin_range(const bit_array& a, util::u64 start, util::u64 stop,
+                              util::u64* first_bin, util::u64* n_bins);
+    static bool all_bits_set(util::u64 value, util::u32 n);
 };
@@ -0,0 +1,45 @@
+//
+//  bit_ops.hpp
+//  categorical
+//
+
+#pragma once
+
+#include "types.hpp"
+
+namespace util {
+    inline util::u32 popcount64(util::u64 x);
+    inline util::u32 ctz64(util::u64 x);
+}
+
+//  popcount64: Number of set bits in `x`.
+
+inline util::u32 util::popcount64(util::u64 x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return util::u32(__builtin_popcountll(x));
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return util::u32((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+//  ctz64: Index of the lowest set bit in `x`. `x` must be non-zero.
+
+inline util::u32 util::ctz64(util::u64 x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return util::u32(__builtin_ctzll(x));
+#else
+    util::u32 bit = 0;
+    
+    while ((x & (util::u64(1) << bit)) == 0)
+    {
+        bit++;
+    }
+    
+    return bit;
+#endif
+}
@@ -8,11 +8,17 @@
 #include "categorical.hpp"
 #include "helpers.hpp"
 #include "hashing.hpp"
+#include "bit_ops.hpp"
+#include "parallel.hpp"
 #include <random>
+#include <atomic>
 #include <iostream>
 #include <algorithm>
 #include <numeric>
 #include <cstring>
+#include <iterator>
+#include <utility>
+#include <map>
 
 //  !=: Check for inequality.
 
@@ -23,17 +29,13 @@ bool util::categorical::operator !=(const util::categorical& other) const
 
 //  unchecked_eq_progenitors_match: Check for equality, assuming progenitors and sizes match.
 
-bool util::categorical::unchecked_eq_progenitors_match(const util::categorical& other, util::u64 sz) const
+bool util::categorical::unchecked_eq_progenitors_match(const util::categorical& other) const
 {
     u64 n_cats = m_labels.size();
     
     for (u64 i = 0; i < n_cats; i++)
     {
-        const u32* own_ptr = m_labels[i].data();
-        const u32* other_ptr = other.m_labels[i].data();
-        const std::size_t num_compare = sz * sizeof(u32);
-        
-        if (std::memcmp(own_ptr, other_ptr, num_compare) != 0)
+        if (m_labels[i] != other.m_labels[i])
         {
             return false;
         }
@@ -42,6 +44,14 @@ bool util::categorical::unchecked_eq_progenitors_match(const util::categorical&
     return true;
 }
 
+//  unchecked_take: Move the contents of `other` into `this`, leaving `other` empty.
+
+void util::categorical::unchecked_take(util::categorical& other)
+{
+    *this = std::move(other);
+    other = util::categorical();
+}
+
 //  ==: Check for equality.
 
 bool util::categorical::operator ==(const util::categorical& other) const
@@ -61,20 +71,20 @@ bool util::categorical::operator ==(const util::categorical& other) const
     
     if (m_progenitor_ids == other.m_progenitor_ids)
     {
-        return unchecked_eq_progenitors_match(other, own_sz);
+        return unchecked_eq_progenitors_match(other);
     }
     
-    if (m_label_ids.size() != other.m_label_ids.size() || !categories_match(other))
+    if (m_label_ids->size() != other.m_label_ids->size() || !categories_match(other))
     {
         return false;
     }
     
     std::unordered_map<u32, u32> visited_ids_a_to_b;
     
-    for (const auto& category_it : m_category_indices)
+    for (const auto& category_it : *m_category_indices)
     {
-        const std::vector<u32>& col_a = m_labels[category_it.second];
-        const std::vector<u32>& col_b = other.m_labels[other.m_category_indices.at(category_it.first)];
+        const util::label_column& col_a = m_labels[category_it.second];
+        const util::label_column& col_b = other.m_labels[other.m_category_indices->at(category_it.first)];
         
         for (u64 i = 0; i < own_sz; i++)
         {
@@ -85,10 +95,10 @@ bool util::categorical::operator ==(const util::categorical& other) const
             //  We must get the corresponding label id for b.
             if (visited_it == visited_ids_a_to_b.end())
             {
-                const std::string& label_a = m_label_ids.ref_at(lab_a);
-                const auto& other_it = other.m_label_ids.find(label_a);
+                const std::string& label_a = m_label_ids->ref_at(lab_a);
+                const auto& other_it = other.m_label_ids->find(label_a);
                 
-                if (other_it == other.m_label_ids.endk())
+                if (other_it == other.m_label_ids->endk())
                 {
                     //  a has a label that b doesn't have.
                     return false;
@@ -116,26 +126,26 @@ bool util::categorical::operator ==(const util::categorical& other) const
 
 bool util::categorical::has_label(const std::string &label) const
 {
-    return m_in_category.find(label) != m_in_category.end();
+    return m_in_category->find(label) != m_in_category->end();
 }
 
 //  has_label: True if the label id is present.
 
 bool util::categorical::has_label(util::u32 label_id) const
 {
-    return m_label_ids.contains(label_id);
+    return m_label_ids->contains(label_id);
 }
 
 bool util::categorical::is_collapsed_expression_in_wrong_category(const std::string& category, const std::string& label) const
 {
-    return m_collapsed_expressions.count(label) > 0 && label != get_collapsed_expression(category);
+    return m_collapsed_expressions->count(label) > 0 && label != get_collapsed_expression(category);
 }
 
 //  has_category: True if the category is present.
 
 bool util::categorical::has_category(const std::string &category) const
 {
-    return m_category_indices.find(category) != m_category_indices.end();
+    return m_category_indices->find(category) != m_category_indices->end();
 }
 
 bool util::categorical::has_categories(const std::vector<std::string>& categories) const
@@ -165,6 +175,8 @@ void util::categorical::resize(util::u64 rows)
 
 void util::categorical::reserve(util::u64 rows)
 {
+    modified();
+    
     u64 orig_size = size();
     resize(rows);
     
@@ -184,6 +196,8 @@ void util::categorical::reserve(util::u64 rows)
 
 void util::categorical::repeat(util::u64 times)
 {
+    modified();
+    
     const u64 sz = size();
     
     if (sz == 0 || times == 0)
@@ -191,22 +205,10 @@ void util::categorical::repeat(util::u64 times)
         return;
     }
     
-    resize(sz + sz * times);
-    const u64 lab_sz = m_labels.size();
-    size_t n_copy = sz * sizeof(u32);
-    
-    for (u64 i = 0; i < lab_sz; i++)
+    for (auto& column : m_labels)
     {
-        u32* src = m_labels[i].data();
-        u64 idx = sz;
-        
-        for (u64 j = 0; j < times; j++)
-        {
-            std::memcpy(src + idx, src, n_copy);
-            idx += sz;
-        }
+        column.repeat_rows(sz, times);
     }
-    
 }
 
 //  size: Get the current number of rows.
@@ -220,23 +222,23 @@ util::u64 util::categorical::size() const
 
 util::u64 util::categorical::n_categories() const
 {
-    return m_category_indices.size();
+    return m_category_indices->size();
 }
 
 //  n_labels: Get the current number of labels.
 
 util::u64 util::categorical::n_labels() const
 {
-    return m_label_ids.size();
+    return m_label_ids->size();
 }
 
 util::u32 util::categorical::get_label_id_or_0(const std::string& lab, bool* exist) const
 {
     *exist = true;
     
-    const auto lab_id_it = m_label_ids.find(lab);
+    const auto lab_id_it = m_label_ids->find(lab);
     
-    if (lab_id_it == m_label_ids.endk())
+    if (lab_id_it == m_label_ids->endk())
     {
         *exist = false;
         return 0;
@@ -248,10 +250,10 @@ util::u32 util::categorical::get_label_id_or_0(const std::string& lab, bool* exi
 //  unchecked_get_label_column: Get a reference to the column of label_ids in which
 //      a label resides. No checking is done to ensure that the label exists.
 
-const std::vector<util::u32>& util::categorical::unchecked_get_label_column(const std::string& lab) const
+const util::label_column& util::categorical::unchecked_get_label_column(const std::string& lab) const
 {
-    const std::string& in_cat = m_in_category.at(lab);
-    const u64 cat_idx = m_category_indices.at(in_cat);
+    const std::string& in_cat = m_in_category->at(lab);
+    const u64 cat_idx = m_category_indices->at(in_cat);
     return m_labels[cat_idx];
 }
 
@@ -267,20 +269,35 @@ util::u64 util::categorical::count(const std::string& lab) const
         return 0;
     }
     
-    u64 sum = 0;
-    
-    const std::vector<u32>& lab_col = unchecked_get_label_column(lab);
+    const util::label_column& lab_col = unchecked_get_label_column(lab);
     const u64 sz = lab_col.size();
     
-    for (u64 i = 0; i < sz; i++)
+#ifdef CAT_USE_LABEL_INDEX
+    if (use_label_index() && lab_col.note_query())
     {
-        if (lab_col[i] == id)
-        {
-            sum++;
-        }
+        return lab_col.postings()->count(id);
     }
+#endif
+    
+    std::vector<u64> sums(util::parallel::n_chunks(sz), 0);
+    
+    util::parallel::for_each_chunk(sz, sums.size(), [&](u64 chunk, u64 begin, u64 end) {
+        sums[chunk] = lab_col.visit([&](const auto* ids) -> u64 {
+            u64 sum = 0;
+            
+            for (u64 i = begin; i < end; i++)
+            {
+                if (ids[i] == id)
+                {
+                    sum++;
+                }
+            }
+            
+            return sum;
+        });
+    });
     
-    return sum;
+    return std::accumulate(sums.begin(), sums.end(), u64(0));
 }
 
 util::u64 util::categorical::count(const std::string& lab,
@@ -298,29 +315,31 @@ util::u64 util::categorical::count(const std::string& lab,
         return 0;
     }
     
-    const std::vector<u32>& lab_col = unchecked_get_label_column(lab);
+    const util::label_column& lab_col = unchecked_get_label_column(lab);
     const u64 n_indices = indices.size();
     const u64 sz = lab_col.size();
     
-    u64 sum = 0;
-    
-    for (u64 i = 0; i < n_indices; i++)
-    {
-        const u64 idx = indices[i] - index_offset;
+    return lab_col.visit([&](const auto* ids) -> u64 {
+        u64 sum = 0;
         
-        if (idx >= sz)
+        for (u64 i = 0; i < n_indices; i++)
         {
-            *status = util::categorical_status::OUT_OF_BOUNDS;
-            return 0;
+            const u64 idx = indices[i] - index_offset;
+            
+            if (idx >= sz)
+            {
+                *status = util::categorical_status::OUT_OF_BOUNDS;
+                return 0;
+            }
+            
+            if (ids[idx] == id)
+            {
+                sum++;
+            }
         }
         
-        if (lab_col[idx] == id)
-        {
-            sum++;
-        }
-    }
-    
-    return sum;
+        return sum;
+    });
 }
 
 //  add_category: Add a new category.
@@ -331,9 +350,11 @@ util::u64 util::categorical::count(const std::string& lab,
 
 util::u32 util::categorical::add_category(const std::string& category)
 {
+    modified();
+    
     std::string clpsed = get_collapsed_expression(category);
     
-    if (has_label(clpsed) && m_in_category.at(clpsed) != category)
+    if (has_label(clpsed) && m_in_category->at(clpsed) != category)
     {
         return util::categorical_status::COLLAPSED_EXPRESSION_IN_WRONG_CATEGORY;
     }
@@ -355,6 +376,8 @@ util::u32 util::categorical::add_category(const std::string& category)
 
 util::u32 util::categorical::add_label(const std::string& category, const std::string& label)
 {
+    modified();
+    
     if (!has_category(category))
     {
         return util::categorical_status::CATEGORY_DOES_NOT_EXIST;
@@ -372,13 +395,13 @@ util::u32 util::categorical::add_label_unchecked_has_category(const std::string&
                                                               const std::string& label,
                                                               u32* label_id)
 {
-    const auto& label_id_it = m_label_ids.find(label);
+    const auto& label_id_it = m_label_ids->find(label);
     
-    if (label_id_it != m_label_ids.endk())
+    if (label_id_it != m_label_ids->endk())
     {
         *label_id = label_id_it->second;
         //  Label either already exists or is in the wrong.
-        return (category == m_in_category.at(label) ? categorical_status::OK : categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY);
+        return (category == m_in_category->at(label) ? categorical_status::OK : categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY);
     }
     
     //  Check if the label is a collapsed expression. If it is, ensure it is the collapsed
@@ -404,9 +427,11 @@ util::u32 util::categorical::add_label_unchecked_has_category(const std::string&
 
 util::u32 util::categorical::require_category(const std::string& category)
 {
+    modified();
+    
     std::string clpsed = get_collapsed_expression(category);
     
-    if (has_label(clpsed) && m_in_category.at(clpsed) != category)
+    if (has_label(clpsed) && m_in_category->at(clpsed) != category)
     {
         return util::categorical_status::COLLAPSED_EXPRESSION_IN_WRONG_CATEGORY;
     }
@@ -427,10 +452,9 @@ void util::categorical::unchecked_add_category(const std::string& category,
     u64 sz = size();
     u64 ncats = n_categories();
     
-    std::vector<u32> new_labs(sz);
-    m_category_indices[category] = ncats;
-    m_labels.push_back(new_labs);
-    m_collapsed_expressions.insert(collapsed_expression);
+    m_category_indices.mutate()[category] = ncats;
+    m_labels.emplace_back(sz);
+    m_collapsed_expressions.mutate().insert(collapsed_expression);
     
     //  fill the category with the collapsed expression for the category.
     if (sz > 0)
@@ -443,6 +467,8 @@ void util::categorical::unchecked_add_category(const std::string& category,
 
 util::u32 util::categorical::rename_category(const std::string &from, const std::string &to)
 {
+    modified();
+    
     if (!has_category(from))
     {
         return util::categorical_status::CATEGORY_DOES_NOT_EXIST;
@@ -455,7 +481,7 @@ util::u32 util::categorical::rename_category(const std::string &from, const std:
     
     const std::string clpsed = get_collapsed_expression(to);
     
-    if (has_label(clpsed) && m_in_category.at(clpsed) != from)
+    if (has_label(clpsed) && m_in_category->at(clpsed) != from)
     {
         return util::categorical_status::COLLAPSED_EXPRESSION_IN_WRONG_CATEGORY;
     }
@@ -464,15 +490,15 @@ util::u32 util::categorical::rename_category(const std::string &from, const std:
     
     for (const auto& lab : labs)
     {
-        m_in_category[lab] = to;
+        m_in_category.mutate()[lab] = to;
     }
     
-    util::u64 cat_idx = m_category_indices.at(from);
-    m_category_indices.erase(from);
-    m_category_indices[to] = cat_idx;
+    util::u64 cat_idx = m_category_indices->at(from);
+    m_category_indices.mutate().erase(from);
+    m_category_indices.mutate()[to] = cat_idx;
   
-    m_collapsed_expressions.erase(get_collapsed_expression(from));
-    m_collapsed_expressions.insert(clpsed);
+    m_collapsed_expressions.mutate().erase(get_collapsed_expression(from));
+    m_collapsed_expressions.mutate().insert(clpsed);
     
     m_progenitor_ids.randomize();
     
@@ -485,22 +511,61 @@ void util::categorical::unchecked_insert_label(const std::string& lab,
                                                const util::u32 id,
                                                const std::string& category)
 {
-    m_label_ids.insert(lab, id);
-    m_in_category[lab] = category;
+    m_label_ids.mutate().insert(lab, id);
+    m_in_category.mutate()[lab] = category;
+}
+
+//  unchecked_insert_new_labels [private]: Add labels given ids by
+//      reconcile_new_label_ids, and adopt the allocator that gave them.
+
+void util::categorical::unchecked_insert_new_labels(const std::unordered_map<std::string, util::u32>& new_label_ids,
+                                                    const std::unordered_map<std::string, std::string>& new_in_cat,
+                                                    label_id_allocator&& label_id_allocator)
+{
+    if (new_label_ids.empty())
+    {
+        return;
+    }
+    
+    for (const auto& it : new_label_ids)
+    {
+        unchecked_insert_label(it.first, it.second, new_in_cat.at(it.first));
+    }
+    
+    m_label_id_allocator = std::move(label_id_allocator);
+    m_progenitor_ids.randomize();
+}
+
+//  unchecked_erase_label [private]: Internally remove label, and release its id.
+
+void util::categorical::unchecked_erase_label(const std::string& lab)
+{
+    const auto lab_it = m_label_ids->find(lab);
+    
+    if (lab_it == m_label_ids->endk())
+    {
+        return;
+    }
+    
+    const u32 id = lab_it->second;
+    
+    m_label_ids.mutate().erase(lab);
+    m_in_category.mutate().erase(lab);
+    m_label_id_allocator.release(id);
 }
 
 //  set_collapsed_expressions: Initialize categories with collapsed expressions.
 
-void util::categorical::set_collapsed_expressions(std::vector<util::u32> &labs,
+void util::categorical::set_collapsed_expressions(util::label_column& labs,
                                                   const std::string& category,
                                                   const std::string& collapsed_expression,
                                                   util::u64 start_offset)
 {
     util::u32 id;
     
-    if (m_label_ids.contains(collapsed_expression))
+    if (m_label_ids->contains(collapsed_expression))
     {
-        id = m_label_ids.at(collapsed_expression);
+        id = m_label_ids->at(collapsed_expression);
     }
     else
     {
@@ -509,19 +574,19 @@ void util::categorical::set_collapsed_expressions(std::vector<util::u32> &labs,
         m_progenitor_ids.randomize();
     }
     
-    std::fill(labs.begin() + start_offset, labs.end(), id);
+    labs.fill(start_offset, labs.size(), id);
 }
 
 //  set_all_collapsed_expressions: Initialize all categories with collapsed expressions.
 
 void util::categorical::set_all_collapsed_expressions(util::u64 start_offset)
 {
-    for (const auto& it : m_category_indices)
+    for (const auto& it : *m_category_indices)
     {
         const std::string& cat = it.first;
         const util::u64 cat_idx = it.second;
         
-        std::vector<util::u32>& labs = m_labels[cat_idx];
+        util::label_column& labs = m_labels[cat_idx];
         
         set_collapsed_expressions(labs, cat, get_collapsed_expression(cat), start_offset);
     }
@@ -630,6 +695,56 @@ std::vector<util::u64> util::categorical::find_none(const std::vector<std::strin
     return find_or_impl(labels, use_indices, flip_index, indices, status, index_offset);
 }
 
+//  find_expr: Get indices of rows matching a boolean expression over labels.
+
+std::vector<util::u64> util::categorical::find_expr(const util::query_expr& expr,
+                                                    util::u64 index_offset) const
+{
+    std::vector<util::u64> dummy_indices;
+    util::u32 dummy_status;
+    const bool use_indices = false;
+    
+    return find_expr_impl(expr, use_indices, dummy_indices, &dummy_status, index_offset);
+}
+
+//  find_expr: Get indices of rows matching a boolean expression over labels, from
+//      subsets of rows.
+
+std::vector<util::u64> util::categorical::find_expr(const util::query_expr& expr,
+                                                    const std::vector<util::u64>& indices,
+                                                    util::u32* status,
+                                                    util::u64 index_offset) const
+{
+    const bool use_indices = true;
+    
+    return find_expr_impl(expr, use_indices, indices, status, index_offset);
+}
+
+//  find_batch: Get indices of each of several label combinations, as with find.
+
+std::vector<std::vector<util::u64>> util::categorical::find_batch(const std::vector<std::vector<std::string>>& label_sets,
+                                                                  util::u64 index_offset) const
+{
+    std::vector<util::u64> dummy_indices;
+    util::u32 dummy_status;
+    const bool use_indices = false;
+    
+    return find_batch_impl(label_sets, use_indices, dummy_indices, &dummy_status, index_offset);
+}
+
+//  find_batch: Get indices of each of several label combinations, as with find,
+//      from subsets of rows.
+
+std::vector<std::vector<util::u64>> util::categorical::find_batch(const std::vector<std::vector<std::string>>& label_sets,
+                                                                  const std::vector<util::u64>& indices,
+                                                                  util::u32* status,
+                                                                  util::u64 index_offset) const
+{
+    const bool use_indices = true;
+    
+    return find_batch_impl(label_sets, use_indices, indices, status, index_offset);
+}
+
 util::u32 util::categorical::find_flipped_apply_mask(util::bit_array& final_index,
                                                      const util::u64 sz,
                                                      const std::vector<util::u64>& indices,
@@ -675,327 +790,2512 @@ std::vector<util::u64> util::categorical::find_flipped_get_complete_index(const
     return util::bit_array::findv(final_index, index_offset);
 }
 
-//  find_impl [private]: Private implementation of find, with and without subsets
-
-std::vector<util::u64> util::categorical::find_impl(const std::vector<std::string>& labels,
-                                                    const bool use_indices,
-                                                    const bool flip_index,
-                                                    const std::vector<util::u64>& indices,
-                                                    util::u32* status,
-                                                    util::u64 index_offset) const
+namespace
 {
-    std::vector<util::u64> out;
-    
-    const u64 n_in = labels.size();
-    const u64 sz = size();
+    //  Rows are evaluated in blocks of 64, one bit per row.
+    const util::u64 find_block_size = 64;
     
-    *status = util::categorical_status::OK;
-    
-    if (n_in == 0)
+    //  find_term: A category's column, and the ids of the queried labels in that category.
+    struct find_term
     {
-        if (sz == 0 || !flip_index)
-        {
-            return out;
-        }
-        else
-        {
-            //  return complete / masked indices into `this`
-            return find_flipped_get_complete_index(use_indices, sz, indices, index_offset, status);
-        }
-    }
-    
-    std::unordered_map<std::string, bit_array> index_map;
+        const util::label_column* column;
+        std::vector<util::u32> ids;
+    };
     
-    for (u64 i = 0; i < n_in; i++)
+    template <typename T>
+    util::u64 match_block(const T* codes, util::u64 n, const std::vector<util::u32>& ids)
     {
-        const std::string& lab = labels[i];
-        
-        auto search_it = m_label_ids.find(lab);
+        util::u64 word = 0;
         
-        //  label doesn't exist
-        if (search_it == m_label_ids.endk())
+        if (ids.size() == 1)
         {
-            if (flip_index)
-            {
-                return find_flipped_get_complete_index(use_indices, sz, indices, index_offset, status);
-            }
-            else
+            const util::u32 id = ids[0];
+            
+            for (util::u64 i = 0; i < n; i++)
             {
-                return out;
+                word |= util::u64(util::u32(codes[i]) == id) << i;
             }
+            
+            return word;
         }
         
-        const u32 lab_id = search_it->second;
-        const std::string& cat = m_in_category.at(lab);
-        const u64 cat_idx = m_category_indices.at(cat);
-        
-        bit_array index;
+        const util::u64 n_ids = ids.size();
         
-        if (use_indices)
+        for (util::u64 i = 0; i < n; i++)
         {
-            index = util::categorical::assign_bit_array(m_labels[cat_idx], lab_id, indices, status, index_offset);
-            if (*status != util::categorical_status::OK)
+            const util::u32 code = codes[i];
+            util::u64 hit = 0;
+            
+            for (util::u64 j = 0; j < n_ids; j++)
             {
-                return out;
+                hit |= util::u64(code == ids[j]);
             }
-        }
-        else
-        {
-            index = util::categorical::assign_bit_array(m_labels[cat_idx], lab_id);
+            
+            word |= hit << i;
         }
         
-        if (index_map.find(cat) == index_map.end())
-        {
-            index_map[cat] = index;
-        }
-        else if (sz > 0)
-        {
-            bit_array& current = index_map[cat];
-            bit_array::unchecked_dot_or(current, current, index, 0, sz);
-        }
+        return word;
     }
     
-    util::bit_array final_index(sz, true);
-  
-    if (sz > 0)
+    util::u64 match_block(const util::label_column& column,
+                          const std::vector<util::u32>& ids,
+                          util::u64 start,
+                          util::u64 n)
     {
-        for (const auto& it : index_map)
-        {
-            bit_array::unchecked_dot_and(final_index, final_index, it.second, 0, sz);
-        }
-      
-        if (flip_index)
+        return column.visit([&](const auto* codes) -> util::u64 {
+            return match_block(codes + start, n, ids);
+        });
+    }
+    
+    //  add_find_term: Add `id` to the term for `column`, creating the term if necessary.
+    void add_find_term(std::vector<find_term>& terms, const util::label_column* column, util::u32 id)
+    {
+        for (auto& term : terms)
         {
-            final_index.flip();
-          
-            if (use_indices)
+            if (term.column == column)
             {
-                u32 tmp_status = categorical::find_flipped_apply_mask(final_index, sz, indices, index_offset);
-              
-                if (tmp_status != util::categorical_status::OK)
-                {
-                    *status = tmp_status;
-                    return out;
-                }
+                term.ids.push_back(id);
+                return;
             }
         }
+        
+        find_term term;
+        term.column = column;
+        term.ids.push_back(id);
+        terms.push_back(std::move(term));
     }
     
-    return bit_array::findv(final_index, index_offset);
-}
-
-//  find_or_impl [private]: Private implementation of find_or, with and without subsets
-
-std::vector<util::u64> util::categorical::find_or_impl(const std::vector<std::string>& labels,
-                                                       const bool use_indices,
-                                                       const bool flip_index,
-                                                       const std::vector<util::u64>& indices,
-                                                       util::u32* status,
-                                                       util::u64 index_offset) const
-{
-    using util::u64;
-    using util::bit_array;
-    
-    std::vector<util::u64> out;
-    
-    const u64 n_in = labels.size();
-    const u64 sz = size();
-    
-    *status = util::categorical_status::OK;
-    
-    if (n_in == 0)
+    //  make_index_words: Set the bits of `indices`, which must be in bounds, in a
+    //      block-aligned mask of `sz` rows.
+    std::vector<util::u64> make_index_words(util::u64 sz,
+                                            const std::vector<util::u64>& indices,
+                                            util::u64 index_offset)
     {
-        if (sz == 0 || !flip_index)
-        {
-            return out;
-        }
-        else
+        std::vector<util::u64> words((sz + find_block_size - 1) / find_block_size, 0);
+        
+        for (const auto idx : indices)
         {
-            //  return complete / masked indices into `this`
-            return find_flipped_get_complete_index(use_indices, sz, indices, index_offset, status);
+            const util::u64 row = idx - index_offset;
+            words[row / find_block_size] |= util::u64(1) << (row % find_block_size);
         }
+        
+        return words;
     }
     
-    auto label_it_end = m_label_ids.endk();
-    
-    util::bit_array final_index(sz, false);
-    
-    for (u64 i = 0; i < n_in; i++)
+    //  concatenate: Join per-chunk results in chunk order.
+    std::vector<util::u64> concatenate(std::vector<std::vector<util::u64>>& parts)
     {
-        const std::string& lab = labels[i];
-        const auto search_it = m_label_ids.find(lab);
-        
-        //  label doesn't exist
-        if (search_it == label_it_end)
+        if (parts.size() == 1)
         {
-            continue;
+            return std::move(parts[0]);
         }
         
-        const u32 lab_id = search_it->second;
-        const std::string& cat = m_in_category.at(lab);
-        const u64 cat_idx = m_category_indices.at(cat);
-        
-        bit_array index;
+        util::u64 total = 0;
         
-        if (use_indices)
-        {
-            index = util::categorical::assign_bit_array(m_labels[cat_idx], lab_id, indices, status, index_offset);
-            if (*status != util::categorical_status::OK)
-            {
-                return out;
-            }
-        }
-        else
+        for (const auto& part : parts)
         {
-            index = util::categorical::assign_bit_array(m_labels[cat_idx], lab_id);
+            total += part.size();
         }
-      
-        if (sz > 0)
+        
+        std::vector<util::u64> out;
+        out.reserve(total);
+        
+        for (const auto& part : parts)
         {
-            bit_array::unchecked_dot_or(final_index, final_index, index, 0, sz);
+            out.insert(out.end(), part.begin(), part.end());
         }
+        
+        return out;
     }
     
-    if (flip_index)
+    //  Rows are matched a batch of blocks at a time, so that each column is
+    //  visited once per batch rather than once per block.
+    const util::u64 find_batch_blocks = 64;
+    
+    //  pack_block: Pack `n` bytes of 0 or 1 into the low bits of a word. Each
+    //      group of 8 bytes, read as a little-endian word, is gathered into 8 bits
+    //      with a multiply.
+    util::u64 pack_block(const util::u8* hits, util::u64 n)
     {
-        final_index.flip();
+        util::u64 word = 0;
         
-        if (use_indices)
+        for (util::u64 i = 0; i < n; i += 8)
         {
-            u32 tmp_status = categorical::find_flipped_apply_mask(final_index, sz, indices, index_offset);
+            util::u64 bytes = 0;
+            std::memcpy(&bytes, hits + i, 8);
             
-            if (tmp_status != util::categorical_status::OK)
-            {
-                *status = tmp_status;
-                return out;
-            }
+            word |= ((bytes * 0x0102040810204080ull) >> 56) << i;
         }
+        
+        return word;
     }
     
-    return bit_array::findv(final_index, index_offset);
-}
-
-util::u32 util::categorical::assign_bit_array(util::bit_array& mask,
-                                              const std::vector<util::u64>& at_indices,
-                                              util::u64 index_offset)
-{
-    const u64 mask_sz = mask.size();
-    const u64 n_indices = at_indices.size();
-    const u64* indices = at_indices.data();
-    
-    for (u64 i = 0; i < n_indices; i++)
+    //  match_rows: Set hits[i] to 1 if the code of row `i` is one of `ids`, or else 0.
+    template <typename T>
+    void match_rows(const T* codes, util::u64 n, const std::vector<util::u32>& ids, util::u8* hits)
     {
-        u64 assign_idx = indices[i] - index_offset;
+        const util::u32 first = ids[0];
         
-        if (assign_idx >= mask_sz)
+        for (util::u64 i = 0; i < n; i++)
         {
-            return util::categorical_status::OUT_OF_BOUNDS;
+            hits[i] = util::u8(util::u32(codes[i]) == first);
         }
         
-        mask.unchecked_place(true, assign_idx);
-    }
-    
-    return util::categorical_status::OK;
-}
-
-//  assign_bit_array: Assign true to bit_array where label id is found
-
-util::bit_array util::categorical::assign_bit_array(const std::vector<util::u32>& labels, util::u32 lab)
-{
-    u64 sz = labels.size();
-    
-    util::bit_array out(sz, false);
-    
-    for (util::u64 i = 0; i < sz; i++)
-    {
-        if (labels[i] == lab)
+        for (util::u64 j = 1; j < ids.size(); j++)
         {
-            out.unchecked_place(true, i);
+            const util::u32 id = ids[j];
+            
+            for (util::u64 i = 0; i < n; i++)
+            {
+                hits[i] |= util::u8(util::u32(codes[i]) == id);
+            }
         }
     }
     
+    //  find_matching_rows: Single pass over rows [begin, end), a batch of blocks
+    //      at a time. Each term yields the rows whose code is one of its ids. Terms
+    //      are intersected if `intersect` is true, or else combined with a union.
+    //      The result is optionally flipped, then restricted to `mask`, if non-empty.
+    void find_matching_rows(const std::vector<find_term>& terms,
+                            const bool intersect,
+                            const bool flip_index,
+                            const std::vector<util::u64>& mask,
+                            util::u64 begin,
+                            util::u64 end,
+                            util::u64 index_offset,
+                            std::vector<util::u64>& out)
+    {
+        const bool use_mask = !mask.empty();
+        const util::u64 batch_rows = find_block_size * find_batch_blocks;
+        
+        //  the matches are counted before they are written, so that `out` is
+        //  allocated once.
+        std::vector<util::u64> words((end - begin + find_block_size - 1) / find_block_size);
+        util::u64 n_matches = 0;
+        
+        util::u8 hits[batch_rows];
+        
+        for (util::u64 batch = begin; batch < end; batch += batch_rows)
+        {
+            const util::u64 n_rows = std::min(batch_rows, end - batch);
+            const util::u64 n_words = (n_rows + find_block_size - 1) / find_block_size;
+            const util::u64 tail = n_rows % find_block_size;
+            const util::u64 last_valid = tail == 0 ? ~util::u64(0) : (util::u64(1) << tail) - 1;
+            
+            util::u64* batch_words = words.data() + (batch - begin) / find_block_size;
+            
+            //  rows past the end of the batch read as zero when packed.
+            std::fill(hits + n_rows, hits + n_words * find_block_size, util::u8(0));
+            std::fill(batch_words, batch_words + n_words, intersect ? ~util::u64(0) : 0);
+            
+            util::u64 any = intersect ? 1 : 0;
+            
+            for (const auto& term : terms)
+            {
+                //  all rows are excluded from the intersection.
+                if (intersect && any == 0)
+                {
+                    break;
+                }
+                
+                term.column->visit([&](const auto* codes) -> void {
+                    match_rows(codes + batch, n_rows, term.ids, hits);
+                });
+                
+                any = 0;
+                
+                for (util::u64 i = 0; i < n_words; i++)
+                {
+                    const util::u64 word = pack_block(hits + i * find_block_size, find_block_size);
+                    batch_words[i] = intersect ? batch_words[i] & word : batch_words[i] | word;
+                    any |= batch_words[i];
+                }
+            }
+            
+            for (util::u64 i = 0; i < n_words; i++)
+            {
+                const util::u64 valid = i + 1 == n_words ? last_valid : ~util::u64(0);
+                util::u64 word = batch_words[i] & valid;
+                
+                if (flip_index)
+                {
+                    word = ~word & valid;
+                }
+                
+                if (use_mask)
+                {
+                    word &= mask[batch / find_block_size + i];
+                }
+                
+                batch_words[i] = word;
+                n_matches += util::popcount64(word);
+            }
+        }
+        
+        util::u64 out_idx = out.size();
+        out.resize(out_idx + n_matches);
+        
+        for (util::u64 i = 0; i < words.size(); i++)
+        {
+            const util::u64 start = begin + i * find_block_size + index_offset;
+            util::u64 word = words[i];
+            
+            while (word != 0)
+            {
+                out[out_idx++] = start + util::ctz64(word);
+                word &= word - 1;
+            }
+        }
+    }
+    
+    std::vector<util::u64> find_matching_rows(const std::vector<find_term>& terms,
+                                              const bool intersect,
+                                              const bool flip_index,
+                                              const std::vector<util::u64>& mask,
+                                              util::u64 sz,
+                                              util::u64 index_offset)
+    {
+        std::vector<std::vector<util::u64>> parts(util::parallel::n_chunks(sz));
+        
+        util::parallel::for_each_chunk(sz, parts.size(), [&](util::u64 chunk, util::u64 begin, util::u64 end) {
+            find_matching_rows(terms, intersect, flip_index, mask, begin, end, index_offset, parts[chunk]);
+        });
+        
+        return concatenate(parts);
+    }
+
+#ifdef CAT_USE_LABEL_INDEX
+    //  note_term_queries: Count a query against the column of each term, and get
+    //      whether every column has been queried often enough to be indexed.
+    bool note_term_queries(const std::vector<find_term>& terms)
+    {
+        bool indexed = true;
+        
+        for (const auto& term : terms)
+        {
+            //  count the query against every column, even once one is not indexed.
+            indexed = term.column->note_query() && indexed;
+        }
+        
+        return indexed;
+    }
+    
+    //  merge_rows: Merge the sorted `rows` into the sorted `into`, dropping duplicates.
+    void merge_rows(std::vector<util::u32>& into, const util::u32* begin, const util::u32* end)
+    {
+        if (into.empty())
+        {
+            into.assign(begin, end);
+            return;
+        }
+        
+        std::vector<util::u32> merged(into.size() + (end - begin));
+        auto merged_end = std::set_union(into.begin(), into.end(), begin, end, merged.begin());
+        merged.erase(merged_end, merged.end());
+        
+        into = std::move(merged);
+    }
+    
+    //  posting_term_rows: Sorted rows of the labels of `term`, read from `postings`.
+    std::vector<util::u32> posting_term_rows(const util::label_postings& postings,
+                                             const std::vector<util::u32>& ids)
+    {
+        std::vector<util::u32> rows;
+        
+        for (const auto id : ids)
+        {
+            merge_rows(rows, postings.begin(id), postings.end(id));
+        }
+        
+        return rows;
+    }
+    
+    //  keep_matching_rows: Keep the `rows` whose code in the column of `term` is
+    //      one of its ids.
+    void keep_matching_rows(std::vector<util::u32>& rows, const find_term& term)
+    {
+        term.column->visit([&](const auto* codes) -> void {
+            util::u64 n_kept = 0;
+            
+            for (const auto row : rows)
+            {
+                const util::u32 code = codes[row];
+                bool hit = false;
+                
+                for (const auto id : term.ids)
+                {
+                    hit |= code == id;
+                }
+                
+                rows[n_kept] = row;
+                n_kept += hit;
+            }
+            
+            rows.resize(n_kept);
+        });
+    }
+    
+    //  find_indexed_rows: Like find_matching_rows, but answered from the label
+    //      index without a pass over the rows. Only the posting lists of one term
+    //      are read when intersecting: its rows are filtered by the codes of the
+    //      other terms. `indices` must already have been bounds checked.
+    //
+    //      Returns false without searching if the labels match at least 1 in
+    //      CAT_LABEL_INDEX_QUERY_RATIO rows, in which case a pass over the rows
+    //      is cheaper.
+    bool find_indexed_rows(const std::vector<find_term>& terms,
+                           const bool intersect,
+                           const bool flip_index,
+                           const bool use_indices,
+                           const std::vector<util::u64>& indices,
+                           util::u64 sz,
+                           util::u64 index_offset,
+                           std::vector<util::u64>& out)
+    {
+        std::vector<std::shared_ptr<const util::label_postings>> postings;
+        std::vector<util::u64> counts;
+        util::u64 n_matches = 0;
+        util::u64 smallest = 0;
+        
+        for (util::u64 i = 0; i < terms.size(); i++)
+        {
+            postings.push_back(terms[i].column->postings());
+            
+            util::u64 count = 0;
+            
+            for (const auto id : terms[i].ids)
+            {
+                count += postings[i]->count(id);
+            }
+            
+            counts.push_back(count);
+            
+            if (intersect && count < counts[smallest])
+            {
+                smallest = i;
+            }
+            
+            n_matches += count;
+        }
+        
+        if (intersect && !terms.empty())
+        {
+            n_matches = counts[smallest];
+        }
+        
+        if (n_matches * CAT_LABEL_INDEX_QUERY_RATIO >= sz)
+        {
+            return false;
+        }
+        
+        std::vector<util::u32> rows;
+        
+        if (intersect && !terms.empty())
+        {
+            rows = posting_term_rows(*postings[smallest], terms[smallest].ids);
+            
+            for (util::u64 i = 0; i < terms.size() && !rows.empty(); i++)
+            {
+                if (i != smallest)
+                {
+                    keep_matching_rows(rows, terms[i]);
+                }
+            }
+        }
+        else
+        {
+            for (util::u64 i = 0; i < terms.size(); i++)
+            {
+                const auto term_rows = posting_term_rows(*postings[i], terms[i].ids);
+                merge_rows(rows, term_rows.data(), term_rows.data() + term_rows.size());
+            }
+        }
+        
+        if (!use_indices)
+        {
+            if (flip_index)
+            {
+                out.resize(sz - rows.size());
+                util::u64 row = 0;
+                util::u64 out_idx = 0;
+                
+                for (const auto match : rows)
+                {
+                    for (; row < match; row++)
+                    {
+                        out[out_idx++] = row + index_offset;
+                    }
+                    
+                    row = util::u64(match) + 1;
+                }
+                
+                for (; row < sz; row++)
+                {
+                    out[out_idx++] = row + index_offset;
+                }
+            }
+            else
+            {
+                out.resize(rows.size());
+                
+                for (util::u64 i = 0; i < rows.size(); i++)
+                {
+                    out[i] = util::u64(rows[i]) + index_offset;
+                }
+            }
+            
+            return true;
+        }
+        
+        std::vector<util::u64> subset(indices.size());
+        
+        for (util::u64 i = 0; i < indices.size(); i++)
+        {
+            subset[i] = indices[i] - index_offset;
+        }
+        
+        std::sort(subset.begin(), subset.end());
+        subset.erase(std::unique(subset.begin(), subset.end()), subset.end());
+        
+        auto row_it = rows.begin();
+        
+        for (const auto row : subset)
+        {
+            while (row_it != rows.end() && *row_it < row)
+            {
+                ++row_it;
+            }
+            
+            const bool matches = row_it != rows.end() && *row_it == row;
+            
+            if (matches != flip_index)
+            {
+                out.push_back(row + index_offset);
+            }
+        }
+        
+        return true;
+    }
+#endif
+}
+
+//  find_impl [private]: Private implementation of find, with and without subsets.
+//
+//      Labels are resolved to one term per category, and the rows are then
+//      evaluated in a single pass by find_matching_rows, unless the query is
+//      sparse enough to be answered from the label index.
+
+std::vector<util::u64> util::categorical::find_impl(const std::vector<std::string>& labels,
+                                                    const bool use_indices,
+                                                    const bool flip_index,
+                                                    const std::vector<util::u64>& indices,
+                                                    util::u32* status,
+                                                    util::u64 index_offset) const
+{
+    std::vector<util::u64> out;
+    
+    const u64 n_in = labels.size();
+    const u64 sz = size();
+    
+    *status = util::categorical_status::OK;
+    
+    if (n_in == 0)
+    {
+        if (sz == 0 || !flip_index)
+        {
+            return out;
+        }
+        else
+        {
+            //  return complete / masked indices into `this`
+            return find_flipped_get_complete_index(use_indices, sz, indices, index_offset, status);
+        }
+    }
+    
+    std::vector<find_term> terms;
+    bool checked_bounds = false;
+    
+    for (u64 i = 0; i < n_in; i++)
+    {
+        const std::string& lab = labels[i];
+        
+        auto search_it = m_label_ids->find(lab);
+        
+        //  label doesn't exist
+        if (search_it == m_label_ids->endk())
+        {
+            if (flip_index)
+            {
+                return find_flipped_get_complete_index(use_indices, sz, indices, index_offset, status);
+            }
+            else
+            {
+                return out;
+            }
+        }
+        
+        if (use_indices && !checked_bounds)
+        {
+            *status = bounds_check(indices.data(), indices.size(), sz, index_offset);
+            
+            if (*status != util::categorical_status::OK)
+            {
+                return out;
+            }
+            
+            checked_bounds = true;
+        }
+        
+        const u64 cat_idx = m_category_indices->at(m_in_category->at(lab));
+        
+        add_find_term(terms, &m_labels[cat_idx], search_it->second);
+    }
+    
+#ifdef CAT_USE_LABEL_INDEX
+    if (use_label_index() && note_term_queries(terms) &&
+        find_indexed_rows(terms, true, flip_index, use_indices, indices, sz, index_offset, out))
+    {
+        return out;
+    }
+#endif
+    
+    std::vector<util::u64> mask;
+    
+    if (use_indices)
+    {
+        mask = make_index_words(sz, indices, index_offset);
+    }
+    
+    return find_matching_rows(terms, true, flip_index, mask, sz, index_offset);
+}
+
+//  find_or_impl [private]: Private implementation of find_or, with and without subsets
+
+std::vector<util::u64> util::categorical::find_or_impl(const std::vector<std::string>& labels,
+                                                       const bool use_indices,
+                                                       const bool flip_index,
+                                                       const std::vector<util::u64>& indices,
+                                                       util::u32* status,
+                                                       util::u64 index_offset) const
+{
+    std::vector<util::u64> out;
+    
+    const u64 n_in = labels.size();
+    const u64 sz = size();
+    
+    *status = util::categorical_status::OK;
+    
+    if (n_in == 0)
+    {
+        if (sz == 0 || !flip_index)
+        {
+            return out;
+        }
+        else
+        {
+            //  return complete / masked indices into `this`
+            return find_flipped_get_complete_index(use_indices, sz, indices, index_offset, status);
+        }
+    }
+    
+    const auto label_it_end = m_label_ids->endk();
+    
+    std::vector<find_term> terms;
+    
+    for (u64 i = 0; i < n_in; i++)
+    {
+        const std::string& lab = labels[i];
+        const auto search_it = m_label_ids->find(lab);
+        
+        //  label doesn't exist
+        if (search_it == label_it_end)
+        {
+            continue;
+        }
+        
+        const u64 cat_idx = m_category_indices->at(m_in_category->at(lab));
+        
+        add_find_term(terms, &m_labels[cat_idx], search_it->second);
+    }
+    
+    const bool use_mask = use_indices && (flip_index || !terms.empty());
+    
+    if (use_mask)
+    {
+        *status = bounds_check(indices.data(), indices.size(), sz, index_offset);
+        
+        if (*status != util::categorical_status::OK)
+        {
+            return out;
+        }
+    }
+    
+#ifdef CAT_USE_LABEL_INDEX
+    if (use_label_index() && note_term_queries(terms) &&
+        find_indexed_rows(terms, false, flip_index, use_mask, indices, sz, index_offset, out))
+    {
+        return out;
+    }
+#endif
+    
+    std::vector<util::u64> mask;
+    
+    if (use_mask)
+    {
+        mask = make_index_words(sz, indices, index_offset);
+    }
+    
+    return find_matching_rows(terms, false, flip_index, mask, sz, index_offset);
+}
+
+//  query_step [private]: One instruction of a planned query_expr. Instructions
+//      are evaluated in order against a stack of 64-row words.
+
+struct util::categorical::query_step
+{
+    enum class op : util::u8
+    {
+        term,
+        constant,
+        all_of,
+        any_of,
+        negate
+    };
+    
+    util::categorical::query_step::op code;
+    const util::label_column* column;
+    std::vector<util::u32> ids;
+    util::u64 n_args;
+    bool value;
+    
+    static query_step make(op code, util::u64 n_args = 0, bool value = false)
+    {
+        query_step step;
+        step.code = code;
+        step.column = nullptr;
+        step.n_args = n_args;
+        step.value = value;
+        return step;
+    }
+};
+
+//  plan_query [private]: Resolve the labels of `expr` and append its instructions
+//      to `program`.
+
+void util::categorical::plan_query(const util::query_expr& expr, std::vector<query_step>& program) const
+{
+    using kind = util::query_expr::kind;
+    using op = query_step::op;
+    
+    const auto label_it_end = m_label_ids->endk();
+    
+    switch (expr.type())
+    {
+        case kind::find:
+        case kind::find_or:
+        {
+            const bool is_or = expr.type() == kind::find_or;
+            std::vector<find_term> terms;
+            
+            for (const auto& lab : expr.labels())
+            {
+                const auto search_it = m_label_ids->find(lab);
+                
+                if (search_it == label_it_end)
+                {
+                    if (is_or)
+                    {
+                        continue;
+                    }
+                    
+                    terms.clear();
+                    break;
+                }
+                
+                const u64 cat_idx = m_category_indices->at(m_in_category->at(lab));
+                
+                add_find_term(terms, &m_labels[cat_idx], search_it->second);
+            }
+            
+            if (terms.empty())
+            {
+                program.push_back(query_step::make(op::constant, 0, false));
+                return;
+            }
+            
+            for (auto& term : terms)
+            {
+                query_step step = query_step::make(op::term);
+                step.column = term.column;
+                step.ids = std::move(term.ids);
+                program.push_back(std::move(step));
+            }
+            
+            program.push_back(query_step::make(is_or ? op::any_of : op::all_of, terms.size()));
+            return;
+        }
+        case kind::in_category:
+        {
+            const auto cat_it = m_category_indices->find(expr.category());
+            query_step step = query_step::make(op::term);
+            
+            if (cat_it != m_category_indices->end())
+            {
+                step.column = &m_labels[cat_it->second];
+                
+                for (const auto& lab : expr.labels())
+                {
+                    const auto search_it = m_label_ids->find(lab);
+                    
+                    if (search_it != label_it_end && m_in_category->at(lab) == expr.category())
+                    {
+                        step.ids.push_back(search_it->second);
+                    }
+                }
+            }
+            
+            if (step.ids.empty())
+            {
+                program.push_back(query_step::make(op::constant, 0, false));
+            }
+            else
+            {
+                program.push_back(std::move(step));
+            }
+            
+            return;
+        }
+        case kind::all_of:
+        case kind::any_of:
+        {
+            const bool is_and = expr.type() == kind::all_of;
+            const auto& children = expr.children();
+            
+            if (children.empty())
+            {
+                program.push_back(query_step::make(op::constant, 0, is_and));
+                return;
+            }
+            
+            for (const auto& child : children)
+            {
+                plan_query(child, program);
+            }
+            
+            program.push_back(query_step::make(is_and ? op::all_of : op::any_of, children.size()));
+            return;
+        }
+        case kind::negate:
+        {
+            for (const auto& child : expr.children())
+            {
+                plan_query(child, program);
+            }
+            
+            program.push_back(query_step::make(op::negate));
+            return;
+        }
+    }
+}
+
+//  find_expr_impl [private]: Implementation of find_expr. The expression is
+//      planned once, then evaluated in a single pass over the rows, a block
+//      at a time.
+
+std::vector<util::u64> util::categorical::find_expr_impl(const util::query_expr& expr,
+                                                         const bool use_indices,
+                                                         const std::vector<util::u64>& indices,
+                                                         util::u32* status,
+                                                         util::u64 index_offset) const
+{
+    using op = query_step::op;
+    
+    std::vector<util::u64> out;
+    const u64 sz = size();
+    
+    *status = util::categorical_status::OK;
+    
+    std::vector<util::u64> mask;
+    
+    if (use_indices)
+    {
+        *status = bounds_check(indices.data(), indices.size(), sz, index_offset);
+        
+        if (*status != util::categorical_status::OK)
+        {
+            return out;
+        }
+        
+        mask = make_index_words(sz, indices, index_offset);
+    }
+    
+    std::vector<query_step> program;
+    plan_query(expr, program);
+    
+    auto evaluate = [&](util::u64 begin, util::u64 end, std::vector<util::u64>& result) -> void {
+        std::vector<util::u64> stack;
+        stack.reserve(program.size());
+        
+        for (util::u64 start = begin; start < end; start += find_block_size)
+        {
+            const util::u64 n = std::min(find_block_size, end - start);
+            const util::u64 valid = n == find_block_size ? ~util::u64(0) : (util::u64(1) << n) - 1;
+            
+            stack.clear();
+            
+            for (const auto& step : program)
+            {
+                switch (step.code)
+                {
+                    case op::term:
+                        stack.push_back(match_block(*step.column, step.ids, start, n));
+                        break;
+                    case op::constant:
+                        stack.push_back(step.value ? valid : 0);
+                        break;
+                    case op::all_of:
+                    case op::any_of:
+                    {
+                        const bool is_and = step.code == op::all_of;
+                        util::u64 word = is_and ? valid : 0;
+                        
+                        for (util::u64 i = 0; i < step.n_args; i++)
+                        {
+                            word = is_and ? (word & stack.back()) : (word | stack.back());
+                            stack.pop_back();
+                        }
+                        
+                        stack.push_back(word);
+                        break;
+                    }
+                    case op::negate:
+                        stack.back() = ~stack.back() & valid;
+                        break;
+                }
+            }
+            
+            util::u64 word = stack.back();
+            
+            if (use_indices)
+            {
+                word &= mask[start / find_block_size];
+            }
+            
+            while (word != 0)
+            {
+                result.push_back(start + util::ctz64(word) + index_offset);
+                word &= word - 1;
+            }
+        }
+    };
+    
+    std::vector<std::vector<util::u64>> parts(util::parallel::n_chunks(sz));
+    
+    util::parallel::for_each_chunk(sz, parts.size(), [&](util::u64 chunk, util::u64 begin, util::u64 end) {
+        evaluate(begin, end, parts[chunk]);
+    });
+    
+    return concatenate(parts);
+}
+
+//  find_batch_impl [private]: Implementation of find_batch.
+//
+//      Each (query, category) pair is a slot, which matches the rows whose id
+//      in that category is one of the slot's ids. A query matches the rows
+//      matched by all of its slots. Each touched column is scanned once per
+//      block of rows, and each row's id is routed to every slot that
+//      references it.
+
+std::vector<std::vector<util::u64>> util::categorical::find_batch_impl(const std::vector<std::vector<std::string>>& label_sets,
+                                                                       const bool use_indices,
+                                                                       const std::vector<util::u64>& indices,
+                                                                       util::u32* status,
+                                                                       util::u64 index_offset) const
+{
+    struct batch_column
+    {
+        const util::label_column* column;
+        util::u32 max_id;
+        //  slots referencing id i are routes[offsets[i]] .. routes[offsets[i+1]]
+        std::vector<util::u32> offsets;
+        std::vector<util::u32> routes;
+    };
+    
+    const u64 n_queries = label_sets.size();
+    const u64 sz = size();
+    const auto label_it_end = m_label_ids->endk();
+    
+    std::vector<std::vector<util::u64>> out(n_queries);
+    
+    *status = util::categorical_status::OK;
+    
+    std::vector<util::u64> mask;
+    
+    if (use_indices)
+    {
+        *status = bounds_check(indices.data(), indices.size(), sz, index_offset);
+        
+        if (*status != util::categorical_status::OK)
+        {
+            return out;
+        }
+        
+        mask = make_index_words(sz, indices, index_offset);
+    }
+    
+    //  slots of query i are [slot_begin[i], slot_begin[i+1]); queries without
+    //  slots match no rows.
+    std::vector<util::u64> slot_begin(n_queries + 1, 0);
+    std::vector<find_term> slots;
+    
+    for (u64 i = 0; i < n_queries; i++)
+    {
+        std::vector<find_term> terms;
+        
+        for (const auto& lab : label_sets[i])
+        {
+            const auto search_it = m_label_ids->find(lab);
+            
+            if (search_it == label_it_end)
+            {
+                terms.clear();
+                break;
+            }
+            
+            const u64 cat_idx = m_category_indices->at(m_in_category->at(lab));
+            
+            add_find_term(terms, &m_labels[cat_idx], search_it->second);
+        }
+        
+        for (auto& term : terms)
+        {
+            slots.push_back(std::move(term));
+        }
+        
+        slot_begin[i+1] = slots.size();
+    }
+    
+    if (slots.empty())
+    {
+        return out;
+    }
+    
+    std::vector<batch_column> columns;
+    
+    for (const auto& slot : slots)
+    {
+        auto it = std::find_if(columns.begin(), columns.end(), [&](const batch_column& col) {
+            return col.column == slot.column;
+        });
+        
+        if (it == columns.end())
+        {
+            batch_column col;
+            col.column = slot.column;
+            col.max_id = 0;
+            columns.push_back(std::move(col));
+            it = columns.end() - 1;
+        }
+        
+        for (const auto id : slot.ids)
+        {
+            it->max_id = std::max(it->max_id, id);
+        }
+    }
+    
+    for (auto& col : columns)
+    {
+        col.offsets.assign(u64(col.max_id) + 2, 0);
+        
+        for (const auto& slot : slots)
+        {
+            if (slot.column == col.column)
+            {
+                for (const auto id : slot.ids)
+                {
+                    col.offsets[id+1]++;
+                }
+            }
+        }
+        
+        for (u64 i = 1; i < col.offsets.size(); i++)
+        {
+            col.offsets[i] += col.offsets[i-1];
+        }
+        
+        std::vector<util::u32> next(col.offsets.begin(), col.offsets.end() - 1);
+        col.routes.resize(col.offsets.back());
+        
+        for (u64 i = 0; i < slots.size(); i++)
+        {
+            if (slots[i].column == col.column)
+            {
+                for (const auto id : slots[i].ids)
+                {
+                    col.routes[next[id]++] = util::u32(i);
+                }
+            }
+        }
+    }
+    
+    std::vector<util::u64> slot_words(slots.size());
+    
+    for (util::u64 start = 0; start < sz; start += find_block_size)
+    {
+        const util::u64 n = std::min(find_block_size, sz - start);
+        const util::u64 valid = n == find_block_size ? ~util::u64(0) : (util::u64(1) << n) - 1;
+        
+        std::fill(slot_words.begin(), slot_words.end(), 0);
+        
+        for (const auto& col : columns)
+        {
+            col.column->visit([&](const auto* codes) -> void {
+                for (util::u64 j = 0; j < n; j++)
+                {
+                    const util::u32 id = codes[start + j];
+                    
+                    if (id > col.max_id)
+                    {
+                        continue;
+                    }
+                    
+                    const util::u64 bit = util::u64(1) << j;
+                    
+                    for (util::u32 k = col.offsets[id]; k < col.offsets[id+1]; k++)
+                    {
+                        slot_words[col.routes[k]] |= bit;
+                    }
+                }
+            });
+        }
+        
+        for (u64 i = 0; i < n_queries; i++)
+        {
+            if (slot_begin[i] == slot_begin[i+1])
+            {
+                continue;
+            }
+            
+            util::u64 word = valid;
+            
+            for (u64 j = slot_begin[i]; j < slot_begin[i+1]; j++)
+            {
+                word &= slot_words[j];
+            }
+            
+            if (use_indices)
+            {
+                word &= mask[start / find_block_size];
+            }
+            
+            std::vector<util::u64>& result = out[i];
+            
+            while (word != 0)
+            {
+                result.push_back(start + util::ctz64(word) + index_offset);
+                word &= word - 1;
+            }
+        }
+    }
+    
+    return out;
+}
+
+//  use_label_index [private]: True if queries should be answered from the label index.
+
+bool util::categorical::use_label_index() const
+{
+    const u64 sz = size();
+    
+    //  an enabled parallel scan takes precedence over building the index serially.
+    return util::label_column::can_build_postings(sz) && !util::parallel::applies(sz);
+}
+
+util::u32 util::categorical::assign_bit_array(util::bit_array& mask,
+                                              const std::vector<util::u64>& at_indices,
+                                              util::u64 index_offset)
+{
+    const u64 mask_sz = mask.size();
+    const u64 n_indices = at_indices.size();
+    const u64* indices = at_indices.data();
+    
+    for (u64 i = 0; i < n_indices; i++)
+    {
+        u64 assign_idx = indices[i] - index_offset;
+        
+        if (assign_idx >= mask_sz)
+        {
+            return util::categorical_status::OUT_OF_BOUNDS;
+        }
+        
+        mask.unchecked_place(true, assign_idx);
+    }
+    
+    return util::categorical_status::OK;
+}
+
+//  assign_bit_array: Assign true to bit_array where label id is found
+
+util::bit_array util::categorical::assign_bit_array(const util::label_column& labels, util::u32 lab)
+{
+    u64 sz = labels.size();
+    
+    util::bit_array out(sz, false);
+    
+    //  chunks are word-aligned, so threads never write to the same word.
+    util::parallel::for_each_chunk(sz, util::parallel::n_chunks(sz), [&](u64, u64 begin, u64 end) {
+        labels.visit([&](const auto* ids) -> void {
+            for (util::u64 i = begin; i < end; i++)
+            {
+                if (ids[i] == lab)
+                {
+                    out.unchecked_place(true, i);
+                }
+            }
+        });
+    });
+    
+    return out;
+}
+
+util::bit_array util::categorical::assign_bit_array(const util::label_column& labels,
+                                                    util::u32 lab,
+                                                    const std::vector<util::u64>& indices,
+                                                    util::u32* status,
+                                                    util::u64 index_offset)
+{
+    *status = util::categorical_status::OK;
+    
+    util::u64 sz = labels.size();
+    util::bit_array out(sz, false);
+    util::u64 n_inds = indices.size();
+    
+    labels.visit([&](const auto* ids) -> void {
+        for (util::u64 i = 0; i < n_inds; i++)
+        {
+            const util::u64 idx = indices[i] - index_offset;
+            
+            if (idx >= sz)
+            {
+                *status = util::categorical_status::OUT_OF_BOUNDS;
+                return;
+            }
+            
+            if (ids[idx] == lab)
+            {
+                out.unchecked_place(true, idx);
+            }
+        }
+    });
+    
     return out;
 }
 
-util::bit_array util::categorical::assign_bit_array(const std::vector<util::u32>& labels,
-                                                    util::u32 lab,
-                                                    const std::vector<util::u64>& indices,
-                                                    util::u32* status,
-                                                    util::u64 index_offset)
+std::vector<util::u64> util::categorical::get_category_indices(const std::vector<std::string>& cats,
+                                                               const util::u64 n_cats,
+                                                               bool* exist) const
+{
+    std::vector<u64> category_inds;
+    *exist = true;
+    
+    for (u64 i = 0; i < n_cats; i++)
+    {
+        auto category_idx_it = m_category_indices->find(cats[i]);
+        
+        //  if a category doesn't exist, no combinations can exist with it.
+        if (category_idx_it == m_category_indices->end())
+        {
+            *exist = false;
+            return std::vector<u64>();
+        }
+        
+        category_inds.push_back(category_idx_it->second);
+    }
+    
+    return category_inds;
+}
+
+std::vector<util::u64> util::categorical::get_category_indices_unchecked_has_category(const std::vector<std::string>& cats) const
+{
+    const u64 num_cats = cats.size();
+    std::vector<util::u64> result(num_cats);
+    
+    for (u64 i = 0; i < num_cats; i++)
+    {
+        result[i] = m_category_indices->at(cats[i]);
+    }
+    
+    return result;
+}
+
+namespace
+{
+    //  empty_groups: Groups with no members.
+    util::groups_t empty_groups()
+    {
+        util::groups_t result;
+        result.offsets.push_back(0);
+        return result;
+    }
+    
+    //  make_groups: Gather the rows searched into groups, given the group of each
+    //      row. Rows are kept in search order within each group.
+    util::groups_t make_groups(std::vector<util::u64>&& group_ids,
+                               util::u64 n_groups,
+                               const bool use_indices,
+                               const std::vector<util::u64>& indices,
+                               util::u64 index_offset,
+                               const bool with_group_ids)
+    {
+        using util::u64;
+        
+        util::groups_t result;
+        const u64 rows = group_ids.size();
+        
+        result.offsets.assign(n_groups + 1, 0);
+        
+        for (u64 i = 0; i < rows; i++)
+        {
+            result.offsets[group_ids[i] + 1]++;
+        }
+        
+        for (u64 i = 0; i < n_groups; i++)
+        {
+            result.offsets[i + 1] += result.offsets[i];
+        }
+        
+        std::vector<u64> next(result.offsets.begin(), result.offsets.end() - 1);
+        result.indices.resize(rows);
+        
+        for (u64 i = 0; i < rows; i++)
+        {
+            result.indices[next[group_ids[i]]++] = use_indices ? indices[i] : i + index_offset;
+        }
+        
+        if (with_group_ids)
+        {
+            result.group_ids = std::move(group_ids);
+        }
+        
+        return result;
+    }
+    
+    //  to_nested: Copy each group into its own vector.
+    std::vector<std::vector<util::u64>> to_nested(const util::groups_t& groups)
+    {
+        const util::u64 n_groups = groups.offsets.empty() ? 0 : groups.offsets.size() - 1;
+        std::vector<std::vector<util::u64>> result(n_groups);
+        
+        for (util::u64 i = 0; i < n_groups; i++)
+        {
+            auto begin = groups.indices.begin();
+            result[i].assign(begin + groups.offsets[i], begin + groups.offsets[i + 1]);
+        }
+        
+        return result;
+    }
+}
+
+//  find_all_hash_impl: Get indices of all possible unique combinations of labels, hashing rows.
+
+util::groups_t
+util::categorical::find_all_hash_impl(const std::vector<std::string>& categories,
+                                      const bool use_indices,
+                                      const std::vector<util::u64>& indices,
+                                      util::u32* status,
+                                      util::u64 index_offset,
+                                      const bool with_group_ids) const
+{
+    *status = util::categorical_status::OK;
+    
+    u64 n_cats_in = categories.size();
+    bool cats_exist;
+    std::vector<u64> category_inds = get_category_indices(categories, n_cats_in, &cats_exist);
+    
+    if (n_cats_in == 0 || !cats_exist)
+    {
+        return empty_groups();
+    }
+    
+    const u64 rows = use_indices ? indices.size() : size();
+    const u64 max_rows = use_indices ? size() : rows;
+    
+    std::string hash_code = make_label_id_hash_string(n_cats_in);
+    char* hash_code_ptr = &hash_code[0];
+    
+    std::unordered_map<std::string, u64> combination_exists;
+    std::vector<u64> group_ids(rows);
+    u64 next_id = 0;
+    
+    for (u64 i = 0; i < rows; i++)
+    {
+        u64 internal_index = i;
+        
+        if (use_indices)
+        {
+            internal_index = indices[i] - index_offset;
+            
+            if (internal_index >= max_rows)
+            {
+                *status = util::categorical_status::OUT_OF_BOUNDS;
+                return empty_groups();
+            }
+        }
+        
+        build_row_hash(hash_code_ptr, m_labels, internal_index, category_inds);
+        
+        const auto c_it = combination_exists.find(hash_code);
+        
+        //  Doesn't exist, add a new group.
+        if (c_it == combination_exists.end())
+        {
+            combination_exists[hash_code] = next_id;
+            group_ids[i] = next_id++;
+        }
+        else
+        {
+            group_ids[i] = c_it->second;
+        }
+    }
+    
+    return make_groups(std::move(group_ids), next_id, use_indices, indices, index_offset, with_group_ids);
+}
+    
+util::groups_t
+util::categorical::find_all_custom_hash_impl(const std::vector<std::string>& categories,
+                                             const bool use_indices,
+                                             const std::vector<util::u64>& indices,
+                                             util::u32* status,
+                                             util::u64 index_offset,
+                                             const bool with_group_ids) const
+{
+    *status = util::categorical_status::OK;
+    
+    const u64 num_cats = categories.size();
+    bool cats_exist;
+    std::vector<u64> category_inds = get_category_indices(categories, num_cats, &cats_exist);
+    
+    if (num_cats == 0 || !cats_exist)
+    {
+        return empty_groups();
+    }
+    
+    const u64 rows = use_indices ? indices.size() : size();
+    const u64 max_rows = use_indices ? size() : rows;
+    
+    std::vector<u32> ids(num_cats);
+    u32* id_data = &ids[0];
+    std::vector<u64> group_ids(rows);
+    u64 next_id = 0;
+    
+    util::IntegralTypeRowMap<u32, u64> row_map(num_cats);
+    row_map.reserve(2 * u64(std::sqrt(double(rows))));
+    
+    for (u64 i = 0; i < rows; i++)
+    {
+        u64 internal_index = i;
+        
+        if (use_indices)
+        {
+            internal_index = indices[i] - index_offset;
+            
+            if (internal_index >= max_rows)
+            {
+                *status = util::categorical_status::OUT_OF_BOUNDS;
+                return empty_groups();
+            }
+        }
+        
+        for (u64 j = 0; j < num_cats; j++)
+        {
+            id_data[j] = m_labels[category_inds[j]][internal_index];
+        }
+        
+        const auto c_it = row_map.find(id_data);
+
+        //  Doesn't exist, add a new group.
+        if (c_it.value == nullptr)
+        {
+            row_map.insert(c_it, id_data, next_id);
+            group_ids[i] = next_id++;
+        }
+        else
+        {
+            group_ids[i] = *c_it.value;
+        }
+    }
+    
+    return make_groups(std::move(group_ids), next_id, use_indices, indices, index_offset, with_group_ids);
+}
+
+//  find_all_sort_impl: Get indices of all possible unique combinations of labels, sorting rows.
+
+util::groups_t
+util::categorical::find_all_sort_impl(const std::vector<std::string>& categories,
+                                      const bool use_indices,
+                                      const std::vector<util::u64>& indices,
+                                      util::u32* status,
+                                      util::u64 index_offset,
+                                      const bool with_group_ids) const
+{
+    *status = util::categorical_status::OK;
+    
+    const u64 rows = use_indices ? indices.size() : size();
+    //  @Robustness: Restrict num categories to s64 range.
+    const u64 num_cats_in = categories.size();
+    bool cats_exist;
+    const std::vector<u64> category_inds = get_category_indices(categories, num_cats_in, &cats_exist);
+    
+    if (num_cats_in == 0 || !cats_exist || rows == 0)
+    {
+        return empty_groups();
+    }
+    
+    if (use_indices)
+    {
+        const u32 bounds_status = bounds_check(indices.data(), indices.size(), size(), index_offset);
+        if (bounds_status != categorical_status::OK)
+        {
+            *status = bounds_status;
+            return empty_groups();
+        }
+    }
+    
+    std::vector<u64> sorted_indices(rows);
+    std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
+    
+    if (num_cats_in > 1)
+    {
+        //  Sort rows of matrix.
+        std::vector<u64> row_indices(rows);
+        std::vector<u64> sorted_indices_tmp(rows);
+        
+        for (s64 i = num_cats_in-1; i >= 0; i--)
+        {
+            std::iota(row_indices.begin(), row_indices.end(), 0);
+            
+            m_labels[category_inds[i]].visit([&](const auto* column) -> void {
+                if (use_indices)
+                {
+                    std::stable_sort(row_indices.begin(), row_indices.end(), [column, &sorted_indices, &indices, index_offset](u64 i0, u64 i1) -> bool
+                    {
+                        const u64 col_i0 = indices[sorted_indices[i0]] - index_offset;
+                        const u64 col_i1 = indices[sorted_indices[i1]] - index_offset;
+                        
+                        return column[col_i0] < column[col_i1];
+                    });
+                }
+                else
+                {
+                    std::stable_sort(row_indices.begin(), row_indices.end(), [column, &sorted_indices](u64 i0, u64 i1) -> bool
+                    {
+                        return column[sorted_indices[i0]] < column[sorted_indices[i1]];
+                    });
+                }
+            });
+            
+            for (u64 j = 0; j < rows; j++)
+            {
+                sorted_indices_tmp[j] = sorted_indices[row_indices[j]];
+            }
+            
+            std::swap(sorted_indices_tmp, sorted_indices);
+        }
+    }
+    else
+    {
+        //  Just sort the column.
+        m_labels[category_inds[0]].visit([&](const auto* column) -> void {
+            if (use_indices)
+            {
+                std::sort(sorted_indices.begin(), sorted_indices.end(), [column, &indices, index_offset](u64 i0, u64 i1) -> bool
+                {
+                    return column[indices[i0] - index_offset] < column[indices[i1] - index_offset];
+                });
+            }
+            else
+            {
+                std::sort(sorted_indices.begin(), sorted_indices.end(), [column](u64 i0, u64 i1) -> bool
+                {
+                    return column[i0] < column[i1];
+                });
+            }
+        });
+    }
+    
+    util::groups_t result;
+    result.indices.resize(rows);
+    
+    if (with_group_ids)
+    {
+        result.group_ids.resize(rows);
+    }
+    
+    u64 reference = 0;
+    
+    for (u64 i = 0; i < rows; i++)
+    {
+        bool new_combination = i == reference || false;
+        u64 ref_row;
+        u64 test_row;
+        
+        if (use_indices)
+        {
+            ref_row = indices[sorted_indices[reference]] - index_offset;
+            test_row = indices[sorted_indices[i]] - index_offset;
+        }
+        else
+        {
+            ref_row = sorted_indices[reference];
+            test_row = sorted_indices[i];
+        }
+        
+        for (u64 j = 0; j < num_cats_in; j++)
+        {
+            const u64 col = category_inds[j];
+            const u32 ref_id = m_labels[col][ref_row];
+            const u32 test_id = m_labels[col][test_row];
+            
+            if (ref_id != test_id)
+            {
+                new_combination = true;
+                break;
+            }
+        }
+        
+        if (new_combination)
+        {
+            reference = i;
+            result.offsets.push_back(i);
+        }
+        
+        result.indices[i] = test_row + index_offset;
+        
+        if (with_group_ids)
+        {
+            result.group_ids[sorted_indices[i]] = result.offsets.size() - 1;
+        }
+    }
+    
+    result.offsets.push_back(rows);
+    
+    return result;
+}
+
+namespace
+{
+    //  Number of bits needed to represent every id in [0, capacity).
+    util::u32 id_bit_width(util::u32 capacity)
+    {
+        util::u32 n_bits = 1;
+        
+        while (n_bits < 32 && (util::u64(1) << n_bits) < capacity)
+        {
+            n_bits++;
+        }
+        
+        return n_bits;
+    }
+    
+    //  radix_sort_pairs: Stable LSD radix sort of (key, position) pairs on the
+    //      low `n_bits` of each key, one byte per pass. The histograms of all
+    //      bytes are built in a single read, and a pass whose byte is the same
+    //      for every key is skipped.
+    void radix_sort_pairs(std::vector<util::u64>& keys,
+                          std::vector<util::u64>& positions,
+                          std::vector<util::u64>& keys_tmp,
+                          std::vector<util::u64>& positions_tmp,
+                          util::u32 n_bits)
+    {
+        using util::u64;
+        
+        const u64 n = keys.size();
+        const util::u32 n_bytes = (n_bits + 7) / 8;
+        
+        std::vector<u64> counts(n_bytes * 256, 0);
+        
+        for (u64 i = 0; i < n; i++)
+        {
+            const u64 key = keys[i];
+            
+            for (util::u32 j = 0; j < n_bytes; j++)
+            {
+                counts[j * 256 + ((key >> (j * 8)) & 0xff)]++;
+            }
+        }
+        
+        for (util::u32 j = 0; j < n_bytes; j++)
+        {
+            const util::u32 shift = j * 8;
+            u64* offsets = &counts[j * 256];
+            
+            if (offsets[(keys[0] >> shift) & 0xff] == n)
+            {
+                continue;
+            }
+            
+            u64 total = 0;
+            
+            for (u64 k = 0; k < 256; k++)
+            {
+                const u64 count = offsets[k];
+                offsets[k] = total;
+                total += count;
+            }
+            
+            for (u64 i = 0; i < n; i++)
+            {
+                const u64 dest = offsets[(keys[i] >> shift) & 0xff]++;
+                keys_tmp[dest] = keys[i];
+                positions_tmp[dest] = positions[i];
+            }
+            
+            std::swap(keys, keys_tmp);
+            std::swap(positions, positions_tmp);
+        }
+    }
+}
+
+//  find_all_radix_impl: Get indices of all possible unique combinations of labels, radix
+//      sorting rows.
+//
+//      The label ids of each row are packed into one or more 64-bit keys, the
+//      first category in the most significant bits, and positions are sorted
+//      key by key, starting with the least significant. Groups are then split
+//      where adjacent sorted keys differ, so the columns are not read again.
+//      The groups, and their order, are those of find_all_sort_impl. Rows
+//      within a group keep the order in which they were searched, which
+//      find_all_sort_impl does not guarantee for a single category, since it
+//      sorts that column unstably.
+
+util::groups_t
+util::categorical::find_all_radix_impl(const std::vector<std::string>& categories,
+                                       const bool use_indices,
+                                       const std::vector<util::u64>& indices,
+                                       util::u32* status,
+                                       util::u64 index_offset,
+                                       const bool with_group_ids) const
+{
+    *status = util::categorical_status::OK;
+    
+    const u64 rows = use_indices ? indices.size() : size();
+    const u64 num_cats_in = categories.size();
+    bool cats_exist;
+    const std::vector<u64> category_inds = get_category_indices(categories, num_cats_in, &cats_exist);
+    
+    if (num_cats_in == 0 || !cats_exist || rows == 0)
+    {
+        return empty_groups();
+    }
+    
+    if (use_indices)
+    {
+        const u32 bounds_status = bounds_check(indices.data(), indices.size(), size(), index_offset);
+        if (bounds_status != categorical_status::OK)
+        {
+            *status = bounds_status;
+            return empty_groups();
+        }
+    }
+    
+    auto row_at = [&](u64 position) -> u64 {
+        return use_indices ? indices[position] - index_offset : position;
+    };
+    
+    const u32 id_bits = id_bit_width(label_id_capacity());
+    const u64 cats_per_word = 64 / id_bits;
+    const u64 n_words = (num_cats_in + cats_per_word - 1) / cats_per_word;
+    
+    //  Keys of each word, by position. Only retained when there is more than one
+    //  word; otherwise the sorted keys alone delimit groups.
+    std::vector<std::vector<u64>> word_keys(n_words > 1 ? n_words : 0);
+    
+    std::vector<u64> keys(rows);
+    std::vector<u64> positions(rows);
+    std::vector<u64> keys_tmp(rows);
+    std::vector<u64> positions_tmp(rows);
+    
+    std::iota(positions.begin(), positions.end(), 0);
+    
+    for (s64 w = s64(n_words) - 1; w >= 0; w--)
+    {
+        const u64 cat_begin = u64(w) * cats_per_word;
+        const u64 cat_end = std::min(cat_begin + cats_per_word, num_cats_in);
+        
+        std::vector<u64>& dest = n_words > 1 ? word_keys[w] : keys;
+        
+        if (n_words > 1)
+        {
+            dest.resize(rows);
+        }
+        
+        std::fill(dest.begin(), dest.end(), 0);
+        
+        for (u64 c = cat_begin; c < cat_end; c++)
+        {
+            m_labels[category_inds[c]].visit([&](const auto* column) -> void {
+                for (u64 i = 0; i < rows; i++)
+                {
+                    dest[i] = (dest[i] << id_bits) | column[row_at(i)];
+                }
+            });
+        }
+        
+        if (n_words > 1)
+        {
+            for (u64 i = 0; i < rows; i++)
+            {
+                keys[i] = dest[positions[i]];
+            }
+        }
+        
+        radix_sort_pairs(keys, positions, keys_tmp, positions_tmp, u32(cat_end - cat_begin) * id_bits);
+    }
+    
+    util::groups_t result;
+    result.indices.resize(rows);
+    
+    if (with_group_ids)
+    {
+        result.group_ids.resize(rows);
+    }
+    
+    for (u64 i = 0; i < rows; i++)
+    {
+        bool new_combination = i == 0 || keys[i] != keys[i-1];
+        
+        for (u64 w = 1; w < n_words && !new_combination; w++)
+        {
+            new_combination = word_keys[w][positions[i]] != word_keys[w][positions[i-1]];
+        }
+        
+        if (new_combination)
+        {
+            result.offsets.push_back(i);
+        }
+        
+        result.indices[i] = row_at(positions[i]) + index_offset;
+        
+        if (with_group_ids)
+        {
+            result.group_ids[positions[i]] = result.offsets.size() - 1;
+        }
+    }
+    
+    result.offsets.push_back(rows);
+    
+    return result;
+}
+
+//  dense_key_strides [private]: Assign each label of `categories` a code in [0, k),
+//      where k is the number of labels in its category, and compute the stride of
+//      each category in a mixed-radix key over those codes.
+//
+//      Returns false if the number of possible keys exceeds CAT_DENSE_KEY_MAX_SPACE.
+
+bool util::categorical::dense_key_strides(const std::vector<std::string>& categories,
+                                          std::vector<util::u32>& local_codes,
+                                          std::vector<util::u64>& strides,
+                                          util::u64* n_keys) const
+{
+    std::unordered_map<std::string, u64> cardinalities;
+    
+    for (const auto& category : categories)
+    {
+        cardinalities.emplace(category, 0);
+    }
+    
+    local_codes.assign(label_id_capacity(), 0);
+    
+    for (const auto& it : *m_in_category)
+    {
+        auto card_it = cardinalities.find(it.second);
+        
+        if (card_it != cardinalities.end())
+        {
+            local_codes[m_label_ids->at(it.first)] = u32(card_it->second++);
+        }
+    }
+    
+    const u64 n_cats = categories.size();
+    u64 n_possible = 1;
+    
+    strides.resize(n_cats);
+    
+    for (s64 i = s64(n_cats) - 1; i >= 0; i--)
+    {
+        const u64 cardinality = std::max(cardinalities.at(categories[i]), u64(1));
+        
+        strides[i] = n_possible;
+        n_possible *= cardinality;
+        
+        if (n_possible > CAT_DENSE_KEY_MAX_SPACE)
+        {
+            return false;
+        }
+    }
+    
+    *n_keys = n_possible;
+    
+    return true;
+}
+
+//  find_all_dense_key_impl: Get indices of all possible unique combinations of labels,
+//      indexing a table by a mixed-radix key of each row.
+//
+//      Groups are in order of first appearance, as in find_all_hash_impl, which
+//      is used instead when the key space is too large relative to
+//      CAT_DENSE_KEY_MAX_SPACE or the number of rows.
+
+util::groups_t
+util::categorical::find_all_dense_key_impl(const std::vector<std::string>& categories,
+                                           const bool use_indices,
+                                           const std::vector<util::u64>& indices,
+                                           util::u32* status,
+                                           util::u64 index_offset,
+                                           const bool with_group_ids) const
+{
+    *status = util::categorical_status::OK;
+    
+    const u64 rows = use_indices ? indices.size() : size();
+    const u64 num_cats_in = categories.size();
+    bool cats_exist;
+    const std::vector<u64> category_inds = get_category_indices(categories, num_cats_in, &cats_exist);
+    
+    if (num_cats_in == 0 || !cats_exist)
+    {
+        return empty_groups();
+    }
+    
+    std::vector<u32> local_codes;
+    std::vector<u64> strides;
+    u64 n_keys;
+    
+    if (!dense_key_strides(categories, local_codes, strides, &n_keys) ||
+        n_keys > std::max(rows, u64(1)) * CAT_DENSE_KEY_ROWS_RATIO)
+    {
+        return find_all_method_dispatch(find_all_method::hash, categories, use_indices, indices,
+                                        status, index_offset, with_group_ids);
+    }
+    
+    if (use_indices)
+    {
+        const u32 bounds_status = bounds_check(indices.data(), indices.size(), size(), index_offset);
+        if (bounds_status != categorical_status::OK)
+        {
+            *status = bounds_status;
+            return empty_groups();
+        }
+    }
+    
+    //  Keys fit in 32 bits, because n_keys <= CAT_DENSE_KEY_MAX_SPACE.
+    std::vector<u32> keys(rows, 0);
+    
+    util::parallel::for_each_chunk(rows, util::parallel::n_chunks(rows), [&](u64, u64 begin, u64 end) {
+        for (u64 i = 0; i < num_cats_in; i++)
+        {
+            const u32 stride = u32(strides[i]);
+            
+            m_labels[category_inds[i]].visit([&](const auto* column) -> void {
+                if (use_indices)
+                {
+                    for (u64 j = begin; j < end; j++)
+                    {
+                        keys[j] += local_codes[column[indices[j] - index_offset]] * stride;
+                    }
+                }
+                else
+                {
+                    for (u64 j = begin; j < end; j++)
+                    {
+                        keys[j] += local_codes[column[j]] * stride;
+                    }
+                }
+            });
+        }
+    });
+    
+    const u32 no_group = ~u32(0);
+    std::vector<u32> groups(n_keys, no_group);
+    std::vector<u64> group_ids(rows);
+    u32 next_id = 0;
+    
+    for (u64 i = 0; i < rows; i++)
+    {
+        u32& group = groups[keys[i]];
+        
+        if (group == no_group)
+        {
+            group = next_id++;
+        }
+        
+        group_ids[i] = group;
+    }
+    
+    return make_groups(std::move(group_ids), next_id, use_indices, indices, index_offset, with_group_ids);
+}
+
+//  find_all_parallel_impl: Get indices of all possible unique combinations of labels,
+//      hashing rows on multiple threads.
+//
+//      Each chunk of rows is grouped independently. Chunk-local groups are then
+//      given global ids in chunk order, so that groups are in order of first
+//      appearance, as in find_all_hash_impl. If `sorted` is true, groups are
+//      instead ordered by their label ids, as in find_all_sort_impl.
+
+util::groups_t
+util::categorical::find_all_parallel_impl(const std::vector<std::string>& categories,
+                                          const bool use_indices,
+                                          const std::vector<util::u64>& indices,
+                                          util::u32* status,
+                                          util::u64 index_offset,
+                                          const bool with_group_ids,
+                                          const bool sorted) const
+{
+    *status = util::categorical_status::OK;
+    
+    const u64 rows = use_indices ? indices.size() : size();
+    const u64 n_cats_in = categories.size();
+    bool cats_exist;
+    const std::vector<u64> category_inds = get_category_indices(categories, n_cats_in, &cats_exist);
+    
+    if (n_cats_in == 0 || !cats_exist)
+    {
+        return empty_groups();
+    }
+    
+    if (use_indices)
+    {
+        const u32 bounds_status = bounds_check(indices.data(), indices.size(), size(), index_offset);
+        if (bounds_status != categorical_status::OK)
+        {
+            *status = bounds_status;
+            return empty_groups();
+        }
+    }
+    
+    //  Chunk-local groups, by key in order of first appearance, and their
+    //  global ids.
+    struct partial_groups
+    {
+        std::vector<std::string> keys;
+        std::vector<u64> global_ids;
+    };
+    
+    std::vector<partial_groups> parts(util::parallel::n_chunks(rows));
+    std::vector<u64> group_ids(rows);
+    
+    util::parallel::for_each_chunk(rows, parts.size(), [&](u64 chunk, u64 begin, u64 end) {
+        std::string hash_code = make_label_id_hash_string(n_cats_in);
+        char* hash_code_ptr = &hash_code[0];
+        
+        std::unordered_map<std::string, u64> combination_exists;
+        std::vector<std::string>& keys = parts[chunk].keys;
+        
+        for (u64 i = begin; i < end; i++)
+        {
+            const u64 internal_index = use_indices ? indices[i] - index_offset : i;
+            
+            build_row_hash(hash_code_ptr, m_labels, internal_index, category_inds);
+            
+            const auto c_it = combination_exists.find(hash_code);
+            
+            if (c_it == combination_exists.end())
+            {
+                combination_exists.emplace(hash_code, keys.size());
+                group_ids[i] = keys.size();
+                keys.push_back(hash_code);
+            }
+            else
+            {
+                group_ids[i] = c_it->second;
+            }
+        }
+    });
+    
+    std::unordered_map<std::string, u64> combination_exists;
+    std::vector<const std::string*> global_keys;
+    
+    for (auto& part : parts)
+    {
+        const u64 n_local = part.keys.size();
+        part.global_ids.resize(n_local);
+        
+        for (u64 i = 0; i < n_local; i++)
+        {
+            const auto c_it = combination_exists.emplace(part.keys[i], global_keys.size());
+            
+            if (c_it.second)
+            {
+                global_keys.push_back(&c_it.first->first);
+            }
+            
+            part.global_ids[i] = c_it.first->second;
+        }
+    }
+    
+    const u64 n_groups = global_keys.size();
+    
+    if (sorted)
+    {
+        auto label_ids = [n_cats_in](const std::string* key) {
+            std::vector<u32> ids(n_cats_in);
+            std::memcpy(ids.data(), key->data(), n_cats_in * sizeof(u32));
+            return ids;
+        };
+        
+        std::vector<std::vector<u32>> group_labels(n_groups);
+        std::vector<u64> order(n_groups);
+        std::vector<u64> rank(n_groups);
+        
+        for (u64 i = 0; i < n_groups; i++)
+        {
+            group_labels[i] = label_ids(global_keys[i]);
+        }
+        
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&group_labels](u64 a, u64 b) -> bool {
+            return group_labels[a] < group_labels[b];
+        });
+        
+        for (u64 i = 0; i < n_groups; i++)
+        {
+            rank[order[i]] = i;
+        }
+        
+        for (auto& part : parts)
+        {
+            for (auto& id : part.global_ids)
+            {
+                id = rank[id];
+            }
+        }
+    }
+    
+    util::parallel::for_each_chunk(rows, parts.size(), [&](u64 chunk, u64 begin, u64 end) {
+        const std::vector<u64>& global_ids = parts[chunk].global_ids;
+        
+        for (u64 i = begin; i < end; i++)
+        {
+            group_ids[i] = global_ids[group_ids[i]];
+        }
+    });
+    
+    return make_groups(std::move(group_ids), n_groups, use_indices, indices, index_offset, with_group_ids);
+}
+
+//  choose_find_all_method [private]: Estimate the fastest method of grouping `rows` rows
+//      by `categories`, in order of first appearance.
+//
+//      Rows are grouped by dense key if the key space is bounded; otherwise by
+//      radix sort if enough rows are searched and the label ids of a row pack
+//      into few words; otherwise by hashing. See config.hpp.
+
+util::categorical::find_all_method
+util::categorical::choose_find_all_method(const std::vector<std::string>& categories, util::u64 rows) const
+{
+    std::vector<u32> local_codes;
+    std::vector<u64> strides;
+    u64 n_keys;
+    
+    if (dense_key_strides(categories, local_codes, strides, &n_keys) &&
+        n_keys <= std::max(rows, u64(1)) * CAT_DENSE_KEY_ROWS_RATIO)
+    {
+        return find_all_method::dense_key;
+    }
+    
+    const u64 cats_per_word = 64 / id_bit_width(label_id_capacity());
+    const u64 n_key_words = (categories.size() + cats_per_word - 1) / cats_per_word;
+    
+    if (rows >= CAT_AUTO_RADIX_MIN_ROWS && n_key_words <= CAT_AUTO_RADIX_MAX_KEY_WORDS)
+    {
+        return find_all_method::radix;
+    }
+    
+    return find_all_method::custom_hash;
+}
+
+namespace
+{
+    //  first_seen_order: Reorder groups by the position of their first row searched,
+    //      given the group of each row.
+    util::groups_t first_seen_order(util::groups_t&& groups, const bool with_group_ids)
+    {
+        using util::u64;
+        
+        const u64 n_groups = groups.offsets.size() - 1;
+        const u64 no_rank = ~u64(0);
+        
+        std::vector<u64> rank(n_groups, no_rank);
+        std::vector<u64> order;
+        order.reserve(n_groups);
+        
+        for (const u64 id : groups.group_ids)
+        {
+            if (rank[id] == no_rank)
+            {
+                rank[id] = order.size();
+                order.push_back(id);
+            }
+        }
+        
+        util::groups_t result;
+        result.indices.reserve(groups.indices.size());
+        result.offsets.reserve(n_groups + 1);
+        result.offsets.push_back(0);
+        
+        for (const u64 id : order)
+        {
+            auto begin = groups.indices.begin();
+            result.indices.insert(result.indices.end(), begin + groups.offsets[id], begin + groups.offsets[id + 1]);
+            result.offsets.push_back(result.indices.size());
+        }
+        
+        if (with_group_ids)
+        {
+            result.group_ids = std::move(groups.group_ids);
+            
+            for (u64& id : result.group_ids)
+            {
+                id = rank[id];
+            }
+        }
+        
+        return result;
+    }
+}
+
+//  find_all_automatic_impl: Get indices of all possible unique combinations of labels,
+//      in order of first appearance, with the method given by choose_find_all_method.
+
+util::groups_t
+util::categorical::find_all_automatic_impl(const std::vector<std::string>& categories,
+                                           const bool use_indices,
+                                           const std::vector<util::u64>& indices,
+                                           util::u32* status,
+                                           util::u64 index_offset,
+                                           const bool with_group_ids) const
+{
+    const u64 rows = use_indices ? indices.size() : size();
+    const find_all_method method = choose_find_all_method(categories, rows);
+    
+    if (method != find_all_method::radix || util::parallel::applies(rows))
+    {
+        const find_all_method unsorted = method == find_all_method::radix ? find_all_method::custom_hash : method;
+        return find_all_method_dispatch(unsorted, categories, use_indices, indices, status, index_offset, with_group_ids);
+    }
+    
+    util::groups_t groups = find_all_radix_impl(categories, use_indices, indices, status, index_offset, true);
+    
+    if (*status != util::categorical_status::OK)
+    {
+        return groups;
+    }
+    
+    return first_seen_order(std::move(groups), with_group_ids);
+}
+
+util::groups_t util::categorical::find_all_method_dispatch(const util::categorical::find_all_method method,
+                                                          const std::vector<std::string>& categories,
+                                                          const bool use_indices,
+                                                          const std::vector<util::u64>& indices,
+                                                          util::u32* status,
+                                                          util::u64 index_offset,
+                                                          const bool with_group_ids) const
+{
+    const u64 rows = use_indices ? indices.size() : size();
+    
+    //  The dense_key method parallelizes its own key computation, and the automatic
+    //  method dispatches again once it has chosen a method.
+    if (method != find_all_method::dense_key &&
+        method != find_all_method::automatic &&
+        util::parallel::applies(rows))
+    {
+        const bool sorted = method == find_all_method::sort || method == find_all_method::radix;
+        return find_all_parallel_impl(categories, use_indices, indices, status, index_offset, with_group_ids, sorted);
+    }
+    
+    switch (method)
+    {
+        case find_all_method::hash:
+            return find_all_hash_impl(categories, use_indices, indices, status, index_offset, with_group_ids);
+        case find_all_method::sort:
+            return find_all_sort_impl(categories, use_indices, indices, status, index_offset, with_group_ids);
+        case find_all_method::custom_hash:
+            return find_all_custom_hash_impl(categories, use_indices, indices, status, index_offset, with_group_ids);
+        case find_all_method::radix:
+            return find_all_radix_impl(categories, use_indices, indices, status, index_offset, with_group_ids);
+        case find_all_method::dense_key:
+            return find_all_dense_key_impl(categories, use_indices, indices, status, index_offset, with_group_ids);
+        case find_all_method::automatic:
+            return find_all_automatic_impl(categories, use_indices, indices, status, index_offset, with_group_ids);
+        default:
+            return find_all_hash_impl(categories, use_indices, indices, status, index_offset, with_group_ids);
+    }
+}
+
+std::vector<std::vector<util::u64>> util::categorical::find_all(util::categorical::find_all_method method,
+                                                                const std::vector<std::string>& categories,
+                                                                util::u64 index_offset) const
+{
+    u32 ignore_status;
+    return to_nested(*cached_groups(false, method, categories, false, {}, &ignore_status, index_offset, false));
+}
+
+//  find_all: Specify underlying implementation method, with indices.
+
+std::vector<std::vector<util::u64>> util::categorical::find_all(util::categorical::find_all_method method,
+                                                                const std::vector<std::string>& categories,
+                                                                const std::vector<util::u64>& indices,
+                                                                util::u32* status,
+                                                                util::u64 index_offset) const
+{
+    return to_nested(*cached_groups(false, method, categories, true, indices, status, index_offset, false));
+}
+
+//  find_all: Get indices of all possible unique combinations of labels.
+//
+//      A repeated query is answered from the grouping cache, but the cached
+//      groups are still copied into one vector per group on every call. Use
+//      find_all_groups to get them as contiguous arrays, without the per-group
+//      allocations.
+
+std::vector<std::vector<util::u64>> util::categorical::find_all(const std::vector<std::string>& categories,
+                                                                util::u64 index_offset) const
+{
+    u32 ignore_status;
+    return to_nested(*cached_groups(false, find_all_method::automatic, categories, false, {}, &ignore_status, index_offset, false));
+}
+
+//  find_all: Get indices of all possible unique combinations of labels, from subset,
+//      with bounds check.
+//
+//      find_all does not return the combinations.
+
+std::vector<std::vector<util::u64>> util::categorical::find_all(const std::vector<std::string>& categories,
+                                                                const std::vector<util::u64>& indices,
+                                                                util::u32* status,
+                                                                util::u64 index_offset) const
+{
+    return to_nested(*cached_groups(false, find_all_method::automatic, categories, true, indices, status, index_offset, false));
+}
+
+//  find_all_groups: Get indices of all possible unique combinations of labels, as
+//      contiguous groups.
+//
+//      If `ids` is with_group_ids::yes, the group of each row is also returned.
+
+util::groups_t util::categorical::find_all_groups(const std::vector<std::string>& categories,
+                                                  util::u64 index_offset,
+                                                  util::with_group_ids ids) const
+{
+    u32 ignore_status;
+    return *cached_groups(false, find_all_method::automatic, categories, false, {}, &ignore_status,
+                          index_offset, ids == util::with_group_ids::yes);
+}
+
+//  find_all_groups: Get indices of all possible unique combinations of labels, as
+//      contiguous groups, from subset.
+
+util::groups_t util::categorical::find_all_groups(const std::vector<std::string>& categories,
+                                                  const std::vector<util::u64>& indices,
+                                                  util::u32* status,
+                                                  util::u64 index_offset,
+                                                  util::with_group_ids ids) const
 {
-    *status = util::categorical_status::OK;
-    
-    util::u64 sz = labels.size();
-    util::bit_array out(sz, false);
-    util::u64 n_inds = indices.size();
+    return *cached_groups(false, find_all_method::automatic, categories, true, indices, status,
+                          index_offset, ids == util::with_group_ids::yes);
+}
+
+//  find_all_groups: Specify underlying implementation method.
+
+util::groups_t util::categorical::find_all_groups(util::categorical::find_all_method method,
+                                                  const std::vector<std::string>& categories,
+                                                  util::u64 index_offset,
+                                                  util::with_group_ids ids) const
+{
+    u32 ignore_status;
+    return *cached_groups(false, method, categories, false, {}, &ignore_status, index_offset, ids == util::with_group_ids::yes);
+}
+
+//  find_all_groups: Specify underlying implementation method, with indices.
+
+util::groups_t util::categorical::find_all_groups(util::categorical::find_all_method method,
+                                                  const std::vector<std::string>& categories,
+                                                  const std::vector<util::u64>& indices,
+                                                  util::u32* status,
+                                                  util::u64 index_offset,
+                                                  util::with_group_ids ids) const
+{
+    return *cached_groups(false, method, categories, true, indices, status, index_offset, ids == util::with_group_ids::yes);
+}
+
+//  find_allc: Get indices of all possible unique combinations of labels.
+//
+//      find_allc also returns the combinations. As with find_all, a cached
+//      result is still copied into one vector per group; find_allc_groups
+//      avoids the per-group allocations.
+
+util::combinations_t util::categorical::find_allc(const std::vector<std::string>& categories,
+                                                  util::u64 index_offset) const
+{
+    util::u32 dummy_status;
+    std::vector<util::u64> dummy_indices;
+    const auto groups = cached_groups(true, find_all_method::hash, categories, false, dummy_indices,
+                                      &dummy_status, index_offset, false);
     
-    for (util::u64 i = 0; i < n_inds; i++)
-    {
-        const util::u64 idx = indices[i] - index_offset;
-        
-        if (idx >= sz)
-        {
-            *status = util::categorical_status::OUT_OF_BOUNDS;
-            return out;
-        }
-        
-        if (labels[idx] == lab)
-        {
-            out.unchecked_place(true, idx);
-        }
-    }
+    util::combinations_t result;
+    result.indices = to_nested(*groups);
+    result.combinations = groups->combinations;
     
-    return out;
+    return result;
 }
 
-std::vector<util::u64> util::categorical::get_category_indices(const std::vector<std::string>& cats,
-                                                               const util::u64 n_cats,
-                                                               bool* exist) const
+//  find_allc: Get indices of all possible unique combinations of labels, from subset.
+//
+//      find_allc also returns the combinations.
+
+util::combinations_t util::categorical::find_allc(const std::vector<std::string>& categories,
+                                                  const std::vector<util::u64>& indices,
+                                                  util::u32* status,
+                                                  util::u64 index_offset) const
 {
-    std::vector<u64> category_inds;
-    *exist = true;
+    const auto groups = cached_groups(true, find_all_method::hash, categories, true, indices,
+                                      status, index_offset, false);
     
-    for (u64 i = 0; i < n_cats; i++)
-    {
-        auto category_idx_it = m_category_indices.find(cats[i]);
-        
-        //  if a category doesn't exist, no combinations can exist with it.
-        if (category_idx_it == m_category_indices.end())
-        {
-            *exist = false;
-            return std::vector<u64>();
-        }
-        
-        category_inds.push_back(category_idx_it->second);
-    }
+    util::combinations_t result;
+    result.indices = to_nested(*groups);
+    result.combinations = groups->combinations;
     
-    return category_inds;
+    return result;
 }
 
-std::vector<util::u64> util::categorical::get_category_indices_unchecked_has_category(const std::vector<std::string>& cats) const
+//  find_allc_groups: Get indices of all possible unique combinations of labels, as
+//      contiguous groups, and the combinations.
+
+util::groups_t util::categorical::find_allc_groups(const std::vector<std::string>& categories,
+                                                   util::u64 index_offset,
+                                                   util::with_group_ids ids) const
 {
-    const u64 num_cats = cats.size();
-    std::vector<util::u64> result(num_cats);
+    util::u32 dummy_status;
+    std::vector<util::u64> dummy_indices;
+    return *cached_groups(true, find_all_method::hash, categories, false, dummy_indices, &dummy_status,
+                          index_offset, ids == util::with_group_ids::yes);
+}
+
+//  find_allc_groups: Get indices of all possible unique combinations of labels, as
+//      contiguous groups, and the combinations, from subset.
+
+util::groups_t util::categorical::find_allc_groups(const std::vector<std::string>& categories,
+                                                   const std::vector<util::u64>& indices,
+                                                   util::u32* status,
+                                                   util::u64 index_offset,
+                                                   util::with_group_ids ids) const
+{
+    return *cached_groups(true, find_all_method::hash, categories, true, indices, status,
+                          index_offset, ids == util::with_group_ids::yes);
+}
+
+//  find_allc_ids: Get indices of all possible unique combinations of labels, as
+//      contiguous groups, and the label ids of each combination.
+//
+//      Unlike find_allc, no string is created per group; only the labels of the
+//      distinct ids are copied. See combination_ids_t.
+
+util::combination_ids_t util::categorical::find_allc_ids(const std::vector<std::string>& categories,
+                                                         util::u64 index_offset) const
+{
+    util::u32 dummy_status;
+    std::vector<util::u64> dummy_indices;
+    return find_allc_ids_impl(categories, false, dummy_indices, &dummy_status, index_offset);
+}
+
+//  find_allc_ids: Get indices of all possible unique combinations of labels, as
+//      contiguous groups, and the label ids of each combination, from subset.
+
+util::combination_ids_t util::categorical::find_allc_ids(const std::vector<std::string>& categories,
+                                                         const std::vector<util::u64>& indices,
+                                                         util::u32* status,
+                                                         util::u64 index_offset) const
+{
+    return find_allc_ids_impl(categories, true, indices, status, index_offset);
+}
+
+//  cached_groups [private]: Get the groups of find_all_method_dispatch, or of
+//      find_allc_impl if `with_combinations` is true, from the grouping cache
+//      if an identical query was answered since the object was last modified.
+//
+//      Results are cached only if all categories exist and `status` is OK.
+
+std::shared_ptr<const util::groups_t>
+util::categorical::cached_groups(const bool with_combinations,
+                                 util::categorical::find_all_method method,
+                                 const std::vector<std::string>& categories,
+                                 const bool use_indices,
+                                 const std::vector<util::u64>& indices,
+                                 util::u32* status,
+                                 util::u64 index_offset,
+                                 const bool with_group_ids) const
+{
+    auto compute = [&]() {
+        return with_combinations ?
+            find_allc_impl(categories, use_indices, indices, status, index_offset, with_group_ids) :
+            find_all_method_dispatch(method, categories, use_indices, indices, status, index_offset, with_group_ids);
+    };
     
-    for (u64 i = 0; i < num_cats; i++)
+    const u64 n_cats = categories.size();
+    bool cats_exist;
+    std::vector<u64> category_inds = get_category_indices(categories, n_cats, &cats_exist);
+    
+    if (!cats_exist || !m_grouping_cache.enabled())
     {
-        result[i] = m_category_indices.at(cats[i]);
+        return std::make_shared<const util::groups_t>(compute());
     }
     
-    return result;
+    util::grouping_cache::key key;
+    key.query = {u64(with_combinations), u64(method), u64(use_indices), index_offset, u64(with_group_ids)};
+    key.query.insert(key.query.end(), category_inds.begin(), category_inds.end());
+    
+    if (use_indices)
+    {
+        key.set_indices(indices);
+    }
+    
+    auto cached = m_grouping_cache.find(key, m_version);
+    
+    if (cached)
+    {
+        *status = util::categorical_status::OK;
+        return cached;
+    }
+    
+    auto groups = std::make_shared<const util::groups_t>(compute());
+    
+    if (*status == util::categorical_status::OK)
+    {
+        u64 bytes = (groups->indices.size() + groups->offsets.size() + groups->group_ids.size()) * sizeof(u64);
+        
+        for (const auto& combination : groups->combinations)
+        {
+            bytes += sizeof(std::string) + combination.size();
+        }
+        
+        m_grouping_cache.insert(std::move(key), m_version, groups, bytes);
+    }
+    
+    return groups;
 }
 
-//  find_all_hash_impl: Get indices of all possible unique combinations of labels, hashing rows.
+//  find_allc_impl [private]: Implementation of find_allc and findall_c [indexed]
 
-std::vector<std::vector<util::u64>>
-util::categorical::find_all_hash_impl(const std::vector<std::string>& categories,
-                                      const bool use_indices,
-                                      const std::vector<util::u64>& indices,
-                                      util::u32* status,
-                                      util::u64 index_offset) const
+util::groups_t util::categorical::find_allc_impl(const std::vector<std::string>& categories,
+                                                 const bool use_indices,
+                                                 const std::vector<util::u64>& indices,
+                                                 util::u32* status,
+                                                 util::u64 index_offset,
+                                                 const bool with_group_ids) const
 {
     *status = util::categorical_status::OK;
-    std::vector<std::vector<u64>> result;
     
     u64 n_cats_in = categories.size();
     bool cats_exist;
@@ -1003,399 +3303,478 @@ util::categorical::find_all_hash_impl(const std::vector<std::string>& categories
     
     if (n_cats_in == 0 || !cats_exist)
     {
-        return result;
+        return empty_groups();
     }
     
-    const u64 rows = use_indices ? indices.size() : size();
-    const u64 max_rows = use_indices ? size() : rows;
-    
     std::string hash_code = make_label_id_hash_string(n_cats_in);
     char* hash_code_ptr = &hash_code[0];
     
+    const u64 sz = size();
+    const u64 rows = use_indices ? indices.size() : sz;
+    
     std::unordered_map<std::string, u64> combination_exists;
+    std::vector<std::string> combinations;
+    std::vector<u64> group_ids(rows);
     u64 next_id = 0;
     
     for (u64 i = 0; i < rows; i++)
     {
-        u64 internal_index;
-        u64 input_index;
+        u64 internal_idx = i;
         
         if (use_indices)
         {
-            input_index = indices[i];
-            internal_index = input_index - index_offset;
+            internal_idx = indices[i] - index_offset;
             
-            if (internal_index >= max_rows)
+            if (internal_idx >= sz)
             {
                 *status = util::categorical_status::OUT_OF_BOUNDS;
-                return result;
+                return empty_groups();
             }
         }
-        else
-        {
-            internal_index = i;
-            input_index = i + index_offset;
-        }
         
-        build_row_hash(hash_code_ptr, m_labels, internal_index, category_inds);
+        build_row_hash(hash_code_ptr, m_labels, internal_idx, category_inds);
         
-        const auto c_it = combination_exists.find(hash_code);
-        u64 comb_idx;
+        auto c_it = combination_exists.find(hash_code);
         
-        //  Doesn't exist, add a new set of indices.
         if (c_it == combination_exists.end())
         {
+            for (u64 j = 0; j < n_cats_in; j++)
+            {
+                const util::label_column& full_cat = m_labels[category_inds[j]];
+                combinations.push_back(m_label_ids->ref_at(full_cat[internal_idx]));
+            }
+            
             combination_exists[hash_code] = next_id;
-            comb_idx = next_id;
-            next_id++;
-            result.push_back(std::vector<u64>());
+            group_ids[i] = next_id++;
         }
-        //  Does exist, get the index into `result`.
         else
         {
-            comb_idx = c_it->second;
+            group_ids[i] = c_it->second;
         }
-        
-        std::vector<u64>& inds_ptr = result[comb_idx];
-        inds_ptr.push_back(input_index);
     }
     
+    util::groups_t result = make_groups(std::move(group_ids), next_id, use_indices, indices, index_offset, with_group_ids);
+    result.combinations = std::move(combinations);
+    
     return result;
 }
-    
-std::vector<std::vector<util::u64>>
-util::categorical::find_all_custom_hash_impl(const std::vector<std::string>& categories,
-                                             const bool use_indices,
-                                             const std::vector<util::u64>& indices,
-                                             util::u32* status,
-                                             util::u64 index_offset) const
+
+//  find_allc_ids_impl [private]: Implementation of find_allc_ids [indexed]. The
+//      groups are those of find_all, in the same order as those of find_allc;
+//      the ids of each group are read from its first row.
+
+util::combination_ids_t util::categorical::find_allc_ids_impl(const std::vector<std::string>& categories,
+                                                              const bool use_indices,
+                                                              const std::vector<util::u64>& indices,
+                                                              util::u32* status,
+                                                              util::u64 index_offset) const
 {
-    struct HashUnsignedInt {
-        //  https://www.partow.net/programming/hashfunctions/
-        //  SDBM Hash Function
-        const u32 operator()(const u32* row, const std::size_t num_columns) const
-        {
-            u32 hash = 0;
-            
-            for (std::size_t i = 0; i < num_columns; i++)
-            {
-                hash = row[i] + (hash << 6) + (hash << 16) - hash;
-            }
-            
-            return hash;
-        }
-    };
+    const auto groups = cached_groups(false, find_all_method::automatic, categories, use_indices, indices,
+                                      status, index_offset, false);
     
-    *status = util::categorical_status::OK;
-    std::vector<std::vector<u64>> result;
+    util::combination_ids_t result;
+    result.indices = groups->indices;
+    result.offsets = groups->offsets;
     
-    const u64 num_cats = categories.size();
+    const u64 n_cats = categories.size();
     bool cats_exist;
-    std::vector<u64> category_inds = get_category_indices(categories, num_cats, &cats_exist);
+    std::vector<u64> category_inds = get_category_indices(categories, n_cats, &cats_exist);
     
-    if (num_cats == 0 || !cats_exist)
+    if (*status != util::categorical_status::OK || !cats_exist)
     {
         return result;
     }
     
-    const u64 rows = use_indices ? indices.size() : size();
-    const u64 max_rows = use_indices ? size() : rows;
-    
-    std::vector<u32> ids(num_cats);
-    u32* id_data = &ids[0];
-    u64 next_id = 0;
+    const u64 n_groups = result.offsets.size() - 1;
+    result.ids.resize(n_groups * n_cats);
     
-    u64 row_map_size = 2 * u64(std::sqrt(double(rows)));
-    if (row_map_size < 10)
+    for (u64 j = 0; j < n_cats; j++)
     {
-        row_map_size = 10;
+        const util::label_column& full_cat = m_labels[category_inds[j]];
+        u32* ids = result.ids.data() + j * n_groups;
+        
+        for (u64 i = 0; i < n_groups; i++)
+        {
+            ids[i] = full_cat[result.indices[result.offsets[i]] - index_offset];
+        }
     }
     
-    util::IntegralTypeRowMap<u32, u64, HashUnsignedInt> row_map(row_map_size, num_cats);
+    std::vector<u32> unique_ids = result.ids;
+    std::sort(unique_ids.begin(), unique_ids.end());
+    unique_ids.erase(std::unique(unique_ids.begin(), unique_ids.end()), unique_ids.end());
     
-    for (u64 i = 0; i < rows; i++)
+    result.labels.labels.reserve(unique_ids.size());
+    
+    for (const u32 id : unique_ids)
     {
-        u64 internal_index;
-        u64 input_index;
-        
-        if (use_indices)
-        {
-            input_index = indices[i];
-            internal_index = input_index - index_offset;
-            
-            if (internal_index >= max_rows)
-            {
-                *status = util::categorical_status::OUT_OF_BOUNDS;
-                return result;
-            }
-        }
-        else
-        {
-            internal_index = i;
-            input_index = i + index_offset;
-        }
-        
-        for (u64 j = 0; j < num_cats; j++)
-        {
-            id_data[j] = m_labels[category_inds[j]][internal_index];
-        }
-        
-        const auto c_it = row_map.find(id_data);
-        u64 comb_idx;
-
-        //  Doesn't exist, add a new set of indices.
-        if (c_it.value == nullptr)
-        {
-            row_map.insert(c_it, id_data, next_id);
-            comb_idx = next_id++;
-            result.emplace_back();
-        }
-        //  Does exist, get the index into `result`.
-        else
-        {
-            comb_idx = *c_it.value;
-        }
-
-        std::vector<u64>& inds_ptr = result[comb_idx];
-        inds_ptr.push_back(input_index);
+        result.labels.labels.push_back(m_label_ids->ref_at(id));
     }
     
+    result.labels.ids = std::move(unique_ids);
+    
     return result;
 }
 
-//  find_all_sort_impl: Get indices of all possible unique combinations of labels, sorting rows.
+//  find_all_nested: Get indices of all possible unique combinations of labels,
+//      nested by levels of categories.
+//
+//      Each group of level k is split into the unique combinations of labels
+//      in the categories of level k+1. See nested_groups_t.
 
-std::vector<std::vector<util::u64>>
-util::categorical::find_all_sort_impl(const std::vector<std::string>& categories,
-                                      const bool use_indices,
-                                      const std::vector<util::u64>& indices,
-                                      util::u32* status,
-                                      util::u64 index_offset) const
+util::nested_groups_t util::categorical::find_all_nested(const std::vector<std::vector<std::string>>& levels,
+                                                         util::u64 index_offset) const
+{
+    u32 ignore_status;
+    return find_all_nested_impl(levels, false, {}, &ignore_status, index_offset);
+}
+
+//  find_all_nested: Get indices of all possible unique combinations of labels,
+//      nested by levels of categories, from subset.
+
+util::nested_groups_t util::categorical::find_all_nested(const std::vector<std::vector<std::string>>& levels,
+                                                         const std::vector<util::u64>& indices,
+                                                         util::u32* status,
+                                                         util::u64 index_offset) const
+{
+    return find_all_nested_impl(levels, true, indices, status, index_offset);
+}
+
+//  find_all_nested_impl [private]: Group rows level by level, keying each row by
+//      its group in the previous level and its labels in the current level, then
+//      order the groups of each level by parent and the rows by leaf group.
+//
+//      If a category does not exist, the result is empty.
+
+util::nested_groups_t util::categorical::find_all_nested_impl(const std::vector<std::vector<std::string>>& levels,
+                                                              const bool use_indices,
+                                                              const std::vector<util::u64>& indices,
+                                                              util::u32* status,
+                                                              util::u64 index_offset) const
 {
     *status = util::categorical_status::OK;
     
-    const u64 rows = use_indices ? indices.size() : size();
-    //  @Robustness: Restrict num categories to s64 range.
-    const u64 num_cats_in = categories.size();
-    bool cats_exist;
-    const std::vector<u64> category_inds = get_category_indices(categories, num_cats_in, &cats_exist);
+    util::nested_groups_t result;
     
-    if (num_cats_in == 0 || !cats_exist || rows == 0)
+    const u64 n_levels = levels.size();
+    std::vector<std::vector<u64>> level_category_inds(n_levels);
+    
+    for (u64 k = 0; k < n_levels; k++)
     {
-        return {};
+        bool cats_exist;
+        level_category_inds[k] = get_category_indices(levels[k], levels[k].size(), &cats_exist);
+        
+        if (!cats_exist)
+        {
+            return result;
+        }
+    }
+    
+    if (n_levels == 0)
+    {
+        return result;
     }
     
     if (use_indices)
     {
         const u32 bounds_status = bounds_check(indices.data(), indices.size(), size(), index_offset);
-        if (bounds_status != categorical_status::OK)
+        
+        if (bounds_status != util::categorical_status::OK)
         {
             *status = bounds_status;
-            return {};
+            return result;
         }
     }
     
-    std::vector<u64> sorted_indices(rows);
-    std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
+    const u64 rows = use_indices ? indices.size() : size();
     
-    if (num_cats_in > 1)
-    {
-        //  Sort rows of matrix.
-        std::vector<u64> row_indices(rows);
-        std::vector<u64> sorted_indices_tmp(rows);
+    //  group of each row in the current level, numbered by first appearance.
+    std::vector<u64> row_groups(rows, 0);
+    //  position of the first row, and parent, of each group in each level.
+    std::vector<std::vector<u64>> first_rows(n_levels);
+    std::vector<std::vector<u64>> parents(n_levels);
+    
+    for (u64 k = 0; k < n_levels; k++)
+    {
+        const std::vector<u64>& category_inds = level_category_inds[k];
+        const u64 n_cats = category_inds.size();
         
-        for (s64 i = num_cats_in-1; i >= 0; i--)
+        std::vector<u64> key(n_cats + 1);
+        util::IntegralTypeRowMap<u64, u64> row_map(n_cats + 1);
+        row_map.reserve(2 * u64(std::sqrt(double(rows))));
+        
+        for (u64 i = 0; i < rows; i++)
         {
-            std::iota(row_indices.begin(), row_indices.end(), 0);
-            const std::vector<u32>& column = m_labels[category_inds[i]];
+            const u64 row = use_indices ? indices[i] - index_offset : i;
             
-            if (use_indices)
+            key[0] = row_groups[i];
+            
+            for (u64 j = 0; j < n_cats; j++)
             {
-                std::stable_sort(row_indices.begin(), row_indices.end(), [&column, &sorted_indices, &indices, index_offset](u64 i0, u64 i1) -> bool
-                {
-                    const u64 col_i0 = indices[sorted_indices[i0]] - index_offset;
-                    const u64 col_i1 = indices[sorted_indices[i1]] - index_offset;
-                    
-                    return column[col_i0] < column[col_i1];
-                });
+                key[j+1] = m_labels[category_inds[j]][row];
             }
-            else
+            
+            const auto c_it = row_map.find(key.data());
+            
+            if (c_it.value == nullptr)
             {
-                std::stable_sort(row_indices.begin(), row_indices.end(), [&column, &sorted_indices](u64 i0, u64 i1) -> bool
-                {
-                    return column[sorted_indices[i0]] < column[sorted_indices[i1]];
-                });
+                const u64 id = first_rows[k].size();
+                
+                row_map.insert(c_it, key.data(), id);
+                first_rows[k].push_back(i);
+                parents[k].push_back(row_groups[i]);
+                row_groups[i] = id;
             }
-            
-            for (u64 j = 0; j < rows; j++)
+            else
             {
-                sorted_indices_tmp[j] = sorted_indices[row_indices[j]];
+                row_groups[i] = *c_it.value;
             }
-            
-            std::swap(sorted_indices_tmp, sorted_indices);
         }
     }
-    else
+    
+    //  Order the groups of each level by the order of their parents, then by
+    //  first appearance.
+    std::vector<std::vector<u64>> ranks(n_levels);
+    
+    ranks[0].resize(first_rows[0].size());
+    std::iota(ranks[0].begin(), ranks[0].end(), u64(0));
+    
+    for (u64 k = 1; k < n_levels; k++)
     {
-        //  Just sort the column.
-        const std::vector<u32>& column = m_labels[category_inds[0]];
+        const std::vector<u64>& parent_ranks = ranks[k-1];
+        std::vector<u64> next(parent_ranks.size() + 1, 0);
         
-        if (use_indices)
+        for (const u64 parent : parents[k])
         {
-            std::sort(sorted_indices.begin(), sorted_indices.end(), [&column, &indices, index_offset](u64 i0, u64 i1) -> bool
-            {
-                return column[indices[i0] - index_offset] < column[indices[i1] - index_offset];
-            });
+            next[parent_ranks[parent] + 1]++;
         }
-        else
+        
+        std::partial_sum(next.begin(), next.end(), next.begin());
+        
+        ranks[k].resize(parents[k].size());
+        
+        for (u64 g = 0; g < parents[k].size(); g++)
         {
-            std::sort(sorted_indices.begin(), sorted_indices.end(), [&column](u64 i0, u64 i1) -> bool
-            {
-                return column[i0] < column[i1];
-            });
+            ranks[k][g] = next[parent_ranks[parents[k][g]]]++;
         }
     }
     
-    std::vector<std::vector<u64>> result;
-    u64 reference = 0;
+    //  Row counts of the leaf groups, then of each level above them.
+    result.offsets.resize(n_levels);
     
-    for (u64 i = 0; i < rows; i++)
+    const std::vector<u64>& leaf_ranks = ranks[n_levels-1];
+    std::vector<u64>& leaf_offsets = result.offsets[n_levels-1];
+    leaf_offsets.assign(leaf_ranks.size() + 1, 0);
+    
+    for (const u64 group : row_groups)
     {
-        bool new_combination = i == reference || false;
-        u64 ref_row;
-        u64 test_row;
+        leaf_offsets[leaf_ranks[group] + 1]++;
+    }
+    
+    for (u64 k = n_levels-1; k > 0; k--)
+    {
+        const std::vector<u64>& child_offsets = result.offsets[k];
+        std::vector<u64>& level_offsets = result.offsets[k-1];
+        level_offsets.assign(ranks[k-1].size() + 1, 0);
         
-        if (use_indices)
+        for (u64 g = 0; g < parents[k].size(); g++)
         {
-            ref_row = indices[sorted_indices[reference]] - index_offset;
-            test_row = indices[sorted_indices[i]] - index_offset;
+            level_offsets[ranks[k-1][parents[k][g]] + 1] += child_offsets[ranks[k][g] + 1];
         }
-        else
+    }
+    
+    for (auto& level_offsets : result.offsets)
+    {
+        std::partial_sum(level_offsets.begin(), level_offsets.end(), level_offsets.begin());
+    }
+    
+    //  Scatter rows to their leaf groups, in order of appearance within each.
+    std::vector<u64> next(leaf_offsets.begin(), leaf_offsets.end() - 1);
+    result.indices.resize(rows);
+    
+    for (u64 i = 0; i < rows; i++)
+    {
+        result.indices[next[leaf_ranks[row_groups[i]]]++] = use_indices ? indices[i] : i + index_offset;
+    }
+    
+    //  Parents and labels of each group, in order.
+    result.parents.resize(n_levels);
+    result.combinations.resize(n_levels);
+    
+    for (u64 k = 0; k < n_levels; k++)
+    {
+        const std::vector<u64>& category_inds = level_category_inds[k];
+        const u64 n_cats = category_inds.size();
+        const u64 n_groups = ranks[k].size();
+        
+        if (k > 0)
         {
-            ref_row = sorted_indices[reference];
-            test_row = sorted_indices[i];
+            result.parents[k].resize(n_groups);
         }
         
-        for (u64 j = 0; j < num_cats_in; j++)
+        result.combinations[k].resize(n_groups * n_cats);
+        
+        for (u64 g = 0; g < n_groups; g++)
         {
-            const u64 col = category_inds[j];
-            const u32 ref_id = m_labels[col][ref_row];
-            const u32 test_id = m_labels[col][test_row];
+            const u64 rank = ranks[k][g];
+            const u64 first = first_rows[k][g];
+            const u64 row = use_indices ? indices[first] - index_offset : first;
             
-            if (ref_id != test_id)
+            if (k > 0)
             {
-                new_combination = true;
-                break;
+                result.parents[k][rank] = ranks[k-1][parents[k][g]];
+            }
+            
+            for (u64 j = 0; j < n_cats; j++)
+            {
+                result.combinations[k][rank * n_cats + j] = m_label_ids->ref_at(m_labels[category_inds[j]][row]);
             }
         }
-        
-        if (new_combination)
-        {
-            reference = i;
-            result.push_back(std::vector<u64>());
-        }
-        
-        std::vector<u64>& end = result[result.size()-1];
-        end.push_back(test_row + index_offset);
     }
     
     return result;
 }
 
-std::vector<std::vector<util::u64>> util::categorical::find_all_method_dispatch(const util::categorical::find_all_method method,
-                                                                                const std::vector<std::string>& categories,
-                                                                                const bool use_indices,
-                                                                                const std::vector<util::u64>& indices,
-                                                                                util::u32* status,
-                                                                                util::u64 index_offset) const
-{
-    switch (method)
-    {
-        case find_all_method::hash:
-            return find_all_hash_impl(categories, use_indices, indices, status, index_offset);
-        case find_all_method::sort:
-            return find_all_sort_impl(categories, use_indices, indices, status, index_offset);
-        case find_all_method::custom_hash:
-            return find_all_custom_hash_impl(categories, use_indices, indices, status, index_offset);
-        default:
-            return find_all_hash_impl(categories, use_indices, indices, status, index_offset);
-    }
-}
-
-std::vector<std::vector<util::u64>> util::categorical::find_all(util::categorical::find_all_method method,
-                                                                const std::vector<std::string>& categories,
-                                                                util::u64 index_offset) const
-{
-    u32 ignore_status;
-    return find_all_method_dispatch(method, categories, false, {}, &ignore_status, index_offset);
-}
-
-//  find_all: Specify underlying implementation method, with indices.
+//  value_counts: Count the rows of each label in `category`.
+//
+//      Labels are returned in order of first appearance, and only if
+//      they are present in at least one row.
 
-std::vector<std::vector<util::u64>> util::categorical::find_all(util::categorical::find_all_method method,
-                                                                const std::vector<std::string>& categories,
-                                                                const std::vector<util::u64>& indices,
-                                                                util::u32* status,
-                                                                util::u64 index_offset) const
+util::value_counts_t util::categorical::value_counts(const std::string& category, bool* exists) const
 {
-    return find_all_method_dispatch(method, categories, true, indices, status, index_offset);
+    std::vector<util::u64> dummy_indices;
+    util::u32 status;
+    const bool use_indices = false;
+    
+    util::value_counts_t result = value_counts_impl(category, use_indices, dummy_indices, &status, 0);
+    *exists = status != util::categorical_status::CATEGORY_DOES_NOT_EXIST;
+    
+    return result;
 }
 
-//  find_all: Get indices of all possible unique combinations of labels.
+//  value_counts: Count the rows of each label in `category`, from subset.
 
-std::vector<std::vector<util::u64>> util::categorical::find_all(const std::vector<std::string>& categories,
-                                                                util::u64 index_offset) const
+util::value_counts_t util::categorical::value_counts(const std::string& category,
+                                                     const std::vector<util::u64>& indices,
+                                                     util::u32* status,
+                                                     util::u64 index_offset) const
 {
-    u32 ignore_status;
-    return find_all_hash_impl(categories, false, {}, &ignore_status, index_offset);
+    const bool use_indices = true;
+    
+    return value_counts_impl(category, use_indices, indices, status, index_offset);
 }
 
-//  find_all: Get indices of all possible unique combinations of labels, from subset,
-//      with bounds check.
-//
-//      find_all does not return the combinations.
+//  value_counts_impl [private]: Implementation of value_counts.
 
-std::vector<std::vector<util::u64>> util::categorical::find_all(const std::vector<std::string>& categories,
-                                                                const std::vector<util::u64>& indices,
-                                                                util::u32* status,
-                                                                util::u64 index_offset) const
+util::value_counts_t util::categorical::value_counts_impl(const std::string& category,
+                                                          const bool use_indices,
+                                                          const std::vector<util::u64>& indices,
+                                                          util::u32* status,
+                                                          util::u64 index_offset) const
 {
-    return find_all_hash_impl(categories, true, indices, status, index_offset);
+    util::value_counts_t result;
+    
+    const auto cat_it = m_category_indices->find(category);
+    
+    if (cat_it == m_category_indices->end())
+    {
+        *status = util::categorical_status::CATEGORY_DOES_NOT_EXIST;
+        return result;
+    }
+    
+    *status = util::categorical_status::OK;
+    
+    const util::label_column& col = m_labels[cat_it->second];
+    const u64 sz = size();
+    const u64 rows = use_indices ? indices.size() : sz;
+    
+    std::vector<util::u64> counts(label_id_capacity(), 0);
+    
+    col.visit([&](const auto* ids) -> void {
+        for (u64 i = 0; i < rows; i++)
+        {
+            u64 idx = i;
+            
+            if (use_indices)
+            {
+                idx = indices[i] - index_offset;
+                
+                if (idx >= sz)
+                {
+                    *status = util::categorical_status::OUT_OF_BOUNDS;
+                    return;
+                }
+            }
+            
+            const util::u32 id = ids[idx];
+            
+            if (id >= counts.size())
+            {
+                counts.resize(u64(id) + 1, 0);
+            }
+            
+            if (counts[id]++ == 0)
+            {
+                result.ids.push_back(id);
+            }
+        }
+    });
+    
+    if (*status != util::categorical_status::OK)
+    {
+        return util::value_counts_t();
+    }
+    
+    const u64 n_labels = result.ids.size();
+    
+    result.labels.resize(n_labels);
+    result.counts.resize(n_labels);
+    
+    for (u64 i = 0; i < n_labels; i++)
+    {
+        result.labels[i] = m_label_ids->ref_at(result.ids[i]);
+        result.counts[i] = counts[result.ids[i]];
+    }
+    
+    return result;
 }
 
-//  find_allc: Get indices of all possible unique combinations of labels.
+//  combination_counts: Count the rows of each combination of labels in `categories`.
 //
-//      find_allc also returns the combinations.
+//      Combinations are ordered as in find_allc.
 
-util::combinations_t util::categorical::find_allc(const std::vector<std::string>& categories,
-                                                  util::u64 index_offset) const
+util::combination_counts_t util::categorical::combination_counts(const std::vector<std::string>& categories) const
 {
-    util::u32 dummy_status;
     std::vector<util::u64> dummy_indices;
-    return find_allc_impl(categories, false, dummy_indices, &dummy_status, index_offset);
+    util::u32 dummy_status;
+    const bool use_indices = false;
+    
+    return combination_counts_impl(categories, use_indices, dummy_indices, &dummy_status, 0);
 }
 
-//  find_allc: Get indices of all possible unique combinations of labels, from subset.
-//
-//      find_allc also returns the combinations.
+//  combination_counts: Count the rows of each combination of labels in `categories`,
+//      from subset.
 
-util::combinations_t util::categorical::find_allc(const std::vector<std::string>& categories,
-                                                  const std::vector<util::u64>& indices,
-                                                  util::u32* status,
-                                                  util::u64 index_offset) const
+util::combination_counts_t util::categorical::combination_counts(const std::vector<std::string>& categories,
+                                                                 const std::vector<util::u64>& indices,
+                                                                 util::u32* status,
+                                                                 util::u64 index_offset) const
 {
-    return find_allc_impl(categories, true, indices, status, index_offset);
+    const bool use_indices = true;
+    
+    return combination_counts_impl(categories, use_indices, indices, status, index_offset);
 }
 
-//  find_allc_impl [private]: Implementation of find_allc and findall_c [indexed]
+//  combination_counts_impl [private]: Implementation of combination_counts. As
+//      find_allc_impl, but accumulates a count per combination rather than
+//      its indices.
 
-util::combinations_t util::categorical::find_allc_impl(const std::vector<std::string>& categories,
-                                                       const bool use_indices,
-                                                       const std::vector<util::u64>& indices,
-                                                       util::u32* status,
-                                                       util::u64 index_offset) const
+util::combination_counts_t util::categorical::combination_counts_impl(const std::vector<std::string>& categories,
+                                                                      const bool use_indices,
+                                                                      const std::vector<util::u64>& indices,
+                                                                      util::u32* status,
+                                                                      util::u64 index_offset) const
 {
-    util::combinations_t result;
+    util::combination_counts_t result;
     *status = util::categorical_status::OK;
     
     u64 n_cats_in = categories.size();
@@ -1414,51 +3793,41 @@ util::combinations_t util::categorical::find_allc_impl(const std::vector<std::st
     const u64 rows = use_indices ? indices.size() : sz;
     
     std::unordered_map<std::string, u64> combination_exists;
-    u64 next_id = 0;
     
     for (u64 i = 0; i < rows; i++)
     {
-        u64 input_idx = i + index_offset;
         u64 internal_idx = i;
         
         if (use_indices)
         {
-            input_idx = indices[i];
-            internal_idx = input_idx - index_offset;
+            internal_idx = indices[i] - index_offset;
             
             if (internal_idx >= sz)
             {
                 *status = util::categorical_status::OUT_OF_BOUNDS;
-                return result;
+                return util::combination_counts_t();
             }
         }
         
         build_row_hash(hash_code_ptr, m_labels, internal_idx, category_inds);
         
         auto c_it = combination_exists.find(hash_code);
-        const bool c_exists = c_it != combination_exists.end();
-        u64 comb_idx;
         
-        if (!c_exists)
+        if (c_it == combination_exists.end())
         {
             for (u64 j = 0; j < n_cats_in; j++)
             {
-                const std::vector<u32>& full_cat = m_labels[category_inds[j]];
-                result.combinations.push_back(m_label_ids.ref_at(full_cat[internal_idx]));
+                const util::label_column& full_cat = m_labels[category_inds[j]];
+                result.combinations.push_back(m_label_ids->ref_at(full_cat[internal_idx]));
             }
             
-            combination_exists[hash_code] = next_id;
-            comb_idx = next_id;
-            next_id++;
-            result.indices.push_back(std::vector<u64>());
+            combination_exists.emplace(hash_code, result.counts.size());
+            result.counts.push_back(1);
         }
         else
         {
-            comb_idx = c_it->second;
+            result.counts[c_it->second]++;
         }
-        
-        std::vector<u64>& inds_ptr = result.indices[comb_idx];
-        inds_ptr.push_back(input_idx);
     }
     
     return result;
@@ -1472,11 +3841,12 @@ util::combinations_t util::categorical::find_allc_impl(const std::vector<std::st
 std::vector<std::vector<util::u64>> util::categorical::keep_each(const std::vector<std::string> &categories,
                                                                  util::u64 index_offset)
 {
-    std::vector<std::vector<util::u64>> indices = find_all(categories, index_offset);
+    util::groups_t groups = find_all_groups(categories, index_offset, util::with_group_ids::yes);
     
-    unchecked_keep_each(indices, index_offset);
+    modified();
+    unchecked_keep_each(groups, categories, false, {}, index_offset);
     
-    return indices;
+    return to_nested(groups);
 }
 
 //  keep_each: Retain one row for each combination of labels, from subset.
@@ -1489,16 +3859,57 @@ std::vector<std::vector<util::u64>> util::categorical::keep_each(const std::vect
                                                                  util::u32* status,
                                                                  util::u64 index_offset)
 {
-    std::vector<std::vector<util::u64>> out_indices = find_all(categories, indices, status, index_offset);
+    util::groups_t groups = find_all_groups(categories, indices, status, index_offset, util::with_group_ids::yes);
+    
+    if (*status != util::categorical_status::OK)
+    {
+        return {};
+    }
+    
+    modified();
+    unchecked_keep_each(groups, categories, true, indices, index_offset);
+    
+    return to_nested(groups);
+}
+
+//  keep_each_groups: Retain one row for each combination of labels.
+//
+//      keep_each_groups returns the indices used to generate each row of
+//      the modified object, as contiguous groups.
+
+util::groups_t util::categorical::keep_each_groups(const std::vector<std::string>& categories,
+                                                   util::u64 index_offset)
+{
+    util::groups_t groups = find_all_groups(categories, index_offset, util::with_group_ids::yes);
+    
+    modified();
+    unchecked_keep_each(groups, categories, false, {}, index_offset);
+    
+    groups.group_ids.clear();
+    
+    return groups;
+}
+
+//  keep_each_groups: Retain one row for each combination of labels, from subset.
+
+util::groups_t util::categorical::keep_each_groups(const std::vector<std::string>& categories,
+                                                   const std::vector<util::u64>& indices,
+                                                   util::u32* status,
+                                                   util::u64 index_offset)
+{
+    util::groups_t groups = find_all_groups(categories, indices, status, index_offset, util::with_group_ids::yes);
     
     if (*status != util::categorical_status::OK)
     {
-        return out_indices;
+        return groups;
     }
     
-    unchecked_keep_each(out_indices, index_offset);
+    modified();
+    unchecked_keep_each(groups, categories, true, indices, index_offset);
     
-    return out_indices;
+    groups.group_ids.clear();
+    
+    return groups;
 }
 
 //  keep_eachc: Retain one row for each combination of labels.
@@ -1509,11 +3920,16 @@ std::vector<std::vector<util::u64>> util::categorical::keep_each(const std::vect
 util::combinations_t util::categorical::keep_eachc(const std::vector<std::string> &categories,
                                                   util::u64 index_offset)
 {
-    util::combinations_t combs = find_allc(categories, index_offset);
+    util::groups_t groups = find_allc_groups(categories, index_offset, util::with_group_ids::yes);
+    
+    modified();
+    unchecked_keep_each(groups, categories, false, {}, index_offset);
     
-    unchecked_keep_each(combs.indices, index_offset);
+    util::combinations_t result;
+    result.indices = to_nested(groups);
+    result.combinations = std::move(groups.combinations);
     
-    return combs;
+    return result;
 }
 
 //  keep_eachc: Retain one row for each combination of labels, from subset.
@@ -1526,111 +3942,152 @@ util::combinations_t util::categorical::keep_eachc(const std::vector<std::string
                                                    util::u32* status,
                                                    util::u64 index_offset)
 {
-    util::combinations_t combs = find_allc(categories, indices, status, index_offset);
+    util::groups_t groups = find_allc_groups(categories, indices, status, index_offset, util::with_group_ids::yes);
+    
+    util::combinations_t result;
     
     if (*status != util::categorical_status::OK)
     {
-        return combs;
+        return result;
     }
     
-    unchecked_keep_each(combs.indices, index_offset);
+    modified();
+    unchecked_keep_each(groups, categories, true, indices, index_offset);
+    
+    result.indices = to_nested(groups);
+    result.combinations = std::move(groups.combinations);
     
-    return combs;
+    return result;
 }
 
-//  unchecked_keep_each [private]: Main utility to keep each subset.
-
-void util::categorical::unchecked_keep_each(const std::vector<std::vector<util::u64>>& indices,
+//  unchecked_keep_each [private]: Retain one row for each group, given the group of
+//      each row searched.
+//
+//      A row keeps the label of a category that is uniform over its group, and
+//      otherwise takes the category's collapsed expression. The grouped
+//      `categories` are uniform by construction; uniformity in the others is
+//      found in one pass over each column, in row order. Labels left without
+//      rows are then removed without the full scan of prune().
+
+void util::categorical::unchecked_keep_each(const util::groups_t& groups,
+                                            const std::vector<std::string>& categories,
+                                            const bool use_indices,
+                                            const std::vector<util::u64>& indices,
                                             util::u64 index_offset)
 {
-    using util::u64;
-    using util::u32;
+    const u64 n_groups = groups.offsets.empty() ? 0 : groups.offsets.size() - 1;
+    const u64 rows = groups.group_ids.size();
+    const u64 n_cats = m_labels.size();
+    const u32 no_label = ~u32(0);
     
-    util::categorical copy = util::categorical::empty_copy(*this);
+    std::vector<bool> is_grouped(n_cats, false);
     
-    const u64 n_indices = indices.size();
-    const u64 n_cats = m_labels.size();
+    for (const auto& category : categories)
+    {
+        const auto it = m_category_indices->find(category);
+        
+        if (it != m_category_indices->end())
+        {
+            is_grouped[it->second] = true;
+        }
+    }
     
-    copy.resize(n_indices);
+    std::vector<u32> first_labels(n_groups);
+    std::vector<u8> mixed(n_groups);
+    std::vector<u32> kept(n_groups);
+    std::vector<bool> in_use(label_id_capacity(), false);
     
     bool randomize_on_insert = true;
     
     for (u64 i = 0; i < n_cats; i++)
     {
-        const std::vector<u32>& labs = m_labels[i];
-        std::vector<u32>& copy_labs = copy.m_labels[i];
+        std::fill(first_labels.begin(), first_labels.end(), no_label);
+        std::fill(mixed.begin(), mixed.end(), u8(0));
+        
+        bool any_mixed = false;
+        
+        if (is_grouped[i])
+        {
+            m_labels[i].visit([&](const auto* labs) -> void {
+                for (u64 j = 0; j < n_groups; j++)
+                {
+                    first_labels[j] = labs[groups.indices[groups.offsets[j]] - index_offset];
+                }
+            });
+        }
+        else
+        {
+            m_labels[i].visit([&](const auto* labs) -> void {
+                for (u64 j = 0; j < rows; j++)
+                {
+                    const u64 row = use_indices ? indices[j] - index_offset : j;
+                    const u64 group = groups.group_ids[j];
+                    const u32 lab = labs[row];
+                    
+                    if (first_labels[group] == no_label)
+                    {
+                        first_labels[group] = lab;
+                    }
+                    else if (first_labels[group] != lab)
+                    {
+                        mixed[group] = 1;
+                        any_mixed = true;
+                    }
+                }
+            });
+        }
         
-        for (u64 j = 0; j < n_indices; j++)
+        u32 collapsed_id = no_label;
+        
+        if (any_mixed)
         {
-            const std::vector<u64>& c_indices = indices[j];
-            u64 n_c_indices = c_indices.size();
-            
-            u32 first_lab = labs[c_indices[0] - index_offset];
+            const u64 group = u64(std::find(mixed.begin(), mixed.end(), u8(1)) - mixed.begin());
+            const std::string& cat = m_in_category->at(m_label_ids->ref_at(first_labels[group]));
+            const std::string collapsed_expression = get_collapsed_expression(cat);
             
-            bool should_proceed = true;
-            bool need_collapse = false;
-            u64 k = 1;
-            
-            while (should_proceed && k < n_c_indices)
+            if (m_label_ids->contains(collapsed_expression))
             {
-                u32 c_lab = labs[c_indices[k] - index_offset];
-                
-                if (c_lab != first_lab)
-                {
-                    should_proceed = false;
-                    need_collapse = true;
-                }
-                
-                k++;
+                collapsed_id = m_label_ids->at(collapsed_expression);
             }
-            
-            if (need_collapse)
+            else
             {
-                const std::string& str_lab = m_label_ids.at(first_lab);
-                const std::string& cat = m_in_category.at(str_lab);
-                
-                std::string collapsed_expression = get_collapsed_expression(cat);
+                collapsed_id = get_next_label_id();
+                unchecked_insert_label(collapsed_expression, collapsed_id, cat);
                 
-                u32 collapsed_id;
-                
-                if (copy.m_label_ids.contains(collapsed_expression))
+                if (collapsed_id >= in_use.size())
                 {
-                    collapsed_id = copy.m_label_ids.at(collapsed_expression);
+                    in_use.resize(u64(collapsed_id) + 1, false);
                 }
-                else
+                
+                if (randomize_on_insert)
                 {
-                    collapsed_id = copy.get_next_label_id();
-                    copy.unchecked_insert_label(collapsed_expression, collapsed_id, cat);
-                    
-                    if (randomize_on_insert)
-                    {
-                        m_progenitor_ids.randomize();
-                        copy.m_progenitor_ids.randomize();
-                        randomize_on_insert = false;
-                    }
+                    m_progenitor_ids.randomize();
+                    randomize_on_insert = false;
                 }
-                
-                copy_labs[j] = collapsed_id;
-            }
-            else
-            {
-                copy_labs[j] = first_lab;
             }
         }
+        
+        for (u64 j = 0; j < n_groups; j++)
+        {
+            kept[j] = mixed[j] ? collapsed_id : first_labels[j];
+            in_use[kept[j]] = true;
+        }
+        
+        m_labels[i] = util::label_column(kept);
     }
     
-    copy.prune();
-    
-    *this = std::move(copy);
+    erase_unused_labels(in_use);
 }
 
 //  one: Retain a single row, collapsing non-uniform categories.
 
 void util::categorical::one()
 {
-    for (const auto& it : m_category_indices)
+    modified();
+    
+    for (const auto& it : *m_category_indices)
     {
-        const std::vector<u32>& ids = m_labels[it.second];
+        const util::label_column& ids = m_labels[it.second];
         
         if (!is_uniform(ids))
         {
@@ -1653,9 +4110,11 @@ util::u32 util::categorical::set_category(const std::string& category,
                                           const std::vector<util::u64>& at_indices,
                                           util::u64 index_offset)
 {
-    auto category_it = m_category_indices.find(category);
+    modified();
     
-    if (category_it == m_category_indices.end())
+    auto category_it = m_category_indices->find(category);
+    
+    if (category_it == m_category_indices->end())
     {
         return util::categorical_status::CATEGORY_DOES_NOT_EXIST;
     }
@@ -1714,7 +4173,7 @@ util::u32 util::categorical::set_category(const std::string& category,
     }
     
     const u64 category_idx = category_it->second;
-    std::vector<u32>& labels = m_labels[category_idx];
+    util::label_column& labels = m_labels[category_idx];
     
     std::unordered_map<std::string, u32> processed;
     
@@ -1743,7 +4202,7 @@ util::u32 util::categorical::set_category(const std::string& category,
             lab_id = processed[lab];
         }
         
-        labels[at_indices[i] - index_offset] = lab_id;
+        labels.set(at_indices[i] - index_offset, lab_id);
     }
     
 #ifdef CAT_PRUNE_AFTER_ASSIGN
@@ -1766,6 +4225,8 @@ util::u32 util::categorical::set_category(const std::string& category,
 util::u32 util::categorical::set_category(const std::string& category,
                                           const std::vector<std::string>& full_category)
 {
+    modified();
+    
     const u64 own_size = size();
     const u64 cat_sz = full_category.size();
     
@@ -1774,8 +4235,8 @@ util::u32 util::categorical::set_category(const std::string& category,
         return fill_category(category, full_category[0]);
     }
     
-    const auto category_it = m_category_indices.find(category);
-    if (category_it == m_category_indices.end())
+    const auto category_it = m_category_indices->find(category);
+    if (category_it == m_category_indices->end())
     {
         return util::categorical_status::CATEGORY_DOES_NOT_EXIST;
     }
@@ -1796,7 +4257,7 @@ util::u32 util::categorical::set_category(const std::string& category,
 #endif
     }
     
-    std::vector<u32>& labels = m_labels[category_idx];
+    util::label_column& labels = m_labels[category_idx];
     std::unordered_map<std::string, u32> processed;
     auto copy_ids = m_label_ids;
     
@@ -1822,7 +4283,7 @@ util::u32 util::categorical::set_category(const std::string& category,
             
             if (had_label)
             {
-                copy_ids.erase(lab);
+                copy_ids.mutate().erase(lab);
             }
 
             processed[lab] = lab_id;
@@ -1832,17 +4293,16 @@ util::u32 util::categorical::set_category(const std::string& category,
             lab_id = processed_it->second;
         }
         
-        labels[i] = lab_id;
+        labels.set(i, lab_id);
     }
     
-    const std::vector<std::string> to_erase = copy_ids.keys();
+    const std::vector<std::string> to_erase = copy_ids->keys();
     
     for (const auto& key : to_erase)
     {
-        if (m_in_category.at(key) == category)
+        if (m_in_category->at(key) == category)
         {
-            m_label_ids.erase(key);
-            m_in_category.erase(key);
+            unchecked_erase_label(key);
         }
     }
     
@@ -1853,9 +4313,11 @@ util::u32 util::categorical::set_category(const std::string& category,
 
 util::u32 util::categorical::fill_category(const std::string& category, const std::string& lab)
 {
-    const auto category_it = m_category_indices.find(category);
+    modified();
     
-    if (category_it == m_category_indices.end())
+    const auto category_it = m_category_indices->find(category);
+    
+    if (category_it == m_category_indices->end())
     {
         return util::categorical_status::CATEGORY_DOES_NOT_EXIST;
     }
@@ -1873,14 +4335,14 @@ util::u32 util::categorical::fill_category(const std::string& category, const st
         return util::categorical_status::COLLAPSED_EXPRESSION_IN_WRONG_CATEGORY;
     }
     
-    auto lab_it = m_label_ids.find(lab);
-    bool exists = lab_it != m_label_ids.endk();
+    auto lab_it = m_label_ids->find(lab);
+    bool exists = lab_it != m_label_ids->endk();
     
     u32 lab_id;
     
     if (exists)
     {
-        if (m_in_category.at(lab) != category)
+        if (m_in_category->at(lab) != category)
         {
             return util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY;
         }
@@ -1903,14 +4365,12 @@ util::u32 util::categorical::fill_category(const std::string& category, const st
         
         if (should_erase)
         {
-            m_in_category.erase(c_lab);
-            m_label_ids.erase(c_lab);
+            unchecked_erase_label(c_lab);
         }
     }
     
     u64 category_idx = category_it->second;
-    std::vector<u32>& labels = m_labels[category_idx];
-    std::fill(labels.begin(), labels.end(), lab_id);
+    m_labels[category_idx].fill(lab_id);
     
     if (!exists)
     {
@@ -1931,9 +4391,9 @@ bool util::categorical::categories_match(const util::categorical &other) const
         return false;
     }
     
-    for (const auto& it : m_category_indices)
+    for (const auto& it : *m_category_indices)
     {
-        if (other.m_category_indices.count(it.first) == 0)
+        if (other.m_category_indices->count(it.first) == 0)
         {
             return false;
         }
@@ -1946,14 +4406,16 @@ bool util::categorical::categories_match(const util::categorical &other) const
 
 util::u32 util::categorical::replace_labels(const std::string& from, const std::string& with)
 {
+    modified();
+    
     if (from == with)
     {
         return util::categorical_status::OK;
     }
     
-    auto from_it = m_label_ids.find(from);
-    auto with_it = m_label_ids.find(with);
-    auto end_it = m_label_ids.endk();
+    auto from_it = m_label_ids->find(from);
+    auto with_it = m_label_ids->find(with);
+    auto end_it = m_label_ids->endk();
     
     //  to-replace label does not exist
     if (from_it == end_it)
@@ -1970,7 +4432,7 @@ util::u32 util::categorical::replace_labels(const std::string& from, const std::
         return replace_labels(input, with, test_scalar);
     }
     
-    const std::string c_incat = m_in_category.at(from);
+    const std::string c_incat = m_in_category->at(from);
     
     //  test whether we're trying to replace a label with the
     //  collapsed expression for the wrong category
@@ -1980,10 +4442,10 @@ util::u32 util::categorical::replace_labels(const std::string& from, const std::
     }
     
     //  otherwise, just change from -> with
-    m_label_ids.insert(with, from_it->second);
+    m_label_ids.mutate().insert(with, from_it->second);
     
-    m_in_category.erase(from);
-    m_in_category[with] = c_incat;
+    m_in_category.mutate().erase(from);
+    m_in_category.mutate()[with] = c_incat;
     
     //  string-label to uint32 mapping is now different
     m_progenitor_ids.randomize();
@@ -1997,6 +4459,8 @@ util::u32 util::categorical::replace_labels(const std::vector<std::string>& from
                                             const std::string& with,
                                             bool test_scalar)
 {
+    modified();
+    
     u64 n_from = from.size();
     
     if (n_from == 0)
@@ -2021,7 +4485,7 @@ util::u32 util::categorical::replace_labels(const std::vector<std::string>& from
             continue;
         }
         
-        const std::string& c_cat = m_in_category.at(c_from);
+        const std::string& c_cat = m_in_category->at(c_from);
         
         if (found_cat && c_cat != last_cat)
         {
@@ -2030,7 +4494,7 @@ util::u32 util::categorical::replace_labels(const std::vector<std::string>& from
         
         found_cat = true;
         last_cat = c_cat;
-        replace_ids.insert(m_label_ids.at(c_from));
+        replace_ids.insert(m_label_ids->at(c_from));
     }
     
     //  nothing to replace
@@ -2042,7 +4506,7 @@ util::u32 util::categorical::replace_labels(const std::vector<std::string>& from
     bool with_exists = has_label(with);
     
     //  otherwise, if `with` exists, make sure it's in the right category
-    if (with_exists && m_in_category.at(with) != last_cat)
+    if (with_exists && m_in_category->at(with) != last_cat)
     {
         return util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY;
     }
@@ -2056,25 +4520,25 @@ util::u32 util::categorical::replace_labels(const std::vector<std::string>& from
     
     if (with_exists)
     {
-        with_id = m_label_ids.at(with);
+        with_id = m_label_ids->at(with);
     }
     else
     {
         with_id = get_next_label_id();
-        m_in_category[with] = last_cat;
-        m_label_ids.insert(with, with_id);
+        m_in_category.mutate()[with] = last_cat;
+        m_label_ids.mutate().insert(with, with_id);
         m_progenitor_ids.randomize();
     }
     
-    u64 cat_index = m_category_indices.at(last_cat);
-    std::vector<u32>& col = m_labels[cat_index];
+    u64 cat_index = m_category_indices->at(last_cat);
+    util::label_column& col = m_labels[cat_index];
     u64 n_rows = col.size();
     
     for (u64 i = 0; i < n_rows; i++)
     {
         if (replace_ids.count(col[i]) > 0)
         {
-            col[i] = with_id;
+            col.set(i, with_id);
         }
     }
     
@@ -2096,29 +4560,45 @@ std::string util::categorical::get_collapsed_expression(const std::string& for_c
 
 util::u32 util::categorical::keep(const std::vector<util::u64>& at_indices, util::u64 offset)
 {
+    modified();
+    
     const u64 n_indices = at_indices.size();
     const u64 sz = size();
     const u64 n_cats = m_labels.size();
     
-    std::vector<std::vector<u32>> tmp(n_cats);
+    std::vector<util::label_column> tmp(n_cats);
     
     for (u64 i = 0; i < n_cats; i++)
     {
-        std::vector<u32>& tmp_col = tmp[i];
-        std::vector<u32>& own_col = m_labels[i];
+        util::label_column& tmp_col = tmp[i];
+        const util::label_column& own_col = m_labels[i];
         
+        tmp_col.require_width_for(own_col.max_storable_id());
         tmp_col.resize(n_indices);
         
-        for (u64 j = 0; j < n_indices; j++)
-        {
-            u64 idx = at_indices[j] - offset;
-            
-            if (idx >= sz)
-            {
-                return util::categorical_status::OUT_OF_BOUNDS;
-            }
+        const bool in_bounds = own_col.visit([&](const auto* own_ids) -> bool {
+            using T = typename std::remove_const<typename std::remove_pointer<decltype(own_ids)>::type>::type;
             
-            tmp_col[j] = own_col[idx];
+            return tmp_col.visit_mutable([&](auto* tmp_ids) -> bool {
+                for (u64 j = 0; j < n_indices; j++)
+                {
+                    u64 idx = at_indices[j] - offset;
+                    
+                    if (idx >= sz)
+                    {
+                        return false;
+                    }
+                    
+                    tmp_ids[j] = T(own_ids[idx]);
+                }
+                
+                return true;
+            });
+        });
+        
+        if (!in_bounds)
+        {
+            return util::categorical_status::OUT_OF_BOUNDS;
         }
     }
     
@@ -2131,17 +4611,19 @@ util::u32 util::categorical::keep(const std::vector<util::u64>& at_indices, util
 
 std::vector<util::u64> util::categorical::remove(const std::vector<std::string>& labels)
 {
+    modified();
+    
     const u64 n_labs = labels.size();
     const u64 sz = size();
     
     util::bit_array to_keep(sz, true);
     
-    auto lab_it_end = m_label_ids.endk();
+    auto lab_it_end = m_label_ids->endk();
     
     for (u64 i = 0; i < n_labs; i++)
     {
         const std::string& lab = labels[i];
-        const auto lab_it = m_label_ids.find(lab);
+        const auto lab_it = m_label_ids->find(lab);
         
         //  label doesn't exist
         if (lab_it == lab_it_end)
@@ -2150,9 +4632,9 @@ std::vector<util::u64> util::categorical::remove(const std::vector<std::string>&
         }
         
         const u32 lab_id = lab_it->second;
-        const std::string& cat = m_in_category.at(lab);
-        const u64 cat_idx = m_category_indices.at(cat);
-        const std::vector<util::u32>& lab_col = m_labels[cat_idx];
+        const std::string& cat = m_in_category->at(lab);
+        const u64 cat_idx = m_category_indices->at(cat);
+        const util::label_column& lab_col = m_labels[cat_idx];
         
         util::bit_array lab_idx = util::categorical::assign_bit_array(lab_col, lab_id);
         
@@ -2170,54 +4652,172 @@ std::vector<util::u64> util::categorical::remove(const std::vector<std::string>&
 
 void util::categorical::empty()
 {
+    modified();
+    
     reserve(0);
 }
 
+//  compact: Store each column in the narrowest width that fits its ids, and
+//      release the capacity left over from appends. Rows and labels are
+//      unchanged, so the object keeps its version.
+
+void util::categorical::compact()
+{
+    for (auto& col : m_labels)
+    {
+        col.narrow();
+        col.shrink_to_fit();
+    }
+}
+
 //  prune: Remove labels wihout rows.
 
 util::u64 util::categorical::prune()
 {
+    modified();
+    
     const u64 n_cats = m_labels.size();
     
-    auto copy_ids = m_label_ids;
-    std::unordered_set<u32> visited;
+    std::vector<bool> in_use(label_id_capacity(), false);
     
     for (u64 i = 0; i < n_cats; i++)
     {
-        const std::vector<u32>& labs = m_labels[i];
-        u64 n_labs = labs.size();
-        
-        for (u64 j = 0; j < n_labs; j++)
-        {
-            u32 lab = labs[j];
+        m_labels[i].visit([&](const auto* labs) -> void {
+            const u64 n_labs = m_labels[i].size();
             
-            if (visited.count(lab) == 0)
+            for (u64 j = 0; j < n_labs; j++)
             {
-                copy_ids.erase(lab);
-                visited.insert(lab);
+                in_use[labs[j]] = true;
             }
+        });
+    }
+    
+    return erase_unused_labels(in_use);
+}
+
+//  erase_unused_labels [private]: Remove labels whose ids are not marked in
+//      `in_use`, then compact label ids and narrow columns. Returns the number of
+//      labels removed.
+
+util::u64 util::categorical::erase_unused_labels(const std::vector<bool>& in_use)
+{
+    std::vector<u32> remaining;
+    
+    for (const u32 id : m_label_ids->values())
+    {
+        if (!in_use[id])
+        {
+            remaining.push_back(id);
         }
     }
     
-    std::vector<u32> remaining = copy_ids.values();
-    u64 n_remaining = remaining.size();
+    const u64 n_remaining = remaining.size();
     
     for (u64 i = 0; i < n_remaining; i++)
     {
         const u32 id = remaining[i];
-        const std::string& lab = m_label_ids.at(id);
-        m_in_category.erase(lab);
-        m_label_ids.erase(id);
+        const std::string lab = m_label_ids->at(id);
+        unchecked_erase_label(lab);
     }
     
-    if (n_remaining > 0)
+    const bool compacted = compact_label_ids();
+    
+    //  Ids are unchanged, so every column is already as narrow as it was.
+    if (n_remaining == 0 && !compacted)
     {
-        m_progenitor_ids.randomize();
+        return 0;
+    }
+    
+    m_progenitor_ids.randomize();
+    
+    for (auto& col : m_labels)
+    {
+        col.narrow();
     }
     
     return n_remaining;
 }
 
+//  compact_label_ids [private]: Renumber label ids to close holes left by released ids,
+//      such that all ids lie in [0, n_labels()). Returns true if any id changed.
+
+bool util::categorical::compact_label_ids()
+{
+    const u32 n_labs = u32(m_label_ids->size());
+    const u32 capacity = m_label_id_allocator.capacity();
+    
+    if (capacity == n_labs)
+    {
+        return false;
+    }
+    
+    std::vector<bool> taken(capacity, false);
+    const std::vector<std::string> labs = m_label_ids->keys();
+    
+    for (const auto& lab : labs)
+    {
+        taken[m_label_ids->ref_at(lab)] = true;
+    }
+    
+    std::vector<u32> remap(capacity);
+    std::iota(remap.begin(), remap.end(), 0);
+    
+    u32 next_free = 0;
+    
+    for (const auto& lab : labs)
+    {
+        const u32 id = m_label_ids->ref_at(lab);
+        
+        if (id < n_labs)
+        {
+            continue;
+        }
+        
+        while (taken[next_free])
+        {
+            next_free++;
+        }
+        
+        taken[next_free] = true;
+        remap[id] = next_free;
+        m_label_ids.mutate().insert(lab, next_free);
+    }
+    
+    for (auto& col : m_labels)
+    {
+        const u64 n_rows = col.size();
+        bool has_moved_id = false;
+        
+        //  Leave a column without moved ids alone, so that it keeps its shared
+        //  buffer and label index.
+        col.visit([&](const auto* ids) -> void {
+            for (u64 i = 0; i < n_rows && !has_moved_id; i++)
+            {
+                has_moved_id = remap[ids[i]] != ids[i];
+            }
+        });
+        
+        if (!has_moved_id)
+        {
+            continue;
+        }
+        
+        col.visit_mutable([&](auto* ids) -> void {
+            using T = typename std::remove_pointer<decltype(ids)>::type;
+            
+            //  Ids only ever decrease, so the current width still fits.
+            for (u64 i = 0; i < n_rows; i++)
+            {
+                ids[i] = T(remap[ids[i]]);
+            }
+        });
+    }
+    
+    m_label_id_allocator.rebuild(m_label_ids->values());
+    
+    return true;
+}
+
 void util::categorical::unchecked_append_progenitors_match(const util::categorical& other,
                                                            util::u64 own_sz,
                                                            util::u64 other_sz)
@@ -2226,13 +4826,9 @@ void util::categorical::unchecked_append_progenitors_match(const util::categoric
     
     u64 n_cols = m_labels.size();
     
-    size_t n_copy = other_sz * sizeof(util::u32);
-    
     for (u64 i = 0; i < n_cols; i++)
     {
-        util::u32* dest_ptr = m_labels[i].data();
-        const util::u32* src_ptr = other.m_labels[i].data();
-        std::memcpy(dest_ptr + own_sz, src_ptr, n_copy);
+        m_labels[i].copy_rows(own_sz, other.m_labels[i], 0, other_sz);
     }
 }
 
@@ -2248,8 +4844,10 @@ util::u32 util::categorical::unchecked_append_progenitors_match_indexed(const ut
     
     for (u64 i = 0; i < n_cols; i++)
     {
-        util::u32* dest_ptr = m_labels[i].data();
-        const util::u32* src_ptr = other.m_labels[i].data();
+        util::label_column& dest = m_labels[i];
+        const util::label_column& src = other.m_labels[i];
+        
+        dest.require_width_for(src.max_storable_id());
         
         for (u64 j = 0; j < indices_sz; j++)
         {
@@ -2261,7 +4859,7 @@ util::u32 util::categorical::unchecked_append_progenitors_match_indexed(const ut
                 return util::categorical_status::OUT_OF_BOUNDS;
             }
             
-            dest_ptr[own_sz + j] = src_ptr[idx];
+            dest.set(own_sz + j, src[idx]);
         }
     }
     
@@ -2273,6 +4871,8 @@ util::u32 util::categorical::unchecked_append_progenitors_match_indexed(const ut
 
 util::u32 util::categorical::append_one(const util::categorical& other)
 {
+    modified();
+    
     return append_one_impl(other, false, std::vector<util::u64>(), 0, 0);
 }
 
@@ -2284,6 +4884,8 @@ util::u32 util::categorical::append_one(const util::categorical& other,
                                         util::u64 index_offset,
                                         util::u64 repetitions)
 {
+    modified();
+    
     return append_one_impl(other, true, indices, index_offset, repetitions);
 }
 
@@ -2305,13 +4907,13 @@ util::u32 util::categorical::append_one_impl(const util::categorical& other,
     
     categorical tmp;
     
-    for (const auto& cat_it : other.m_category_indices)
+    for (const auto& cat_it : *other.m_category_indices)
     {
         const std::string& cat = cat_it.first;
         
         tmp.require_category(cat);
         
-        const std::vector<u32>& ids = other.m_labels[cat_it.second];
+        const util::label_column& ids = other.m_labels[cat_it.second];
         
         bool is_uniform;
         
@@ -2341,7 +4943,7 @@ util::u32 util::categorical::append_one_impl(const util::categorical& other,
                 idx = indices[0] - index_offset;
             }
             
-            assign_lab = other.m_label_ids.at(ids[idx]);
+            assign_lab = other.m_label_ids->at(ids[idx]);
         }
         else
         {
@@ -2354,13 +4956,15 @@ util::u32 util::categorical::append_one_impl(const util::categorical& other,
     tmp.prune();
     tmp.repeat(repetitions);
     
-    return append(tmp);
+    return append(std::move(tmp));
 }
 
 //  append: Append one categorical object to another.
 
 util::u32 util::categorical::append(const util::categorical &other)
 {
+    modified();
+    
     return append_impl(other, false, std::vector<util::u64>(), 0);
 }
 
@@ -2368,9 +4972,113 @@ util::u32 util::categorical::append(const util::categorical &other,
                                     const std::vector<util::u64>& indices,
                                     util::u64 index_offset)
 {
+    modified();
+    
+    return append_impl(other, true, indices, index_offset);
+}
+
+//  append: Append one categorical object to another, taking its storage where
+//      possible. When `this` has no rows, `other` (or the subset `indices` of
+//      it) is moved into `this` rather than copied, and `other` is left empty.
+//      Otherwise, `other` is left unchanged.
+
+util::u32 util::categorical::append(util::categorical&& other)
+{
+    modified();
+    
+    if (size() == 0 && other.size() > 0)
+    {
+        unchecked_take(other);
+        return util::categorical_status::OK;
+    }
+    
+    return append_impl(other, false, std::vector<util::u64>(), 0);
+}
+
+util::u32 util::categorical::append(util::categorical&& other,
+                                    const std::vector<util::u64>& indices,
+                                    util::u64 index_offset)
+{
+    modified();
+    
+    if (size() == 0 && !indices.empty() && this != &other)
+    {
+        u32 status = other.keep(indices, index_offset);
+        
+        if (status != util::categorical_status::OK)
+        {
+            return status;
+        }
+        
+        unchecked_take(other);
+        return util::categorical_status::OK;
+    }
+    
     return append_impl(other, true, indices, index_offset);
 }
 
+namespace
+{
+    //  covers_all_rows: True if `indices`, less `offset`, are 0, 1, ... n-1.
+    bool covers_all_rows(const std::vector<util::u64>& indices, util::u64 offset, util::u64 n)
+    {
+        if (indices.size() != n)
+        {
+            return false;
+        }
+        
+        for (util::u64 i = 0; i < n; i++)
+        {
+            if (indices[i] - offset != i)
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    //  is_identity: True if each id of a label id table maps to itself.
+    bool is_identity(const std::vector<util::u32>& table)
+    {
+        for (util::u64 i = 0; i < table.size(); i++)
+        {
+            if (table[i] != i)
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    //  remap_label_ids: Replace each id in rows [begin, end) of `col` by table[id].
+    //      The lookup is unconditional, so the loop is a plain gather.
+    void remap_label_ids(util::label_column& col,
+                         util::u64 begin,
+                         util::u64 end,
+                         const std::vector<util::u32>& table)
+    {
+        if (table.empty() || begin >= end)
+        {
+            return;
+        }
+        
+        col.require_width_for(*std::max_element(table.begin(), table.end()));
+        
+        const util::u32* lookup = table.data();
+        
+        col.visit_mutable([&](auto* ids) -> void {
+            using T = typename std::remove_pointer<decltype(ids)>::type;
+            
+            for (util::u64 i = begin; i < end; i++)
+            {
+                ids[i] = T(lookup[ids[i]]);
+            }
+        });
+    }
+}
+
 util::u32 util::categorical::append_impl(const util::categorical& other,
                                          const bool use_indices,
                                          const std::vector<util::u64>& indices,
@@ -2432,12 +5140,14 @@ util::u32 util::categorical::append_impl(const util::categorical& other,
         }
     }
     
-    std::unordered_map<u32, u32> replace_other_labs;
+    std::vector<u32> replace_other_labs;
     
-    auto tmp_label_ids = m_label_ids;
-    auto tmp_in_cat = m_in_category;
+    std::unordered_map<std::string, u32> new_label_ids;
+    std::unordered_map<std::string, std::string> new_in_cat;
+    auto tmp_label_id_allocator = m_label_id_allocator;
     
-    util::u32 new_labels_status = reconcile_new_label_ids(other, tmp_label_ids, tmp_in_cat, replace_other_labs);
+    util::u32 new_labels_status = reconcile_new_label_ids(other, new_label_ids, new_in_cat,
+                                                          replace_other_labs, tmp_label_id_allocator);
     
     if (new_labels_status != util::categorical_status::OK)
     {
@@ -2452,69 +5162,253 @@ util::u32 util::categorical::append_impl(const util::categorical& other,
     }
     
     //  if we get here, all is well.
-    u64 orig_n_labels = m_label_ids.size();
-    u64 new_n_labels = tmp_label_ids.size();
+    unchecked_insert_new_labels(new_label_ids, new_in_cat, std::move(tmp_label_id_allocator));
     
-    if (new_n_labels > orig_n_labels)
+    if (use_indices)
     {
-        m_progenitor_ids.randomize();
+        resize(own_sz + other_sz);
+        
+        util::u32 status = append_fill_new_label_ids_indexed(other, replace_other_labs, own_sz, other.size(), indices, index_offset);
+        
+        if (status != util::categorical_status::OK)
+        {
+            resize(own_sz);
+        }
+        
+        return status;
+    }
+    else
+    {
+        std::vector<std::vector<u32>> tables(1);
+        std::vector<u64> table_indices{0};
+        
+        if (!is_identity(replace_other_labs))
+        {
+            tables.push_back(std::move(replace_other_labs));
+            table_indices[0] = 1;
+        }
+        
+        append_many_fill({&other}, {0, other_sz}, tables, table_indices, own_sz);
+        return util::categorical_status::OK;
     }
+}
+
+//  append_many: Append several categorical objects at once.
+//
+//      The result is that of appending each of `others` in turn, but the label
+//      ids of all objects are reconciled before any row is copied, the columns
+//      are resized once, and incoming ids are translated through a flat table
+//      per distinct set of labels. If any object cannot be appended, `this` is
+//      unchanged and the status of the first failure is returned.
+
+util::u32 util::categorical::append_many(const std::vector<const util::categorical*>& others)
+{
+    modified();
     
-    m_label_ids = std::move(tmp_label_ids);
-    m_in_category = std::move(tmp_in_cat);
+    const u64 n_others = others.size();
+    u64 first = 0;
     
-    resize(own_sz + other_sz);
+    while (first < n_others && others[first]->size() == 0)
+    {
+        first++;
+    }
     
-    if (use_indices)
+    if (first == n_others)
     {
-        util::u32 status = append_fill_new_label_ids_indexed(other, replace_other_labs, own_sz, other.size(), indices, index_offset);
+        return util::categorical_status::OK;
+    }
+    
+    //  Appending to an empty object copies the first non-empty one, categories
+    //  included, as in append().
+    if (size() == 0)
+    {
+        util::categorical tmp = *others[first];
+        std::vector<const util::categorical*> rest(others.begin() + first + 1, others.end());
+        
+        const u32 status = tmp.append_many(rest);
+        
+        if (status == util::categorical_status::OK)
+        {
+            *this = std::move(tmp);
+        }
+        
+        return status;
+    }
+    
+    const u64 own_sz = size();
+    const u64 int_max = ~(u64(0));
+    
+    std::vector<u64> offsets(n_others + 1, 0);
+    
+    for (u64 i = 0; i < n_others; i++)
+    {
+        const util::categorical& other = *others[i];
+        const u64 other_sz = other.size();
+        
+        if (other_sz > 0 && !categories_match(other))
+        {
+            return util::categorical_status::CATEGORIES_DO_NOT_MATCH;
+        }
+        
+        if (int_max - own_sz - offsets[i] < other_sz)
+        {
+            return util::categorical_status::CAT_OVERFLOW;
+        }
+        
+        offsets[i + 1] = offsets[i] + other_sz;
+    }
+    
+    std::unordered_map<std::string, u32> new_label_ids;
+    std::unordered_map<std::string, std::string> new_in_cat;
+    auto tmp_label_id_allocator = m_label_id_allocator;
+    
+    //  tables[0] is empty, and stands for the identity; objects that share
+    //  progenitors share a table.
+    std::vector<std::vector<u32>> tables(1);
+    std::vector<u64> table_indices(n_others, 0);
+    std::map<std::pair<u32, u32>, u64> table_by_progenitors;
+    
+    for (u64 i = 0; i < n_others; i++)
+    {
+        const util::categorical& other = *others[i];
+        
+        if (other.size() == 0 || other.m_progenitor_ids == m_progenitor_ids)
+        {
+            continue;
+        }
+        
+        const auto progenitors = std::make_pair(other.m_progenitor_ids.a, other.m_progenitor_ids.b);
+        const auto table_it = table_by_progenitors.find(progenitors);
+        
+        if (table_it != table_by_progenitors.end())
+        {
+            table_indices[i] = table_it->second;
+            continue;
+        }
+        
+        u32 status = merge_check_collapsed_expressions(other);
         
         if (status != util::categorical_status::OK)
         {
-            resize(own_sz);
+            return status;
         }
         
-        return status;
-    }
-    else
-    {
-        append_fill_new_label_ids(other, replace_other_labs, own_sz, other_sz);
-        return util::categorical_status::OK;
+        std::vector<u32> table;
+        status = reconcile_new_label_ids(other, new_label_ids, new_in_cat, table, tmp_label_id_allocator);
+        
+        if (status != util::categorical_status::OK)
+        {
+            return status;
+        }
+        
+        if (!is_identity(table))
+        {
+            table_indices[i] = tables.size();
+            tables.push_back(std::move(table));
+        }
+        
+        table_by_progenitors[progenitors] = table_indices[i];
     }
+    
+    //  if we get here, all is well.
+    unchecked_insert_new_labels(new_label_ids, new_in_cat, std::move(tmp_label_id_allocator));
+    
+    append_many_fill(others, offsets, tables, table_indices, own_sz);
+    
+    return util::categorical_status::OK;
 }
 
-void util::categorical::append_fill_new_label_ids(const util::categorical& other,
-                                                  const std::unordered_map<util::u32, util::u32>& replace_other_labs,
-                                                  util::u64 own_sz,
-                                                  util::u64 other_sz)
+//  append_many_fill [private]: Copy the rows of `others` into rows `own_sz` and
+//      beyond, translating ids through `tables`. The rows of others[i] become
+//      rows own_sz + offsets[i] through own_sz + offsets[i+1] - 1. Large copies
+//      are split into chunks of rows, which may span objects, and filled
+//      concurrently.
+
+void util::categorical::append_many_fill(const std::vector<const util::categorical*>& others,
+                                         const std::vector<util::u64>& offsets,
+                                         const std::vector<std::vector<util::u32>>& tables,
+                                         const std::vector<util::u64>& table_indices,
+                                         util::u64 own_sz)
 {
-    const size_t n_copy = other_sz * sizeof(util::u32);
+    const u64 n_new = offsets.back();
+    const u32 max_id = m_label_id_allocator.capacity() - 1;
     
-    for (const auto& it : m_category_indices)
+    for (const auto& it : *m_category_indices)
     {
         const std::string& cat = it.first;
-        const util::u64 own_idx = it.second;
-        const util::u64 other_idx = other.m_category_indices.at(cat);
-        
-        const util::u32* src = other.m_labels[other_idx].data();
-        util::u32* dest = m_labels[own_idx].data();
+        util::label_column& dest = m_labels[it.second];
         
-        std::memcpy(dest + own_sz, src, n_copy);
+        std::vector<const util::label_column*> sources(others.size(), nullptr);
         
-        for (util::u64 i = 0; i < other_sz; i++)
+        for (u64 i = 0; i < others.size(); i++)
         {
-            util::u32 id = dest[i + own_sz];
-            
-            if (replace_other_labs.count(id) > 0)
+            //  `this` may be among the objects; its columns are read after resizing.
+            if (offsets[i + 1] > offsets[i])
             {
-                dest[i + own_sz] = replace_other_labs.at(id);
+                sources[i] = &others[i]->m_labels[others[i]->m_category_indices->at(cat)];
             }
         }
+        
+        dest.require_width_for(max_id);
+        dest.resize(own_sz + n_new);
+        
+        dest.visit_mutable([&](auto* out) -> void {
+            using T = typename std::remove_pointer<decltype(out)>::type;
+            
+            auto fill_rows = [&](u64 begin, u64 end) -> void {
+                u64 i = std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+                
+                while (begin < end)
+                {
+                    const u64 stop = std::min(end, offsets[i + 1]);
+                    
+                    if (stop > begin)
+                    {
+                        const std::vector<u32>& table = tables[table_indices[i]];
+                        
+                        sources[i]->visit([&](const auto* in) -> void {
+                            const auto* src = in + (begin - offsets[i]);
+                            T* dst = out + own_sz + begin;
+                            const u64 n = stop - begin;
+                            
+                            if (table.empty())
+                            {
+                                for (u64 j = 0; j < n; j++)
+                                {
+                                    dst[j] = T(src[j]);
+                                }
+                            }
+                            else
+                            {
+                                for (u64 j = 0; j < n; j++)
+                                {
+                                    dst[j] = T(table[src[j]]);
+                                }
+                            }
+                        });
+                    }
+                    
+                    begin = stop;
+                    i++;
+                }
+            };
+            
+            if (util::parallel::applies(n_new))
+            {
+                util::parallel::for_each_chunk(n_new, util::parallel::n_chunks(n_new), [&](u64, u64 begin, u64 end) {
+                    fill_rows(begin, end);
+                });
+            }
+            else
+            {
+                fill_rows(0, n_new);
+            }
+        });
     }
 }
 
 util::u32 util::categorical::append_fill_new_label_ids_indexed(const util::categorical& other,
-                                                               const std::unordered_map<util::u32, util::u32>& replace_other_labs,
+                                                               const std::vector<util::u32>& replace_other_labs,
                                                                util::u64 own_sz,
                                                                util::u64 other_sz,
                                                                const std::vector<util::u64>& indices,
@@ -2522,14 +5416,14 @@ util::u32 util::categorical::append_fill_new_label_ids_indexed(const util::categ
 {
     const u64 n_indices = indices.size();
     
-    for (const auto& it : m_category_indices)
+    for (const auto& it : *m_category_indices)
     {
         const std::string& cat = it.first;
         const u64 own_idx = it.second;
-        const u64 other_idx = other.m_category_indices.at(cat);
+        const u64 other_idx = other.m_category_indices->at(cat);
         
-        const u32* src = other.m_labels[other_idx].data();
-        u32* dest = m_labels[own_idx].data();
+        const util::label_column& src = other.m_labels[other_idx];
+        util::label_column& dest = m_labels[own_idx];
         
         for (u64 i = 0; i < n_indices; i++)
         {
@@ -2540,48 +5434,28 @@ util::u32 util::categorical::append_fill_new_label_ids_indexed(const util::categ
                 return util::categorical_status::OUT_OF_BOUNDS;
             }
             
-            u32 id = src[idx];
-            
-            if (replace_other_labs.count(id) > 0)
-            {
-                id = replace_other_labs.at(id);
-            }
-            
-            dest[i + own_sz] = id;
+            dest.set(i + own_sz, replace_other_labs[src[idx]]);
         }
     }
     
     return util::categorical_status::OK;
 }
 
-//  replace_labels: Helper function to replace outgoing label ids with new ids.
+//  replace_labels: Helper function to replace outgoing label ids with new ids, such
+//      that id `i` in rows [start, stop) becomes replace_table[i].
 
-void util::categorical::replace_labels(std::vector<std::vector<u32>>& labels,
+void util::categorical::replace_labels(std::vector<util::label_column>& labels,
                                        util::u64 start, util::u64 stop,
-                                       const std::unordered_map<util::u32, util::u32>& replace_map)
+                                       const std::vector<util::u32>& replace_table)
 {
-    using util::u64;
-    
-    if (replace_map.size() == 0)
+    if (is_identity(replace_table))
     {
         return;
     }
     
-    u64 cols = labels.size();
-    
-    for (u64 i = 0; i < cols; i++)
+    for (auto& col : labels)
     {
-        std::vector<u32>& c_cat = labels[i];
-        
-        for (u64 j = start; j < stop; j++)
-        {
-            u32 c_lab = c_cat[j];
-            
-            if (replace_map.count(c_lab) > 0)
-            {
-                c_cat[j] = replace_map.at(c_lab);
-            }
-        }
+        remap_label_ids(col, start, stop, replace_table);
     }
 }
 
@@ -2596,13 +5470,13 @@ void util::categorical::unchecked_assign_progenitors_match(const util::categoric
     
     for (u64 i = 0; i < n_cols; i++)
     {
-        std::vector<u32>& own_labs = m_labels[i];
-        const std::vector<u32>& other_labs = other.m_labels[i];
+        util::label_column& own_labs = m_labels[i];
+        const util::label_column& other_labs = other.m_labels[i];
         
         for (u64 j = 0; j < n_indices; j++)
         {
             u64 to_idx = to_indices[j] - index_offset;
-            own_labs[to_idx] = other_labs[j];
+            own_labs.set(to_idx, other_labs[j]);
         }
     }
 }
@@ -2620,15 +5494,15 @@ void util::categorical::unchecked_assign_progenitors_match(const util::categoric
     
     for (u64 i = 0; i < n_cols; i++)
     {
-        std::vector<u32>& own_labs = m_labels[i];
-        const std::vector<u32>& other_labs = other.m_labels[i];
+        util::label_column& own_labs = m_labels[i];
+        const util::label_column& other_labs = other.m_labels[i];
         
         for (u64 j = 0; j < n_indices; j++)
         {
             const u64 ind_from = is_scalar ? 0 : j;
             u64 from_idx = from_indices[ind_from] - index_offset;
             u64 to_idx = to_indices[j] - index_offset;
-            own_labs[to_idx] = other_labs[from_idx];
+            own_labs.set(to_idx, other_labs[from_idx]);
         }
     }
 }
@@ -2639,6 +5513,8 @@ util::u32 util::categorical::assign(const util::categorical& other,
                                     const std::vector<util::u64>& at_indices,
                                     util::u64 index_offset)
 {
+    modified();
+    
     if (!categories_match(other))
     {
         return util::categorical_status::CATEGORIES_DO_NOT_MATCH;
@@ -2683,24 +5559,24 @@ util::u32 util::categorical::assign(const util::categorical& other,
     
     m_progenitor_ids.randomize();
     
-    std::vector<std::string> other_labels = other.m_label_ids.keys();
+    std::vector<std::string> other_labels = other.m_label_ids->keys();
     u64 n_other_labels = other_labels.size();
     
-    std::unordered_map<u32, u32> replace_other_label_ids;
-    std::unordered_set<u32> new_label_ids;
+    std::vector<u32> replace_other_label_ids(other.m_label_id_allocator.capacity());
+    std::iota(replace_other_label_ids.begin(), replace_other_label_ids.end(), u32(0));
     
     for (u64 i = 0; i < n_other_labels; i++)
     {
         const std::string& other_lab = other_labels[i];
-        const u32 other_id = other.m_label_ids.at(other_lab);
+        const u32 other_id = other.m_label_ids->at(other_lab);
         
-        auto own_id_it = m_label_ids.find(other_lab);
+        auto own_id_it = m_label_ids->find(other_lab);
         
         //  label exists in `this`
-        if (own_id_it != m_label_ids.endk())
+        if (own_id_it != m_label_ids->endk())
         {
-            const std::string& own_cat = m_in_category.at(other_lab);
-            const std::string& other_cat = other.m_in_category.at(other_lab);
+            const std::string& own_cat = m_in_category->at(other_lab);
+            const std::string& other_cat = other.m_in_category->at(other_lab);
             
             if (own_cat != other_cat)
             {
@@ -2709,7 +5585,7 @@ util::u32 util::categorical::assign(const util::categorical& other,
                 return util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY;
             }
             
-            u32 own_id = m_label_ids.at(other_lab);
+            u32 own_id = m_label_ids->at(other_lab);
             
             if (own_id != other_id)
             {
@@ -2718,40 +5594,30 @@ util::u32 util::categorical::assign(const util::categorical& other,
         }
         else
         {
-            u32 assign_id = other_id;
+            const u32 assign_id = get_next_label_id();
             
-            if (m_label_ids.contains(other_id))
+            if (assign_id != other_id)
             {
-                u32 new_id = util::categorical::get_id(this, &other, new_label_ids);
-                replace_other_label_ids[other_id] = new_id;
-                new_label_ids.insert(new_id);
-                assign_id = new_id;
+                replace_other_label_ids[other_id] = assign_id;
             }
             
-            unchecked_insert_label(other_lab, assign_id, other.m_in_category.at(other_lab));
+            unchecked_insert_label(other_lab, assign_id, other.m_in_category->at(other_lab));
         }
     }
     
-    for (const auto& cat_it : m_category_indices)
+    for (const auto& cat_it : *m_category_indices)
     {
         const std::string& cat = cat_it.first;
         const u64 own_cat_idx = cat_it.second;
-        const u64 other_cat_idx = other.m_category_indices.at(cat);
+        const u64 other_cat_idx = other.m_category_indices->at(cat);
         
-        std::vector<u32>& own_ids = m_labels[own_cat_idx];
-        const std::vector<u32>& other_ids = other.m_labels[other_cat_idx];
+        util::label_column& own_ids = m_labels[own_cat_idx];
+        const util::label_column& other_ids = other.m_labels[other_cat_idx];
         
         for (u64 i = 0; i < n_indices; i++)
         {
             const u64 own_idx = at_indices[i] - index_offset;
-            u32 other_id = other_ids[i];
-            
-            if (replace_other_label_ids.count(other_id) > 0)
-            {
-                other_id = replace_other_label_ids[other_id];
-            }
-            
-            own_ids[own_idx] = other_id;
+            own_ids.set(own_idx, replace_other_label_ids[other_ids[i]]);
         }
     }
     
@@ -2767,6 +5633,8 @@ util::u32 util::categorical::assign(const util::categorical& other,
                                     const std::vector<util::u64>& from_indices,
                                     util::u64 index_offset)
 {
+    modified();
+    
     if (!categories_match(other))
     {
         return util::categorical_status::CATEGORIES_DO_NOT_MATCH;
@@ -2810,25 +5678,26 @@ util::u32 util::categorical::assign(const util::categorical& other,
     }
     m_progenitor_ids.randomize();
     
-    std::unordered_map<u32, u32> replace_other_label_ids;
-    std::unordered_set<u32> new_label_ids;
+    //  ids of `other` not yet processed map to no_id.
+    const u32 no_id = ~u32(0);
+    std::vector<u32> replace_other_label_ids(other.m_label_id_allocator.capacity(), no_id);
     
 #ifdef CAT_COPY_ASSIGN_FROM
-    std::vector<std::vector<u32>> copy_own_labs = m_labels;
+    std::vector<util::label_column> copy_own_labs = m_labels;
 #endif
     
-    for (const auto& cat_it : m_category_indices)
+    for (const auto& cat_it : *m_category_indices)
     {
         const std::string& own_cat = cat_it.first;
         const u64 own_cat_idx = cat_it.second;
-        const u64 other_cat_idx = other.m_category_indices.at(own_cat);
+        const u64 other_cat_idx = other.m_category_indices->at(own_cat);
         
 #ifdef CAT_COPY_ASSIGN_FROM
-        std::vector<u32>& own_labs = copy_own_labs[own_cat_idx];
+        util::label_column& own_labs = copy_own_labs[own_cat_idx];
 #else
-        std::vector<u32>& own_labs = m_labels[own_cat_idx];
+        util::label_column& own_labs = m_labels[own_cat_idx];
 #endif
-        const std::vector<u32>& other_labs = other.m_labels[other_cat_idx];
+        const util::label_column& other_labs = other.m_labels[other_cat_idx];
         
         for (u64 i = 0; i < n_to_indices; i++)
         {
@@ -2837,27 +5706,28 @@ util::u32 util::categorical::assign(const util::categorical& other,
             const u64 to_idx = to_indices[i] - index_offset;
             
             const u32 other_lab_id = other_labs[from_idx];
+            const u32 replace_id = replace_other_label_ids[other_lab_id];
             
-            if (replace_other_label_ids.count(other_lab_id) > 0)
+            if (replace_id != no_id)
             {
-                own_labs[to_idx] = replace_other_label_ids.at(other_lab_id);
+                own_labs.set(to_idx, replace_id);
                 continue;
             }
             
             //
             //  not yet processed
             //
-            const std::string& str_lab = other.m_label_ids.at(other_lab_id);
-            const std::string& other_cat = other.m_in_category.at(str_lab);
+            const std::string& str_lab = other.m_label_ids->at(other_lab_id);
+            const std::string& other_cat = other.m_in_category->at(str_lab);
             
-            auto own_lab_it = m_label_ids.find(str_lab);
+            auto own_lab_it = m_label_ids->find(str_lab);
             
             u32 assign_id = other_lab_id;
             
             //  label exists
-            if (own_lab_it != m_label_ids.endk())
+            if (own_lab_it != m_label_ids->endk())
             {
-                if (m_in_category.at(str_lab) != other_cat)
+                if (m_in_category->at(str_lab) != other_cat)
                 {
                     //  get rid of added labels
                     prune();
@@ -2865,7 +5735,7 @@ util::u32 util::categorical::assign(const util::categorical& other,
                     return util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY;
                 }
                 
-                u32 own_lab_id = m_label_ids.at(str_lab);
+                u32 own_lab_id = m_label_ids->at(str_lab);
                 
                 if (own_lab_id != other_lab_id)
                 {
@@ -2874,19 +5744,13 @@ util::u32 util::categorical::assign(const util::categorical& other,
             }
             else
             {
-                if (m_label_ids.contains(other_lab_id))
-                {
-                    u32 new_id = util::categorical::get_id(this, &other, new_label_ids);
-                    new_label_ids.insert(new_id);
-                    assign_id = new_id;
-                }
-                
+                assign_id = get_next_label_id();
                 unchecked_insert_label(str_lab, assign_id, other_cat);
             }
             
             replace_other_label_ids[other_lab_id] = assign_id;
             
-            own_labs[to_idx] = assign_id;
+            own_labs.set(to_idx, assign_id);
         }
     }
     
@@ -2900,8 +5764,57 @@ util::u32 util::categorical::assign(const util::categorical& other,
     return util::categorical_status::OK;
 }
 
-util::u32 util::categorical::merge(const util::categorical& other, const bool overwrite_existing_cats)
+//  assign: Assign contents at indices, taking the storage of `other` where
+//      possible. When `other` derives from `this` and replaces every row in
+//      order, `other` is moved into `this` rather than copied, and `other` is
+//      left empty. Otherwise, `other` is left unchanged.
+
+util::u32 util::categorical::assign(util::categorical&& other,
+                                    const std::vector<util::u64>& to_indices,
+                                    util::u64 index_offset)
+{
+    modified();
+    
+    const u64 own_sz = size();
+    
+    if (this != &other && own_sz > 0 && other.size() == own_sz &&
+        m_progenitor_ids == other.m_progenitor_ids &&
+        covers_all_rows(to_indices, index_offset, own_sz))
+    {
+        unchecked_take(other);
+        return util::categorical_status::OK;
+    }
+    
+    return assign(static_cast<const util::categorical&>(other), to_indices, index_offset);
+}
+
+util::u32 util::categorical::assign(util::categorical&& other,
+                                    const std::vector<util::u64>& to_indices,
+                                    const std::vector<util::u64>& from_indices,
+                                    util::u64 index_offset)
+{
+    modified();
+    
+    const u64 own_sz = size();
+    
+    if (this != &other && own_sz > 0 && other.size() == own_sz &&
+        m_progenitor_ids == other.m_progenitor_ids &&
+        covers_all_rows(to_indices, index_offset, own_sz) &&
+        covers_all_rows(from_indices, index_offset, own_sz))
+    {
+        unchecked_take(other);
+        return util::categorical_status::OK;
+    }
+    
+    return assign(static_cast<const util::categorical&>(other), to_indices, from_indices, index_offset);
+}
+
+util::u32 util::categorical::merge(const util::categorical& other,
+                                   const bool overwrite_existing_cats,
+                                   util::categorical* take_columns_from)
 {
+    modified();
+    
     const u64 own_sz = size();
     const u64 other_sz = other.size();
     
@@ -2913,13 +5826,14 @@ util::u32 util::categorical::merge(const util::categorical& other, const bool ov
         return util::categorical_status::INCOMPATIBLE_SIZES;
     }
     
-    std::unordered_map<u32, u32> replace_other_labs;
+    std::vector<u32> replace_other_labs;
     
-    auto tmp_label_ids = m_label_ids;
-    auto tmp_in_cat = m_in_category;
+    std::unordered_map<std::string, u32> new_label_ids;
+    std::unordered_map<std::string, std::string> new_in_cat;
+    auto tmp_label_id_allocator = m_label_id_allocator;
     
-    util::u32 new_labels_status = reconcile_new_label_ids(other, tmp_label_ids, tmp_in_cat,
-                                                          replace_other_labs, overwrite_existing_cats);
+    util::u32 new_labels_status = reconcile_new_label_ids(other, new_label_ids, new_in_cat, replace_other_labs,
+                                                          tmp_label_id_allocator, overwrite_existing_cats);
     
     if (new_labels_status != util::categorical_status::OK)
     {
@@ -2941,21 +5855,32 @@ util::u32 util::categorical::merge(const util::categorical& other, const bool ov
         return require_cat_status;
     }
     
-    //  if we get here, all is well.
-    const u64 orig_n_labels = m_label_ids.size();
-    const u64 new_n_labels = tmp_label_ids.size();
-    
-    if (new_n_labels > orig_n_labels)
+    //  the collapsed expressions of new categories were given ids by the
+    //  allocator that `tmp_label_id_allocator` replaces, and may share ids with
+    //  the incoming labels. The columns of new categories are filled from
+    //  `other` below, so these labels are unused; erase them.
+    for (const auto& cat : new_categories)
     {
-        m_progenitor_ids.randomize();
+        unchecked_erase_label(get_collapsed_expression(cat));
     }
     
-    m_label_ids = std::move(tmp_label_ids);
-    m_in_category = std::move(tmp_in_cat);
+    //  if we get here, all is well.
+    unchecked_insert_new_labels(new_label_ids, new_in_cat, std::move(tmp_label_id_allocator));
     
     const auto& cats_to_check = overwrite_existing_cats ? other.get_categories() : new_categories;
     
-    merge_fill_new_label_ids(other, cats_to_check, replace_other_labs, is_scalar, sizes_match, own_sz);
+    if (is_scalar && !sizes_match)
+    {
+        take_columns_from = nullptr;
+    }
+    
+    merge_fill_new_label_ids(other, cats_to_check, replace_other_labs,
+                             is_scalar, sizes_match, own_sz, take_columns_from);
+    
+    if (take_columns_from)
+    {
+        *take_columns_from = util::categorical();
+    }
     
     return util::categorical_status::OK;
 }
@@ -2964,6 +5889,8 @@ util::u32 util::categorical::merge(const util::categorical& other, const bool ov
 
 util::u32 util::categorical::merge(const util::categorical& other)
 {
+    modified();
+    
     const bool overwrite_existing_cats = true;
     return merge(other, overwrite_existing_cats);
 }
@@ -2972,39 +5899,73 @@ util::u32 util::categorical::merge(const util::categorical& other)
 
 util::u32 util::categorical::merge_new(const util::categorical& other)
 {
+    modified();
+    
     const bool overwrite_existing_cats = false;
     return merge(other, overwrite_existing_cats);
 }
 
+//  merge: Merge array contents, taking the columns of `other` rather than
+//      copying them. Unless `other` has a single row that is expanded to the
+//      size of `this`, `other` is left empty on success. Otherwise, `other` is
+//      left unchanged.
+
+util::u32 util::categorical::merge(util::categorical&& other)
+{
+    modified();
+    
+    const bool overwrite_existing_cats = true;
+    return merge(other, overwrite_existing_cats, this == &other ? nullptr : &other);
+}
+
+//  merge_new: Merge array contents, preserving existing categories, and taking
+//      the columns of `other` as in merge().
+
+util::u32 util::categorical::merge_new(util::categorical&& other)
+{
+    modified();
+    
+    const bool overwrite_existing_cats = false;
+    return merge(other, overwrite_existing_cats, this == &other ? nullptr : &other);
+}
+
 void util::categorical::merge_fill_new_label_ids(const util::categorical& other,
                                                  const std::vector<std::string>& categories,
-                                                 std::unordered_map<util::u32, util::u32>& replace_other_labs,
+                                                 const std::vector<util::u32>& replace_other_labs,
                                                  bool is_scalar,
                                                  bool sizes_match,
-                                                 util::u64 own_sz)
+                                                 util::u64 own_sz,
+                                                 util::categorical* take_columns_from)
 {
+    const bool identity = is_identity(replace_other_labs);
+    
     for (const auto& cat : categories)
     {
-        u64 own_idx = m_category_indices.at(cat);
-        u64 other_idx = other.m_category_indices.at(cat);
+        u64 own_idx = m_category_indices->at(cat);
+        u64 other_idx = other.m_category_indices->at(cat);
         
-        m_labels[own_idx] = other.m_labels[other_idx];
-        
-        std::vector<u32>& col = m_labels[own_idx];
+        util::label_column& col = m_labels[own_idx];
+        const util::label_column& other_col = other.m_labels[other_idx];
         
         if (is_scalar && !sizes_match)
         {
             col.resize(own_sz);
-            std::fill(col.begin(), col.end(), other.m_labels[other_idx][0]);
+            col.fill(replace_other_labs[other_col[0]]);
         }
-        
-        for (u64 j = 0; j < own_sz; j++)
+        else
         {
-            u32 id = col[j];
+            if (take_columns_from)
+            {
+                col = std::move(take_columns_from->m_labels[other_idx]);
+            }
+            else
+            {
+                col = other_col;
+            }
             
-            if (replace_other_labs.count(id) > 0)
+            if (!identity)
             {
-                col[j] = replace_other_labs.at(id);
+                remap_label_ids(col, 0, own_sz, replace_other_labs);
             }
         }
     }
@@ -3013,14 +5974,14 @@ void util::categorical::merge_fill_new_label_ids(const util::categorical& other,
 util::u32 util::categorical::merge_check_collapsed_expressions(const util::categorical &other,
                                                                const bool overwrite_existing_categories) const
 {
-    for (const auto& it : m_category_indices)
+    for (const auto& it : *m_category_indices)
     {
         const std::string& cat = it.first;
         const std::string collapsed_expression = get_collapsed_expression(cat);
         
         if (other.has_label(collapsed_expression))
         {
-            const std::string& other_cat = other.m_in_category.at(collapsed_expression);
+            const std::string& other_cat = other.m_in_category->at(collapsed_expression);
             const bool wrong_cat = other_cat != cat && (overwrite_existing_categories || !has_category(other_cat));
             
             if (wrong_cat)
@@ -3036,7 +5997,7 @@ util::u32 util::categorical::merge_check_collapsed_expressions(const util::categ
 util::u32 util::categorical::merge_require_categories(const util::categorical& other,
                                                       std::vector<std::string>& new_categories)
 {
-    for (const auto& it : other.m_category_indices)
+    for (const auto& it : *other.m_category_indices)
     {
         const std::string& cat = it.first;
         
@@ -3063,66 +6024,80 @@ util::u32 util::categorical::merge_require_categories(const util::categorical& o
 }
 
 //  reconcile_new_label_ids: Create new label ids for incoming labels.
+//
+//      Incoming labels that are neither in `this` nor in `new_label_ids` are
+//      given the next dense id from `tmp_label_id_allocator`, and added to
+//      `new_label_ids` and `new_in_cat`; `this` is not modified, and its
+//      dictionary is not copied. `replace_other` becomes a table of `other`'s
+//      ids, such that replace_other[id] is the new id of the label `other`
+//      stores as `id`; unused ids, and those of skipped categories, map to
+//      themselves.
 
 util::u32 util::categorical::reconcile_new_label_ids(const util::categorical& other,
-                                                     util::multimap<std::string, util::u32>& tmp_label_ids,
-                                                     std::unordered_map<std::string, std::string>& tmp_in_cat,
-                                                     std::unordered_map<util::u32, util::u32>& replace_other,
+                                                     std::unordered_map<std::string, util::u32>& new_label_ids,
+                                                     std::unordered_map<std::string, std::string>& new_in_cat,
+                                                     std::vector<util::u32>& replace_other,
+                                                     label_id_allocator& tmp_label_id_allocator,
                                                      const bool overwrite_existing_categories) const
 {
-    std::unordered_set<util::u32> new_label_ids;
-    
-    std::vector<std::string> other_labs = other.m_label_ids.keys();
+    const u32 other_capacity = other.m_label_id_allocator.capacity();
+    const auto other_id_end = other.m_label_ids->endv();
+    const auto own_lab_it_end = m_label_ids->endk();
     
-    auto own_lab_it_end = m_label_ids.endk();
+    replace_other.resize(other_capacity);
+    std::iota(replace_other.begin(), replace_other.end(), u32(0));
     
-    u64 n_other_labs = other_labs.size();
-    
-    for (u64 i = 0; i < n_other_labs; i++)
+    for (u32 other_id = 0; other_id < other_capacity; other_id++)
     {
-        const std::string& other_lab = other_labs[i];
-        const std::string& other_in_cat = other.m_in_category.at(other_lab);
+        const auto other_it = other.m_label_ids->find(other_id);
+        
+        if (other_it == other_id_end)
+        {
+            continue;
+        }
+        
+        const std::string& other_lab = other_it->second;
+        const std::string& other_in_cat = other.m_in_category->at(other_lab);
         
         if (!overwrite_existing_categories && has_category(other_in_cat))
         {
             continue;
         }
         
-        auto own_lab_it = m_label_ids.find(other_lab);
-        util::u32 other_id = other.m_label_ids.at(other_lab);
+        auto own_lab_it = m_label_ids->find(other_lab);
         
         //  this label exists
         if (own_lab_it != own_lab_it_end)
         {
-            const std::string& own_in_cat = m_in_category.at(other_lab);
-            
-            if (own_in_cat != other_in_cat)
+            if (m_in_category->at(other_lab) != other_in_cat)
             {
                 return util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY;
             }
             
-            util::u32 own_id = own_lab_it->second;
-            
-            if (own_id != other_id)
-            {
-                replace_other[other_id] = own_id;
-            }
+            replace_other[other_id] = own_lab_it->second;
+            continue;
         }
-        else
-        {            
-            //  label is new
-            util::u32 replace_id = other_id;
-            
-            if (m_label_ids.contains(other_id))
+        
+        auto new_lab_it = new_label_ids.find(other_lab);
+        
+        //  this label was added by an earlier call
+        if (new_lab_it != new_label_ids.end())
+        {
+            if (new_in_cat.at(other_lab) != other_in_cat)
             {
-                replace_id = util::categorical::get_id(this, &other, new_label_ids);
-                new_label_ids.insert(replace_id);
-                replace_other[other_id] = replace_id;
+                return util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY;
             }
             
-            tmp_label_ids.insert(other_lab, replace_id);
-            tmp_in_cat[other_lab] = other_in_cat;
+            replace_other[other_id] = new_lab_it->second;
+            continue;
         }
+        
+        //  label is new
+        const u32 replace_id = tmp_label_id_allocator.next();
+        
+        new_label_ids[other_lab] = replace_id;
+        new_in_cat[other_lab] = other_in_cat;
+        replace_other[other_id] = replace_id;
     }
     
     return util::categorical_status::OK;
@@ -3152,12 +6127,12 @@ std::vector<std::string> util::categorical::get_uniform_categories() const
 {
     std::vector<std::string> cats;
     
-    for (const auto& cat_it : m_category_indices)
+    for (const auto& cat_it : *m_category_indices)
     {
         const u64 cat_idx = cat_it.second;
         const std::string& cat = cat_it.first;
         
-        const std::vector<u32>& labs = m_labels[cat_idx];
+        const util::label_column& labs = m_labels[cat_idx];
         
         if (is_uniform(labs))
         {
@@ -3179,7 +6154,7 @@ std::vector<std::string> util::categorical::get_categories() const
     
     util::u64 i = 0;
     
-    for (const auto& it : m_category_indices)
+    for (const auto& it : *m_category_indices)
     {
         cats[i++] = it.first;
     }
@@ -3212,7 +6187,7 @@ std::vector<std::string> util::categorical::get_categories_except(const std::vec
 
 std::vector<std::string> util::categorical::get_labels() const
 {
-    std::vector<std::string> labs = m_label_ids.keys();
+    std::vector<std::string> labs = m_label_ids->keys();
     std::sort(labs.begin(), labs.end());
     return labs;
 }
@@ -3227,7 +6202,7 @@ util::labels_t util::categorical::get_labels_and_ids() const
     
     for (util::u64 i = 0; i < n_labs; i++)
     {
-        ids[i] = m_label_ids.at(labs[i]);
+        ids[i] = m_label_ids->at(labs[i]);
     }
     
     return { ids, labs };
@@ -3236,7 +6211,7 @@ util::labels_t util::categorical::get_labels_and_ids() const
 //  get_label_mat: Get a reference to the labels array, where columns
 //      are ordered by category.
 
-std::vector<const std::vector<util::u32>*> util::categorical::get_label_mat() const
+std::vector<const util::label_column*> util::categorical::get_label_mat() const
 {
     bool dummy;
     return get_label_mat(get_categories(), &dummy);
@@ -3244,17 +6219,17 @@ std::vector<const std::vector<util::u32>*> util::categorical::get_label_mat() co
 
 //  get_label_mat: Get a reference to the labels array, in subset of categories.
 
-std::vector<const std::vector<util::u32>*> util::categorical::get_label_mat(const std::vector<std::string>& cats,
+std::vector<const util::label_column*> util::categorical::get_label_mat(const std::vector<std::string>& cats,
                                                                             bool* exists) const
 {
     *exists = true;
     util::u64 n_cats = cats.size();
-    std::vector<const std::vector<util::u32>*> res(n_cats);
-    auto cat_end = m_category_indices.end();
+    std::vector<const util::label_column*> res(n_cats);
+    auto cat_end = m_category_indices->end();
     
     for (util::u64 i = 0; i < n_cats; i++)
     {
-        auto it = m_category_indices.find(cats[i]);
+        auto it = m_category_indices->find(cats[i]);
         
         if (it == cat_end)
         {
@@ -3283,17 +6258,17 @@ std::vector<std::string> util::categorical::partial_category(const std::string &
     using util::u64;
     using util::u32;
     
-    const auto cat_it = m_category_indices.find(category);
+    const auto cat_it = m_category_indices->find(category);
     
     std::vector<std::string> result;
     
-    if (cat_it == m_category_indices.end())
+    if (cat_it == m_category_indices->end())
     {
         *status = util::categorical_status::CATEGORY_DOES_NOT_EXIST;
         return result;
     }
     
-    const std::vector<u32>& labs = m_labels[cat_it->second];
+    const util::label_column& labs = m_labels[cat_it->second];
     
     u64 n_indices = at_indices.size();
     u64 sz = size();
@@ -3309,7 +6284,7 @@ std::vector<std::string> util::categorical::partial_category(const std::string &
             return result;
         }
         
-        result.push_back(m_label_ids.at(labs[idx]));
+        result.push_back(m_label_ids->at(labs[idx]));
     }
     
     *status = util::categorical_status::OK;
@@ -3324,11 +6299,11 @@ std::vector<std::string> util::categorical::partial_category(const std::string &
 
 std::vector<std::string> util::categorical::full_category(const std::string &category, bool *exists) const
 {
-    const auto cat_it = m_category_indices.find(category);
+    const auto cat_it = m_category_indices->find(category);
     
     std::vector<std::string> result;
     
-    if (cat_it == m_category_indices.end())
+    if (cat_it == m_category_indices->end())
     {
         *exists = false;
         return result;
@@ -3340,11 +6315,11 @@ std::vector<std::string> util::categorical::full_category(const std::string &cat
     
     result.resize(sz);
     
-    const std::vector<util::u32>& ids = m_labels[cat_it->second];
+    const util::label_column& ids = m_labels[cat_it->second];
     
     for (util::u64 i = 0; i < sz; i++)
     {
-        std::string lab = m_label_ids.at(ids[i]);
+        std::string lab = m_label_ids->at(ids[i]);
         result[i] = lab;
     }
     
@@ -3370,15 +6345,15 @@ bool util::categorical::is_uniform_category(const std::string& cat, bool* exists
     
     *exists = true;
     
-    auto cat_it = m_category_indices.find(cat);
+    auto cat_it = m_category_indices->find(cat);
     
-    if (cat_it == m_category_indices.end())
+    if (cat_it == m_category_indices->end())
     {
         *exists = false;
         return false;
     }
     
-    const std::vector<u32>& lab_ids = m_labels[cat_it->second];
+    const util::label_column& lab_ids = m_labels[cat_it->second];
     
     return is_uniform(lab_ids);
 }
@@ -3395,15 +6370,15 @@ bool util::categorical::is_uniform_category(const std::string &cat,
     
     *status = util::categorical_status::OK;
     
-    auto cat_it = m_category_indices.find(cat);
+    auto cat_it = m_category_indices->find(cat);
     
-    if (cat_it == m_category_indices.end())
+    if (cat_it == m_category_indices->end())
     {
         *status = util::categorical_status::CATEGORY_DOES_NOT_EXIST;
         return false;
     }
     
-    const std::vector<u32>& lab_ids = m_labels[cat_it->second];
+    const util::label_column& lab_ids = m_labels[cat_it->second];
     
     return is_uniform(lab_ids, indices, status, index_offset);
 }
@@ -3445,7 +6420,7 @@ std::vector<bool> util::categorical::are_uniform_categories(const std::vector<st
     return result;
 }
 
-bool util::categorical::is_uniform(const std::vector<util::u32>& lab_ids) const
+bool util::categorical::is_uniform(const util::label_column& lab_ids) const
 {
     using util::u64;
     using util::u32;
@@ -3457,20 +6432,22 @@ bool util::categorical::is_uniform(const std::vector<util::u32>& lab_ids) const
         return true;
     }
     
-    u32 last = lab_ids[0];
-    
-    for (u64 i = 1; i < sz; i++)
-    {
-        if (lab_ids[i] != last)
+    return lab_ids.visit([sz](const auto* ids) -> bool {
+        const auto last = ids[0];
+        
+        for (u64 i = 1; i < sz; i++)
         {
-            return false;
+            if (ids[i] != last)
+            {
+                return false;
+            }
         }
-    }
-    
-    return true;
+        
+        return true;
+    });
 }
 
-bool util::categorical::is_uniform(const std::vector<util::u32>& lab_ids,
+bool util::categorical::is_uniform(const util::label_column& lab_ids,
                                    const std::vector<util::u64>& indices,
                                    util::u32* status,
                                    util::u64 index_offset) const
@@ -3528,7 +6505,7 @@ std::string util::categorical::which_category(const std::string& label, bool* ex
     }
     
     *exists = true;
-    return m_in_category.find(label)->second;
+    return m_in_category->find(label)->second;
 }
 
 //  in_category: Get all labels in a category.
@@ -3574,13 +6551,13 @@ std::vector<std::string> util::categorical::in_categories(const std::vector<std:
     *exist = true;
     
     std::vector<std::string> result;
-    std::vector<std::string> labs = m_label_ids.keys();
+    std::vector<std::string> labs = m_label_ids->keys();
     
     for (const auto& cat : categories)
     {
         for (const auto& lab : labs)
         {
-            if (m_in_category.at(lab) == cat)
+            if (m_in_category->at(lab) == cat)
             {
                 result.push_back(lab);
             }
@@ -3592,14 +6569,14 @@ std::vector<std::string> util::categorical::in_categories(const std::vector<std:
 
 void util::categorical::unchecked_in_category(std::vector<std::string>& out, const std::string& category) const
 {
-    std::vector<std::string> labs = m_label_ids.keys();
+    std::vector<std::string> labs = m_label_ids->keys();
     util::u64 n_labs = labs.size();
     
     for (util::u64 i = 0; i < n_labs; i++)
     {
         const std::string& lab = labs[i];
         
-        if (m_in_category.at(lab) == category)
+        if (m_in_category->at(lab) == category)
         {
             out.push_back(lab);
         }
@@ -3610,6 +6587,8 @@ void util::categorical::unchecked_in_category(std::vector<std::string>& out, con
 
 void util::categorical::remove_category(const std::string& category, bool* exists)
 {
+    modified();
+    
     std::vector<std::string> labs = in_category(category, exists);
     
     if (!(*exists))
@@ -3617,9 +6596,9 @@ void util::categorical::remove_category(const std::string& category, bool* exist
         return;
     }
     
-    util::u64 cat_index = m_category_indices.at(category);
+    util::u64 cat_index = m_category_indices->at(category);
     
-    for (auto& it : m_category_indices)
+    for (auto& it : m_category_indices.mutate())
     {
         if (it.second > cat_index)
         {
@@ -3628,17 +6607,14 @@ void util::categorical::remove_category(const std::string& category, bool* exist
     }
     
     m_labels.erase(m_labels.begin() + cat_index);
-    m_collapsed_expressions.erase(get_collapsed_expression(category));
-    m_category_indices.erase(category);
+    m_collapsed_expressions.mutate().erase(get_collapsed_expression(category));
+    m_category_indices.mutate().erase(category);
     
     u64 n_labs = labs.size();
     
     for (u64 i = 0; i < n_labs; i++)
     {
-        const std::string& lab = labs[i];
-        
-        m_label_ids.erase(lab);
-        m_in_category.erase(lab);
+        unchecked_erase_label(labs[i]);
     }
     
     m_progenitor_ids.randomize();
@@ -3648,6 +6624,8 @@ void util::categorical::remove_category(const std::string& category, bool* exist
 
 void util::categorical::collapse_category(const std::string& category, bool* exists)
 {
+    modified();
+    
     const bool is_uniform = is_uniform_category(category, exists);
     if (!*exists || is_uniform)
     {
@@ -3662,9 +6640,9 @@ void util::categorical::collapse_category(const std::string& category, bool* exi
     
     u32 lab_id;
     
-    if (m_label_ids.contains(collapsed_expression))
+    if (m_label_ids->contains(collapsed_expression))
     {
-        lab_id = m_label_ids.at(collapsed_expression);
+        lab_id = m_label_ids->at(collapsed_expression);
     }
     else
     {
@@ -3676,19 +6654,19 @@ void util::categorical::collapse_category(const std::string& category, bool* exi
     {
         if (labs[i] != collapsed_expression)
         {
-            m_label_ids.erase(labs[i]);
-            m_in_category.erase(labs[i]);
+            unchecked_erase_label(labs[i]);
         }
     }
     
-    std::vector<u32>& full_labs = m_labels[m_category_indices.at(category)];
-    std::fill(full_labs.begin(), full_labs.end(), lab_id);
+    m_labels[m_category_indices->at(category)].fill(lab_id);
     
     m_progenitor_ids.randomize();
 }
 
 void util::categorical::collapse_category(const std::string& category)
 {
+    modified();
+    
     bool dummy;
     collapse_category(category, &dummy);
 }
@@ -3704,12 +6682,13 @@ util::categorical util::categorical::empty_copy(const util::categorical& to_copy
     tmp.m_in_category = to_copy.m_in_category;
     tmp.m_collapsed_expressions = to_copy.m_collapsed_expressions;
     tmp.m_progenitor_ids = to_copy.m_progenitor_ids;
+    tmp.m_label_id_allocator = to_copy.m_label_id_allocator;
     
     u64 n_cats = to_copy.m_labels.size();
     
     for (u64 i = 0; i < n_cats; i++)
     {
-        tmp.m_labels.push_back(std::vector<u32>());
+        tmp.m_labels.emplace_back();
     }
     
     return tmp;
@@ -3717,23 +6696,29 @@ util::categorical util::categorical::empty_copy(const util::categorical& to_copy
 
 //  get_next_label_id: Get the next label id.
 //
-//      The next label id is a random 32 bit unsigned int
+//      Label ids are dense: a released id is reused before a new one is
+//      issued, such that all ids lie in [0, label_id_capacity()).
 
 util::u32 util::categorical::get_next_label_id()
 {
-    using util::u32;
-    static std::mt19937 random_engine = std::mt19937(std::random_device()());
-    
-    u32 int_max = ~(u32(0));
-    std::uniform_int_distribution<u32> uniform_dist(0, int_max);
-    u32 id = uniform_dist(random_engine);
-    
-    while (has_label(id))
-    {
-        id = uniform_dist(random_engine);
-    }
-    
-    return id;
+    return m_label_id_allocator.next();
+}
+
+//  label_id_capacity: Get one past the largest label id that can currently be in use.
+//
+//      Arrays of this size can be indexed directly by label id.
+
+util::u32 util::categorical::label_id_capacity() const
+{
+    return m_label_id_allocator.capacity();
+}
+
+//  rebuild_label_id_allocator: Recompute free ids after labels were inserted with
+//      externally chosen ids.
+
+void util::categorical::rebuild_label_id_allocator()
+{
+    m_label_id_allocator.rebuild(m_label_ids->values());
 }
 
 bool util::categorical::progenitors_match(const util::categorical& other) const
@@ -3741,23 +6726,39 @@ bool util::categorical::progenitors_match(const util::categorical& other) const
     return m_progenitor_ids == other.m_progenitor_ids;
 }
 
-util::u32 util::categorical::get_id(const categorical* self,
-                                    const categorical* other,
-                                    const std::unordered_set<util::u32>& new_ids)
+//  version: Get an id of the current contents of the object, which changes
+//      whenever the object is modified. Ids are unique across objects, except
+//      that a copy shares the id of its source until either is modified.
+
+util::u64 util::categorical::version() const
 {
-    using util::u32;
-    static std::mt19937 random_engine = std::mt19937(std::random_device()());
-    
-    u32 int_max = ~(u32(0));
-    std::uniform_int_distribution<u32> uniform_dist(0, int_max);
-    u32 id = uniform_dist(random_engine);
-    
-    while (self->has_label(id) || other->has_label(id) || new_ids.count(id) > 0)
-    {
-        id = uniform_dist(random_engine);
-    }
-    
-    return id;
+    return m_version;
+}
+
+//  set_grouping_cache_capacity: Bound the cache of find_all and find_allc
+//      results to `max_entries` entries and `max_bytes` bytes. Either bound
+//      being 0 disables the cache.
+
+void util::categorical::set_grouping_cache_capacity(util::u64 max_entries, util::u64 max_bytes)
+{
+    m_grouping_cache.set_capacity(max_entries, max_bytes);
+}
+
+//  next_version [private]: Get a new version id.
+
+util::u64 util::categorical::next_version()
+{
+    static std::atomic<util::u64> last_version(0);
+    return ++last_version;
+}
+
+//  modified [private]: Mark the object as modified, invalidating cached results.
+//
+//      Every non-const method calls modified() before changing the object.
+
+void util::categorical::modified()
+{
+    m_version = next_version();
 }
 
 //  get_id: Get random unsigned 32-bit integer.
@@ -3817,3 +6818,73 @@ bool util::categorical::progenitor_ids::exists(util::u32 id) const
 {
     return a == id || b == id || id == 0;
 }
+
+//
+//  label_id_allocator
+//
+
+util::categorical::label_id_allocator::label_id_allocator() : high_water_mark(0)
+{
+    //
+}
+
+util::u32 util::categorical::label_id_allocator::next()
+{
+    if (!free_ids.empty())
+    {
+        const util::u32 id = free_ids.back();
+        free_ids.pop_back();
+        return id;
+    }
+    
+    return high_water_mark++;
+}
+
+void util::categorical::label_id_allocator::release(util::u32 id)
+{
+    if (id + 1 == high_water_mark)
+    {
+        high_water_mark--;
+    }
+    else
+    {
+        free_ids.push_back(id);
+    }
+}
+
+//  rebuild: Reset such that exactly the ids in `in_use` are taken.
+
+void util::categorical::label_id_allocator::rebuild(const std::vector<util::u32>& in_use)
+{
+    free_ids.clear();
+    high_water_mark = 0;
+    
+    for (const auto id : in_use)
+    {
+        if (id >= high_water_mark)
+        {
+            high_water_mark = id + 1;
+        }
+    }
+    
+    std::vector<bool> taken(high_water_mark, false);
+    
+    for (const auto id : in_use)
+    {
+        taken[id] = true;
+    }
+    
+    //  Push in descending order, so that the lowest ids are reused first.
+    for (util::u32 i = high_water_mark; i > 0; i--)
+    {
+        if (!taken[i-1])
+        {
+            free_ids.push_back(i-1);
+        }
+    }
+}
+
+util::u32 util::categorical::label_id_allocator::capacity() const
+{
+    return high_water_mark;
+}
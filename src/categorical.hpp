@@ -11,11 +11,16 @@
 #include "types.hpp"
 #include "multimap.hpp"
 #include "bit_array.hpp"
+#include "label_column.hpp"
+#include "query_expr.hpp"
+#include "grouping_cache.hpp"
+#include "copy_on_write.hpp"
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <memory>
 
 namespace util {
     class categorical;
@@ -28,12 +33,74 @@ namespace util {
         std::vector<std::string> combinations;
     };
     
+    enum class with_group_ids
+    {
+        no,
+        yes
+    };
+    
+    //  groups_t: Indices of each group stored contiguously. The indices of group
+    //  i are indices[offsets[i]] through indices[offsets[i+1]-1], such that
+    //  `offsets` has one more element than there are groups. `group_ids` holds
+    //  the group of each row searched, if requested, and `combinations` holds the
+    //  labels of each group as in combinations_t, if requested.
+    struct groups_t
+    {
+        std::vector<util::u64> indices;
+        std::vector<util::u64> offsets;
+        std::vector<util::u64> group_ids;
+        std::vector<std::string> combinations;
+    };
+    
+    //  nested_groups_t: Groups of rows at successive levels, in which each group
+    //  of a level is split by the categories of the next level. The rows of
+    //  group i of level k are indices[offsets[k][i]] through
+    //  indices[offsets[k][i+1]-1], and the group is a subgroup of group
+    //  parents[k][i] of level k-1 (parents[0] is empty). combinations[k] holds
+    //  the labels of the level's categories for each group, as in
+    //  combinations_t. Groups are ordered by parent, then by first appearance,
+    //  such that the rows and subgroups of each group are contiguous; the rows
+    //  of a group are ordered by subgroup, then by appearance.
+    struct nested_groups_t
+    {
+        std::vector<util::u64> indices;
+        std::vector<std::vector<util::u64>> offsets;
+        std::vector<std::vector<util::u64>> parents;
+        std::vector<std::vector<std::string>> combinations;
+    };
+    
     struct labels_t
     {
         std::vector<util::u32> ids;
         std::vector<std::string> labels;
     };
     
+    //  combination_ids_t: Groups as in groups_t, identified by label ids rather
+    //  than labels. `ids` is a (groups x categories) matrix stored by column,
+    //  such that the id of the label of group i in category j is
+    //  ids[j * n_groups + i]. `labels` holds each id in `ids` once, in
+    //  ascending order, along with its label.
+    struct combination_ids_t
+    {
+        std::vector<util::u64> indices;
+        std::vector<util::u64> offsets;
+        std::vector<util::u32> ids;
+        util::labels_t labels;
+    };
+    
+    struct value_counts_t
+    {
+        std::vector<util::u32> ids;
+        std::vector<std::string> labels;
+        std::vector<util::u64> counts;
+    };
+    
+    struct combination_counts_t
+    {
+        std::vector<std::string> combinations;
+        std::vector<util::u64> counts;
+    };
+    
     namespace categorical_status {
         static constexpr util::u32 OK = 0u;
         static constexpr util::u32 CATEGORY_EXISTS = 1u;
@@ -70,12 +137,20 @@ public:
     {
         hash,
         sort,
-        custom_hash
+        custom_hash,
+        radix,
+        dense_key,
+        automatic
     };
 public:
     categorical() = default;
     ~categorical() = default;
     
+    categorical(const util::categorical& other) = default;
+    categorical& operator=(const util::categorical& other) = default;
+    categorical(util::categorical&& other) = default;
+    categorical& operator=(util::categorical&& other) = default;
+    
     bool operator ==(const util::categorical& other) const;
     bool operator !=(const util::categorical& other) const;
     
@@ -103,6 +178,19 @@ public:
                                      util::u32* status,
                                      util::u64 index_offset = 0) const;
     
+    std::vector<util::u64> find_expr(const util::query_expr& expr, util::u64 index_offset = 0) const;
+    std::vector<util::u64> find_expr(const util::query_expr& expr,
+                                     const std::vector<util::u64>& indices,
+                                     util::u32* status,
+                                     util::u64 index_offset = 0) const;
+    
+    std::vector<std::vector<util::u64>> find_batch(const std::vector<std::vector<std::string>>& label_sets,
+                                                   util::u64 index_offset = 0) const;
+    std::vector<std::vector<util::u64>> find_batch(const std::vector<std::vector<std::string>>& label_sets,
+                                                   const std::vector<util::u64>& indices,
+                                                   util::u32* status,
+                                                   util::u64 index_offset = 0) const;
+    
     std::vector<std::vector<util::u64>> find_all(const std::vector<std::string>& categories, util::u64 index_offset = 0) const;
     std::vector<std::vector<util::u64>> find_all(const std::vector<std::string>& categories,
                                                  const std::vector<util::u64>& indices,
@@ -118,6 +206,26 @@ public:
                                                  util::u32* status,
                                                  util::u64 index_offset = 0) const;
     
+    util::groups_t find_all_groups(const std::vector<std::string>& categories,
+                                   util::u64 index_offset = 0,
+                                   util::with_group_ids ids = util::with_group_ids::no) const;
+    util::groups_t find_all_groups(const std::vector<std::string>& categories,
+                                   const std::vector<util::u64>& indices,
+                                   util::u32* status,
+                                   util::u64 index_offset = 0,
+                                   util::with_group_ids ids = util::with_group_ids::no) const;
+    
+    util::groups_t find_all_groups(find_all_method method,
+                                   const std::vector<std::string>& categories,
+                                   util::u64 index_offset = 0,
+                                   util::with_group_ids ids = util::with_group_ids::no) const;
+    util::groups_t find_all_groups(find_all_method method,
+                                   const std::vector<std::string>& categories,
+                                   const std::vector<util::u64>& indices,
+                                   util::u32* status,
+                                   util::u64 index_offset = 0,
+                                   util::with_group_ids ids = util::with_group_ids::no) const;
+    
     util::combinations_t find_allc(const std::vector<std::string>& categories,
                                    util::u64 index_offset = 0) const;
     
@@ -126,6 +234,41 @@ public:
                                    util::u32* status,
                                    util::u64 index_offset = 0) const;
     
+    util::groups_t find_allc_groups(const std::vector<std::string>& categories,
+                                    util::u64 index_offset = 0,
+                                    util::with_group_ids ids = util::with_group_ids::no) const;
+    util::groups_t find_allc_groups(const std::vector<std::string>& categories,
+                                    const std::vector<util::u64>& indices,
+                                    util::u32* status,
+                                    util::u64 index_offset = 0,
+                                    util::with_group_ids ids = util::with_group_ids::no) const;
+    
+    util::combination_ids_t find_allc_ids(const std::vector<std::string>& categories,
+                                          util::u64 index_offset = 0) const;
+    util::combination_ids_t find_allc_ids(const std::vector<std::string>& categories,
+                                          const std::vector<util::u64>& indices,
+                                          util::u32* status,
+                                          util::u64 index_offset = 0) const;
+    
+    util::nested_groups_t find_all_nested(const std::vector<std::vector<std::string>>& levels,
+                                          util::u64 index_offset = 0) const;
+    util::nested_groups_t find_all_nested(const std::vector<std::vector<std::string>>& levels,
+                                          const std::vector<util::u64>& indices,
+                                          util::u32* status,
+                                          util::u64 index_offset = 0) const;
+    
+    util::value_counts_t value_counts(const std::string& category, bool* exists) const;
+    util::value_counts_t value_counts(const std::string& category,
+                                      const std::vector<util::u64>& indices,
+                                      util::u32* status,
+                                      util::u64 index_offset = 0) const;
+    
+    util::combination_counts_t combination_counts(const std::vector<std::string>& categories) const;
+    util::combination_counts_t combination_counts(const std::vector<std::string>& categories,
+                                                  const std::vector<util::u64>& indices,
+                                                  util::u32* status,
+                                                  util::u64 index_offset = 0) const;
+    
     std::vector<std::vector<util::u64>> keep_each(const std::vector<std::string>& categories, util::u64 index_offset = 0);
     
     std::vector<std::vector<util::u64>> keep_each(const std::vector<std::string>& categories,
@@ -133,6 +276,12 @@ public:
                                                   util::u32* status,
                                                   util::u64 index_offset = 0);
     
+    util::groups_t keep_each_groups(const std::vector<std::string>& categories, util::u64 index_offset = 0);
+    util::groups_t keep_each_groups(const std::vector<std::string>& categories,
+                                    const std::vector<util::u64>& indices,
+                                    util::u32* status,
+                                    util::u64 index_offset = 0);
+    
     util::combinations_t keep_eachc(const std::vector<std::string>& categories,
                                    util::u64 index_offset = 0);
     
@@ -144,6 +293,7 @@ public:
     void one();
     void empty();
     util::u64 prune();
+    void compact();
     
     std::vector<std::string> get_uniform_categories() const;
     std::vector<std::string> get_categories() const;
@@ -152,8 +302,8 @@ public:
     std::vector<std::string> get_labels() const;
     util::labels_t get_labels_and_ids() const;
     
-    std::vector<const std::vector<util::u32>*> get_label_mat() const;
-    std::vector<const std::vector<util::u32>*> get_label_mat(const std::vector<std::string>& categories, bool* exists) const;
+    std::vector<const util::label_column*> get_label_mat() const;
+    std::vector<const util::label_column*> get_label_mat(const std::vector<std::string>& categories, bool* exists) const;
     
     std::vector<std::string> full_category(const std::string& category, bool* exists) const;
     std::vector<std::string> full_category(const std::string& category) const;
@@ -195,6 +345,11 @@ public:
     util::u32 append(const util::categorical &other,
                      const std::vector<util::u64>& indices,
                      util::u64 index_offset = 0);
+    util::u32 append(util::categorical&& other);
+    util::u32 append(util::categorical&& other,
+                     const std::vector<util::u64>& indices,
+                     util::u64 index_offset = 0);
+    util::u32 append_many(const std::vector<const util::categorical*>& others);
     
     util::u32 append_one(const util::categorical& other);
     util::u32 append_one(const util::categorical& other,
@@ -209,9 +364,18 @@ public:
                      const std::vector<util::u64>& to_indices,
                      const std::vector<util::u64>& from_indices,
                      util::u64 index_offset = 0);
+    util::u32 assign(util::categorical&& other,
+                     const std::vector<util::u64>& to_indices,
+                     util::u64 index_offset = 0);
+    util::u32 assign(util::categorical&& other,
+                     const std::vector<util::u64>& to_indices,
+                     const std::vector<util::u64>& from_indices,
+                     util::u64 index_offset = 0);
     
     util::u32 merge(const util::categorical& other);
     util::u32 merge_new(const util::categorical& other);
+    util::u32 merge(util::categorical&& other);
+    util::u32 merge_new(util::categorical&& other);
     
     bool has_category(const std::string& category) const;
     bool has_categories(const std::vector<std::string>& categories) const;
@@ -247,6 +411,9 @@ public:
     
     bool progenitors_match(const util::categorical& other) const;
     
+    util::u64 version() const;
+    void set_grouping_cache_capacity(util::u64 max_entries, util::u64 max_bytes);
+    
     friend void from_matlab_categorical(util::categorical* self,
                                         const std::vector<std::string>& categories,
                                         const std::vector<std::string>& labels,
@@ -254,28 +421,51 @@ public:
                                         util::u64 rows,
                                         util::u64 cols);
 private:
-    std::vector<std::vector<util::u32>> m_labels;
-    std::unordered_map<std::string, util::u64> m_category_indices;
-    util::multimap<std::string, util::u32> m_label_ids;
-    std::unordered_map<std::string, std::string> m_in_category;
-    std::unordered_set<std::string> m_collapsed_expressions;
+    struct label_id_allocator;
+    struct query_step;
     
 private:
+    std::vector<util::label_column> m_labels;
+    util::copy_on_write<std::unordered_map<std::string, util::u64>> m_category_indices;
+    util::copy_on_write<util::multimap<std::string, util::u32>> m_label_ids;
+    util::copy_on_write<std::unordered_map<std::string, std::string>> m_in_category;
+    util::copy_on_write<std::unordered_set<std::string>> m_collapsed_expressions;
+    
+    util::u64 m_version = next_version();
+    mutable util::grouping_cache m_grouping_cache;
+    
+private:
+    static util::u64 next_version();
+    void modified();
+    
     bool is_collapsed_expression_in_wrong_category(const std::string& category, const std::string& label) const;
     bool has_label(util::u32 label_id) const;
     util::u32 add_label_unchecked_has_category(const std::string& category, const std::string& label, u32* label_id);
     
     util::u32 get_next_label_id();
     util::u32 get_label_id_or_0(const std::string& lab, bool* exist) const;
+    util::u32 label_id_capacity() const;
+    void rebuild_label_id_allocator();
+    bool compact_label_ids();
     
     void unchecked_add_category(const std::string& category, const std::string& collapsed_expression);
     void unchecked_in_category(std::vector<std::string>& out, const std::string& category) const;
     void unchecked_full_category(std::vector<std::string>& out, const std::string& category) const;
-    void unchecked_keep_each(const std::vector<std::vector<util::u64>>& indices, util::u64 index_offset);
+    void unchecked_keep_each(const util::groups_t& groups,
+                             const std::vector<std::string>& categories,
+                             const bool use_indices,
+                             const std::vector<util::u64>& indices,
+                             util::u64 index_offset);
+    util::u64 erase_unused_labels(const std::vector<bool>& in_use);
     void unchecked_insert_label(const std::string& lab, const util::u32 id, const std::string& category);
-    const std::vector<util::u32>& unchecked_get_label_column(const std::string& lab) const;
+    void unchecked_insert_new_labels(const std::unordered_map<std::string, util::u32>& new_label_ids,
+                                     const std::unordered_map<std::string, std::string>& new_in_cat,
+                                     label_id_allocator&& label_id_allocator);
+    void unchecked_erase_label(const std::string& lab);
+    const util::label_column& unchecked_get_label_column(const std::string& lab) const;
     
-    bool unchecked_eq_progenitors_match(const util::categorical& other, util::u64 sz) const;
+    bool unchecked_eq_progenitors_match(const util::categorical& other) const;
+    void unchecked_take(util::categorical& other);
     
     void unchecked_append_progenitors_match(const util::categorical& other,
                                             util::u64 own_sz,
@@ -306,8 +496,8 @@ private:
                               util::u64 repetitions);
     
     bool categories_match(const categorical& other) const;
-    bool is_uniform(const std::vector<util::u32>& lab_ids) const;
-    bool is_uniform(const std::vector<util::u32>& lab_ids,
+    bool is_uniform(const util::label_column& lab_ids) const;
+    bool is_uniform(const util::label_column& lab_ids,
                     const std::vector<util::u64>& indices,
                     util::u32* status,
                     util::u64 index_offset) const;
@@ -326,42 +516,132 @@ private:
                                         util::u32* status,
                                         util::u64 index_offset) const;
     
-    std::vector<std::vector<util::u64>> find_all_method_dispatch(const find_all_method method,
-                                                                 const std::vector<std::string>& categories,
-                                                                 const bool use_indices,
-                                                                 const std::vector<util::u64>& indices,
-                                                                 util::u32* status,
-                                                                 util::u64 index_offset) const;
-    
-    std::vector<std::vector<util::u64>> find_all_hash_impl(const std::vector<std::string>& categories,
-                                                           const bool use_indices,
-                                                           const std::vector<util::u64>& indices,
-                                                           util::u32* status,
-                                                           util::u64 index_offset) const;
-    
-    std::vector<std::vector<util::u64>> find_all_custom_hash_impl(const std::vector<std::string>& categories,
-                                                                  const bool use_indices,
-                                                                  const std::vector<util::u64>& indices,
-                                                                  util::u32* status,
-                                                                  util::u64 index_offset) const;
+    bool use_label_index() const;
     
-    std::vector<std::vector<util::u64>> find_all_sort_impl(const std::vector<std::string>& categories,
-                                                           const bool use_indices,
-                                                           const std::vector<util::u64>& indices,
-                                                           util::u32* status,
-                                                           util::u64 index_offset) const;
+    std::vector<util::u64> find_expr_impl(const util::query_expr& expr,
+                                          const bool use_indices,
+                                          const std::vector<util::u64>& indices,
+                                          util::u32* status,
+                                          util::u64 index_offset) const;
     
-    util::combinations_t find_allc_impl(const std::vector<std::string>& categories,
-                                        const bool use_indices,
-                                        const std::vector<util::u64>& indices,
-                                        util::u32* status,
-                                        util::u64 index_offset) const;
+    void plan_query(const util::query_expr& expr, std::vector<query_step>& program) const;
+    
+    std::vector<std::vector<util::u64>> find_batch_impl(const std::vector<std::vector<std::string>>& label_sets,
+                                                        const bool use_indices,
+                                                        const std::vector<util::u64>& indices,
+                                                        util::u32* status,
+                                                        util::u64 index_offset) const;
+    
+    util::groups_t find_all_method_dispatch(const find_all_method method,
+                                            const std::vector<std::string>& categories,
+                                            const bool use_indices,
+                                            const std::vector<util::u64>& indices,
+                                            util::u32* status,
+                                            util::u64 index_offset,
+                                            const bool with_group_ids) const;
+    
+    util::groups_t find_all_hash_impl(const std::vector<std::string>& categories,
+                                      const bool use_indices,
+                                      const std::vector<util::u64>& indices,
+                                      util::u32* status,
+                                      util::u64 index_offset,
+                                      const bool with_group_ids) const;
+    
+    util::groups_t find_all_custom_hash_impl(const std::vector<std::string>& categories,
+                                             const bool use_indices,
+                                             const std::vector<util::u64>& indices,
+                                             util::u32* status,
+                                             util::u64 index_offset,
+                                             const bool with_group_ids) const;
+    
+    util::groups_t find_all_radix_impl(const std::vector<std::string>& categories,
+                                       const bool use_indices,
+                                       const std::vector<util::u64>& indices,
+                                       util::u32* status,
+                                       util::u64 index_offset,
+                                       const bool with_group_ids) const;
+    
+    util::groups_t find_all_dense_key_impl(const std::vector<std::string>& categories,
+                                           const bool use_indices,
+                                           const std::vector<util::u64>& indices,
+                                           util::u32* status,
+                                           util::u64 index_offset,
+                                           const bool with_group_ids) const;
+    
+    util::groups_t find_all_automatic_impl(const std::vector<std::string>& categories,
+                                           const bool use_indices,
+                                           const std::vector<util::u64>& indices,
+                                           util::u32* status,
+                                           util::u64 index_offset,
+                                           const bool with_group_ids) const;
+    
+    find_all_method choose_find_all_method(const std::vector<std::string>& categories, util::u64 rows) const;
+    
+    util::groups_t find_all_parallel_impl(const std::vector<std::string>& categories,
+                                          const bool use_indices,
+                                          const std::vector<util::u64>& indices,
+                                          util::u32* status,
+                                          util::u64 index_offset,
+                                          const bool with_group_ids,
+                                          const bool sorted) const;
+    
+    bool dense_key_strides(const std::vector<std::string>& categories,
+                           std::vector<util::u32>& local_codes,
+                           std::vector<util::u64>& strides,
+                           util::u64* n_keys) const;
+    
+    util::groups_t find_all_sort_impl(const std::vector<std::string>& categories,
+                                      const bool use_indices,
+                                      const std::vector<util::u64>& indices,
+                                      util::u32* status,
+                                      util::u64 index_offset,
+                                      const bool with_group_ids) const;
+    
+    util::groups_t find_allc_impl(const std::vector<std::string>& categories,
+                                  const bool use_indices,
+                                  const std::vector<util::u64>& indices,
+                                  util::u32* status,
+                                  util::u64 index_offset,
+                                  const bool with_group_ids) const;
+    
+    util::combination_ids_t find_allc_ids_impl(const std::vector<std::string>& categories,
+                                               const bool use_indices,
+                                               const std::vector<util::u64>& indices,
+                                               util::u32* status,
+                                               util::u64 index_offset) const;
+    
+    std::shared_ptr<const util::groups_t> cached_groups(const bool with_combinations,
+                                                        find_all_method method,
+                                                        const std::vector<std::string>& categories,
+                                                        const bool use_indices,
+                                                        const std::vector<util::u64>& indices,
+                                                        util::u32* status,
+                                                        util::u64 index_offset,
+                                                        const bool with_group_ids) const;
+    
+    util::nested_groups_t find_all_nested_impl(const std::vector<std::vector<std::string>>& levels,
+                                               const bool use_indices,
+                                               const std::vector<util::u64>& indices,
+                                               util::u32* status,
+                                               util::u64 index_offset) const;
+    
+    util::value_counts_t value_counts_impl(const std::string& category,
+                                           const bool use_indices,
+                                           const std::vector<util::u64>& indices,
+                                           util::u32* status,
+                                           util::u64 index_offset) const;
+    
+    util::combination_counts_t combination_counts_impl(const std::vector<std::string>& categories,
+                                                       const bool use_indices,
+                                                       const std::vector<util::u64>& indices,
+                                                       util::u32* status,
+                                                       util::u64 index_offset) const;
     
     std::vector<util::u64> get_category_indices(const std::vector<std::string>& cats,
                                                 const util::u64 n_cats, bool* exist) const;
     std::vector<util::u64> get_category_indices_unchecked_has_category(const std::vector<std::string>& cats) const;
     
-    void set_collapsed_expressions(std::vector<util::u32>& labs,
+    void set_collapsed_expressions(util::label_column& labs,
                                    const std::string& category,
                                    const std::string& collapsed_expression,
                                    util::u64 start_offset = 0);
@@ -373,30 +653,36 @@ private:
     void resize(util::u64 rows);
     
     util::u32 reconcile_new_label_ids(const util::categorical& other,
-                                      util::multimap<std::string, util::u32>& tmp_label_ids,
-                                      std::unordered_map<std::string, std::string>& tmp_in_cat,
-                                      std::unordered_map<util::u32, util::u32>& replace_other,
+                                      std::unordered_map<std::string, util::u32>& new_label_ids,
+                                      std::unordered_map<std::string, std::string>& new_in_cat,
+                                      std::vector<util::u32>& replace_other,
+                                      label_id_allocator& tmp_label_id_allocator,
                                       const bool overwrite_existing_categories = true) const;
     
-    void append_fill_new_label_ids(const util::categorical& other,
-                                   const std::unordered_map<util::u32, util::u32>& replace_other_labs,
-                                   util::u64 own_sz,
-                                   util::u64 other_sz);
     util::u32 append_fill_new_label_ids_indexed(const util::categorical& other,
-                                                const std::unordered_map<util::u32, util::u32>& replace_other_labs,
+                                                const std::vector<util::u32>& replace_other_labs,
                                                 util::u64 own_sz,
                                                 util::u64 other_sz,
                                                 const std::vector<util::u64>& indices,
                                                 util::u64 index_offset);
     
-    util::u32 merge(const util::categorical& other, const bool overwrite_existing_cats);
+    void append_many_fill(const std::vector<const util::categorical*>& others,
+                          const std::vector<util::u64>& offsets,
+                          const std::vector<std::vector<util::u32>>& tables,
+                          const std::vector<util::u64>& table_indices,
+                          util::u64 own_sz);
+    
+    util::u32 merge(const util::categorical& other,
+                    const bool overwrite_existing_cats,
+                    util::categorical* take_columns_from = nullptr);
     
     void merge_fill_new_label_ids(const util::categorical& other,
                                   const std::vector<std::string>& categories,
-                                  std::unordered_map<util::u32, util::u32>& replace_other_labs,
+                                  const std::vector<util::u32>& replace_other_labs,
                                   bool is_scalar,
                                   bool sizes_match,
-                                  util::u64 own_sz);
+                                  util::u64 own_sz,
+                                  util::categorical* take_columns_from);
     
     util::u32 merge_require_categories(const util::categorical& other, std::vector<std::string>& new_categories);
     util::u32 merge_check_collapsed_expressions(const util::categorical& other,
@@ -413,19 +699,16 @@ private:
                                                                   const util::u64 index_offset,
                                                                   util::u32* status);
     
-    static util::u32 get_id(const categorical* self, const categorical* other,
-                            const std::unordered_set<util::u32>& new_ids);
-    
-    static void replace_labels(std::vector<std::vector<util::u32>>& labels,
+    static void replace_labels(std::vector<util::label_column>& labels,
                                util::u64 start, util::u64 stop,
-                               const std::unordered_map<util::u32, util::u32>& replace_map);
+                               const std::vector<util::u32>& replace_table);
     
     static util::u32 assign_bit_array(util::bit_array& mask,
                                       const std::vector<util::u64>& at_indices,
                                       util::u64 index_offset);
     
-    static util::bit_array assign_bit_array(const std::vector<util::u32>& labels, util::u32 lab);
-    static util::bit_array assign_bit_array(const std::vector<util::u32>& labels,
+    static util::bit_array assign_bit_array(const util::label_column& labels, util::u32 lab);
+    static util::bit_array assign_bit_array(const util::label_column& labels,
                                             util::u32 lab,
                                             const std::vector<util::u64>& indices,
                                             util::u32* status,
@@ -451,4 +734,21 @@ private:
         util::u32 a;
         util::u32 b;
     } m_progenitor_ids;
+    
+    //  label_id_allocator: Hands out dense label ids. Released ids are
+    //      reused before the high-water mark is advanced, such that all ids
+    //      lie in [0, capacity()).
+    struct label_id_allocator
+    {
+        label_id_allocator();
+        ~label_id_allocator() = default;
+        
+        util::u32 next();
+        void release(util::u32 id);
+        void rebuild(const std::vector<util::u32>& in_use);
+        util::u32 capacity() const;
+        
+        std::vector<util::u32> free_ids;
+        util::u32 high_water_mark;
+    } m_label_id_allocator;
 };
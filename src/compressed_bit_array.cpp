@@ -0,0 +1,827 @@
+//
+//  compressed_bit_array.cpp
+//  categorical
+//
+
+#include "compressed_bit_array.hpp"
+#include "bit_ops.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+    const util::u32 chunk_bits = 1u << 16;
+    const util::u32 words_per_chunk = chunk_bits / 64;
+    const util::u32 max_array_cardinality = 4096;
+    
+    //  Convert (start, length - 1) pairs to inclusive [start, stop] bounds.
+    void runs_to_bounds(const std::vector<util::u16>& runs, std::vector<util::u32>& bounds)
+    {
+        bounds.resize(runs.size());
+        
+        for (util::u64 i = 0; i < runs.size(); i += 2)
+        {
+            bounds[i] = runs[i];
+            bounds[i+1] = util::u32(runs[i]) + runs[i+1];
+        }
+    }
+}
+
+//
+//  container
+//
+
+util::compressed_bit_array::container::container() :
+    key(0),
+    type(kind::array),
+    cardinality(0)
+{
+    //
+}
+
+template <typename F>
+void util::compressed_bit_array::container::for_each(F&& f) const
+{
+    switch (type)
+    {
+        case kind::array:
+            for (const auto value : values)
+            {
+                f(util::u32(value));
+            }
+            break;
+        case kind::bitmap:
+            for (util::u32 i = 0; i < words_per_chunk; i++)
+            {
+                util::u64 word = words[i];
+                
+                while (word != 0)
+                {
+                    f(i * 64 + util::ctz64(word));
+                    word &= word - 1;
+                }
+            }
+            break;
+        case kind::run:
+            for (util::u64 i = 0; i < values.size(); i += 2)
+            {
+                const util::u32 start = values[i];
+                const util::u32 stop = start + values[i+1];
+                
+                for (util::u32 j = start; j <= stop; j++)
+                {
+                    f(j);
+                }
+            }
+            break;
+    }
+}
+
+bool util::compressed_bit_array::container::contains(util::u16 value) const
+{
+    switch (type)
+    {
+        case kind::array:
+            return std::binary_search(values.begin(), values.end(), value);
+        case kind::bitmap:
+            return (words[value / 64] & (util::u64(1) << (value % 64))) != 0;
+        case kind::run:
+        {
+            util::u64 lo = 0;
+            util::u64 hi = values.size() / 2;
+            
+            while (lo < hi)
+            {
+                const util::u64 mid = (lo + hi) / 2;
+                const util::u32 start = values[mid*2];
+                const util::u32 stop = start + values[mid*2+1];
+                
+                if (value < start)
+                {
+                    hi = mid;
+                }
+                else if (value > stop)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    return true;
+                }
+            }
+            
+            return false;
+        }
+    }
+    
+    return false;
+}
+
+void util::compressed_bit_array::container::to_words(std::vector<util::u64>& out) const
+{
+    if (type == kind::bitmap)
+    {
+        out = words;
+        return;
+    }
+    
+    out.assign(words_per_chunk, 0);
+    
+    for_each([&out](util::u32 value) -> void {
+        out[value / 64] |= util::u64(1) << (value % 64);
+    });
+}
+
+//  optimize: Convert to the smallest of the array, bitmap and run representations.
+
+void util::compressed_bit_array::container::optimize()
+{
+    if (cardinality == 0)
+    {
+        return;
+    }
+    
+    util::u64 n_runs = 0;
+    
+    if (type == kind::run)
+    {
+        n_runs = values.size() / 2;
+    }
+    else
+    {
+        util::s64 last = -2;
+        
+        for_each([&](util::u32 value) -> void {
+            if (util::s64(value) != last + 1)
+            {
+                n_runs++;
+            }
+            
+            last = value;
+        });
+    }
+    
+    const util::u64 array_bytes = util::u64(cardinality) * sizeof(util::u16);
+    const util::u64 bitmap_bytes = words_per_chunk * sizeof(util::u64);
+    const util::u64 run_bytes = n_runs * 2 * sizeof(util::u16);
+    
+    kind target = kind::bitmap;
+    
+    if (run_bytes < array_bytes && run_bytes < bitmap_bytes)
+    {
+        target = kind::run;
+    }
+    else if (cardinality <= max_array_cardinality)
+    {
+        target = kind::array;
+    }
+    
+    if (target == type)
+    {
+        return;
+    }
+    
+    container result;
+    result.key = key;
+    result.type = target;
+    result.cardinality = cardinality;
+    
+    if (target == kind::bitmap)
+    {
+        to_words(result.words);
+    }
+    else if (target == kind::array)
+    {
+        result.values.reserve(cardinality);
+        
+        for_each([&result](util::u32 value) -> void {
+            result.values.push_back(util::u16(value));
+        });
+    }
+    else
+    {
+        util::s64 last = -2;
+        
+        for_each([&](util::u32 value) -> void {
+            if (util::s64(value) != last + 1)
+            {
+                result.values.push_back(util::u16(value));
+                result.values.push_back(0);
+            }
+            else
+            {
+                result.values.back()++;
+            }
+            
+            last = value;
+        });
+    }
+    
+    *this = std::move(result);
+}
+
+util::compressed_bit_array::container
+util::compressed_bit_array::container::from_values(util::u64 key, std::vector<util::u16>&& values)
+{
+    container result;
+    result.key = key;
+    result.cardinality = util::u32(values.size());
+    
+    if (values.size() <= max_array_cardinality)
+    {
+        result.type = kind::array;
+        result.values = std::move(values);
+    }
+    else
+    {
+        result.type = kind::bitmap;
+        result.words.assign(words_per_chunk, 0);
+        
+        for (const auto value : values)
+        {
+            result.words[value / 64] |= util::u64(1) << (value % 64);
+        }
+    }
+    
+    return result;
+}
+
+util::compressed_bit_array::container
+util::compressed_bit_array::container::from_words(util::u64 key, std::vector<util::u64>&& words)
+{
+    container result;
+    result.key = key;
+    result.type = kind::bitmap;
+    
+    for (const auto word : words)
+    {
+        result.cardinality += util::popcount64(word);
+    }
+    
+    result.words = std::move(words);
+    result.optimize();
+    
+    return result;
+}
+
+//  from_runs: Create from inclusive [start, stop] bounds, which must be ascending
+//      and non-adjacent.
+
+util::compressed_bit_array::container
+util::compressed_bit_array::container::from_runs(util::u64 key, const std::vector<util::u32>& bounds)
+{
+    container result;
+    result.key = key;
+    result.type = kind::run;
+    result.values.resize(bounds.size());
+    
+    for (util::u64 i = 0; i < bounds.size(); i += 2)
+    {
+        result.values[i] = util::u16(bounds[i]);
+        result.values[i+1] = util::u16(bounds[i+1] - bounds[i]);
+        result.cardinality += bounds[i+1] - bounds[i] + 1;
+    }
+    
+    result.optimize();
+    
+    return result;
+}
+
+util::compressed_bit_array::container
+util::compressed_bit_array::container::op_or(const container& a, const container& b)
+{
+    if (a.type == kind::array && b.type == kind::array)
+    {
+        std::vector<util::u16> values;
+        values.reserve(a.values.size() + b.values.size());
+        std::set_union(a.values.begin(), a.values.end(),
+                       b.values.begin(), b.values.end(), std::back_inserter(values));
+        
+        container result = from_values(a.key, std::move(values));
+        result.optimize();
+        return result;
+    }
+    
+    if (a.type == kind::run && b.type == kind::run)
+    {
+        std::vector<util::u32> bounds_a;
+        std::vector<util::u32> bounds_b;
+        std::vector<util::u32> bounds;
+        runs_to_bounds(a.values, bounds_a);
+        runs_to_bounds(b.values, bounds_b);
+        
+        util::u64 i = 0;
+        util::u64 j = 0;
+        
+        while (i < bounds_a.size() || j < bounds_b.size())
+        {
+            const bool take_a = j >= bounds_b.size() || (i < bounds_a.size() && bounds_a[i] <= bounds_b[j]);
+            const util::u32 start = take_a ? bounds_a[i] : bounds_b[j];
+            const util::u32 stop = take_a ? bounds_a[i+1] : bounds_b[j+1];
+            
+            if (take_a)
+            {
+                i += 2;
+            }
+            else
+            {
+                j += 2;
+            }
+            
+            if (!bounds.empty() && start <= bounds.back() + 1)
+            {
+                bounds.back() = std::max(bounds.back(), stop);
+            }
+            else
+            {
+                bounds.push_back(start);
+                bounds.push_back(stop);
+            }
+        }
+        
+        return from_runs(a.key, bounds);
+    }
+    
+    std::vector<util::u64> words_a;
+    std::vector<util::u64> words_b;
+    a.to_words(words_a);
+    b.to_words(words_b);
+    
+    for (util::u32 i = 0; i < words_per_chunk; i++)
+    {
+        words_a[i] |= words_b[i];
+    }
+    
+    return from_words(a.key, std::move(words_a));
+}
+
+util::compressed_bit_array::container
+util::compressed_bit_array::container::op_and(const container& a, const container& b)
+{
+    if (a.type == kind::array || b.type == kind::array)
+    {
+        const container& arr = a.type == kind::array ? a : b;
+        const container& other = a.type == kind::array ? b : a;
+        
+        std::vector<util::u16> values;
+        
+        if (other.type == kind::array)
+        {
+            std::set_intersection(arr.values.begin(), arr.values.end(),
+                                  other.values.begin(), other.values.end(), std::back_inserter(values));
+        }
+        else
+        {
+            for (const auto value : arr.values)
+            {
+                if (other.contains(value))
+                {
+                    values.push_back(value);
+                }
+            }
+        }
+        
+        return from_values(a.key, std::move(values));
+    }
+    
+    if (a.type == kind::run && b.type == kind::run)
+    {
+        std::vector<util::u32> bounds_a;
+        std::vector<util::u32> bounds_b;
+        std::vector<util::u32> bounds;
+        runs_to_bounds(a.values, bounds_a);
+        runs_to_bounds(b.values, bounds_b);
+        
+        util::u64 i = 0;
+        util::u64 j = 0;
+        
+        while (i < bounds_a.size() && j < bounds_b.size())
+        {
+            const util::u32 start = std::max(bounds_a[i], bounds_b[j]);
+            const util::u32 stop = std::min(bounds_a[i+1], bounds_b[j+1]);
+            
+            if (start <= stop)
+            {
+                bounds.push_back(start);
+                bounds.push_back(stop);
+            }
+            
+            if (bounds_a[i+1] < bounds_b[j+1])
+            {
+                i += 2;
+            }
+            else
+            {
+                j += 2;
+            }
+        }
+        
+        return from_runs(a.key, bounds);
+    }
+    
+    std::vector<util::u64> words_a;
+    std::vector<util::u64> words_b;
+    a.to_words(words_a);
+    b.to_words(words_b);
+    
+    for (util::u32 i = 0; i < words_per_chunk; i++)
+    {
+        words_a[i] &= words_b[i];
+    }
+    
+    return from_words(a.key, std::move(words_a));
+}
+
+util::compressed_bit_array::container
+util::compressed_bit_array::container::op_and_not(const container& a, const container& b)
+{
+    if (a.type == kind::array)
+    {
+        std::vector<util::u16> values;
+        
+        if (b.type == kind::array)
+        {
+            std::set_difference(a.values.begin(), a.values.end(),
+                                b.values.begin(), b.values.end(), std::back_inserter(values));
+        }
+        else
+        {
+            for (const auto value : a.values)
+            {
+                if (!b.contains(value))
+                {
+                    values.push_back(value);
+                }
+            }
+        }
+        
+        return from_values(a.key, std::move(values));
+    }
+    
+    std::vector<util::u64> words_a;
+    std::vector<util::u64> words_b;
+    a.to_words(words_a);
+    b.to_words(words_b);
+    
+    for (util::u32 i = 0; i < words_per_chunk; i++)
+    {
+        words_a[i] &= ~words_b[i];
+    }
+    
+    return from_words(a.key, std::move(words_a));
+}
+
+//
+//  compressed_bit_array
+//
+
+util::compressed_bit_array::compressed_bit_array() :
+    m_size(0)
+{
+    //
+}
+
+util::compressed_bit_array::compressed_bit_array(util::u64 size) :
+    m_size(size)
+{
+    //
+}
+
+util::compressed_bit_array::compressed_bit_array(util::u64 size, bool fill_with) :
+    m_size(size)
+{
+    fill(fill_with);
+}
+
+util::compressed_bit_array::compressed_bit_array(const util::bit_array& other) :
+    m_size(other.size())
+{
+    const std::vector<util::u64> indices = util::bit_array::findv(other);
+    *this = from_sorted(m_size, indices.begin(), indices.end());
+}
+
+util::u64 util::compressed_bit_array::size() const
+{
+    return m_size;
+}
+
+util::u64 util::compressed_bit_array::sum() const
+{
+    util::u64 result = 0;
+    
+    for (const auto& c : m_containers)
+    {
+        result += c.cardinality;
+    }
+    
+    return result;
+}
+
+bool util::compressed_bit_array::any() const
+{
+    return !m_containers.empty();
+}
+
+bool util::compressed_bit_array::all() const
+{
+    return m_size > 0 && sum() == m_size;
+}
+
+util::u64 util::compressed_bit_array::n_chunks() const
+{
+    return (m_size + chunk_bits - 1) / chunk_bits;
+}
+
+util::u32 util::compressed_bit_array::chunk_length(util::u64 key) const
+{
+    const util::u64 remaining = m_size - key * chunk_bits;
+    return remaining < chunk_bits ? util::u32(remaining) : chunk_bits;
+}
+
+const util::compressed_bit_array::container* util::compressed_bit_array::find_container(util::u64 key) const
+{
+    const auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                                     [](const container& c, util::u64 k) -> bool {
+                                         return c.key < k;
+                                     });
+    
+    return (it == m_containers.end() || it->key != key) ? nullptr : &*it;
+}
+
+void util::compressed_bit_array::push_chunk(util::u64 key, std::vector<util::u16>&& values)
+{
+    container c = container::from_values(key, std::move(values));
+    c.optimize();
+    m_containers.push_back(std::move(c));
+}
+
+bool util::compressed_bit_array::at(util::u64 index) const
+{
+    if (index >= m_size)
+    {
+        throw std::runtime_error("Index exceeds array size.");
+    }
+    
+    const container* c = find_container(index >> 16);
+    
+    return c != nullptr && c->contains(util::u16(index & 0xffff));
+}
+
+void util::compressed_bit_array::place(bool value, util::u64 at_index)
+{
+    if (at_index >= m_size)
+    {
+        throw std::runtime_error("Index exceeds array size.");
+    }
+    
+    const util::u64 key = at_index >> 16;
+    const util::u16 bit = util::u16(at_index & 0xffff);
+    
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                               [](const container& c, util::u64 k) -> bool {
+                                   return c.key < k;
+                               });
+    
+    if (it == m_containers.end() || it->key != key)
+    {
+        if (value)
+        {
+            m_containers.insert(it, container::from_values(key, {bit}));
+        }
+        
+        return;
+    }
+    
+    if (it->contains(bit) == value)
+    {
+        return;
+    }
+    
+    container& c = *it;
+    
+    if (c.type == container::kind::array)
+    {
+        auto pos = std::lower_bound(c.values.begin(), c.values.end(), bit);
+        
+        if (value)
+        {
+            c.values.insert(pos, bit);
+        }
+        else
+        {
+            c.values.erase(pos);
+        }
+        
+        c.cardinality = util::u32(c.values.size());
+        
+        if (c.cardinality > max_array_cardinality)
+        {
+            c.optimize();
+        }
+    }
+    else
+    {
+        std::vector<util::u64> words;
+        c.to_words(words);
+        
+        if (value)
+        {
+            words[bit / 64] |= util::u64(1) << (bit % 64);
+        }
+        else
+        {
+            words[bit / 64] &= ~(util::u64(1) << (bit % 64));
+        }
+        
+        c.type = container::kind::bitmap;
+        c.values.clear();
+        c.words = std::move(words);
+        c.cardinality = value ? c.cardinality + 1 : c.cardinality - 1;
+    }
+    
+    if (c.cardinality == 0)
+    {
+        m_containers.erase(it);
+    }
+}
+
+void util::compressed_bit_array::fill(bool value)
+{
+    m_containers.clear();
+    
+    if (!value)
+    {
+        return;
+    }
+    
+    const util::u64 n = n_chunks();
+    
+    for (util::u64 i = 0; i < n; i++)
+    {
+        m_containers.push_back(container::from_runs(i, {0, chunk_length(i) - 1}));
+    }
+}
+
+void util::compressed_bit_array::flip()
+{
+    std::vector<container> result;
+    const util::u64 n = n_chunks();
+    util::u64 next = 0;
+    
+    for (util::u64 i = 0; i < n; i++)
+    {
+        const util::u32 len = chunk_length(i);
+        
+        if (next >= m_containers.size() || m_containers[next].key != i)
+        {
+            result.push_back(container::from_runs(i, {0, len - 1}));
+            continue;
+        }
+        
+        std::vector<util::u64> words;
+        m_containers[next++].to_words(words);
+        
+        for (util::u32 j = 0; j < words_per_chunk; j++)
+        {
+            const util::u32 first_bit = j * 64;
+            
+            if (first_bit >= len)
+            {
+                words[j] = 0;
+            }
+            else if (len - first_bit < 64)
+            {
+                words[j] = ~words[j] & ((util::u64(1) << (len - first_bit)) - 1);
+            }
+            else
+            {
+                words[j] = ~words[j];
+            }
+        }
+        
+        container c = container::from_words(i, std::move(words));
+        
+        if (c.cardinality > 0)
+        {
+            result.push_back(std::move(c));
+        }
+    }
+    
+    m_containers = std::move(result);
+}
+
+util::bit_array util::compressed_bit_array::to_bit_array() const
+{
+    util::bit_array result(m_size, false);
+    
+    for (const auto& c : m_containers)
+    {
+        const util::u64 base = c.key * chunk_bits;
+        
+        c.for_each([&result, base](util::u32 value) -> void {
+            result.unchecked_place(true, base + value);
+        });
+    }
+    
+    return result;
+}
+
+std::vector<util::u64> util::compressed_bit_array::findv(const compressed_bit_array& a, util::u64 index_offset)
+{
+    std::vector<util::u64> result;
+    result.reserve(a.sum());
+    
+    for (const auto& c : a.m_containers)
+    {
+        const util::u64 base = c.key * chunk_bits + index_offset;
+        
+        c.for_each([&result, base](util::u32 value) -> void {
+            result.push_back(base + value);
+        });
+    }
+    
+    return result;
+}
+
+void util::compressed_bit_array::binary_check_dimensions(const compressed_bit_array& out,
+                                                         const compressed_bit_array& a,
+                                                         const compressed_bit_array& b)
+{
+    if (a.size() != b.size() || a.size() != out.size())
+    {
+        throw std::runtime_error("Dimension mismatch.");
+    }
+}
+
+template <typename Op>
+void util::compressed_bit_array::binary_op(compressed_bit_array& out,
+                                           const compressed_bit_array& a,
+                                           const compressed_bit_array& b,
+                                           bool keep_a_only,
+                                           bool keep_b_only,
+                                           Op op)
+{
+    binary_check_dimensions(out, a, b);
+    
+    std::vector<container> result;
+    util::u64 i = 0;
+    util::u64 j = 0;
+    
+    const util::u64 n_a = a.m_containers.size();
+    const util::u64 n_b = b.m_containers.size();
+    
+    while (i < n_a || j < n_b)
+    {
+        if (j == n_b || (i < n_a && a.m_containers[i].key < b.m_containers[j].key))
+        {
+            if (keep_a_only)
+            {
+                result.push_back(a.m_containers[i]);
+            }
+            
+            i++;
+        }
+        else if (i == n_a || b.m_containers[j].key < a.m_containers[i].key)
+        {
+            if (keep_b_only)
+            {
+                result.push_back(b.m_containers[j]);
+            }
+            
+            j++;
+        }
+        else
+        {
+            container c = op(a.m_containers[i++], b.m_containers[j++]);
+            
+            if (c.cardinality > 0)
+            {
+                result.push_back(std::move(c));
+            }
+        }
+    }
+    
+    out.m_containers = std::move(result);
+}
+
+void util::compressed_bit_array::dot_or(compressed_bit_array& out,
+                                        const compressed_bit_array& a,
+                                        const compressed_bit_array& b)
+{
+    binary_op(out, a, b, true, true, &container::op_or);
+}
+
+void util::compressed_bit_array::dot_and(compressed_bit_array& out,
+                                         const compressed_bit_array& a,
+                                         const compressed_bit_array& b)
+{
+    binary_op(out, a, b, false, false, &container::op_and);
+}
+
+void util::compressed_bit_array::dot_and_not(compressed_bit_array& out,
+                                             const compressed_bit_array& a,
+                                             const compressed_bit_array& b)
+{
+    binary_op(out, a, b, true, false, &container::op_and_not);
+}
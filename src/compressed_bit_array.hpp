@@ -0,0 +1,151 @@
+//
+//  compressed_bit_array.hpp
+//  categorical
+//
+
+#pragma once
+
+#include "types.hpp"
+#include "bit_array.hpp"
+#include <vector>
+
+namespace util {
+    class compressed_bit_array;
+}
+
+//  compressed_bit_array: Bit array partitioned into chunks of 2^16 bits. Each
+//      chunk with at least one true bit is stored as a sorted array of set
+//      bits, a dense bitmap, or a list of runs, whichever is smallest. Chunks
+//      with no true bits are not stored at all.
+
+class util::compressed_bit_array
+{
+public:
+    compressed_bit_array();
+    explicit compressed_bit_array(util::u64 size);
+    explicit compressed_bit_array(util::u64 size, bool fill_with);
+    explicit compressed_bit_array(const util::bit_array& other);
+    ~compressed_bit_array() = default;
+    
+    compressed_bit_array(const compressed_bit_array& other) = default;
+    compressed_bit_array& operator=(const compressed_bit_array& other) = default;
+    compressed_bit_array(compressed_bit_array&& rhs) noexcept = default;
+    compressed_bit_array& operator=(compressed_bit_array&& rhs) noexcept = default;
+    
+    //  from_sorted: Create an array of `size` bits, in which the bits at the
+    //      strictly ascending indices [begin, end) are true.
+    template <typename It>
+    static compressed_bit_array from_sorted(util::u64 size, It begin, It end);
+    
+    util::u64 size() const;
+    util::u64 sum() const;
+    
+    bool at(util::u64 index) const;
+    void place(bool value, util::u64 at_index);
+    
+    void fill(bool value);
+    void flip();
+    
+    bool all() const;
+    bool any() const;
+    
+    util::bit_array to_bit_array() const;
+    
+    static void dot_or(compressed_bit_array& out, const compressed_bit_array& a, const compressed_bit_array& b);
+    static void dot_and(compressed_bit_array& out, const compressed_bit_array& a, const compressed_bit_array& b);
+    static void dot_and_not(compressed_bit_array& out, const compressed_bit_array& a, const compressed_bit_array& b);
+    
+    static std::vector<util::u64> findv(const compressed_bit_array& a, util::u64 index_offset = 0u);
+
+private:
+    struct container
+    {
+        enum class kind : util::u8
+        {
+            array,
+            bitmap,
+            run
+        };
+        
+        container();
+        
+        bool contains(util::u16 value) const;
+        void to_words(std::vector<util::u64>& out) const;
+        void optimize();
+        
+        template <typename F>
+        void for_each(F&& f) const;
+        
+        static container from_values(util::u64 key, std::vector<util::u16>&& values);
+        static container from_words(util::u64 key, std::vector<util::u64>&& words);
+        static container from_runs(util::u64 key, const std::vector<util::u32>& bounds);
+        
+        static container op_or(const container& a, const container& b);
+        static container op_and(const container& a, const container& b);
+        static container op_and_not(const container& a, const container& b);
+        
+        util::u64 key;
+        kind type;
+        util::u32 cardinality;
+        
+        //  array: sorted set bits. run: pairs of (start, length - 1).
+        std::vector<util::u16> values;
+        //  bitmap: 1024 words of 64 bits.
+        std::vector<util::u64> words;
+    };
+    
+    std::vector<container> m_containers;
+    util::u64 m_size;
+    
+    util::u32 chunk_length(util::u64 key) const;
+    util::u64 n_chunks() const;
+    const container* find_container(util::u64 key) const;
+    
+    void push_chunk(util::u64 key, std::vector<util::u16>&& values);
+    
+    static void binary_check_dimensions(const compressed_bit_array& out,
+                                        const compressed_bit_array& a,
+                                        const compressed_bit_array& b);
+    
+    template <typename Op>
+    static void binary_op(compressed_bit_array& out,
+                          const compressed_bit_array& a,
+                          const compressed_bit_array& b,
+                          bool keep_a_only,
+                          bool keep_b_only,
+                          Op op);
+};
+
+//
+//  impl
+//
+
+template <typename It>
+util::compressed_bit_array util::compressed_bit_array::from_sorted(util::u64 size, It begin, It end)
+{
+    compressed_bit_array result(size);
+    std::vector<util::u16> chunk;
+    util::u64 current_key = 0;
+    
+    for (; begin != end; ++begin)
+    {
+        const util::u64 index = util::u64(*begin);
+        const util::u64 key = index >> 16;
+        
+        if (key != current_key && !chunk.empty())
+        {
+            result.push_chunk(current_key, std::move(chunk));
+            chunk.clear();
+        }
+        
+        current_key = key;
+        chunk.push_back(util::u16(index & 0xffff));
+    }
+    
+    if (!chunk.empty())
+    {
+        result.push_chunk(current_key, std::move(chunk));
+    }
+    
+    return result;
+}
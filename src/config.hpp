@@ -12,7 +12,8 @@
 #define CAT_ALLOW_SET_FROM_SIZE0
 
 //  during assignment, copy the `m_labels` variable, such that
-//  errors during assignment don't mutate the object.
+//  errors during assignment don't mutate the object. Columns are
+//  copy-on-write, so only the columns assigned to are cloned.
 #define CAT_COPY_ASSIGN_FROM
 
 //  call prune after assignment operation (set_category, assign),
@@ -20,3 +21,51 @@
 //  one row in the array. Otherwise, `m_label_ids` may contain "dangling"
 //  labels.
 //#define CAT_PRUNE_AFTER_ASSIGN
+
+//  answer find, find_or, find_not, find_none and count from a per-category
+//  inverted index of label id -> rows, discarded when the category is modified.
+//  The index takes 4 bytes per row plus 8 per id up to the column's largest
+//  label id. Ids are numbered across all categories, so this can exceed the
+//  category's own label count. The index is built only once the category has
+//  been queried CAT_LABEL_INDEX_MIN_QUERIES times since it was last modified;
+//  earlier queries scan the rows.
+#define CAT_USE_LABEL_INDEX
+#define CAT_LABEL_INDEX_MIN_QUERIES 2
+
+//  answer a query from the label index only if the queried labels match fewer
+//  than 1 in CAT_LABEL_INDEX_QUERY_RATIO rows; otherwise scan the rows.
+#define CAT_LABEL_INDEX_QUERY_RATIO 4
+
+//  use SSE2 / AVX2 / POPCNT kernels for bit_array operations where the
+//  platform supports them, chosen at runtime on x86 with gcc or clang.
+#define CAT_USE_SIMD_BIT_KERNELS
+
+//  defaults for multithreaded row scans (see util::parallel_options), which
+//  are off unless enabled at runtime. Chunks are the unit of work handed to
+//  each thread, and must be a multiple of 64 rows.
+#define CAT_PARALLEL_N_THREADS 0
+#define CAT_PARALLEL_MIN_ROWS 1000000
+#define CAT_PARALLEL_CHUNK_ROWS 65536
+
+//  group rows in find_all by a mixed-radix key over the labels of each
+//  category, rather than by hashing, when the number of possible label
+//  combinations is at most CAT_DENSE_KEY_MAX_SPACE, and at most
+//  CAT_DENSE_KEY_ROWS_RATIO times the number of rows searched.
+#define CAT_DENSE_KEY_MAX_SPACE 1048576
+#define CAT_DENSE_KEY_ROWS_RATIO 8
+
+//  thresholds of find_all_method::automatic, the default method of find_all.
+//  When the key space is too large for the dense_key method, rows are grouped
+//  by radix sort if at least CAT_AUTO_RADIX_MIN_ROWS rows are searched and the
+//  label ids of a row pack into at most CAT_AUTO_RADIX_MAX_KEY_WORDS 64-bit
+//  words, and by custom hash otherwise. Calibrate with find_all-benchmark.
+#define CAT_AUTO_RADIX_MIN_ROWS 8192
+#define CAT_AUTO_RADIX_MAX_KEY_WORDS 2
+
+//  defaults for the per-object cache of find_all and find_allc results (see
+//  util::grouping_cache), keyed by the categories, method and indices searched,
+//  and discarded when the object is modified. The least recently used results
+//  are evicted beyond CAT_GROUPING_CACHE_MAX_ENTRIES results or
+//  CAT_GROUPING_CACHE_MAX_BYTES bytes; either being 0 disables the cache.
+#define CAT_GROUPING_CACHE_MAX_ENTRIES 16
+#define CAT_GROUPING_CACHE_MAX_BYTES (16 * 1024 * 1024)
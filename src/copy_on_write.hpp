@@ -0,0 +1,118 @@
+//
+//  copy_on_write.hpp
+//  categorical
+//
+
+#pragma once
+
+#include <memory>
+#include <atomic>
+
+namespace util {
+    template <typename T>
+    class copy_on_write;
+}
+
+//  copy_on_write: Value of type T held through a reference-counted pointer.
+//      Copies share the value, so copying is O(1). The value is read through
+//      the const accessors; mutate() first clones the value if it is shared,
+//      and so must be called before any reference or iterator into the value
+//      that is to be written through is obtained. A default-constructed or
+//      moved-from object holds a default-constructed T.
+
+template <typename T>
+class util::copy_on_write
+{
+public:
+    copy_on_write() = default;
+    explicit copy_on_write(T value);
+    ~copy_on_write() = default;
+    
+    copy_on_write(const copy_on_write& other) = default;
+    copy_on_write& operator=(const copy_on_write& other) = default;
+    copy_on_write(copy_on_write&& other) = default;
+    copy_on_write& operator=(copy_on_write&& other) = default;
+    
+    const T& get() const;
+    const T& operator*() const;
+    const T* operator->() const;
+    
+    T& mutate();
+    
+    bool shares_with(const copy_on_write& other) const;
+    
+private:
+    std::shared_ptr<T> m_value;
+    
+private:
+    static const T& empty_value();
+};
+
+//
+//  impl
+//
+
+template <typename T>
+util::copy_on_write<T>::copy_on_write(T value) :
+    m_value(std::make_shared<T>(std::move(value)))
+{
+    //
+}
+
+template <typename T>
+inline const T& util::copy_on_write<T>::get() const
+{
+    return m_value ? *m_value : empty_value();
+}
+
+template <typename T>
+inline const T& util::copy_on_write<T>::operator*() const
+{
+    return get();
+}
+
+template <typename T>
+inline const T* util::copy_on_write<T>::operator->() const
+{
+    return &get();
+}
+
+//  mutate: Get a mutable reference to the value, cloning it first if it is
+//      shared with another object.
+
+template <typename T>
+T& util::copy_on_write<T>::mutate()
+{
+    if (!m_value)
+    {
+        m_value = std::make_shared<T>();
+    }
+    else if (m_value.use_count() > 1)
+    {
+        m_value = std::make_shared<T>(*m_value);
+    }
+    else
+    {
+        //  order the writes to come after reads made through copies released
+        //  by other threads.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    
+    return *m_value;
+}
+
+//  shares_with: True if `other` holds the same value, such that the values
+//      are equal without being compared.
+
+template <typename T>
+inline bool util::copy_on_write<T>::shares_with(const copy_on_write& other) const
+{
+    return m_value != nullptr && m_value == other.m_value;
+}
+
+template <typename T>
+const T& util::copy_on_write<T>::empty_value()
+{
+    static const T value{};
+    return value;
+}
@@ -0,0 +1,344 @@
+//
+//  grouping_cache.cpp
+//  categorical
+//
+
+#include "grouping_cache.hpp"
+#include "config.hpp"
+#include <iterator>
+#include <utility>
+
+namespace
+{
+    //  approximate size of the list and lookup nodes of an entry.
+    const util::u64 entry_overhead_bytes = 128;
+    
+    util::u64 mix(util::u64 hash, util::u64 value)
+    {
+        hash = (hash ^ value) * 0xbf58476d1ce4e5b9ull;
+        return hash ^ (hash >> 31);
+    }
+}
+
+//  set_indices: Borrow `inds`, which must outlive the use of the key, and
+//      compute their fingerprint.
+
+void util::grouping_cache::key::set_indices(const std::vector<util::u64>& inds)
+{
+    util::u64 hash = 0x9e3779b97f4a7c15ull;
+    
+    for (const util::u64 index : inds)
+    {
+        hash = mix(hash, index);
+    }
+    
+    indices = &inds;
+    indices_hash = hash;
+}
+
+util::u64 util::grouping_cache::key::n_indices() const
+{
+    return indices ? indices->size() : 0;
+}
+
+util::grouping_cache::grouping_cache() :
+    grouping_cache(CAT_GROUPING_CACHE_MAX_ENTRIES, CAT_GROUPING_CACHE_MAX_BYTES)
+{
+    //
+}
+
+util::grouping_cache::grouping_cache(util::u64 max_entries, util::u64 max_bytes) :
+    m_version(0),
+    m_bytes(0),
+    m_max_entries(max_entries),
+    m_max_bytes(max_bytes)
+{
+    //
+}
+
+util::grouping_cache::grouping_cache(const grouping_cache& other) :
+    m_version(0),
+    m_bytes(0),
+    m_max_entries(0),
+    m_max_bytes(0)
+{
+    std::lock_guard<std::mutex> other_lock(other.m_mutex);
+    unchecked_copy_from(other);
+}
+
+util::grouping_cache& util::grouping_cache::operator=(const grouping_cache& other)
+{
+    if (this != &other)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+        std::unique_lock<std::mutex> other_lock(other.m_mutex, std::defer_lock);
+        std::lock(lock, other_lock);
+        
+        unchecked_copy_from(other);
+    }
+    
+    return *this;
+}
+
+util::grouping_cache::grouping_cache(grouping_cache&& other) noexcept :
+    m_version(0),
+    m_bytes(0),
+    m_max_entries(0),
+    m_max_bytes(0)
+{
+    std::lock_guard<std::mutex> other_lock(other.m_mutex);
+    unchecked_move_from(other);
+}
+
+util::grouping_cache& util::grouping_cache::operator=(grouping_cache&& other) noexcept
+{
+    if (this != &other)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+        std::unique_lock<std::mutex> other_lock(other.m_mutex, std::defer_lock);
+        std::lock(lock, other_lock);
+        
+        unchecked_move_from(other);
+    }
+    
+    return *this;
+}
+
+//  find: Get the value stored under `k` at `version`, or null. A found entry
+//      becomes the most recently used.
+
+util::grouping_cache::value_type util::grouping_cache::find(const key& k, util::u64 version)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    unchecked_use_version(version);
+    
+    if (m_entries.empty())
+    {
+        return nullptr;
+    }
+    
+    auto it = unchecked_find(k, hash_key(k));
+    
+    if (it == m_entries.end())
+    {
+        return nullptr;
+    }
+    
+    m_entries.splice(m_entries.begin(), m_entries, it);
+    
+    return it->value;
+}
+
+//  insert: Store `value`, of about `value_bytes` bytes, under `k` at `version`,
+//      replacing an existing entry with the same key. Values larger than the
+//      cache are not stored.
+
+void util::grouping_cache::insert(key&& k, util::u64 version, value_type value, util::u64 value_bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    unchecked_use_version(version);
+    
+    const util::u64 bytes = value_bytes + entry_overhead_bytes +
+        (k.query.size() + k.n_indices()) * sizeof(util::u64);
+    
+    if (m_max_entries == 0 || bytes > m_max_bytes)
+    {
+        return;
+    }
+    
+    const util::u64 hash = hash_key(k);
+    auto existing = unchecked_find(k, hash);
+    
+    if (existing != m_entries.end())
+    {
+        m_bytes -= existing->bytes;
+        existing->bytes = bytes;
+        existing->value = std::move(value);
+        m_bytes += bytes;
+        
+        m_entries.splice(m_entries.begin(), m_entries, existing);
+    }
+    else
+    {
+        std::vector<util::u64> indices;
+        
+        if (k.indices)
+        {
+            indices = *k.indices;
+        }
+        
+        m_entries.push_front(entry{std::move(k.query), std::move(indices), k.indices_hash,
+            hash, bytes, std::move(value)});
+        m_lookup.emplace(hash, m_entries.begin());
+        m_bytes += bytes;
+    }
+    
+    unchecked_evict();
+}
+
+void util::grouping_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    unchecked_clear();
+}
+
+//  set_capacity: Bound the cache to `max_entries` entries and `max_bytes` bytes,
+//      evicting as necessary. Either bound being 0 disables the cache.
+
+void util::grouping_cache::set_capacity(util::u64 max_entries, util::u64 max_bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    m_max_entries = max_entries;
+    m_max_bytes = max_bytes;
+    
+    unchecked_evict();
+}
+
+bool util::grouping_cache::enabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_entries > 0 && m_max_bytes > 0;
+}
+
+util::u64 util::grouping_cache::max_entries() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_entries;
+}
+
+util::u64 util::grouping_cache::max_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_bytes;
+}
+
+util::u64 util::grouping_cache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+util::u64 util::grouping_cache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+void util::grouping_cache::unchecked_copy_from(const grouping_cache& other)
+{
+    m_entries = other.m_entries;
+    m_lookup.clear();
+    
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        m_lookup.emplace(it->hash, it);
+    }
+    
+    m_version = other.m_version;
+    m_bytes = other.m_bytes;
+    m_max_entries = other.m_max_entries;
+    m_max_bytes = other.m_max_bytes;
+}
+
+void util::grouping_cache::unchecked_move_from(grouping_cache& other)
+{
+    //  Iterators into a moved list remain valid, so the lookup can be moved too.
+    m_entries = std::move(other.m_entries);
+    m_lookup = std::move(other.m_lookup);
+    
+    m_version = other.m_version;
+    m_bytes = other.m_bytes;
+    m_max_entries = other.m_max_entries;
+    m_max_bytes = other.m_max_bytes;
+    
+    other.unchecked_clear();
+}
+
+void util::grouping_cache::unchecked_clear()
+{
+    m_entries.clear();
+    m_lookup.clear();
+    m_bytes = 0;
+}
+
+void util::grouping_cache::unchecked_use_version(util::u64 version)
+{
+    if (version != m_version)
+    {
+        unchecked_clear();
+        m_version = version;
+    }
+}
+
+void util::grouping_cache::unchecked_evict()
+{
+    if (m_max_entries == 0 || m_max_bytes == 0)
+    {
+        unchecked_clear();
+        return;
+    }
+    
+    while (m_entries.size() > m_max_entries || m_bytes > m_max_bytes)
+    {
+        auto last = std::prev(m_entries.end());
+        auto range = m_lookup.equal_range(last->hash);
+        
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == last)
+            {
+                m_lookup.erase(it);
+                break;
+            }
+        }
+        
+        m_bytes -= last->bytes;
+        m_entries.erase(last);
+    }
+}
+
+util::grouping_cache::entry_list::iterator util::grouping_cache::unchecked_find(const key& k, util::u64 hash)
+{
+    auto range = m_lookup.equal_range(hash);
+    
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (matches(*it->second, k))
+        {
+            return it->second;
+        }
+    }
+    
+    return m_entries.end();
+}
+
+util::u64 util::grouping_cache::hash_key(const key& k)
+{
+    util::u64 hash = mix(0x9e3779b97f4a7c15ull, k.query.size());
+    
+    for (const util::u64 value : k.query)
+    {
+        hash = mix(hash, value);
+    }
+    
+    hash = mix(hash, k.n_indices());
+    hash = mix(hash, k.indices_hash);
+    
+    return hash;
+}
+
+//  matches: True if `e` is stored under `k`. The row indices are compared
+//      element-wise only if their fingerprints agree.
+
+bool util::grouping_cache::matches(const entry& e, const key& k)
+{
+    if (e.query != k.query || e.indices_hash != k.indices_hash || e.indices.size() != k.n_indices())
+    {
+        return false;
+    }
+    
+    return e.indices.empty() || e.indices == *k.indices;
+}
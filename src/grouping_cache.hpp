@@ -0,0 +1,101 @@
+//
+//  grouping_cache.hpp
+//  categorical
+//
+
+#pragma once
+
+#include "types.hpp"
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+namespace util {
+    struct groups_t;
+    class grouping_cache;
+}
+
+//  grouping_cache: Bounded, least-recently-used cache of grouping results.
+//      An entry is keyed by a description of the query (e.g., the category
+//      indices and method) and the row indices searched. The row indices are
+//      borrowed by a key and fingerprinted by their hash and length; they are
+//      compared element-wise only against entries with a matching fingerprint,
+//      and copied only when an entry is inserted. Entries belong to a
+//      single version of the cached object; the first lookup or insertion at a
+//      different version discards them all. The least recently used entries
+//      are evicted once there are more than max_entries() of them, or they
+//      occupy more than max_bytes() bytes. A capacity of 0 disables the cache.
+
+class util::grouping_cache
+{
+public:
+    struct key
+    {
+        std::vector<util::u64> query;
+        const std::vector<util::u64>* indices = nullptr;
+        util::u64 indices_hash = 0;
+        
+        void set_indices(const std::vector<util::u64>& inds);
+        util::u64 n_indices() const;
+    };
+    
+    using value_type = std::shared_ptr<const util::groups_t>;
+
+public:
+    grouping_cache();
+    grouping_cache(util::u64 max_entries, util::u64 max_bytes);
+    ~grouping_cache() = default;
+    
+    grouping_cache(const grouping_cache& other);
+    grouping_cache& operator=(const grouping_cache& other);
+    grouping_cache(grouping_cache&& other) noexcept;
+    grouping_cache& operator=(grouping_cache&& other) noexcept;
+    
+    value_type find(const key& k, util::u64 version);
+    void insert(key&& k, util::u64 version, value_type value, util::u64 value_bytes);
+    
+    void clear();
+    void set_capacity(util::u64 max_entries, util::u64 max_bytes);
+    
+    bool enabled() const;
+    util::u64 max_entries() const;
+    util::u64 max_bytes() const;
+    util::u64 size() const;
+    util::u64 bytes() const;
+
+private:
+    struct entry
+    {
+        std::vector<util::u64> query;
+        std::vector<util::u64> indices;
+        util::u64 indices_hash;
+        util::u64 hash;
+        util::u64 bytes;
+        value_type value;
+    };
+    
+    //  most recently used first.
+    using entry_list = std::list<entry>;
+    
+    mutable std::mutex m_mutex;
+    entry_list m_entries;
+    std::unordered_multimap<util::u64, entry_list::iterator> m_lookup;
+    
+    util::u64 m_version;
+    util::u64 m_bytes;
+    util::u64 m_max_entries;
+    util::u64 m_max_bytes;
+
+private:
+    void unchecked_copy_from(const grouping_cache& other);
+    void unchecked_move_from(grouping_cache& other);
+    void unchecked_clear();
+    void unchecked_use_version(util::u64 version);
+    void unchecked_evict();
+    entry_list::iterator unchecked_find(const key& k, util::u64 hash);
+    
+    static bool matches(const entry& e, const key& k);    
+    static util::u64 hash_key(const key& k);
+};
@@ -13,128 +13,282 @@
 #include <type_traits>
 #include <cstring>
 #include <cassert>
+#include <utility>
 
 #define TEMPLATE_HEADER template <typename K, typename V, typename Hash>
 #define TEMPLATE_PREFIX util::IntegralTypeRowMap<K, V, Hash>
 
 namespace util
 {
-    template <typename K, typename V, typename Hash>
+    template <typename K>
+    struct IntegralRowHash;
+    
+    template <typename K, typename V, typename Hash = util::IntegralRowHash<K>>
     class IntegralTypeRowMap;
 }
 
+//  IntegralRowHash: Hash a row of `num_columns` integers, mixing each element
+//      into a 64-bit state with a multiply-xorshift step.
+
+template <typename K>
+struct util::IntegralRowHash
+{
+    util::u64 operator()(const K* row, const std::size_t num_columns) const
+    {
+        util::u64 hash = 0x9e3779b97f4a7c15ull ^ util::u64(num_columns);
+        
+        for (std::size_t i = 0; i < num_columns; i++)
+        {
+            hash = (hash ^ util::u64(row[i])) * 0xbf58476d1ce4e5b9ull;
+            hash ^= hash >> 31;
+        }
+        
+        return hash ^ (hash >> 29);
+    }
+};
+
+//  IntegralTypeRowMap: Map from fixed-width rows of integers to values, with
+//      open addressing and linear probing. Rows and values are stored
+//      contiguously, in order of insertion, and slots refer to them by index.
+//      The slot array doubles when the load factor would exceed
+//      max_load_factor().
+
 TEMPLATE_HEADER
 class util::IntegralTypeRowMap
 {
 public:
-    using key_bucket_t = std::vector<K>;
-    using value_bucket_t = std::vector<V>;
-    
     struct find_result
     {
         friend class util::IntegralTypeRowMap<K, V, Hash>;
         
-        find_result(std::size_t bucket_index, const V* value) : bucket_index(bucket_index), value(value)
+        find_result(std::size_t slot_index, util::u64 hash, const V* value) :
+        slot_index(slot_index), hash(hash), value(value)
         {
             //
         }
         
         ~find_result() = default;
-        
+    
     private:
-        std::size_t bucket_index;
-        
+        std::size_t slot_index;
+        util::u64 hash;
+    
     public:
+        //  invalidated by insert().
         const V* value;
     };
-    
+
 public:
-    IntegralTypeRowMap(const std::size_t num_buckets, const std::size_t num_columns);
+    explicit IntegralTypeRowMap(const std::size_t num_columns);
     ~IntegralTypeRowMap() = default;
     
     const find_result find(const K* key_row) const;
     void insert(const find_result& result, const K* key_row, V value);
-    std::size_t max_bucket_size() const;
+    void reserve(std::size_t num_rows);
+    
+    std::size_t size() const;
+    std::size_t max_probe_length() const;
     
+    float max_load_factor() const;
+    void max_load_factor(float factor);
+
 private:
-    const std::size_t num_buckets;
-    const std::size_t num_columns;
+    struct slot
+    {
+        util::u64 hash;
+        //  index into `values` plus one; 0 for an empty slot.
+        util::u64 entry;
+    };
     
-    std::vector<key_bucket_t> keys;
-    std::vector<value_bucket_t> values;
+    std::size_t num_columns;
+    float load_factor_limit;
+    
+    std::vector<slot> slots;
+    std::vector<K> keys;
+    std::vector<V> values;
+    
+    std::size_t mask() const;
+    bool needs_growth(std::size_t num_rows) const;
+    void rehash(std::size_t num_slots);
+    std::size_t empty_slot(util::u64 hash) const;
 };
 
 TEMPLATE_HEADER
-TEMPLATE_PREFIX::IntegralTypeRowMap(const std::size_t num_buckets, const std::size_t num_columns) :
-num_buckets(num_buckets), num_columns(num_columns)
+TEMPLATE_PREFIX::IntegralTypeRowMap(const std::size_t num_columns) :
+num_columns(num_columns), load_factor_limit(0.5f)
 {
 #ifdef CAT_HAS_TRIVIALLY_COPYABLE
     static_assert(std::is_trivially_copyable<K>::value, "Key type must be trivially copyable.");
     static_assert(std::is_trivially_copyable<V>::value, "Value type must be trivially copyable.");
 #endif
-    
-    keys.resize(num_buckets);
-    values.resize(num_buckets);
+
+    rehash(16);
 }
 
 TEMPLATE_HEADER
 const typename TEMPLATE_PREFIX::find_result TEMPLATE_PREFIX::find(const K* key_row) const
 {
-    const std::size_t bucket_index = Hash{}(key_row, num_columns) % num_buckets;
-    assert(bucket_index < keys.size());
-    
-    const value_bucket_t& value_bucket = values[bucket_index];
-    const key_bucket_t& key_bucket = keys[bucket_index];
-    const K* key_data = key_bucket.data();
-
-    const std::size_t num_sequences = value_bucket.size();
+    const util::u64 hash = Hash{}(key_row, num_columns);
     const std::size_t stride = num_columns * sizeof(K);
+    const std::size_t slot_mask = mask();
     
-    for (std::size_t i = 0; i < num_sequences; i++)
+    std::size_t slot_index = std::size_t(hash) & slot_mask;
+    
+    while (slots[slot_index].entry != 0)
     {
-        if (std::memcmp(key_row, key_data + i * num_columns, stride) == 0)
+        const slot& candidate = slots[slot_index];
+        const std::size_t entry = std::size_t(candidate.entry - 1);
+        
+        if (candidate.hash == hash && std::memcmp(key_row, keys.data() + entry * num_columns, stride) == 0)
         {
-            return find_result(bucket_index, &value_bucket[i]);
+            return find_result(slot_index, hash, &values[entry]);
         }
+        
+        slot_index = (slot_index + 1) & slot_mask;
     }
     
-    return find_result(bucket_index, nullptr);
+    return find_result(slot_index, hash, nullptr);
 }
 
+//  insert: Insert a row that find() did not locate, given the result of that
+//      call. No other row may have been inserted in between.
+
 TEMPLATE_HEADER
 void TEMPLATE_PREFIX::insert(const typename TEMPLATE_PREFIX::find_result& result, const K* key_row, V value)
 {
-    assert(result.bucket_index < keys.size());
+    assert(result.value == nullptr);
+    
+    std::size_t slot_index = result.slot_index;
     
-    key_bucket_t& key_bucket = keys[result.bucket_index];
-    value_bucket_t& value_bucket = values[result.bucket_index];
+    if (needs_growth(values.size() + 1))
+    {
+        rehash(slots.size() * 2);
+        slot_index = empty_slot(result.hash);
+    }
+    
+    assert(slots[slot_index].entry == 0);
+    
+    const std::size_t old_size = keys.size();
+    keys.resize(old_size + num_columns);
+    std::memcpy(keys.data() + old_size, key_row, num_columns * sizeof(K));
+    values.push_back(value);
+    
+    slots[slot_index].hash = result.hash;
+    slots[slot_index].entry = values.size();
+}
 
-    const std::size_t old_size = key_bucket.size();
-    const std::size_t new_size = old_size + num_columns;
+//  reserve: Allocate space for at least `num_rows` rows, without growth.
 
-    assert(old_size / num_columns == value_bucket.size());
+TEMPLATE_HEADER
+void TEMPLATE_PREFIX::reserve(std::size_t num_rows)
+{
+    keys.reserve(num_rows * num_columns);
+    values.reserve(num_rows);
+    
+    std::size_t num_slots = slots.size();
+    
+    while (double(num_rows) > double(num_slots) * load_factor_limit)
+    {
+        num_slots *= 2;
+    }
+    
+    if (num_slots != slots.size())
+    {
+        rehash(num_slots);
+    }
+}
 
-    key_bucket.resize(new_size);
-    std::memcpy(key_bucket.data() + old_size, key_row, num_columns * sizeof(K));
-    value_bucket.push_back(value);
+TEMPLATE_HEADER
+std::size_t TEMPLATE_PREFIX::size() const
+{
+    return values.size();
 }
 
+//  max_probe_length: Largest number of slots examined to find an inserted row.
+
 TEMPLATE_HEADER
-std::size_t TEMPLATE_PREFIX::max_bucket_size() const
+std::size_t TEMPLATE_PREFIX::max_probe_length() const
 {
+    const std::size_t slot_mask = mask();
     std::size_t max = 0;
     
-    for (std::size_t i = 0; i < num_buckets; i++)
+    for (std::size_t i = 0; i < slots.size(); i++)
     {
-        if (values[i].size() > max)
+        if (slots[i].entry != 0)
         {
-            max = values[i].size();
+            const std::size_t home = std::size_t(slots[i].hash) & slot_mask;
+            const std::size_t length = ((i - home) & slot_mask) + 1;
+            
+            if (length > max)
+            {
+                max = length;
+            }
         }
     }
     
     return max;
 }
 
+TEMPLATE_HEADER
+float TEMPLATE_PREFIX::max_load_factor() const
+{
+    return load_factor_limit;
+}
+
+TEMPLATE_HEADER
+void TEMPLATE_PREFIX::max_load_factor(float factor)
+{
+    assert(factor > 0.0f && factor < 1.0f);
+    
+    load_factor_limit = factor;
+    reserve(values.size());
+}
+
+TEMPLATE_HEADER
+std::size_t TEMPLATE_PREFIX::mask() const
+{
+    return slots.size() - 1;
+}
+
+TEMPLATE_HEADER
+bool TEMPLATE_PREFIX::needs_growth(std::size_t num_rows) const
+{
+    return double(num_rows) > double(slots.size()) * load_factor_limit;
+}
+
+//  rehash: Move occupied slots into an array of `num_slots` slots, a power of 2.
+
+TEMPLATE_HEADER
+void TEMPLATE_PREFIX::rehash(std::size_t num_slots)
+{
+    assert(num_slots > 0 && (num_slots & (num_slots - 1)) == 0);
+    
+    std::vector<slot> old_slots(num_slots, slot{0, 0});
+    std::swap(slots, old_slots);
+    
+    for (const slot& occupied : old_slots)
+    {
+        if (occupied.entry != 0)
+        {
+            slots[empty_slot(occupied.hash)] = occupied;
+        }
+    }
+}
+
+TEMPLATE_HEADER
+std::size_t TEMPLATE_PREFIX::empty_slot(util::u64 hash) const
+{
+    const std::size_t slot_mask = mask();
+    std::size_t slot_index = std::size_t(hash) & slot_mask;
+    
+    while (slots[slot_index].entry != 0)
+    {
+        slot_index = (slot_index + 1) & slot_mask;
+    }
+    
+    return slot_index;
+}
+
 #undef TEMPLATE_PREFIX
 #undef TEMPLATE_HEADER
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "types.hpp"
+#include "label_column.hpp"
 #include <vector>
 #include <string>
 
@@ -30,42 +31,43 @@ namespace util
         util::u64 index_in_source_matrix;
     };
     
-    template <typename T>
-    inline util::u64 num_rows_in_matrix(const std::vector<std::vector<T>>& v)
+    template <typename Column>
+    inline util::u64 num_rows_in_matrix(const std::vector<Column>& v)
     {
         return v.empty() ? 0 : v[0].size();
     }
     
-    template <typename T>
-    inline void add_column(std::vector<std::vector<T>>& v)
+    template <typename Column>
+    inline void add_column(std::vector<Column>& v)
     {
         const u64 num_rows = num_rows_in_matrix(v);
-        std::vector<T> empty_col(num_rows);
-        v.emplace_back(std::move(empty_col));
+        v.emplace_back(num_rows);
     }
     
-    inline void build_row_hash(char* ptr, const std::vector<std::vector<util::u32>>& id_matrix, const util::u64 row, const util::u64 num_cols)
+    inline void build_row_hash(char* ptr, const std::vector<util::label_column>& id_matrix, const util::u64 row, const util::u64 num_cols)
     {
         for (util::u64 i = 0; i < num_cols; i++)
         {
-            std::memcpy(ptr + i*sizeof(util::u32), &id_matrix[i][row], sizeof(util::u32));
+            const util::u32 id = id_matrix[i][row];
+            std::memcpy(ptr + i*sizeof(util::u32), &id, sizeof(util::u32));
         }
     }
 
     inline void build_row_hash(char* ptr,
-                               const std::vector<std::vector<util::u32>>& id_matrix,
+                               const std::vector<util::label_column>& id_matrix,
                                const util::u64 row,
                                const std::vector<util::u64>& col_indices)
     {
         const util::u64 num_cols = col_indices.size();
         for (util::u64 i = 0; i < num_cols; i++)
         {
-            std::memcpy(ptr + i*sizeof(util::u32), &id_matrix[col_indices[i]][row], sizeof(util::u32));
+            const util::u32 id = id_matrix[col_indices[i]][row];
+            std::memcpy(ptr + i*sizeof(util::u32), &id, sizeof(util::u32));
         }
     }
     
     inline void build_row_hash(char* ptr,
-                               const std::vector<std::vector<util::u32>>& id_matrix,
+                               const std::vector<util::label_column>& id_matrix,
                                const util::u64 row,
                                const std::vector<util::u64>& src_col_indices,
                                const std::vector<util::u64>& dest_col_indices)
@@ -73,7 +75,8 @@ namespace util
         const util::u64 num_cols = src_col_indices.size();
         for (util::u64 i = 0; i < num_cols; i++)
         {
-            std::memcpy(ptr + dest_col_indices[i]*sizeof(util::u32), &id_matrix[src_col_indices[i]][row], sizeof(util::u32));
+            const util::u32 id = id_matrix[src_col_indices[i]][row];
+            std::memcpy(ptr + dest_col_indices[i]*sizeof(util::u32), &id, sizeof(util::u32));
         }
     }
     
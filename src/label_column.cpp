@@ -0,0 +1,523 @@
+//
+//  label_column.cpp
+//  categorical
+//
+
+#include "label_column.hpp"
+#include "config.hpp"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+util::label_column::label_column() :
+    m_width(1),
+    m_n_queries(0)
+{
+    //
+}
+
+util::label_column::label_column(util::u64 size, util::u32 fill_with) :
+    m_width(width_for(fill_with)),
+    m_n_queries(0)
+{
+    resize(size, fill_with);
+}
+
+util::label_column::label_column(const std::vector<util::u32>& ids) :
+    m_width(1),
+    m_n_queries(0)
+{
+    util::u32 max_id = 0;
+    
+    for (const auto& id : ids)
+    {
+        max_id = std::max(max_id, id);
+    }
+    
+    m_width = width_for(max_id);
+    resize(ids.size());
+    
+    visit_mutable([&](auto* data) -> void {
+        using T = typename std::remove_pointer<decltype(data)>::type;
+        
+        for (util::u64 i = 0; i < ids.size(); i++)
+        {
+            data[i] = T(ids[i]);
+        }
+    });
+}
+
+//  width_for: Get the number of bytes required to store `id`.
+util::u32 util::label_column::width_for(util::u32 id)
+{
+    if (id <= 0xff)
+    {
+        return 1;
+    }
+    else if (id <= 0xffff)
+    {
+        return 2;
+    }
+    
+    return 4;
+}
+
+bool util::label_column::operator ==(const util::label_column& other) const
+{
+    if (size() != other.size())
+    {
+        return false;
+    }
+    
+    if (shares_ids_with(other))
+    {
+        return true;
+    }
+    
+    if (m_width == other.m_width)
+    {
+        const buffers& bufs = *m_buffers;
+        const buffers& other_bufs = *other.m_buffers;
+        
+        switch (m_width)
+        {
+            case 1:
+                return bufs.ids8 == other_bufs.ids8;
+            case 2:
+                return bufs.ids16 == other_bufs.ids16;
+            default:
+                return bufs.ids32 == other_bufs.ids32;
+        }
+    }
+    
+    const util::u64 sz = size();
+    
+    for (util::u64 i = 0; i < sz; i++)
+    {
+        if ((*this)[i] != other[i])
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool util::label_column::operator !=(const util::label_column& other) const
+{
+    return !(*this == other);
+}
+
+bool util::label_column::empty() const
+{
+    return size() == 0;
+}
+
+void util::label_column::push_back(util::u32 id)
+{
+    invalidate_postings();
+    
+    require_width_for(id);
+    
+    buffers& bufs = m_buffers.mutate();
+    
+    switch (m_width)
+    {
+        case 1:
+            bufs.ids8.push_back(util::u8(id));
+            break;
+        case 2:
+            bufs.ids16.push_back(util::u16(id));
+            break;
+        default:
+            bufs.ids32.push_back(id);
+    }
+}
+
+void util::label_column::resize(util::u64 rows, util::u32 fill_with)
+{
+    invalidate_postings();
+    
+    require_width_for(fill_with);
+    
+    buffers& bufs = m_buffers.mutate();
+    
+    switch (m_width)
+    {
+        case 1:
+            bufs.ids8.resize(rows, util::u8(fill_with));
+            break;
+        case 2:
+            bufs.ids16.resize(rows, util::u16(fill_with));
+            break;
+        default:
+            bufs.ids32.resize(rows, fill_with);
+    }
+}
+
+void util::label_column::reserve(util::u64 rows)
+{
+    if (capacity() >= rows)
+    {
+        return;
+    }
+    
+    buffers& bufs = m_buffers.mutate();
+    
+    switch (m_width)
+    {
+        case 1:
+            bufs.ids8.reserve(rows);
+            break;
+        case 2:
+            bufs.ids16.reserve(rows);
+            break;
+        default:
+            bufs.ids32.reserve(rows);
+    }
+}
+
+//  shrink_to_fit: Release capacity beyond the current number of rows. Ids
+//      shared with a copy of the column are left as they are.
+void util::label_column::shrink_to_fit()
+{
+    if (capacity() == size())
+    {
+        return;
+    }
+    
+    buffers& bufs = m_buffers.mutate();
+    
+    switch (m_width)
+    {
+        case 1:
+            bufs.ids8.shrink_to_fit();
+            break;
+        case 2:
+            bufs.ids16.shrink_to_fit();
+            break;
+        default:
+            bufs.ids32.shrink_to_fit();
+    }
+}
+
+util::u64 util::label_column::capacity() const
+{
+    const buffers& bufs = *m_buffers;
+    
+    switch (m_width)
+    {
+        case 1:
+            return bufs.ids8.capacity();
+        case 2:
+            return bufs.ids16.capacity();
+        default:
+            return bufs.ids32.capacity();
+    }
+}
+
+void util::label_column::clear()
+{
+    invalidate_postings();
+    
+    m_buffers = util::copy_on_write<buffers>();
+    m_width = 1;
+}
+
+void util::label_column::fill(util::u32 id)
+{
+    fill(0, size(), id);
+}
+
+void util::label_column::fill(util::u64 begin, util::u64 end, util::u32 id)
+{
+    require_width_for(id);
+    
+    visit_mutable([&](auto* data) -> void {
+        using T = typename std::remove_pointer<decltype(data)>::type;
+        std::fill(data + begin, data + end, T(id));
+    });
+}
+
+//  copy_rows: Copy `n` rows of `src`, starting at `src_begin`, into this
+//      column, starting at `dest_begin`. The column must already be large
+//      enough to hold the copied rows.
+void util::label_column::copy_rows(util::u64 dest_begin, const util::label_column& src,
+                                   util::u64 src_begin, util::u64 n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+    
+    if (src.m_width > m_width)
+    {
+        set_width(src.m_width);
+    }
+    
+    visit_mutable([&](auto* dest) -> void {
+        using T = typename std::remove_pointer<decltype(dest)>::type;
+        
+        src.visit([&](const auto* source) -> void {
+            using U = typename std::remove_const<typename std::remove_pointer<decltype(source)>::type>::type;
+            
+            if (std::is_same<T, U>::value)
+            {
+                std::memcpy(dest + dest_begin, source + src_begin, n * sizeof(T));
+            }
+            else
+            {
+                for (util::u64 i = 0; i < n; i++)
+                {
+                    dest[dest_begin + i] = T(source[src_begin + i]);
+                }
+            }
+        });
+    });
+}
+
+//  repeat_rows: Append `times` copies of the first `n` rows.
+void util::label_column::repeat_rows(util::u64 n, util::u64 times)
+{
+    resize(n + n * times);
+    
+    visit_mutable([&](auto* data) -> void {
+        using T = typename std::remove_pointer<decltype(data)>::type;
+        
+        for (util::u64 i = 0; i < times; i++)
+        {
+            std::memcpy(data + n * (i+1), data, n * sizeof(T));
+        }
+    });
+}
+
+//  require_width_for: Widen the column, if necessary, such that `id` can be
+//      stored.
+void util::label_column::require_width_for(util::u32 id)
+{
+    const util::u32 width = width_for(id);
+    
+    if (width > m_width)
+    {
+        set_width(width);
+    }
+}
+
+//  narrow: Shrink the column to the narrowest width that can represent its
+//      current contents.
+void util::label_column::narrow()
+{
+    const util::u32 max_id = visit([&](const auto* data) -> util::u32 {
+        util::u32 res = 0;
+        const util::u64 sz = size();
+        
+        for (util::u64 i = 0; i < sz; i++)
+        {
+            res = std::max(res, util::u32(data[i]));
+        }
+        
+        return res;
+    });
+    
+    const util::u32 width = width_for(max_id);
+    
+    if (width != m_width)
+    {
+        set_width(width);
+    }
+}
+
+void util::label_column::copy_to(util::u32* dest) const
+{
+    visit([&](const auto* data) -> void {
+        const util::u64 sz = size();
+        
+        for (util::u64 i = 0; i < sz; i++)
+        {
+            dest[i] = data[i];
+        }
+    });
+}
+
+std::vector<util::u32> util::label_column::to_vector() const
+{
+    std::vector<util::u32> res(size());
+    copy_to(res.data());
+    return res;
+}
+
+template <typename T>
+void util::label_column::convert(std::vector<T>& dest, const buffers& src, util::u32 src_width)
+{
+    auto convert_from = [&](const auto& ids) -> void {
+        dest.resize(ids.size());
+        
+        for (util::u64 i = 0; i < ids.size(); i++)
+        {
+            dest[i] = T(ids[i]);
+        }
+    };
+    
+    switch (src_width)
+    {
+        case 1:
+            convert_from(src.ids8);
+            break;
+        case 2:
+            convert_from(src.ids16);
+            break;
+        default:
+            convert_from(src.ids32);
+    }
+}
+
+//  set_width: Convert the ids to `width` bytes each. The converted ids are
+//      built in a new buffer, so ids shared with a copy are not cloned first.
+void util::label_column::set_width(util::u32 width)
+{
+    buffers converted;
+    
+    switch (width)
+    {
+        case 1:
+            convert(converted.ids8, *m_buffers, m_width);
+            break;
+        case 2:
+            convert(converted.ids16, *m_buffers, m_width);
+            break;
+        default:
+            convert(converted.ids32, *m_buffers, m_width);
+    }
+    
+    m_buffers = util::copy_on_write<buffers>(std::move(converted));
+    m_width = width;
+}
+
+bool util::label_column::can_build_postings(util::u64 rows)
+{
+    return rows <= util::u64(~(util::u32(0)));
+}
+
+//  copying reads the other column's index, which another thread may be
+//  publishing from a const method.
+
+util::label_column::label_column(const util::label_column& other) :
+    m_buffers(other.m_buffers),
+    m_width(other.m_width),
+    m_postings(std::atomic_load(&other.m_postings)),
+    m_n_queries(other.m_n_queries.load(std::memory_order_relaxed))
+{
+    //
+}
+
+util::label_column& util::label_column::operator=(const util::label_column& other)
+{
+    if (this != &other)
+    {
+        m_buffers = other.m_buffers;
+        m_width = other.m_width;
+        m_postings = std::atomic_load(&other.m_postings);
+        m_n_queries.store(other.m_n_queries.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    
+    return *this;
+}
+
+util::label_column::label_column(util::label_column&& other) noexcept :
+    m_buffers(std::move(other.m_buffers)),
+    m_width(other.m_width),
+    m_postings(std::move(other.m_postings)),
+    m_n_queries(other.m_n_queries.load(std::memory_order_relaxed))
+{
+    other.m_width = 1;
+    other.m_n_queries.store(0, std::memory_order_relaxed);
+}
+
+util::label_column& util::label_column::operator=(util::label_column&& other) noexcept
+{
+    if (this != &other)
+    {
+        m_buffers = std::move(other.m_buffers);
+        m_width = other.m_width;
+        m_postings = std::move(other.m_postings);
+        m_n_queries.store(other.m_n_queries.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        
+        other.m_width = 1;
+        other.m_n_queries.store(0, std::memory_order_relaxed);
+    }
+    
+    return *this;
+}
+
+bool util::label_column::has_postings() const
+{
+    return std::atomic_load(&m_postings) != nullptr;
+}
+
+bool util::label_column::note_query() const
+{
+    if (m_n_queries.load(std::memory_order_relaxed) >= CAT_LABEL_INDEX_MIN_QUERIES || has_postings())
+    {
+        return true;
+    }
+    
+    return m_n_queries.fetch_add(1, std::memory_order_relaxed) + 1 >= CAT_LABEL_INDEX_MIN_QUERIES;
+}
+
+//  postings: Threads that find no index each build one; the first to publish
+//      its index wins, and the others return that index instead of their own.
+//      The index is returned by value so that it outlives a concurrent rebuild.
+
+std::shared_ptr<const util::label_postings> util::label_column::postings() const
+{
+    std::shared_ptr<const util::label_postings> current = std::atomic_load(&m_postings);
+    
+    if (current)
+    {
+        return current;
+    }
+    
+    auto index = std::make_shared<util::label_postings>();
+    const util::u64 sz = size();
+    
+    visit([&](const auto* ids) -> void {
+        util::u32 max_id = 0;
+        
+        for (util::u64 i = 0; i < sz; i++)
+        {
+            max_id = std::max(max_id, util::u32(ids[i]));
+        }
+        
+        std::vector<util::u64>& offsets = index->offsets;
+        std::vector<util::u32>& rows = index->rows;
+        
+        offsets.resize(sz == 0 ? 1 : util::u64(max_id) + 2, 0);
+        rows.resize(sz);
+        
+        for (util::u64 i = 0; i < sz; i++)
+        {
+            offsets[ids[i]+1]++;
+        }
+        
+        for (util::u64 i = 1; i < offsets.size(); i++)
+        {
+            offsets[i] += offsets[i-1];
+        }
+        
+        std::vector<util::u64> cursor(offsets.begin(), offsets.end() - 1);
+        
+        for (util::u64 i = 0; i < sz; i++)
+        {
+            rows[cursor[ids[i]]++] = util::u32(i);
+        }
+    });
+    
+    std::shared_ptr<const util::label_postings> built = std::move(index);
+    
+    if (!std::atomic_compare_exchange_strong(&m_postings, &current, built))
+    {
+        return current;
+    }
+    
+    return built;
+}
@@ -0,0 +1,264 @@
+//
+//  label_column.hpp
+//  categorical
+//
+
+#pragma once
+
+#include "types.hpp"
+#include "copy_on_write.hpp"
+#include <vector>
+#include <memory>
+#include <atomic>
+
+namespace util {
+    class label_column;
+    struct label_postings;
+}
+
+//  label_postings: Inverted index of a label_column. The rows containing id
+//      `i` are rows[offsets[i]] ... rows[offsets[i+1]-1], in ascending order.
+
+struct util::label_postings
+{
+    util::u64 count(util::u32 id) const;
+    const util::u32* begin(util::u32 id) const;
+    const util::u32* end(util::u32 id) const;
+    
+    std::vector<util::u64> offsets;
+    std::vector<util::u32> rows;
+};
+
+//  label_column: Column of label ids, stored with the narrowest of 1, 2 or 4
+//      bytes per row that can represent the largest id in the column. Storing
+//      an id that does not fit widens the column. Copies of a column share its
+//      ids until one of them is modified.
+
+class util::label_column
+{
+public:
+    label_column();
+    explicit label_column(util::u64 size, util::u32 fill_with = 0);
+    explicit label_column(const std::vector<util::u32>& ids);
+    ~label_column() = default;
+    
+    label_column(const util::label_column& other);
+    label_column& operator=(const util::label_column& other);
+    label_column(util::label_column&& other) noexcept;
+    label_column& operator=(util::label_column&& other) noexcept;
+    
+    bool operator ==(const util::label_column& other) const;
+    bool operator !=(const util::label_column& other) const;
+    
+    util::u32 operator[](util::u64 row) const;
+    
+    util::u64 size() const;
+    bool empty() const;
+    util::u32 width() const;
+    util::u32 max_storable_id() const;
+    bool shares_ids_with(const util::label_column& other) const;
+    
+    void set(util::u64 row, util::u32 id);
+    void push_back(util::u32 id);
+    void resize(util::u64 rows, util::u32 fill_with = 0);
+    void reserve(util::u64 rows);
+    void shrink_to_fit();
+    util::u64 capacity() const;
+    void clear();
+    
+    void fill(util::u32 id);
+    void fill(util::u64 begin, util::u64 end, util::u32 id);
+    
+    void copy_rows(util::u64 dest_begin, const util::label_column& src, util::u64 src_begin, util::u64 n);
+    void repeat_rows(util::u64 n, util::u64 times);
+    
+    void require_width_for(util::u32 id);
+    void narrow();
+    
+    void copy_to(util::u32* dest) const;
+    std::vector<util::u32> to_vector() const;
+    
+    //  visit: Invoke `f` with a const pointer to the column's contiguous codes,
+    //      typed as u8, u16 or u32 according to the current width.
+    template <typename F>
+    auto visit(F&& f) const -> decltype(f(static_cast<const util::u32*>(nullptr)));
+    
+    //  visit_mutable: Like `visit`, but with a non-const pointer. Values
+    //      written through the pointer must fit in the current width.
+    template <typename F>
+    auto visit_mutable(F&& f) -> decltype(f(static_cast<util::u32*>(nullptr)));
+    
+    //  postings: Get the inverted index of the column, building it if
+    //      necessary. The index is discarded whenever the column is modified.
+    //      Like the other const methods, safe to call from several threads.
+    std::shared_ptr<const util::label_postings> postings() const;
+    bool has_postings() const;
+    
+    //  note_query: Count a query of the column, and get whether the column has
+    //      been queried at least CAT_LABEL_INDEX_MIN_QUERIES times since it was
+    //      last modified, such that building its index is worthwhile.
+    bool note_query() const;
+    
+    static util::u32 width_for(util::u32 id);
+    static bool can_build_postings(util::u64 rows);
+    
+private:
+    struct buffers
+    {
+        std::vector<util::u8> ids8;
+        std::vector<util::u16> ids16;
+        std::vector<util::u32> ids32;
+    };
+    
+    util::copy_on_write<buffers> m_buffers;
+    util::u32 m_width;
+    
+    //  accessed with std::atomic_load / std::atomic_store.
+    mutable std::shared_ptr<const util::label_postings> m_postings;
+    mutable std::atomic<util::u32> m_n_queries;
+    
+private:
+    void set_width(util::u32 width);
+    void invalidate_postings();
+    
+    template <typename T>
+    static void convert(std::vector<T>& dest, const buffers& src, util::u32 src_width);
+};
+
+//
+//  impl
+//
+
+template <typename F>
+auto util::label_column::visit(F&& f) const -> decltype(f(static_cast<const util::u32*>(nullptr)))
+{
+    const buffers& bufs = *m_buffers;
+    
+    switch (m_width)
+    {
+        case 1:
+            return f(bufs.ids8.data());
+        case 2:
+            return f(bufs.ids16.data());
+        default:
+            return f(bufs.ids32.data());
+    }
+}
+
+template <typename F>
+auto util::label_column::visit_mutable(F&& f) -> decltype(f(static_cast<util::u32*>(nullptr)))
+{
+    invalidate_postings();
+    
+    buffers& bufs = m_buffers.mutate();
+    
+    switch (m_width)
+    {
+        case 1:
+            return f(bufs.ids8.data());
+        case 2:
+            return f(bufs.ids16.data());
+        default:
+            return f(bufs.ids32.data());
+    }
+}
+
+inline util::u32 util::label_column::operator[](util::u64 row) const
+{
+    const buffers& bufs = *m_buffers;
+    
+    switch (m_width)
+    {
+        case 1:
+            return bufs.ids8[row];
+        case 2:
+            return bufs.ids16[row];
+        default:
+            return bufs.ids32[row];
+    }
+}
+
+inline void util::label_column::invalidate_postings()
+{
+    //  the column is being modified, so no other thread may be reading it.
+    if (m_postings)
+    {
+        m_postings.reset();
+    }
+    
+    if (m_n_queries.load(std::memory_order_relaxed) != 0)
+    {
+        m_n_queries.store(0, std::memory_order_relaxed);
+    }
+}
+
+inline void util::label_column::set(util::u64 row, util::u32 id)
+{
+    invalidate_postings();
+    
+    if (id > max_storable_id())
+    {
+        require_width_for(id);
+    }
+    
+    buffers& bufs = m_buffers.mutate();
+    
+    switch (m_width)
+    {
+        case 1:
+            bufs.ids8[row] = util::u8(id);
+            break;
+        case 2:
+            bufs.ids16[row] = util::u16(id);
+            break;
+        default:
+            bufs.ids32[row] = id;
+    }
+}
+
+inline util::u64 util::label_column::size() const
+{
+    const buffers& bufs = *m_buffers;
+    
+    switch (m_width)
+    {
+        case 1:
+            return bufs.ids8.size();
+        case 2:
+            return bufs.ids16.size();
+        default:
+            return bufs.ids32.size();
+    }
+}
+
+inline util::u32 util::label_column::width() const
+{
+    return m_width;
+}
+
+inline util::u32 util::label_column::max_storable_id() const
+{
+    return m_width == 4 ? ~(util::u32(0)) : (util::u32(1) << (m_width * 8)) - 1;
+}
+
+//  shares_ids_with: True if `other` is a copy of this column, neither of which
+//      has been modified since.
+inline bool util::label_column::shares_ids_with(const util::label_column& other) const
+{
+    return m_width == other.m_width && m_buffers.shares_with(other.m_buffers);
+}
+
+inline util::u64 util::label_postings::count(util::u32 id) const
+{
+    return id + 1 < offsets.size() ? offsets[id+1] - offsets[id] : 0;
+}
+
+inline const util::u32* util::label_postings::begin(util::u32 id) const
+{
+    return id + 1 < offsets.size() ? rows.data() + offsets[id] : rows.data();
+}
+
+inline const util::u32* util::label_postings::end(util::u32 id) const
+{
+    return id + 1 < offsets.size() ? rows.data() + offsets[id+1] : rows.data();
+}
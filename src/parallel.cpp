@@ -0,0 +1,191 @@
+//
+//  parallel.cpp
+//  categorical
+//
+
+#include "parallel.hpp"
+#include "config.hpp"
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace
+{
+    std::mutex options_mutex;
+    util::parallel_options global_options;
+    
+    //  worker_pool: Threads kept for the life of the process, which run tasks
+    //      queued by util::parallel::run. The pool grows to the largest number
+    //      of threads requested.
+    class worker_pool
+    {
+    public:
+        worker_pool() = default;
+        ~worker_pool();
+        
+        void run(util::u64 n_helpers, const std::function<void()>& task);
+        
+    private:
+        struct job
+        {
+            const std::function<void()>* task;
+            util::u64 n_running;
+        };
+        
+        void require_threads(util::u64 n_threads);
+        void work();
+        
+        std::mutex mutex;
+        std::condition_variable task_ready;
+        std::condition_variable task_done;
+        std::deque<job*> queue;
+        std::vector<std::thread> threads;
+        bool stopping = false;
+    };
+    
+    worker_pool::~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        
+        task_ready.notify_all();
+        
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+    
+    //  run: Invoke `task` on the calling thread and on up to `n_helpers` pool
+    //      threads, and wait for every invocation that started to finish. Queued
+    //      invocations that have not started once the calling thread's
+    //      invocation returns are cancelled, so that a busy pool never delays the
+    //      caller. `task` must not throw.
+    void worker_pool::run(util::u64 n_helpers, const std::function<void()>& task)
+    {
+        job self{&task, 0};
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            require_threads(n_helpers);
+            
+            for (util::u64 i = 0; i < n_helpers; i++)
+            {
+                queue.push_back(&self);
+            }
+        }
+        
+        task_ready.notify_all();
+        
+        task();
+        
+        std::unique_lock<std::mutex> lock(mutex);
+        
+        queue.erase(std::remove(queue.begin(), queue.end(), &self), queue.end());
+        task_done.wait(lock, [&]() { return self.n_running == 0; });
+    }
+    
+    void worker_pool::require_threads(util::u64 n_threads)
+    {
+        while (threads.size() < n_threads)
+        {
+            threads.emplace_back([this]() { work(); });
+        }
+    }
+    
+    void worker_pool::work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        
+        while (true)
+        {
+            task_ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+            
+            if (stopping)
+            {
+                return;
+            }
+            
+            job* next = queue.front();
+            queue.pop_front();
+            next->n_running++;
+            
+            lock.unlock();
+            (*next->task)();
+            lock.lock();
+            
+            if (--next->n_running == 0)
+            {
+                task_done.notify_all();
+            }
+        }
+    }
+    
+    worker_pool& get_worker_pool()
+    {
+        static worker_pool pool;
+        return pool;
+    }
+}
+
+util::parallel_options::parallel_options() :
+    enabled(false),
+    n_threads(CAT_PARALLEL_N_THREADS),
+    min_rows(CAT_PARALLEL_MIN_ROWS)
+{
+    //
+}
+
+util::parallel_options util::parallel::get_options()
+{
+    std::lock_guard<std::mutex> lock(options_mutex);
+    return global_options;
+}
+
+void util::parallel::set_options(const util::parallel_options& options)
+{
+    std::lock_guard<std::mutex> lock(options_mutex);
+    global_options = options;
+}
+
+//  applies: True if scans of `n_rows` rows should be split across threads.
+
+bool util::parallel::applies(util::u64 n_rows)
+{
+    return n_chunks(n_rows) > 1;
+}
+
+util::u64 util::parallel::n_chunks(util::u64 n_rows)
+{
+    const util::parallel_options options = get_options();
+    
+    if (!options.enabled || n_rows < options.min_rows || options.n_threads == 1)
+    {
+        return 1;
+    }
+    
+    const util::u64 chunk_sz = chunk_rows();
+    
+    return (n_rows + chunk_sz - 1) / chunk_sz;
+}
+
+//  run: Invoke `task` concurrently on `n_threads` threads, including the calling
+//      thread, using threads that persist between calls. Invocations that have
+//      not started by the time the calling thread's returns are skipped, so
+//      `task` must share its work through state it captures. `task` must not
+//      throw.
+
+void util::parallel::run(util::u64 n_threads, const std::function<void()>& task)
+{
+    get_worker_pool().run(n_threads > 0 ? n_threads - 1 : 0, task);
+}
+
+util::u64 util::parallel::chunk_rows()
+{
+    static_assert(CAT_PARALLEL_CHUNK_ROWS > 0 && CAT_PARALLEL_CHUNK_ROWS % 64 == 0,
+                  "Chunk size must be a positive multiple of 64.");
+    
+    return CAT_PARALLEL_CHUNK_ROWS;
+}
@@ -0,0 +1,116 @@
+//
+//  parallel.hpp
+//  categorical
+//
+
+#pragma once
+
+#include "types.hpp"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+namespace util {
+    struct parallel_options;
+    
+    namespace parallel {
+        util::parallel_options get_options();
+        void set_options(const util::parallel_options& options);
+        
+        bool applies(util::u64 n_rows);
+        util::u64 n_chunks(util::u64 n_rows);
+        util::u64 chunk_rows();
+        
+        void run(util::u64 n_threads, const std::function<void()>& task);
+        
+        template <typename F>
+        void for_each_chunk(util::u64 n_rows, util::u64 n_chunks, F&& f);
+    }
+}
+
+//  parallel_options: Process-wide settings for multithreaded row scans. Scans
+//      of objects with at least `min_rows` rows are split into word-aligned
+//      chunks of CAT_PARALLEL_CHUNK_ROWS rows, which are processed by up to
+//      `n_threads` threads. `n_threads` == 0 uses the number of hardware
+//      threads. Disabled by default.
+
+struct util::parallel_options
+{
+    parallel_options();
+    
+    bool enabled;
+    util::u32 n_threads;
+    util::u64 min_rows;
+};
+
+//
+//  impl
+//
+
+//  for_each_chunk: Invoke `f(chunk_index, begin, end)` for each of the `n_chunk`
+//      chunks of `n_rows`, as given by n_chunks(), possibly concurrently.
+//      `begin` is a multiple of 64. With a single chunk, `f` is invoked on
+//      the calling thread. If `f` throws, the remaining chunks are skipped, and
+//      the first exception is rethrown on the calling thread.
+
+template <typename F>
+void util::parallel::for_each_chunk(util::u64 n_rows, util::u64 n_chunk, F&& f)
+{
+    const util::u64 chunk_sz = chunk_rows();
+    
+    if (n_chunk <= 1)
+    {
+        f(util::u64(0), util::u64(0), n_rows);
+        return;
+    }
+    
+    util::u64 n_threads = get_options().n_threads;
+    
+    if (n_threads == 0)
+    {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    n_threads = std::min(n_threads, n_chunk);
+    
+    std::atomic<util::u64> next_chunk(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    
+    const std::function<void()> worker = [&]() {
+        util::u64 chunk;
+        
+        while ((chunk = next_chunk.fetch_add(1)) < n_chunk)
+        {
+            const util::u64 begin = chunk * chunk_sz;
+            const util::u64 end = std::min(n_rows, begin + chunk_sz);
+            
+            try
+            {
+                f(chunk, begin, end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                
+                next_chunk.store(n_chunk);
+            }
+        }
+    };
+    
+    run(n_threads, worker);
+    
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
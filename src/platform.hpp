@@ -15,3 +15,13 @@
     #define CAT_MEX_GCC49
     #endif
 #endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAT_HAS_SSE2
+#endif
+
+//  gcc and clang can compile AVX2 / POPCNT kernels per-function and choose
+//  between them at runtime with __builtin_cpu_supports.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CAT_HAS_X86_DISPATCH
+#endif
@@ -0,0 +1,81 @@
+//
+//  query_expr.cpp
+//  categorical
+//
+
+#include "query_expr.hpp"
+#include <utility>
+
+util::query_expr::query_expr(util::query_expr::kind type) : m_type(type)
+{
+    //
+}
+
+util::query_expr util::query_expr::label(const std::string& label)
+{
+    return find_or({label});
+}
+
+util::query_expr util::query_expr::find(const std::vector<std::string>& labels)
+{
+    query_expr result(kind::find);
+    result.m_labels = labels;
+    return result;
+}
+
+util::query_expr util::query_expr::find_or(const std::vector<std::string>& labels)
+{
+    query_expr result(kind::find_or);
+    result.m_labels = labels;
+    return result;
+}
+
+util::query_expr util::query_expr::in_category(const std::string& category,
+                                               const std::vector<std::string>& labels)
+{
+    query_expr result(kind::in_category);
+    result.m_category = category;
+    result.m_labels = labels;
+    return result;
+}
+
+util::query_expr util::query_expr::all_of(std::vector<util::query_expr> terms)
+{
+    query_expr result(kind::all_of);
+    result.m_children = std::move(terms);
+    return result;
+}
+
+util::query_expr util::query_expr::any_of(std::vector<util::query_expr> terms)
+{
+    query_expr result(kind::any_of);
+    result.m_children = std::move(terms);
+    return result;
+}
+
+util::query_expr util::query_expr::negate(util::query_expr term)
+{
+    query_expr result(kind::negate);
+    result.m_children.push_back(std::move(term));
+    return result;
+}
+
+util::query_expr::kind util::query_expr::type() const
+{
+    return m_type;
+}
+
+const std::vector<std::string>& util::query_expr::labels() const
+{
+    return m_labels;
+}
+
+const std::string& util::query_expr::category() const
+{
+    return m_category;
+}
+
+const std::vector<util::query_expr>& util::query_expr::children() const
+{
+    return m_children;
+}
@@ -0,0 +1,69 @@
+//
+//  query_expr.hpp
+//  categorical
+//
+
+#pragma once
+
+#include "types.hpp"
+#include <vector>
+#include <string>
+
+namespace util {
+    class query_expr;
+}
+
+//  query_expr: Boolean expression over the labels of a categorical, evaluated
+//      with categorical::find_expr. Leaves select rows by label; inner nodes
+//      combine their children with AND, OR or NOT. Labels that do not exist
+//      select no rows.
+
+class util::query_expr
+{
+public:
+    enum class kind : util::u8
+    {
+        find,
+        find_or,
+        in_category,
+        all_of,
+        any_of,
+        negate
+    };
+
+public:
+    ~query_expr() = default;
+    
+    query_expr(const query_expr& other) = default;
+    query_expr& operator=(const query_expr& other) = default;
+    query_expr(query_expr&& rhs) noexcept = default;
+    query_expr& operator=(query_expr&& rhs) noexcept = default;
+    
+    //  label: Rows with `label`.
+    static query_expr label(const std::string& label);
+    //  find: Rows matching `labels` as in categorical::find -- labels in the
+    //      same category are combined with OR, and categories with AND.
+    static query_expr find(const std::vector<std::string>& labels);
+    //  find_or: Rows with any of `labels`.
+    static query_expr find_or(const std::vector<std::string>& labels);
+    //  in_category: Rows whose label in `category` is one of `labels`. Labels
+    //      of other categories are ignored.
+    static query_expr in_category(const std::string& category, const std::vector<std::string>& labels);
+    
+    static query_expr all_of(std::vector<query_expr> terms);
+    static query_expr any_of(std::vector<query_expr> terms);
+    static query_expr negate(query_expr term);
+    
+    util::query_expr::kind type() const;
+    const std::vector<std::string>& labels() const;
+    const std::string& category() const;
+    const std::vector<query_expr>& children() const;
+
+private:
+    query_expr(util::query_expr::kind type);
+    
+    util::query_expr::kind m_type;
+    std::vector<std::string> m_labels;
+    std::string m_category;
+    std::vector<query_expr> m_children;
+};
@@ -87,8 +87,8 @@ namespace
         return categories;
     }
     
-    std::vector<std::vector<util::u32>> unique_rows(std::unordered_map<std::string, util::VisitedRow>& visited_complete_rows,
-                                                    const std::vector<std::vector<util::u32>>& ids,
+    std::vector<util::label_column> unique_rows(std::unordered_map<std::string, util::VisitedRow>& visited_complete_rows,
+                                                    const std::vector<util::label_column>& ids,
                                                     const std::vector<util::u64>& indices,
                                                     const bool use_indices,
                                                     const util::u64 index_offset,
@@ -101,7 +101,7 @@ namespace
         const u64 max_rows = util::num_rows_in_matrix(ids);
         const u64 num_rows = use_indices ? indices.size() : max_rows;
         
-        std::vector<std::vector<u32>> result(num_cols);
+        std::vector<util::label_column> result(num_cols);
         std::string row_hash = util::make_label_id_hash_string(num_cols);
         
         for (u64 i = 0; i < num_rows; i++)
@@ -168,9 +168,9 @@ base(opts), a(a), b(b)
     //
 }
 
-std::vector<std::vector<util::u32>> util::set_union::unique_rows_to_combine(std::unordered_set<std::string>& visited_complete_rows,
+std::vector<util::label_column> util::set_union::unique_rows_to_combine(std::unordered_set<std::string>& visited_complete_rows,
                                                                             std::unordered_map<std::string, util::VisitedRow>& visited_shared_rows,
-                                                                            const std::vector<std::vector<util::u32>>& ids,
+                                                                            const std::vector<util::label_column>& ids,
                                                                             const std::vector<util::u64>& category_indices,
                                                                             const std::vector<util::u64>& shared_category_indices,
                                                                             const std::vector<util::u64>& unique_category_indices,
@@ -187,7 +187,7 @@ std::vector<std::vector<util::u32>> util::set_union::unique_rows_to_combine(std:
     const u64 num_rows = use_indices ? indices.size() : max_rows;
     const u64 index_offset = options.index_offset;
     
-    std::vector<std::vector<util::u32>> result(num_categories);
+    std::vector<util::label_column> result(num_categories);
     
     std::string complete_row_hash = make_label_id_hash_string(num_categories);
     std::string shared_row_hash = make_label_id_hash_string(num_shared);
@@ -259,9 +259,9 @@ std::vector<std::vector<util::u32>> util::set_union::unique_rows_to_combine(std:
     return result;
 }
 
-void util::set_union::append_unique_rows_progenitors_match(std::vector<std::vector<util::u32>>& ids_a,
+void util::set_union::append_unique_rows_progenitors_match(std::vector<util::label_column>& ids_a,
                                                            std::unordered_map<std::string, util::VisitedRow>& visited_rows_a,
-                                                           const std::vector<std::vector<util::u32>>& ids_b,
+                                                           const std::vector<util::label_column>& ids_b,
                                                            const std::vector<util::u64>& indices,
                                                            const bool use_indices,
                                                            const util::u64 index_offset,
@@ -298,9 +298,9 @@ void util::set_union::append_unique_rows_progenitors_match(std::vector<std::vect
 
 void util::set_union::append_unique_rows(util::categorical& a,
                                          const util::categorical& b,
-                                         std::vector<std::vector<util::u32>>& ids_a,
+                                         std::vector<util::label_column>& ids_a,
                                          std::unordered_map<std::string, util::VisitedRow>& visited_rows_a,
-                                         const std::vector<std::vector<util::u32>>& ids_b,
+                                         const std::vector<util::label_column>& ids_b,
                                          const std::vector<std::string>& categories,
                                          const std::vector<util::u64>& category_indices_a,
                                          const std::vector<util::u64>& category_indices_b,
@@ -334,9 +334,9 @@ void util::set_union::append_unique_rows(util::categorical& a,
             
             if (visited_it_b == visited_ids_b.end())
             {
-                const std::string& label_b = b.m_label_ids.ref_at(id_b);
-                const auto it_a = a.m_label_ids.find(label_b);
-                if (it_a == a.m_label_ids.endk())
+                const std::string& label_b = b.m_label_ids->ref_at(id_b);
+                const auto it_a = a.m_label_ids->find(label_b);
+                if (it_a == a.m_label_ids->endk())
                 {
                     const u32 label_status = a.add_label_unchecked_has_category(categories[j], label_b, &id_a);
                     if (label_status != categorical_status::OK)
@@ -377,7 +377,7 @@ void util::set_union::append_unique_rows(util::categorical& a,
 
 bool util::set_union::build_row_hash(const util::categorical& a,
                                      const util::categorical& b,
-                                     const std::vector<std::vector<u32>>& a_label_matrix,
+                                     const std::vector<util::label_column>& a_label_matrix,
                                      char* row_hash_ptr,
                                      const util::u64 row,
                                      const std::vector<util::u64>& src_category_indices,
@@ -394,11 +394,11 @@ bool util::set_union::build_row_hash(const util::categorical& a,
         const u64 num_cats = src_category_indices.size();
         for (u64 j = 0; j < num_cats; j++)
         {
-            const std::string& label = a.m_label_ids.ref_at(a_label_matrix[src_category_indices[j]][row]);
-            const auto& it_b = b.m_label_ids.find(label);
+            const std::string& label = a.m_label_ids->ref_at(a_label_matrix[src_category_indices[j]][row]);
+            const auto& it_b = b.m_label_ids->find(label);
             
             //  Okay - use the b's label id to search.
-            if (it_b != b.m_label_ids.endk())
+            if (it_b != b.m_label_ids->endk())
             {
                 const u32 id_b = it_b->second;
                 std::memcpy(row_hash_ptr + dest_category_indices[j] * sizeof(u32), &id_b, sizeof(u32));
@@ -453,7 +453,7 @@ std::vector<std::string> util::set_union::get_uniform_category_labels(const util
         
         if (sz > 0 && is_uniform)
         {
-            const std::string& label = a.m_label_ids.ref_at(a.m_labels[a.m_category_indices.at(cat)][row0]);
+            const std::string& label = a.m_label_ids->ref_at(a.m_labels[a.m_category_indices->at(cat)][row0]);
             result.push_back(label);
         }
         else
@@ -636,12 +636,12 @@ util::categorical util::set_union::set_combination_impl(util::u32* status,
     std::unordered_set<std::string> visited_rows_a;
     std::unordered_set<std::string> visited_rows_b;
     
-    std::vector<std::vector<util::u32>> unique_ids_a = unique_rows_to_combine(visited_rows_a, visited_shared_rows_a,
+    std::vector<util::label_column> unique_ids_a = unique_rows_to_combine(visited_rows_a, visited_shared_rows_a,
                                                                               a.m_labels, cat_inds_union_a,
                                                                               cat_inds_shared_a, cat_inds_final_only_a,
                                                                               mask_a, use_indices, status);
     CAT_CHECK_STATUS_PTR_EARLY_RETURN_CATEGORICAL()
-    std::vector<std::vector<util::u32>> unique_ids_b = unique_rows_to_combine(visited_rows_b, visited_shared_rows_b,
+    std::vector<util::label_column> unique_ids_b = unique_rows_to_combine(visited_rows_b, visited_shared_rows_b,
                                                                               b.m_labels, cat_inds_union_b,
                                                                               cat_inds_shared_b, cat_inds_final_only_b,
                                                                               mask_b, use_indices, status);
@@ -669,7 +669,7 @@ util::categorical util::set_union::set_combination_impl(util::u32* status,
     //  Remap computed union categories to first N-1.
     for (u64 i = 0; i < union_cats_a.size(); i++)
     {
-        result.m_category_indices[union_cats_a[i]] = i;
+        result.m_category_indices.mutate()[union_cats_a[i]] = i;
     }
     
     result.m_labels = std::move(unique_ids_a);
@@ -723,13 +723,13 @@ util::categorical util::set_union::set_combination_impl(util::u32* status,
                     {
                         const VisitedRow& row = it_shared_b->second;
                         const s64 id_b = row.remaining_ids[j];
-                        new_label = id_b == -1 ? uniform_category_labels_b[j] : b.m_label_ids.at(id_b);
+                        new_label = id_b == -1 ? uniform_category_labels_b[j] : b.m_label_ids->at(id_b);
                     }
                     
                     u32 assign_id;
                     const u32 add_status = result.add_label_unchecked_has_category(final_cats_only_b[j], new_label, &assign_id);
                     CAT_CHECK_STATUS_ASSIGN_STATUS_EARLY_RETURN_CATEGORICAL(add_status)
-                    result.m_labels[cat_inds_final_only_b_result[j]][i] = assign_id;
+                    result.m_labels[cat_inds_final_only_b_result[j]].set(i, assign_id);
                 }
             }
         }
@@ -742,8 +742,7 @@ util::categorical util::set_union::set_combination_impl(util::u32* status,
                 const u32 add_status = result.add_label_unchecked_has_category(final_cats_only_b[j], new_label, &assign_id);
                 CAT_CHECK_STATUS_ASSIGN_STATUS_EARLY_RETURN_CATEGORICAL(add_status)
                 
-                std::vector<u32>& id_column = result.m_labels[cat_inds_final_only_b_result[j]];
-                std::fill(id_column.begin(), id_column.end(), assign_id);
+                result.m_labels[cat_inds_final_only_b_result[j]].fill(assign_id);
             }
         }
         
@@ -793,14 +792,14 @@ util::categorical util::set_union::set_combination_impl(util::u32* status,
                     {
                         const VisitedRow& row = it_shared_a->second;
                         const s64 id_a = row.remaining_ids[j];
-                        new_label = id_a == -1 ? uniform_category_labels_a[j] : a.m_label_ids.at(id_a);
+                        new_label = id_a == -1 ? uniform_category_labels_a[j] : a.m_label_ids->at(id_a);
                     }
                     
                     u32 assign_id;
                     const u32 add_status = result.add_label_unchecked_has_category(final_cats_only_a[j], new_label, &assign_id);
                     CAT_CHECK_STATUS_ASSIGN_STATUS_EARLY_RETURN_CATEGORICAL(add_status)
                     
-                    unique_ids_b[original_num_cats_b+j][i] = assign_id;
+                    unique_ids_b[original_num_cats_b+j].set(i, assign_id);
                 }
             }
         }
@@ -813,8 +812,7 @@ util::categorical util::set_union::set_combination_impl(util::u32* status,
                 const u32 add_status = result.add_label_unchecked_has_category(final_cats_only_a[j], new_label, &assign_id);
                 CAT_CHECK_STATUS_ASSIGN_STATUS_EARLY_RETURN_CATEGORICAL(add_status)
                 
-                std::vector<u32>& id_column = unique_ids_b[original_num_cats_b+j];
-                std::fill(id_column.begin(), id_column.end(), assign_id);
+                unique_ids_b[original_num_cats_b+j].fill(assign_id);
             }
         }
     }
@@ -851,7 +849,7 @@ util::categorical util::set_union::set_combination_impl(util::u32* status,
             
             if (!is_only_a[j])
             {
-                const std::string& label = b.m_label_ids.ref_at(id_b);
+                const std::string& label = b.m_label_ids->ref_at(id_b);
                 const u32 add_status = result.add_label_unchecked_has_category(cats_final[j], label, &id_a);
                 CAT_CHECK_STATUS_ASSIGN_STATUS_EARLY_RETURN_CATEGORICAL(add_status)
             }
@@ -8,7 +8,9 @@
 #pragma once
 
 #include "types.hpp"
+#include "label_column.hpp"
 #include <vector>
+#include <string>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -121,15 +123,15 @@ private:
     
     static bool build_row_hash(const util::categorical& a,
                                      const util::categorical& b,
-                                     const std::vector<std::vector<u32>>& a_label_matrix,
+                                     const std::vector<util::label_column>& a_label_matrix,
                                      char* row_hash_ptr,
                                      const util::u64 row,
                                      const std::vector<util::u64>& src_category_indices,
                                      const std::vector<util::u64>& dest_category_indices);
     
-    std::vector<std::vector<util::u32>> unique_rows_to_combine(std::unordered_set<std::string>& visited_complete_rows,
+    std::vector<util::label_column> unique_rows_to_combine(std::unordered_set<std::string>& visited_complete_rows,
                                                                std::unordered_map<std::string, util::VisitedRow>& visited_shared_rows,
-                                                               const std::vector<std::vector<util::u32>>& ids,
+                                                               const std::vector<util::label_column>& ids,
                                                                const std::vector<util::u64>& category_indices,
                                                                const std::vector<util::u64>& shared_category_indices,
                                                                const std::vector<util::u64>& unique_category_indices,
@@ -137,9 +139,9 @@ private:
                                                                const bool use_indices,
                                                                util::u32* status) const;
     
-    static void append_unique_rows_progenitors_match(std::vector<std::vector<util::u32>>& ids_a,
+    static void append_unique_rows_progenitors_match(std::vector<util::label_column>& ids_a,
                                                      std::unordered_map<std::string, util::VisitedRow>& visited_rows_a,
-                                                     const std::vector<std::vector<util::u32>>& ids_b,
+                                                     const std::vector<util::label_column>& ids_b,
                                                      const std::vector<util::u64>& indices,
                                                      const bool use_indices,
                                                      const util::u64 index_offset,
@@ -147,9 +149,9 @@ private:
     
     static void append_unique_rows(util::categorical& a,
                                    const util::categorical& b,
-                                   std::vector<std::vector<util::u32>>& ids_a,
+                                   std::vector<util::label_column>& ids_a,
                                    std::unordered_map<std::string, util::VisitedRow>& visited_rows_a,
-                                   const std::vector<std::vector<util::u32>>& ids_b,
+                                   const std::vector<util::label_column>& ids_b,
                                    const std::vector<std::string>& categories,
                                    const std::vector<util::u64>& category_indices_a,
                                    const std::vector<util::u64>& category_indices_b,
@@ -12,6 +12,8 @@
 namespace util {
     using u64 = std::uint64_t;
     using u32 = std::uint32_t;
+    using u16 = std::uint16_t;
+    using u8 = std::uint8_t;
     
     using s64 = std::int64_t;
     using s32 = std::int32_t;
@@ -1,4 +1,5 @@
 #include "bit_array.hpp"
+#include "compressed_bit_array.hpp"
 #include <iostream>
 #include <assert.h>
 #include <chrono>
@@ -33,6 +34,8 @@ void test_any_all();
 void test_assign_true();
 double test_profile_append(uint32_t sz);
 double test_profile_resize(uint32_t sz);
+void test_compressed_bit_array();
+void test_word_kernels();
 
 int main(int argc, char* argv[])
 {
@@ -51,6 +54,8 @@ int main(int argc, char* argv[])
 //    test_thread2();
     test_keep_multi(1000);
     test_append_multi();
+    test_compressed_bit_array();
+    test_word_kernels();
     
     util::profile::simple(std::bind(test_profile_append, 1e3), "append", 1e3);
     util::profile::simple(std::bind(test_profile_resize, 1e3), "resize", 1e3);
@@ -1084,3 +1089,166 @@ void test_bit_array()
 //    assert(!bit_array::all(barray6));
     
 }
+
+void test_compressed_bit_array()
+{
+    using namespace util;
+    
+    //  sizes spanning partial, single and multiple 2^16 bit chunks.
+    const std::vector<uint32_t> sizes{1, 100, 65536, 65537, 200000};
+    //  densities from sparse (array chunks) to dense (bitmap chunks).
+    const std::vector<uint32_t> densities{1000, 50, 2};
+    
+    auto make_random = [](uint32_t sz, uint32_t density) -> bit_array {
+        bit_array result(sz, false);
+        
+        for (uint32_t i = 0; i < sz; i++)
+        {
+            if (rand() % density == 0)
+            {
+                result.unchecked_place(true, i);
+            }
+        }
+        
+        return result;
+    };
+    
+    for (const auto sz : sizes)
+    {
+        for (const auto density : densities)
+        {
+            bit_array a = make_random(sz, density);
+            bit_array b = make_random(sz, density);
+            
+            //  runs
+            for (uint32_t i = sz / 4; i < sz / 2; i++)
+            {
+                b.unchecked_place(true, i);
+            }
+            
+            compressed_bit_array ca(a);
+            compressed_bit_array cb(b);
+            
+            assert(ca.size() == sz);
+            assert(ca.sum() == a.sum());
+            assert(compressed_bit_array::findv(ca, 1) == bit_array::findv(a, 1));
+            assert(bit_array::findv(ca.to_bit_array()) == bit_array::findv(a));
+            
+            compressed_bit_array cout(sz);
+            bit_array out(sz);
+            
+            compressed_bit_array::dot_or(cout, ca, cb);
+            bit_array::dot_or(out, a, b);
+            assert(compressed_bit_array::findv(cout) == bit_array::findv(out));
+            
+            compressed_bit_array::dot_and(cout, ca, cb);
+            bit_array::dot_and(out, a, b);
+            assert(compressed_bit_array::findv(cout) == bit_array::findv(out));
+            
+            compressed_bit_array::dot_and_not(cout, ca, cb);
+            bit_array::unchecked_dot_and_not(out, a, b, 0, sz);
+            assert(compressed_bit_array::findv(cout) == bit_array::findv(out));
+            
+            ca.flip();
+            a.flip();
+            assert(ca.sum() == a.sum());
+            assert(compressed_bit_array::findv(ca) == bit_array::findv(a));
+            
+            const uint32_t idx = rand() % sz;
+            ca.place(!ca.at(idx), idx);
+            a.place(!a.at(idx), idx);
+            assert(compressed_bit_array::findv(ca) == bit_array::findv(a));
+        }
+        
+        compressed_bit_array full(sz, true);
+        assert(full.sum() == sz);
+        assert(full.all());
+        
+        full.flip();
+        assert(!full.any());
+    }
+    
+    compressed_bit_array empty(0, true);
+    assert(!empty.any() && !empty.all());
+    empty.flip();
+    assert(empty.sum() == 0);
+    
+    const std::vector<uint32_t> sorted{3, 70000, 70001, 140000};
+    compressed_bit_array from_sorted = compressed_bit_array::from_sorted(140001, sorted.begin(), sorted.end());
+    assert(from_sorted.sum() == 4);
+    assert(from_sorted.at(70001) && !from_sorted.at(70002));
+}
+
+void test_word_kernels()
+{
+    using namespace util;
+    
+    //  sizes around the 64-bit word and 256-bit vector boundaries.
+    const std::vector<uint32_t> sizes{0, 1, 63, 64, 65, 127, 128, 255, 256, 257, 1000, 4099};
+    
+    for (const auto sz : sizes)
+    {
+        std::vector<bool> ref_a(sz);
+        std::vector<bool> ref_b(sz);
+        bit_array a(sz, false);
+        bit_array b(sz, false);
+        
+        for (uint32_t i = 0; i < sz; i++)
+        {
+            ref_a[i] = rand() % 3 == 0;
+            ref_b[i] = rand() % 2 == 0;
+            a.place(ref_a[i], i);
+            b.place(ref_b[i], i);
+        }
+        
+        bit_array out_or(sz);
+        bit_array out_and(sz);
+        bit_array out_and_not(sz);
+        bit_array out_xor(sz);
+        bit_array out_eq(sz);
+        
+        bit_array::dot_or(out_or, a, b);
+        bit_array::dot_and(out_and, a, b);
+        bit_array::unchecked_dot_and_not(out_and_not, a, b, 0, sz);
+        bit_array::unchecked_dot_xor(out_xor, a, b, 0, sz);
+        bit_array::unchecked_dot_eq(out_eq, a, b, 0, sz);
+        
+        uint64_t expect_sum = 0;
+        std::vector<uint64_t> expect_find;
+        
+        for (uint32_t i = 0; i < sz; i++)
+        {
+            assert(out_or.at(i) == (ref_a[i] || ref_b[i]));
+            assert(out_and.at(i) == (ref_a[i] && ref_b[i]));
+            assert(out_and_not.at(i) == (ref_a[i] && !ref_b[i]));
+            assert(out_xor.at(i) == (ref_a[i] != ref_b[i]));
+            assert(out_eq.at(i) == (ref_a[i] == ref_b[i]));
+            
+            if (ref_a[i])
+            {
+                expect_sum++;
+                expect_find.push_back(i + 1);
+            }
+        }
+        
+        assert(a.sum() == expect_sum);
+        assert(bit_array::findv(a, 1) == expect_find);
+        
+        //  bits past the end of the array are ignored after flip.
+        bit_array flipped = out_or;
+        flipped.flip();
+        flipped.flip();
+        assert(flipped.sum() == out_or.sum());
+        
+        out_eq.flip();
+        assert(bit_array::findv(out_eq) == bit_array::findv(out_xor));
+        assert(out_eq.sum() == out_xor.sum());
+        
+        bit_array full(sz, true);
+        assert(full.sum() == sz);
+        assert(full.all() == (sz > 0));
+        assert(bit_array::findv(full).size() == sz);
+    }
+    
+    std::cout << "OK: test_word_kernels" << std::endl;
+}
@@ -1,5 +1,12 @@
 #include "categorical.hpp"
+#include "parallel.hpp"
+#include "hashing.hpp"
 #include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
 #include <assert.h>
 
 void test_progenitor_ids();
@@ -13,6 +20,28 @@ void test_find_allc();
 void test_set_category();
 void test_append();
 void test_append_same_labels();
+void test_dense_label_ids();
+void test_label_column_width();
+void test_find_label_index();
+void test_find_blocks();
+void test_find_expr();
+void test_find_batch();
+void test_parallel_scan();
+void test_value_counts();
+void test_find_all_radix();
+void test_find_all_dense_key();
+void test_find_all_groups();
+void test_parallel_find_all();
+void test_row_map();
+void test_find_all_automatic();
+void test_grouping_cache();
+void test_find_all_nested();
+void test_find_allc_ids();
+void test_append_many();
+void test_append_stream();
+void test_append_move();
+void test_copy_on_write();
+void test_merge_new_category();
 
 int main(int argc, char* argv[])
 {
@@ -29,6 +58,28 @@ int main(int argc, char* argv[])
     test_set_category();
     test_require_category();
     test_find_allc();
+    test_dense_label_ids();
+    test_label_column_width();
+    test_find_label_index();
+    test_find_blocks();
+    test_find_expr();
+    test_find_batch();
+    test_parallel_scan();
+    test_value_counts();
+    test_find_all_radix();
+    test_find_all_dense_key();
+    test_find_all_groups();
+    test_parallel_find_all();
+    test_row_map();
+    test_find_all_automatic();
+    test_grouping_cache();
+    test_find_all_nested();
+    test_find_allc_ids();
+    test_append_many();
+    test_append_stream();
+    test_append_move();
+    test_copy_on_write();
+    test_merge_new_category();
     
     std::cout << "END CATEGORICAL" << std::endl;
 
@@ -105,6 +156,24 @@ void test_keep_each()
     assert(res.indices.size() == 2);
     assert(cat1.size() == 2);
     
+    categorical cat2;
+    cat2.require_category("test1");
+    cat2.require_category("test2");
+    cat2.reserve(4);
+    cat2.set_category("test1", {"a", "a", "b", "c"});
+    cat2.set_category("test2", {"x", "y", "z", "z"});
+    
+    util::u32 status;
+    auto kept = cat2.keep_each({"test1"}, {0, 1, 2}, &status);
+    
+    assert(status == util::categorical_status::OK);
+    assert(kept.size() == 2);
+    assert(cat2.size() == 2);
+    assert(cat2.full_category("test1") == std::vector<std::string>({"a", "b"}));
+    assert(cat2.full_category("test2") == std::vector<std::string>({"<test2>", "z"}));
+    assert(!cat2.has_label("c") && !cat2.has_label("x") && !cat2.has_label("y"));
+    assert(cat2.n_labels() == 4);
+    
     std::cout << "OK: test_keep_each" << std::endl;
 }
 
@@ -343,6 +412,59 @@ void test_find_allc()
     std::cout << "OK: test_find_allc" << std::endl;
 }
 
+void test_dense_label_ids()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    auto assert_dense = [](const categorical& cat) {
+        util::labels_t labs = cat.get_labels_and_ids();
+        
+        for (const auto id : labs.ids)
+        {
+            assert(id < labs.ids.size());
+        }
+    };
+    
+    categorical cat1;
+    cat1.require_category("test1");
+    cat1.require_category("test2");
+    cat1.reserve(4);
+    cat1.set_category("test1", {"a", "b", "c", "d"});
+    cat1.set_category("test2", {"e", "f", "e", "f"});
+    cat1.prune();
+    
+    assert(cat1.n_labels() == 6);
+    assert_dense(cat1);
+    
+    //  Releasing labels frees their ids for reuse.
+    cat1.keep({0, 1});
+    cat1.prune();
+    cat1.set_category("test1", {"g", "h"});
+    cat1.prune();
+    
+    assert(cat1.n_labels() == 4);
+    assert_dense(cat1);
+    
+    categorical cat2;
+    cat2.require_category("test1");
+    cat2.require_category("test2");
+    cat2.reserve(2);
+    cat2.set_category("test1", {"x", "g"});
+    cat2.set_category("test2", {"y", "e"});
+    
+    u32 status = cat1.append(cat2);
+    assert(status == util::categorical_status::OK);
+    cat1.prune();
+    assert_dense(cat1);
+    
+    assert(cat1.find({"x", "y"}) == std::vector<u64>{2});
+    assert(cat1.find({"g", "e"}) == (std::vector<u64>{0, 3}));
+    
+    std::cout << "OK: test_dense_label_ids" << std::endl;
+}
+
 void test_require_category()
 {
     using util::u32;
@@ -368,3 +490,1688 @@ void test_instantiation()
 {
 	util::categorical cats;
 }
+
+void test_label_column_width()
+{
+    using util::categorical;
+    using util::label_column;
+    using util::u64;
+    using util::u32;
+    
+    label_column col(3, 2);
+    assert(col.width() == 1);
+    
+    col.set(1, 300);
+    assert(col.width() == 2);
+    assert(col[0] == 2 && col[1] == 300 && col[2] == 2);
+    
+    col.push_back(70000);
+    assert(col.width() == 4);
+    assert(col.to_vector() == (std::vector<u32>{2, 300, 2, 70000}));
+    
+    col.resize(3);
+    col.narrow();
+    assert(col.width() == 2);
+    assert(col == label_column(std::vector<u32>{2, 300, 2}));
+    
+    //  Categories with more than 256 labels are widened transparently.
+    const u64 n_labs = 400;
+    std::vector<std::string> labs(n_labs);
+    
+    for (u64 i = 0; i < n_labs; i++)
+    {
+        labs[i] = "lab" + std::to_string(i);
+    }
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", labs);
+    cat.fill_category("test2", "a");
+    
+    assert(cat.size() == n_labs);
+    assert(cat.find({"lab399"}) == std::vector<u64>{399});
+    assert(cat.find({"lab5", "a"}) == std::vector<u64>{5});
+    assert(cat.count("a") == n_labs);
+    assert(cat.find_all({"test1", "test2"}).size() == n_labs);
+    
+    categorical copy = cat;
+    cat.repeat(1);
+    cat.keep({0, 1, 2, 3, 399});
+    cat.prune();
+    
+    assert(cat.size() == 5);
+    assert(cat.full_category("test1") == (std::vector<std::string>{"lab0", "lab1", "lab2", "lab3", "lab399"}));
+    
+    u32 status = copy.append(cat);
+    assert(status == util::categorical_status::OK);
+    assert(copy.find({"lab399"}) == (std::vector<u64>{399, 404}));
+    
+    std::cout << "OK: test_label_column_width" << std::endl;
+}
+
+void test_find_label_index()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", {"a", "b", "a", "c", "b", "a"});
+    cat.set_category("test2", {"x", "x", "y", "y", "x", "z"});
+    
+    assert(cat.find({"a"}) == (std::vector<u64>{0, 2, 5}));
+    assert(cat.find({"a", "b", "x"}) == (std::vector<u64>{0, 1, 4}));
+    assert(cat.find({"a", "a"}, 1) == (std::vector<u64>{1, 3, 6}));
+    assert(cat.find_not({"a", "x"}) == (std::vector<u64>{1, 2, 3, 4, 5}));
+    assert(cat.find_or({"c", "z"}) == (std::vector<u64>{3, 5}));
+    assert(cat.find_none({"c", "z"}) == (std::vector<u64>{0, 1, 2, 4}));
+    assert(cat.count("x") == 3);
+    
+    u32 status;
+    assert(cat.find({"a"}, {6, 1, 3, 1}, &status, 1) == (std::vector<u64>{1, 3, 6}));
+    assert(status == util::categorical_status::OK);
+    assert(cat.find_not({"a"}, {6, 1, 2}, &status, 1) == (std::vector<u64>{2}));
+    assert(cat.find_none({"q"}, {4, 2}, &status) == (std::vector<u64>{2, 4}));
+    
+    cat.find({"a"}, {6}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    //  The index is rebuilt after mutation.
+    cat.set_category("test1", {"c"}, {0});
+    assert(cat.find({"a"}) == (std::vector<u64>{2, 5}));
+    assert(cat.count("c") == 2);
+    
+    categorical other = cat;
+    cat.append(other);
+    assert(cat.find({"c", "x"}) == (std::vector<u64>{0, 6}));
+    
+    cat.keep({3, 4, 5});
+    assert(cat.find({"a"}) == (std::vector<u64>{2}));
+    assert(cat.count("y") == 1);
+    
+    //  Queries of rare labels are answered from the index once it is built.
+    categorical sparse;
+    sparse.require_category("test1");
+    sparse.require_category("test2");
+    
+    std::vector<std::string> sparse1(640, "a");
+    std::vector<std::string> sparse2(640, "x");
+    sparse1[3] = "r";
+    sparse1[10] = "s";
+    sparse1[600] = "r";
+    sparse2[10] = "q";
+    sparse2[600] = "q";
+    
+    sparse.set_category("test1", sparse1);
+    sparse.set_category("test2", sparse2);
+    
+    for (u64 i = 0; i < 3; i++)
+    {
+        assert(sparse.find({"r"}) == (std::vector<u64>{3, 600}));
+        assert(sparse.find({"r", "s", "r"}) == (std::vector<u64>{3, 10, 600}));
+        assert(sparse.find({"r", "s", "q"}) == (std::vector<u64>{10, 600}));
+        assert(sparse.find({"r", "q"}, {600, 4, 601, 600}, &status, 1) == (std::vector<u64>{601}));
+        assert(sparse.find_or({"s", "q", "r"}) == (std::vector<u64>{3, 10, 600}));
+        assert(sparse.find_not({"r", "x"}, {3, 4, 600}, &status) == (std::vector<u64>{4, 600}));
+        assert(sparse.find_none({"q", "r"}).size() == 637);
+        assert(sparse.find_none({"q", "r"})[3] == 4);
+        assert(sparse.count("q") == 2);
+    }
+    
+    //  Concurrent queries of an unindexed object build its index once.
+    const u64 n_rows = 100000;
+    std::vector<std::string> col1(n_rows, "a");
+    std::vector<std::string> col2(n_rows, "x");
+    
+    for (u64 i = 0; i < n_rows; i += 3)
+    {
+        col1[i] = "b";
+        col2[i] = "y";
+    }
+    
+    categorical unindexed;
+    unindexed.require_category("test1");
+    unindexed.require_category("test2");
+    unindexed.set_category("test1", col1);
+    unindexed.set_category("test2", col2);
+    
+    const categorical& shared = unindexed;
+    const u64 n_b = (n_rows + 2) / 3;
+    std::vector<std::thread> threads;
+    std::atomic<bool> start{false};
+    
+    for (u64 i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&]() {
+            while (!start.load())
+            {
+                std::this_thread::yield();
+            }
+            
+            for (u64 j = 0; j < 4; j++)
+            {
+                assert(shared.find({"b", "y"}).size() == n_b);
+                assert(shared.find({"a", "y"}).empty());
+                assert(shared.find_or({"b", "x"}).size() == n_rows);
+                assert(shared.count("a") == n_rows - n_b);
+                
+                categorical copy = shared;
+                assert(copy.find({"x"}).size() == n_rows - n_b);
+            }
+        });
+    }
+    
+    start.store(true);
+    
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    
+    std::cout << "OK: test_find_label_index" << std::endl;
+}
+
+void test_find_blocks()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const u64 sz = 200;
+    const std::vector<std::string> labs1{"a", "b", "c"};
+    
+    std::vector<std::string> col1;
+    std::vector<std::string> col2;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        col1.push_back(labs1[i % 3]);
+        col2.push_back(i % 7 == 0 ? "y" : "x");
+    }
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", col1);
+    cat.set_category("test2", col2);
+    
+    std::vector<u64> expect_and;
+    std::vector<u64> expect_or;
+    std::vector<u64> expect_not;
+    std::vector<u64> indices;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        const bool in1 = i % 3 != 2;
+        const bool in2 = i % 7 == 0;
+        
+        if (in1 && in2)
+        {
+            expect_and.push_back(i);
+        }
+        
+        if (i % 3 == 2 || in2)
+        {
+            expect_or.push_back(i);
+        }
+        
+        if (i % 5 == 0)
+        {
+            indices.push_back(i);
+            
+            if (!(in1 && in2))
+            {
+                expect_not.push_back(i);
+            }
+        }
+    }
+    
+    assert(cat.find({"a", "b", "y"}) == expect_and);
+    assert(cat.find_or({"c", "y", "q"}) == expect_or);
+    
+    u32 status;
+    assert(cat.find_not({"b", "y", "a"}, indices, &status) == expect_not);
+    assert(status == util::categorical_status::OK);
+    
+    std::cout << "OK: test_find_blocks" << std::endl;
+}
+
+void test_find_expr()
+{
+    using util::categorical;
+    using util::query_expr;
+    using util::u64;
+    using util::u32;
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", {"a", "b", "a", "c", "b", "a"});
+    cat.set_category("test2", {"x", "x", "y", "y", "x", "z"});
+    
+    assert(cat.find_expr(query_expr::label("a")) == cat.find({"a"}));
+    assert(cat.find_expr(query_expr::find({"a", "b", "x"})) == cat.find({"a", "b", "x"}));
+    assert(cat.find_expr(query_expr::find({"a", "q"})).empty());
+    assert(cat.find_expr(query_expr::find_or({"c", "z", "q"})) == cat.find_or({"c", "z"}));
+    assert(cat.find_expr(query_expr::negate(query_expr::find({"a", "x"}))) == cat.find_not({"a", "x"}));
+    
+    //  (a | c) & !x
+    auto expr = query_expr::all_of({
+        query_expr::find_or({"a", "c"}),
+        query_expr::negate(query_expr::label("x"))
+    });
+    
+    assert(cat.find_expr(expr) == (std::vector<u64>{2, 3, 5}));
+    assert(cat.find_expr(expr, 1) == (std::vector<u64>{3, 4, 6}));
+    
+    //  labels outside of the category are ignored.
+    auto in_cat = query_expr::in_category("test2", {"y", "a", "z"});
+    assert(cat.find_expr(in_cat) == (std::vector<u64>{2, 3, 5}));
+    assert(cat.find_expr(query_expr::in_category("test3", {"y"})).empty());
+    
+    assert(cat.find_expr(query_expr::any_of({in_cat, query_expr::label("b")})) == (std::vector<u64>{1, 2, 3, 4, 5}));
+    assert(cat.find_expr(query_expr::all_of({})).size() == cat.size());
+    assert(cat.find_expr(query_expr::any_of({})).empty());
+    
+    u32 status;
+    assert(cat.find_expr(expr, {5, 0, 3, 3}, &status) == (std::vector<u64>{3, 5}));
+    assert(status == util::categorical_status::OK);
+    
+    cat.find_expr(expr, {6}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    //  a chain of find calls, each searching the rows of the last, is a conjunction.
+    const std::vector<u64> mask{5, 1, 0, 3, 1};
+    auto chained = cat.find_none({"c", "q"}, cat.find_not({"b", "y"}, cat.find({"x", "z"}, mask, &status), &status), &status);
+    auto chain_expr = query_expr::all_of({
+        query_expr::find({"x", "z"}),
+        query_expr::negate(query_expr::find({"b", "y"})),
+        query_expr::negate(query_expr::find_or({"c", "q"}))
+    });
+    
+    assert(cat.find_expr(chain_expr, mask, &status) == chained);
+    assert(chained == (std::vector<u64>{0, 1, 5}));
+    
+    std::cout << "OK: test_find_expr" << std::endl;
+}
+
+void test_find_batch()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const u64 sz = 150;
+    const std::vector<std::string> labs1{"a", "b", "c", "d"};
+    const std::vector<std::string> labs2{"x", "y", "z"};
+    
+    std::vector<std::string> col1;
+    std::vector<std::string> col2;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        col1.push_back(labs1[rand() % labs1.size()]);
+        col2.push_back(labs2[rand() % labs2.size()]);
+    }
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", col1);
+    cat.set_category("test2", col2);
+    
+    const std::vector<std::vector<std::string>> queries{
+        {"a"}, {"a", "b"}, {"a", "x"}, {"b", "c", "y", "z"}, {"a", "q"}, {}, {"x", "x"}, {"d", "z", "c"}
+    };
+    
+    const auto result = cat.find_batch(queries);
+    assert(result.size() == queries.size());
+    
+    for (u64 i = 0; i < queries.size(); i++)
+    {
+        assert(result[i] == cat.find(queries[i]));
+        assert(cat.find_batch({queries[i]}, 1)[0] == cat.find(queries[i], 1));
+    }
+    
+    std::vector<u64> indices{149, 3, 64, 63, 3, 100, 0};
+    u32 status;
+    
+    const auto sub_result = cat.find_batch(queries, indices, &status);
+    assert(status == util::categorical_status::OK);
+    
+    for (u64 i = 0; i < queries.size(); i++)
+    {
+        u32 find_status;
+        assert(sub_result[i] == cat.find(queries[i], indices, &find_status));
+    }
+    
+    cat.find_batch(queries, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    std::cout << "OK: test_find_batch" << std::endl;
+}
+
+void test_parallel_scan()
+{
+    using util::categorical;
+    using util::query_expr;
+    using util::u64;
+    using util::u32;
+    
+    //  spans several chunks, with a partial final chunk.
+    const u64 sz = 3 * CAT_PARALLEL_CHUNK_ROWS + 100;
+    const std::vector<std::string> labs1{"a", "b", "c", "d"};
+    const std::vector<std::string> labs2{"x", "y", "z"};
+    
+    std::vector<std::string> col1(sz);
+    std::vector<std::string> col2(sz);
+    std::vector<u64> indices;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        col1[i] = labs1[rand() % labs1.size()];
+        col2[i] = labs2[rand() % labs2.size()];
+        
+        if (rand() % 3 == 0)
+        {
+            indices.push_back(i);
+        }
+    }
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", col1);
+    cat.set_category("test2", col2);
+    
+    const std::vector<std::vector<std::string>> queries{{"a"}, {"a", "b", "z"}, {"d", "q"}, {}};
+    const auto expr = query_expr::all_of({query_expr::label("c"), query_expr::negate(query_expr::label("y"))});
+    
+    auto run_queries = [&]() {
+        std::vector<std::vector<u64>> result;
+        u32 status;
+        
+        for (const auto& query : queries)
+        {
+            result.push_back(cat.find(query));
+            result.push_back(cat.find_not(query, 1));
+            result.push_back(cat.find_or(query, indices, &status));
+            result.push_back(cat.find_none(query));
+            result.push_back(std::vector<u64>{cat.count(query.empty() ? "" : query[0])});
+        }
+        
+        result.push_back(cat.find_expr(expr));
+        result.push_back(cat.find_expr(expr, indices, &status));
+        
+        return result;
+    };
+    
+    assert(!util::parallel::applies(sz));
+    const auto serial = run_queries();
+    
+    util::parallel_options options;
+    options.enabled = true;
+    options.n_threads = 4;
+    options.min_rows = 1;
+    util::parallel::set_options(options);
+    
+    assert(util::parallel::applies(sz));
+    assert(util::parallel::n_chunks(sz) == 4);
+    assert(run_queries() == serial);
+    
+    //  An exception thrown in a chunk is rethrown on the calling thread, and
+    //  the worker threads remain usable.
+    bool caught = false;
+    
+    try
+    {
+        util::parallel::for_each_chunk(sz, util::parallel::n_chunks(sz), [](u64 chunk, u64, u64) {
+            if (chunk == 2)
+            {
+                throw std::runtime_error("chunk failed");
+            }
+        });
+    }
+    catch (const std::runtime_error& err)
+    {
+        caught = std::string(err.what()) == "chunk failed";
+    }
+    
+    assert(caught);
+    assert(run_queries() == serial);
+    
+    util::parallel::set_options(util::parallel_options());
+    
+    std::cout << "OK: test_parallel_scan" << std::endl;
+}
+
+void test_value_counts()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const u64 sz = 200;
+    const std::vector<std::string> labs1{"a", "b", "c", "d"};
+    const std::vector<std::string> labs2{"x", "y", "z"};
+    
+    std::vector<std::string> col1;
+    std::vector<std::string> col2;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        col1.push_back(labs1[rand() % labs1.size()]);
+        col2.push_back(labs2[rand() % labs2.size()]);
+    }
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", col1);
+    cat.set_category("test2", col2);
+    
+    bool exists;
+    auto counts = cat.value_counts("test1", &exists);
+    assert(exists);
+    assert(counts.labels.size() == counts.counts.size());
+    assert(counts.labels[0] == col1[0]);
+    
+    u64 total = 0;
+    
+    for (u64 i = 0; i < counts.labels.size(); i++)
+    {
+        assert(counts.counts[i] == cat.count(counts.labels[i]));
+        total += counts.counts[i];
+    }
+    
+    assert(total == sz);
+    
+    cat.value_counts("test3", &exists);
+    assert(!exists);
+    
+    const std::vector<std::string> cats{"test1", "test2"};
+    const auto combs = cat.find_allc(cats);
+    const auto comb_counts = cat.combination_counts(cats);
+    
+    assert(comb_counts.combinations == combs.combinations);
+    assert(comb_counts.counts.size() == combs.indices.size());
+    
+    for (u64 i = 0; i < combs.indices.size(); i++)
+    {
+        assert(comb_counts.counts[i] == combs.indices[i].size());
+    }
+    
+    std::vector<u64> indices{199, 3, 64, 3, 0};
+    u32 status;
+    
+    counts = cat.value_counts("test2", indices, &status);
+    assert(status == util::categorical_status::OK);
+    assert(counts.labels[0] == col2[199]);
+    
+    for (u64 i = 0; i < counts.labels.size(); i++)
+    {
+        assert(counts.counts[i] == cat.count(counts.labels[i], indices, &status));
+    }
+    
+    const auto sub_combs = cat.find_allc(cats, indices, &status);
+    const auto sub_comb_counts = cat.combination_counts(cats, indices, &status);
+    assert(status == util::categorical_status::OK);
+    assert(sub_comb_counts.combinations == sub_combs.combinations);
+    
+    for (u64 i = 0; i < sub_combs.indices.size(); i++)
+    {
+        assert(sub_comb_counts.counts[i] == sub_combs.indices[i].size());
+    }
+    
+    cat.value_counts("test1", {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    cat.combination_counts(cats, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    std::cout << "OK: test_value_counts" << std::endl;
+}
+
+void test_find_all_radix()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const auto radix = categorical::find_all_method::radix;
+    const auto sort = categorical::find_all_method::sort;
+    
+    const u64 sz = 500;
+    //  enough categories that label ids span several 64-bit keys.
+    const u64 n_cats = 24;
+    
+    categorical cat;
+    std::vector<std::string> categories;
+    
+    for (u64 i = 0; i < n_cats; i++)
+    {
+        const std::string category = "test" + std::to_string(i);
+        std::vector<std::string> col;
+        
+        for (u64 j = 0; j < sz; j++)
+        {
+            col.push_back(category + "_" + std::to_string(rand() % (i % 3 == 0 ? 300 : 3)));
+        }
+        
+        cat.require_category(category);
+        cat.set_category(category, col);
+        categories.push_back(category);
+    }
+    
+    std::vector<u64> indices{499, 3, 64, 3, 0, 250, 251};
+    u32 status;
+    
+    //  the sort method does not preserve row order within a group of one category.
+    auto sorted_groups = [](std::vector<std::vector<u64>> groups) {
+        for (auto& group : groups)
+        {
+            std::sort(group.begin(), group.end());
+        }
+        return groups;
+    };
+    
+    for (u64 i = 1; i <= n_cats; i += 5)
+    {
+        const std::vector<std::string> cats(categories.begin(), categories.begin() + i);
+        
+        const auto radix_all = cat.find_all(radix, cats);
+        assert(radix_all == sorted_groups(cat.find_all(sort, cats)));
+        assert(radix_all == sorted_groups(radix_all));
+        assert(cat.find_all(radix, cats, 1) == sorted_groups(cat.find_all(sort, cats, 1)));
+        
+        const auto radix_sub = cat.find_all(radix, cats, indices, &status);
+        assert(status == util::categorical_status::OK);
+        assert(sorted_groups(radix_sub) == sorted_groups(cat.find_all(sort, cats, indices, &status)));
+    }
+    
+    assert(cat.find_all(radix, {"test0", "test25"}).empty());
+    
+    cat.find_all(radix, categories, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    std::cout << "OK: test_find_all_radix" << std::endl;
+}
+
+void test_find_all_dense_key()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const auto dense_key = categorical::find_all_method::dense_key;
+    const auto hash = categorical::find_all_method::hash;
+    
+    const u64 sz = 1000;
+    const std::vector<std::string> categories{"test1", "test2", "test3"};
+    const std::vector<u64> n_labels{5, 1, 40};
+    
+    categorical cat;
+    
+    for (u64 i = 0; i < categories.size(); i++)
+    {
+        std::vector<std::string> col;
+        
+        for (u64 j = 0; j < sz; j++)
+        {
+            col.push_back(categories[i] + "_" + std::to_string(rand() % n_labels[i]));
+        }
+        
+        cat.require_category(categories[i]);
+        cat.set_category(categories[i], col);
+    }
+    
+    std::vector<u64> indices{999, 3, 64, 3, 0, 500, 501};
+    u32 status;
+    
+    const std::vector<std::vector<std::string>> groupings{
+        {"test1"}, {"test2"}, {"test1", "test3"}, {"test3", "test2", "test1"}, {"test1", "test1"}
+    };
+    
+    for (const auto& cats : groupings)
+    {
+        const auto result = cat.find_all(dense_key, cats);
+        assert(result == cat.find_all(hash, cats));
+        assert(cat.find_all(cats, 1) == cat.find_all(hash, cats, 1));
+        
+        const auto sub_result = cat.find_all(dense_key, cats, indices, &status);
+        assert(status == util::categorical_status::OK);
+        assert(sub_result == cat.find_all(hash, cats, indices, &status));
+    }
+    
+    assert(cat.find_all(dense_key, {"test1", "test4"}).empty());
+    
+    cat.find_all(dense_key, categories, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    std::cout << "OK: test_find_all_dense_key" << std::endl;
+}
+
+void test_find_all_groups()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const u64 sz = 300;
+    const std::vector<std::string> labs1{"a", "b", "c", "d"};
+    const std::vector<std::string> labs2{"x", "y", "z"};
+    
+    std::vector<std::string> col1;
+    std::vector<std::string> col2;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        col1.push_back(labs1[rand() % labs1.size()]);
+        col2.push_back(labs2[rand() % labs2.size()]);
+    }
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", col1);
+    cat.set_category("test2", col2);
+    
+    const std::vector<std::string> cats{"test1", "test2"};
+    const std::vector<u64> indices{299, 3, 64, 3, 0, 150};
+    
+    auto check_groups = [](const util::groups_t& groups, const std::vector<std::vector<u64>>& expect) {
+        assert(groups.offsets.size() == expect.size() + 1);
+        assert(groups.offsets[0] == 0);
+        
+        for (u64 i = 0; i < expect.size(); i++)
+        {
+            const std::vector<u64> group(groups.indices.begin() + groups.offsets[i],
+                                         groups.indices.begin() + groups.offsets[i+1]);
+            assert(group == expect[i]);
+        }
+    };
+    
+    const std::vector<categorical::find_all_method> methods{
+        categorical::find_all_method::hash,
+        categorical::find_all_method::sort,
+        categorical::find_all_method::custom_hash,
+        categorical::find_all_method::radix,
+        categorical::find_all_method::dense_key
+    };
+    
+    u32 status;
+    
+    for (const auto method : methods)
+    {
+        const auto groups = cat.find_all_groups(method, cats, 1, util::with_group_ids::yes);
+        check_groups(groups, cat.find_all(method, cats, 1));
+        assert(groups.group_ids.size() == sz);
+        
+        for (u64 i = 0; i < sz; i++)
+        {
+            const u64 group = groups.group_ids[i];
+            assert(group + 1 < groups.offsets.size());
+            assert(col1[i] == col1[groups.indices[groups.offsets[group]] - 1]);
+            assert(col2[i] == col2[groups.indices[groups.offsets[group]] - 1]);
+        }
+        
+        const auto sub_groups = cat.find_all_groups(method, cats, indices, &status);
+        assert(status == util::categorical_status::OK);
+        assert(sub_groups.group_ids.empty());
+        check_groups(sub_groups, cat.find_all(method, cats, indices, &status));
+    }
+    
+    check_groups(cat.find_all_groups(cats), cat.find_all(cats));
+    check_groups(cat.find_all_groups({"test1", "test3"}), {});
+    
+    cat.find_all_groups(cats, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    const auto combs = cat.find_allc(cats, indices, &status);
+    const auto comb_groups = cat.find_allc_groups(cats, indices, &status);
+    assert(comb_groups.combinations == combs.combinations);
+    check_groups(comb_groups, combs.indices);
+    
+    categorical cat2 = cat;
+    const auto kept = cat.keep_each(cats, indices, &status);
+    const auto kept_groups = cat2.keep_each_groups(cats, indices, &status);
+    assert(status == util::categorical_status::OK);
+    check_groups(kept_groups, kept);
+    assert(cat == cat2);
+    
+    std::cout << "OK: test_find_all_groups" << std::endl;
+}
+
+void test_parallel_find_all()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    //  spans several chunks, with a partial final chunk.
+    const u64 sz = 3 * CAT_PARALLEL_CHUNK_ROWS + 100;
+    const std::vector<std::string> labs1{"a", "b", "c", "d"};
+    
+    std::vector<std::string> col1(sz);
+    std::vector<std::string> col2(sz);
+    std::vector<u64> indices;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        col1[i] = labs1[rand() % labs1.size()];
+        col2[i] = "x" + std::to_string(rand() % 5000);
+        
+        if (rand() % 3 == 0)
+        {
+            indices.push_back(sz - i - 1);
+        }
+    }
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    cat.set_category("test1", col1);
+    cat.set_category("test2", col2);
+    
+    const std::vector<std::vector<std::string>> groupings{{"test1"}, {"test2", "test1"}};
+    const std::vector<categorical::find_all_method> methods{
+        categorical::find_all_method::hash,
+        categorical::find_all_method::sort,
+        categorical::find_all_method::custom_hash,
+        categorical::find_all_method::radix,
+        categorical::find_all_method::dense_key
+    };
+    
+    //  the sort method does not preserve row order within a group of one category.
+    auto sorted_groups = [](std::vector<std::vector<u64>> groups) {
+        for (auto& group : groups)
+        {
+            std::sort(group.begin(), group.end());
+        }
+        return groups;
+    };
+    
+    auto run_find_all = [&]() {
+        std::vector<std::vector<std::vector<u64>>> result;
+        u32 status;
+        
+        for (const auto& cats : groupings)
+        {
+            for (const auto method : methods)
+            {
+                result.push_back(sorted_groups(cat.find_all(method, cats, 1)));
+                result.push_back(sorted_groups(cat.find_all(method, cats, indices, &status)));
+                result.push_back({cat.find_all_groups(method, cats, 0, util::with_group_ids::yes).group_ids});
+            }
+            
+            result.push_back(cat.find_all(cats));
+        }
+        
+        return result;
+    };
+    
+    const auto serial = run_find_all();
+    
+    util::parallel_options options;
+    options.enabled = true;
+    options.n_threads = 4;
+    options.min_rows = 1;
+    util::parallel::set_options(options);
+    
+    assert(util::parallel::applies(sz));
+    assert(run_find_all() == serial);
+    
+    util::parallel::set_options(util::parallel_options());
+    
+    std::cout << "OK: test_parallel_find_all" << std::endl;
+}
+
+void test_row_map()
+{
+    using util::u64;
+    using util::u32;
+    
+    const u64 n_columns = 3;
+    const u64 n_rows = 20000;
+    
+    util::IntegralTypeRowMap<u32, u64> row_map(n_columns);
+    
+    auto make_row = [](u64 i) {
+        return std::vector<u32>{u32(i % 7), u32(i), u32(i / 3)};
+    };
+    
+    for (u64 i = 0; i < n_rows; i++)
+    {
+        const auto row = make_row(i);
+        const auto result = row_map.find(row.data());
+        
+        assert(result.value == nullptr);
+        row_map.insert(result, row.data(), i);
+    }
+    
+    assert(row_map.size() == n_rows);
+    assert(row_map.max_probe_length() < 64);
+    
+    for (u64 i = 0; i < n_rows; i++)
+    {
+        const auto row = make_row(i);
+        const auto result = row_map.find(row.data());
+        
+        assert(result.value != nullptr && *result.value == i);
+    }
+    
+    const std::vector<u32> missing{1, 2, 3};
+    assert(row_map.find(missing.data()).value == nullptr);
+    
+    util::IntegralTypeRowMap<u32, u64> reserved(n_columns);
+    reserved.reserve(n_rows);
+    reserved.max_load_factor(0.75f);
+    
+    for (u64 i = 0; i < n_rows; i++)
+    {
+        const auto row = make_row(i);
+        reserved.insert(reserved.find(row.data()), row.data(), i);
+    }
+    
+    assert(reserved.size() == n_rows);
+    assert(*reserved.find(make_row(n_rows - 1).data()).value == n_rows - 1);
+    
+    std::cout << "OK: test_row_map" << std::endl;
+}
+
+void test_find_all_automatic()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const auto automatic = categorical::find_all_method::automatic;
+    const auto hash = categorical::find_all_method::hash;
+    
+    //  enough rows and labels that the key space of all three categories is
+    //  too large for the dense_key method, and radix sort is chosen.
+    const u64 sz = CAT_AUTO_RADIX_MIN_ROWS * 2;
+    const std::vector<std::string> categories{"test1", "test2", "test3"};
+    const std::vector<u64> n_labels{3, 200, 1000};
+    
+    categorical cat;
+    
+    for (u64 i = 0; i < categories.size(); i++)
+    {
+        std::vector<std::string> col;
+        
+        for (u64 j = 0; j < sz; j++)
+        {
+            col.push_back(categories[i] + "_" + std::to_string(rand() % n_labels[i]));
+        }
+        
+        cat.require_category(categories[i]);
+        cat.set_category(categories[i], col);
+    }
+    
+    std::vector<u64> indices;
+    
+    for (u64 i = 0; i < sz; i += 2)
+    {
+        indices.push_back(sz - i - 1);
+    }
+    
+    u32 status;
+    
+    const std::vector<std::vector<std::string>> groupings{
+        {"test1"}, {"test1", "test2"}, {"test3", "test2"}, {"test1", "test2", "test3"}
+    };
+    
+    for (const auto& cats : groupings)
+    {
+        assert(cat.find_all(automatic, cats) == cat.find_all(hash, cats));
+        assert(cat.find_all(cats, 1) == cat.find_all(hash, cats, 1));
+        
+        const auto sub_result = cat.find_all(automatic, cats, indices, &status);
+        assert(status == util::categorical_status::OK);
+        assert(sub_result == cat.find_all(hash, cats, indices, &status));
+        
+        const auto groups = cat.find_all_groups(automatic, cats, 0, util::with_group_ids::yes);
+        const auto expect = cat.find_all_groups(hash, cats, 0, util::with_group_ids::yes);
+        
+        assert(groups.indices == expect.indices);
+        assert(groups.offsets == expect.offsets);
+        assert(groups.group_ids == expect.group_ids);
+    }
+    
+    assert(cat.find_all(automatic, {"test1", "test4"}).empty());
+    
+    cat.find_all(automatic, categories, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    std::cout << "OK: test_find_all_automatic" << std::endl;
+}
+
+void test_grouping_cache()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const auto hash = categorical::find_all_method::hash;
+    const u64 sz = 500;
+    
+    categorical cat;
+    cat.require_category("test1");
+    cat.require_category("test2");
+    
+    std::vector<std::string> col1;
+    std::vector<std::string> col2;
+    
+    for (u64 i = 0; i < sz; i++)
+    {
+        col1.push_back("a" + std::to_string(rand() % 5));
+        col2.push_back("b" + std::to_string(rand() % 7));
+    }
+    
+    cat.set_category("test1", col1);
+    cat.set_category("test2", col2);
+    
+    const std::vector<std::string> cats{"test1", "test2"};
+    const std::vector<u64> indices{10, 3, 400, 3, 0};
+    u32 status;
+    
+    categorical uncached = cat;
+    uncached.set_grouping_cache_capacity(0, 0);
+    
+    //  repeat queries are answered from the cache, and do not modify the object.
+    const u64 version = cat.version();
+    const auto result = cat.find_all(cats);
+    
+    assert(cat.find_all(cats) == result);
+    assert(cat.find_all(hash, cats) == uncached.find_all(hash, cats));
+    assert(cat.find_all(cats, indices, &status) == uncached.find_all(cats, indices, &status));
+    assert(cat.find_all(cats, indices, &status, 1) == uncached.find_all(cats, indices, &status, 1));
+    assert(cat.find_allc(cats).combinations == uncached.find_allc(cats).combinations);
+    assert(cat.find_allc({"test2", "test1"}).combinations == uncached.find_allc({"test2", "test1"}).combinations);
+    assert(cat.version() == version);
+    
+    cat.find_all(cats, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    //  copies share a version until either is modified.
+    categorical copy = cat;
+    assert(copy.version() == cat.version());
+    
+    copy.set_category("test1", {"a9"}, {0});
+    assert(copy.version() != cat.version());
+    assert(copy.find_all(cats) != result);
+    assert(cat.find_all(cats) == result);
+    
+    //  results reflect modifications.
+    cat.replace_labels("a0", "a1");
+    uncached.replace_labels("a0", "a1");
+    assert(cat.version() != version);
+    assert(cat.find_all(cats) == uncached.find_all(cats));
+    assert(cat.find_allc(cats).combinations == uncached.find_allc(cats).combinations);
+    
+    cat.keep_each({"test1"});
+    uncached.keep_each({"test1"});
+    assert(cat.find_allc(cats).combinations == uncached.find_allc(cats).combinations);
+    
+    //  least recently used entries are evicted beyond the capacity.
+    util::grouping_cache cache(2, 1024);
+    auto value = std::make_shared<const util::groups_t>();
+    
+    cache.insert({{1}, {}}, 0, value, 0);
+    cache.insert({{2}, {}}, 0, value, 0);
+    assert(cache.find({{1}, {}}, 0) == value);
+    
+    auto indexed_key = [](const std::vector<util::u64>& query, const std::vector<util::u64>& indices) {
+        util::grouping_cache::key k;
+        k.query = query;
+        k.set_indices(indices);
+        return k;
+    };
+    
+    const std::vector<util::u64> inds_56{5, 6};
+    const std::vector<util::u64> inds_65{6, 5};
+    const std::vector<util::u64> inds_5{5};
+    
+    cache.insert(indexed_key({3}, inds_56), 0, value, 0);
+    assert(cache.size() == 2);
+    assert(cache.find({{2}, {}}, 0) == nullptr);
+    assert(cache.find({{1}, {}}, 0) == value);
+    assert(cache.find(indexed_key({3}, std::vector<util::u64>{5, 6}), 0) == value);
+    assert(cache.find(indexed_key({3}, inds_5), 0) == nullptr);
+    assert(cache.find(indexed_key({3}, inds_65), 0) == nullptr);
+    
+    cache.insert({{4}, {}}, 0, value, 2048);
+    assert(cache.find({{4}, {}}, 0) == nullptr);
+    
+    cache.insert({{4}, {}}, 0, value, 800);
+    assert(cache.size() == 1);
+    assert(cache.bytes() <= cache.max_bytes());
+    
+    assert(cache.find({{4}, {}}, 1) == nullptr);
+    assert(cache.size() == 0);
+    
+    cache.set_capacity(0, 1024);
+    cache.insert({{1}, {}}, 1, value, 0);
+    assert(!cache.enabled() && cache.size() == 0);
+    
+    std::cout << "OK: test_grouping_cache" << std::endl;
+}
+
+void test_find_all_nested()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const u64 sz = 400;
+    const std::vector<std::string> categories{"test1", "test2", "test3"};
+    const std::vector<u64> n_labels{3, 4, 5};
+    
+    categorical cat;
+    
+    for (u64 i = 0; i < categories.size(); i++)
+    {
+        std::vector<std::string> col;
+        
+        for (u64 j = 0; j < sz; j++)
+        {
+            col.push_back(categories[i] + "_" + std::to_string(rand() % n_labels[i]));
+        }
+        
+        cat.require_category(categories[i]);
+        cat.set_category(categories[i], col);
+    }
+    
+    auto group_at = [](const util::nested_groups_t& nested, u64 level, u64 i) {
+        const auto begin = nested.indices.begin();
+        return std::vector<u64>(begin + nested.offsets[level][i], begin + nested.offsets[level][i+1]);
+    };
+    
+    auto check = [&](const util::nested_groups_t& nested,
+                     const std::vector<std::vector<std::string>>& levels,
+                     const std::vector<u64>& indices,
+                     u64 index_offset) {
+        std::vector<std::string> prefix;
+        u32 status;
+        
+        assert(nested.offsets.size() == levels.size());
+        assert(nested.indices.size() == indices.size());
+        
+        for (u64 k = 0; k < levels.size(); k++)
+        {
+            prefix.insert(prefix.end(), levels[k].begin(), levels[k].end());
+            
+            //  each level holds the groups of find_all over its categories and
+            //  those of the levels above.
+            auto expect = cat.find_all(prefix, indices, &status, index_offset);
+            const u64 n_groups = nested.offsets[k].size() - 1;
+            
+            assert(status == util::categorical_status::OK);
+            assert(n_groups == expect.size());
+            assert(nested.offsets[k].back() == indices.size());
+            assert(nested.combinations[k].size() == n_groups * levels[k].size());
+            
+            std::vector<std::vector<u64>> groups;
+            
+            for (u64 i = 0; i < n_groups; i++)
+            {
+                groups.push_back(group_at(nested, k, i));
+                
+                for (u64 j = 0; j < levels[k].size(); j++)
+                {
+                    const auto labs = cat.partial_category(levels[k][j], groups.back(), &status, index_offset);
+                    
+                    for (const auto& lab : labs)
+                    {
+                        assert(lab == nested.combinations[k][i * levels[k].size() + j]);
+                    }
+                }
+                
+                if (k == 0)
+                {
+                    continue;
+                }
+                
+                //  subgroups are contiguous, and lie within their parent.
+                const u64 parent = nested.parents[k][i];
+                assert(i == 0 || nested.parents[k][i-1] <= parent);
+                assert(nested.offsets[k][i] >= nested.offsets[k-1][parent]);
+                assert(nested.offsets[k][i+1] <= nested.offsets[k-1][parent+1]);
+            }
+            
+            //  rows of a group are ordered by subgroup.
+            for (auto& group : groups)
+            {
+                std::sort(group.begin(), group.end());
+            }
+            
+            for (auto& group : expect)
+            {
+                std::sort(group.begin(), group.end());
+            }
+            
+            std::sort(groups.begin(), groups.end());
+            std::sort(expect.begin(), expect.end());
+            assert(groups == expect);
+        }
+        
+        assert(nested.parents[0].empty());
+        
+        //  the top level is in order of first appearance.
+        const auto top = cat.find_all(levels[0], indices, &status, index_offset);
+        
+        for (u64 i = 0; i < top.size(); i++)
+        {
+            auto group = group_at(nested, 0, i);
+            auto expect = top[i];
+            
+            std::sort(group.begin(), group.end());
+            std::sort(expect.begin(), expect.end());
+            assert(group == expect);
+        }
+    };
+    
+    std::vector<u64> all_indices(sz);
+    std::iota(all_indices.begin(), all_indices.end(), u64(0));
+    
+    const std::vector<u64> indices{399, 3, 64, 3, 1, 200, 201, 150, 64};
+    u32 status;
+    
+    const std::vector<std::vector<std::vector<std::string>>> level_sets{
+        {{"test1"}},
+        {{"test1"}, {"test2"}},
+        {{"test2", "test3"}, {"test1"}},
+        {{"test3"}, {"test1"}, {"test2"}},
+        {{"test1"}, {}, {"test3"}}
+    };
+    
+    for (const auto& levels : level_sets)
+    {
+        check(cat.find_all_nested(levels), levels, all_indices, 0);
+        
+        const auto nested = cat.find_all_nested(levels, indices, &status, 1);
+        assert(status == util::categorical_status::OK);
+        check(nested, levels, indices, 1);
+    }
+    
+    assert(cat.find_all_nested({}).indices.empty());
+    assert(cat.find_all_nested({{"test1"}, {"test4"}}).offsets.empty());
+    
+    cat.find_all_nested({{"test1"}}, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    std::cout << "OK: test_find_all_nested" << std::endl;
+}
+
+void test_find_allc_ids()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    const u64 sz = 300;
+    const std::vector<std::string> categories{"test1", "test2", "test3"};
+    
+    categorical cat;
+    
+    for (u64 i = 0; i < categories.size(); i++)
+    {
+        std::vector<std::string> col;
+        
+        for (u64 j = 0; j < sz; j++)
+        {
+            col.push_back(categories[i] + "_" + std::to_string(rand() % (i + 3)));
+        }
+        
+        cat.require_category(categories[i]);
+        cat.set_category(categories[i], col);
+    }
+    
+    auto check = [](const util::combination_ids_t& ids, const util::combinations_t& expect, u64 n_cats) {
+        const u64 n_groups = expect.indices.size();
+        
+        assert(ids.offsets.size() == n_groups + 1);
+        assert(ids.ids.size() == n_groups * n_cats);
+        assert(std::is_sorted(ids.labels.ids.begin(), ids.labels.ids.end()));
+        
+        for (u64 i = 0; i < n_groups; i++)
+        {
+            const auto begin = ids.indices.begin();
+            assert(std::vector<u64>(begin + ids.offsets[i], begin + ids.offsets[i+1]) == expect.indices[i]);
+            
+            for (u64 j = 0; j < n_cats; j++)
+            {
+                const u32 id = ids.ids[j * n_groups + i];
+                const auto it = std::lower_bound(ids.labels.ids.begin(), ids.labels.ids.end(), id);
+                
+                assert(it != ids.labels.ids.end() && *it == id);
+                assert(ids.labels.labels[it - ids.labels.ids.begin()] == expect.combinations[i * n_cats + j]);
+            }
+        }
+    };
+    
+    const std::vector<u64> indices{299, 3, 64, 3, 1, 200, 201, 150, 64};
+    u32 status;
+    
+    check(cat.find_allc_ids(categories), cat.find_allc(categories), categories.size());
+    check(cat.find_allc_ids({"test2"}, 1), cat.find_allc({"test2"}, 1), 1);
+    
+    const auto ids = cat.find_allc_ids({"test3", "test1"}, indices, &status, 1);
+    assert(status == util::categorical_status::OK);
+    check(ids, cat.find_allc({"test3", "test1"}, indices, &status, 1), 2);
+    
+    assert(cat.find_allc_ids({"test1", "test4"}).ids.empty());
+    assert(cat.find_allc_ids({}).labels.ids.empty());
+    
+    cat.find_allc_ids({"test1"}, {sz}, &status);
+    assert(status == util::categorical_status::OUT_OF_BOUNDS);
+    
+    std::cout << "OK: test_find_allc_ids" << std::endl;
+}
+
+void test_append_many()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    auto make = [](u64 rows, u64 session) {
+        categorical cat;
+        cat.require_category("session");
+        cat.require_category("trial");
+        cat.require_category("roi");
+        
+        std::vector<std::string> sessions(rows, "session_" + std::to_string(session));
+        std::vector<std::string> trials;
+        std::vector<std::string> rois;
+        
+        for (u64 i = 0; i < rows; i++)
+        {
+            trials.push_back("trial_" + std::to_string(rand() % 300));
+            rois.push_back("roi_" + std::to_string((i + session) % 3));
+        }
+        
+        cat.set_category("session", sessions);
+        cat.set_category("trial", trials);
+        cat.set_category("roi", rois);
+        
+        return cat;
+    };
+    
+    std::vector<categorical> sessions;
+    
+    for (u64 i = 0; i < 20; i++)
+    {
+        sessions.push_back(make(i % 4 == 0 ? 0 : 50 + i, i));
+    }
+    
+    sessions.push_back(sessions[3]);
+    
+    std::vector<const categorical*> others;
+    
+    for (const auto& session : sessions)
+    {
+        others.push_back(&session);
+    }
+    
+    for (const bool start_empty : {true, false})
+    {
+        categorical expect = start_empty ? categorical() : make(10, 100);
+        categorical result = expect;
+        
+        for (const auto* other : others)
+        {
+            assert(expect.append(*other) == util::categorical_status::OK);
+        }
+        
+        assert(result.append_many(others) == util::categorical_status::OK);
+        assert(result == expect);
+        assert(result.n_labels() == expect.n_labels());
+        assert(result.full_category("trial") == expect.full_category("trial"));
+        
+        const u64 sz = result.size();
+        const auto trials = result.full_category("trial");
+        
+        assert(result.append_many({&result, &sessions[1], &result}) == util::categorical_status::OK);
+        assert(result.size() == sz * 3 + sessions[1].size());
+        
+        const auto appended = result.full_category("trial");
+        assert(std::equal(trials.begin(), trials.end(), appended.begin() + sz * 2 + sessions[1].size()));
+    }
+    
+    categorical result = make(10, 100);
+    const categorical orig = result;
+    
+    categorical wrong_cats = make(10, 101);
+    wrong_cats.require_category("other");
+    
+    assert(result.append_many({&sessions[1], &wrong_cats}) == util::categorical_status::CATEGORIES_DO_NOT_MATCH);
+    assert(result == orig);
+    
+    categorical wrong_label = make(10, 102);
+    wrong_label.replace_labels("roi_0", "session_1");
+    
+    assert(result.append_many({&sessions[1], &wrong_label}) == util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY);
+    assert(result == orig);
+    assert(!result.has_label("session_1"));
+    
+    std::cout << "OK: test_append_many" << std::endl;
+}
+
+void test_append_stream()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    categorical cat;
+    cat.require_category("batch");
+    cat.require_category("trial");
+    
+    std::vector<std::string> expect_trials;
+    
+    for (u64 i = 0; i < 300; i++)
+    {
+        categorical batch;
+        batch.require_category("batch");
+        batch.require_category("trial");
+        
+        std::vector<std::string> trials;
+        
+        for (u64 j = 0; j < 7; j++)
+        {
+            trials.push_back("trial_" + std::to_string((i * 7 + j) % 500));
+        }
+        
+        batch.set_category("trial", trials);
+        batch.fill_category("batch", "batch_" + std::to_string(i % 10));
+        
+        u32 status = i % 2 == 0 ? cat.append(batch) : cat.append_one(batch);
+        assert(status == util::categorical_status::OK);
+        
+        if (i % 2 == 0)
+        {
+            expect_trials.insert(expect_trials.end(), trials.begin(), trials.end());
+        }
+        else
+        {
+            expect_trials.push_back("<trial>");
+        }
+    }
+    
+    assert(cat.size() == expect_trials.size());
+    assert(cat.full_category("trial") == expect_trials);
+    
+    auto trial_labels = cat.in_category("trial");
+    std::sort(trial_labels.begin(), trial_labels.end());
+    std::sort(expect_trials.begin(), expect_trials.end());
+    expect_trials.erase(std::unique(expect_trials.begin(), expect_trials.end()), expect_trials.end());
+    assert(trial_labels == expect_trials);
+    assert(cat.in_category("batch").size() == 10);
+    
+    categorical wrong_cat;
+    wrong_cat.require_category("batch");
+    wrong_cat.require_category("trial");
+    wrong_cat.set_category("batch", {"trial_0"});
+    
+    const categorical before = cat;
+    
+    assert(cat.append(wrong_cat) == util::categorical_status::LABEL_EXISTS_IN_OTHER_CATEGORY);
+    assert(cat == before && cat.n_labels() == before.n_labels());
+    
+    const u64 version = cat.version();
+    cat.compact();
+    
+    assert(cat == before);
+    assert(cat.version() == version);
+    
+    for (const auto* col : cat.get_label_mat())
+    {
+        assert(col->capacity() == col->size());
+    }
+    
+    std::cout << "OK: test_append_stream" << std::endl;
+}
+
+void test_append_move()
+{
+    using util::categorical;
+    using util::u64;
+    using util::u32;
+    
+    auto make_part = [](u64 i) -> categorical {
+        categorical part;
+        part.require_category("trial");
+        part.require_category("day");
+        part.set_category("trial", {"trial_" + std::to_string(i), "trial_" + std::to_string(i + 1)});
+        part.fill_category("day", "day_" + std::to_string(i % 3));
+        return part;
+    };
+    
+    categorical copied;
+    categorical moved;
+    
+    for (u64 i = 0; i < 20; i++)
+    {
+        categorical part = make_part(i);
+        
+        assert(copied.append(part) == util::categorical_status::OK);
+        assert(moved.append(std::move(part)) == util::categorical_status::OK);
+    }
+    
+    assert(moved == copied);
+    
+    //  an empty object takes the source's storage, leaving the source empty.
+    categorical source = make_part(0);
+    const categorical source_copy = source;
+    categorical empty;
+    
+    assert(empty.append(std::move(source)) == util::categorical_status::OK);
+    assert(empty == source_copy);
+    assert(source.size() == 0 && source.n_categories() == 0);
+    
+    //  indexed.
+    source = source_copy;
+    categorical indexed;
+    assert(indexed.append(std::move(source), {1}) == util::categorical_status::OK);
+    assert(indexed.size() == 1 && indexed.full_category("trial")[0] == "trial_1");
+    
+    source = source_copy;
+    categorical out_of_bounds;
+    assert(out_of_bounds.append(std::move(source), {2}) == util::categorical_status::OUT_OF_BOUNDS);
+    assert(out_of_bounds.size() == 0 && source == source_copy);
+    
+    //  merge takes the columns of `other`.
+    categorical merge_copied = copied;
+    categorical merge_moved = copied;
+    categorical to_merge;
+    to_merge.require_category("session");
+    to_merge.require_category("day");
+    std::vector<std::string> sessions;
+    
+    for (u64 i = 0; i < copied.size(); i++)
+    {
+        sessions.push_back("session_" + std::to_string(i % 4));
+    }
+    
+    to_merge.set_category("session", sessions);
+    to_merge.fill_category("day", "day_10");
+    
+    assert(merge_copied.merge(to_merge) == util::categorical_status::OK);
+    assert(merge_moved.merge(std::move(to_merge)) == util::categorical_status::OK);
+    assert(merge_moved == merge_copied);
+    assert(to_merge.size() == 0);
+    
+    //  a scalar is expanded, so it is left unchanged.
+    categorical scalar = make_part(0);
+    scalar.keep({0});
+    const categorical scalar_copy = scalar;
+    
+    merge_moved = copied;
+    assert(merge_moved.merge_new(std::move(scalar)) == util::categorical_status::OK);
+    assert(scalar == scalar_copy);
+    
+    //  assign replacing every row of an object derived from `this`.
+    categorical assign_to = copied;
+    categorical assign_from = copied;
+    std::vector<std::string> days(copied.size(), "day_1");
+    assign_from.set_category("day", days);
+    const categorical assign_from_copy = assign_from;
+    
+    std::vector<u64> all_rows(copied.size());
+    std::iota(all_rows.begin(), all_rows.end(), u64(0));
+    
+    assert(assign_to.assign(std::move(assign_from), all_rows) == util::categorical_status::OK);
+    assert(assign_to == assign_from_copy);
+    assert(assign_from.size() == 0);
+    
+    //  partial assignment copies.
+    assign_to = copied;
+    assign_from = assign_from_copy;
+    assign_from.keep({0});
+    const categorical partial_copy = assign_from;
+    
+    assert(assign_to.assign(std::move(assign_from), {5}) == util::categorical_status::OK);
+    assert(assign_from == partial_copy);
+    assert(assign_to.full_category("day")[5] == "day_1");
+    
+    std::cout << "OK: test_append_move" << std::endl;
+}
+
+void test_copy_on_write()
+{
+    using util::categorical;
+    using util::u64;
+    
+    categorical cat;
+    cat.require_category("trial");
+    cat.require_category("day");
+    
+    std::vector<std::string> trials;
+    
+    for (u64 i = 0; i < 1000; i++)
+    {
+        trials.push_back("trial_" + std::to_string(i % 300));
+    }
+    
+    cat.set_category("trial", trials);
+    cat.fill_category("day", "day_0");
+    
+    const categorical original = cat;
+    categorical copy = cat;
+    
+    auto cols = cat.get_label_mat();
+    auto copy_cols = copy.get_label_mat();
+    
+    for (u64 i = 0; i < cols.size(); i++)
+    {
+        assert(cols[i]->shares_ids_with(*copy_cols[i]));
+    }
+    
+    //  modifying one category of the copy clones only that column.
+    copy.fill_category("day", "day_1");
+    
+    const u64 trial_idx = cat.get_categories()[0] == "trial" ? 0 : 1;
+    copy_cols = copy.get_label_mat();
+    
+    assert(cols[trial_idx]->shares_ids_with(*copy_cols[trial_idx]));
+    assert(!cols[1 - trial_idx]->shares_ids_with(*copy_cols[1 - trial_idx]));
+    assert(cat == original);
+    assert(copy.full_category("day") == std::vector<std::string>(1000, "day_1"));
+    assert(copy.has_label("day_1") && !cat.has_label("day_1"));
+    
+    //  modifying the source leaves the copy unchanged.
+    const categorical before = copy;
+    copy = cat;
+    cat.keep({0, 1, 2});
+    cat.replace_labels("trial_0", "trial_x");
+    
+    assert(cat.size() == 3 && cat.has_label("trial_x"));
+    assert(copy == original && copy.size() == 1000 && copy.has_label("trial_0"));
+    assert(before != original);
+    
+    //  a copy still compares equal after a round trip through modification.
+    categorical round_trip = original;
+    assert(round_trip.add_label("trial", "trial_y") == util::categorical_status::OK);
+    round_trip.prune();
+    assert(round_trip == original);
+    
+    //  pruning renumbers ids only in the columns that hold them; other columns
+    //  stay shared.
+    categorical narrowed = original;
+    narrowed.prune();
+    round_trip = narrowed;
+    round_trip.fill_category("day", "day_1");
+    round_trip.prune();
+    
+    const auto narrowed_cols = narrowed.get_label_mat();
+    const auto round_trip_cols = round_trip.get_label_mat();
+    
+    assert(narrowed_cols[trial_idx]->shares_ids_with(*round_trip_cols[trial_idx]));
+    assert(round_trip.full_category("day") == std::vector<std::string>(1000, "day_1"));
+    
+    std::cout << "OK: test_copy_on_write" << std::endl;
+}
+
+void test_merge_new_category()
+{
+    using util::categorical;
+    using util::u64;
+    
+    auto check_labels = [](const categorical& cat) -> void {
+        const auto labels = cat.get_labels();
+        assert(labels.size() == cat.n_labels());
+        
+        for (const auto& cat_name : cat.get_categories())
+        {
+            for (const auto& lab : cat.full_category(cat_name))
+            {
+                assert(cat.has_label(lab));
+                assert(std::find(labels.begin(), labels.end(), lab) != labels.end());
+            }
+        }
+    };
+    
+    for (u64 use_merge_new = 0; use_merge_new < 2; use_merge_new++)
+    {
+        categorical a;
+        a.require_category("x");
+        a.set_category("x", {"x0", "x1"});
+        
+        categorical b;
+        b.require_category("y");
+        b.set_category("y", {"y0", "y1"});
+        
+        auto status = use_merge_new ? a.merge_new(b) : a.merge(b);
+        assert(status == util::categorical_status::OK);
+        
+        assert(a.full_category("y") == std::vector<std::string>({"y0", "y1"}));
+        assert(!a.has_label("<y>"));
+        check_labels(a);
+        
+        //  a scalar whose new category holds its collapsed expression.
+        categorical c;
+        c.require_category("z");
+        c.require_category("w");
+        c.set_category("w", {"w0"});
+        
+        status = use_merge_new ? a.merge_new(c) : a.merge(c);
+        assert(status == util::categorical_status::OK);
+        
+        assert(a.full_category("z") == std::vector<std::string>({"<z>", "<z>"}));
+        assert(a.full_category("w") == std::vector<std::string>({"w0", "w0"}));
+        check_labels(a);
+        
+        //  ids handed out afterwards are not already in use.
+        assert(a.add_label("x", "x2") == util::categorical_status::OK);
+        assert(a.append(a) == util::categorical_status::OK);
+        assert(a.size() == 4);
+        check_labels(a);
+    }
+    
+    std::cout << "OK: test_merge_new_category" << std::endl;
+}